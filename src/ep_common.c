@@ -80,9 +80,11 @@
  */
 
 /* Thread ID database - Contains short names for all EP threads */
+#define TIDDB_SIZE (EP_TP_MAX_WORKER_THREADS_NUM + 4) /* workers, DSP, EXT */
+
 typedef struct tid_db_s {
-    pthread_t tid[EP_TP_WORKER_THREADS_NUM+2];
-    char tid_s[EP_TP_WORKER_THREADS_NUM+2][4];
+    pthread_t tid[TIDDB_SIZE];
+    char tid_s[TIDDB_SIZE][4];
     int num;
     pthread_rwlock_t lock;
 } tid_db_t;
@@ -612,7 +614,18 @@ void tiddb_add(char *name)
 
     pthread_rwlock_wrlock(&(g_ep_handle.g_tid_db.lock));
 
-    curr_db_num = g_ep_handle.g_tid_db.num;
+    /* Reuse entry of the exited thread if any */
+    for (curr_db_num = 0; curr_db_num < g_ep_handle.g_tid_db.num; curr_db_num++)
+    {
+        if (g_ep_handle.g_tid_db.tid_s[curr_db_num][0] == '\0')
+            break;
+    }
+
+    if (curr_db_num >= TIDDB_SIZE)
+    {
+        pthread_rwlock_unlock(&(g_ep_handle.g_tid_db.lock));
+        return;
+    }
 
     g_ep_handle.g_tid_db.tid[curr_db_num] = pthread_self();
 
@@ -624,32 +637,35 @@ void tiddb_add(char *name)
         sprintf(g_ep_handle.g_tid_db.tid_s[curr_db_num], "w%02d", worker_thread_id++);
     }
 
-    g_ep_handle.g_tid_db.num++;
+    if (curr_db_num == g_ep_handle.g_tid_db.num)
+        g_ep_handle.g_tid_db.num++;
 
     pthread_rwlock_unlock(&(g_ep_handle.g_tid_db.lock));
 }
 
-const char *tiddb_get(void)
+void tiddb_del(void)
 {
     int i;
     pthread_t pself = pthread_self();
 
-    pthread_rwlock_rdlock(&(g_ep_handle.g_tid_db.lock));
+    pthread_rwlock_wrlock(&(g_ep_handle.g_tid_db.lock));
 
     for (i = 0; i < g_ep_handle.g_tid_db.num; i++)
     {
         if (g_ep_handle.g_tid_db.tid[i] == pself)
         {
-            pthread_rwlock_unlock(&(g_ep_handle.g_tid_db.lock));
-            return g_ep_handle.g_tid_db.tid_s[i];
+            /* Entries are not moved, so names returned by tiddb_get
+               to other threads stay valid */
+            memset((char *)&(g_ep_handle.g_tid_db.tid[i]), 0, sizeof(pthread_t));
+            g_ep_handle.g_tid_db.tid_s[i][0] = '\0';
+            break;
         }
     }
 
     pthread_rwlock_unlock(&(g_ep_handle.g_tid_db.lock));
-    return "???";
 }
 
-int tiddb_get_w_num(void)
+const char *tiddb_get(void)
 {
     int i;
     pthread_t pself = pthread_self();
@@ -661,12 +677,12 @@ int tiddb_get_w_num(void)
         if (g_ep_handle.g_tid_db.tid[i] == pself)
         {
             pthread_rwlock_unlock(&(g_ep_handle.g_tid_db.lock));
-            return i++;
+            return g_ep_handle.g_tid_db.tid_s[i];
         }
     }
 
     pthread_rwlock_unlock(&(g_ep_handle.g_tid_db.lock));
-    return 0xFF;
+    return "???";
 }
 
 /* Function returns Entry-point hold status and reason   */
@@ -1028,3 +1044,19 @@ ep_stat_t ep_common_get_beinfo_by_bename (char * beName, backend_info_t *beInfo)
 
     return status;
 }
+
+unsigned int ep_hash_str(unsigned int h, const char *str)
+{
+    while (*str)
+        h = (h ^ (unsigned char)*str++) * 16777619u;
+
+    return h;
+}
+
+long ep_time_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
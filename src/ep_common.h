@@ -487,18 +487,18 @@ char *get_config_path(char *buf, size_t buf_len);
  */
 void tiddb_add(char *name);
 
+/*       tiddb_del
+ * Removes the calling thread from the thread ID database (called by
+ * worker threads that exit when the thread pool shrinks)
+ */
+void tiddb_del(void);
+
 
 /*      tiddb_get
  *  Returns thread name (from thread ID db) of the calling thread.
  */
 const char *tiddb_get(void);
 
-/*      tiddb_get_w_num
- *  Returns thread index +1 (from thread ID db) of the calling thread.
- *  This number is used as a "worker number" (from 1 to EP_TP_WORKER_THREADS_NUM)
- */
-int tiddb_get_w_num(void);
-
 
 /*    ep_common_get_hold_status
  * Returns current EP's hold status (true - EP is hold, false - otherwise)
@@ -567,6 +567,20 @@ char * objdepclass2string(int objdepclass);
  */
 int ep_common_get_objdep_info(obj_dependency_info_t **objdep_info);
 
+/* Initial value of ep_hash_str hash */
+#define EP_HASH_INIT  2166136261u
+
+/*   ep_hash_str
+ *  Continues FNV-1a hash "h" over the string; a new hash starts
+ *   with EP_HASH_INIT
+ */
+unsigned int ep_hash_str(unsigned int h, const char *str);
+
+/*   ep_time_ms
+ *  Returns time of the monotonic clock in milliseconds
+ */
+long ep_time_ms(void);
+
 #ifdef USE_SYSLOG
 static inline void ep_openlog() { ing_openlog(); }
 static inline void ep_closelog() { ing_closelog(); }
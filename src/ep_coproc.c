@@ -0,0 +1,441 @@
+/* ep_coproc.c
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+
+
+/*
+ * Script helper coprocesses
+ */
+
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+#include "ep_coproc.h"
+#include "ep_exec.h"
+
+#define EP_COPROC_MAX_NUM       64
+#define EP_COPROC_RBUF_SIZE     4096
+#define EP_COPROC_CMD_LOG_LEN   128    /* beginning of the command in the log */
+
+extern char **environ;
+
+typedef struct ep_coproc_s {
+    pid_t pid;                    /* 0 - not started */
+    int fd;                       /* EP end of the socket pair */
+    BOOL busy;
+    BOOL timedout;                /* the call is not completed in the timeout */
+    size_t rpos;
+    size_t rlen;
+    char rbuf[EP_COPROC_RBUF_SIZE];
+} ep_coproc_t;
+
+static pthread_once_t g_cp_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t g_cp_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cp_free;     /* waits by CLOCK_MONOTONIC */
+static const char *g_cp_helper;
+static int g_cp_num;
+static ep_coproc_t g_cp[EP_COPROC_MAX_NUM];
+static ep_coproc_stats_t g_cp_stats;
+
+static void ep_coproc_init(void)
+{
+    pthread_condattr_t attr;
+    char *str;
+
+    if ((str = EP_SCRIPT_HELPER) == NULL || strlen(str) == 0)
+        return;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_cp_free, &attr);
+    pthread_condattr_destroy(&attr);
+
+    g_cp_num = EP_SCRIPT_HELPER_DEF_NUM;
+    if ((str = EP_SCRIPT_HELPER_NUM) != NULL && atoi(str) > 0)
+        g_cp_num = (atoi(str) > EP_COPROC_MAX_NUM) ? EP_COPROC_MAX_NUM : atoi(str);
+
+    g_cp_stats.num = g_cp_num;
+    g_cp_helper = EP_SCRIPT_HELPER;
+
+    INFO("Script helper: %s, up to %d coprocesses", g_cp_helper, g_cp_num);
+}
+
+BOOL ep_coproc_enabled(void)
+{
+    pthread_once(&g_cp_once, ep_coproc_init);
+    return g_cp_helper ? TRUE : FALSE;
+}
+
+/* Takes a free helper, waits until the deadline if all helpers are
+   busy (NULL - no helper became free); the started helpers are preferred */
+static ep_coproc_t *ep_coproc_acquire(long deadline)
+{
+    ep_coproc_t *cp = NULL;
+    struct timespec ts;
+    BOOL timedout = FALSE;
+    int i;
+
+    ts.tv_sec = deadline / 1000;
+    ts.tv_nsec = (deadline % 1000) * 1000000;
+
+    pthread_mutex_lock(&g_cp_lock);
+    while (TRUE)
+    {
+        for (i = 0; i < g_cp_num; i++)
+        {
+            if (g_cp[i].busy)
+                continue;
+            if (!cp || (g_cp[i].pid && !cp->pid))
+                cp = &g_cp[i];
+        }
+        if (cp || timedout)
+            break;
+        if (pthread_cond_timedwait(&g_cp_free, &g_cp_lock, &ts) == ETIMEDOUT)
+            timedout = TRUE;
+    }
+
+    if (cp)
+    {
+        cp->busy = TRUE;
+        cp->timedout = FALSE;
+        g_cp_stats.calls++;
+    }
+    else
+        g_cp_stats.timeouts++;
+    pthread_mutex_unlock(&g_cp_lock);
+
+    return cp;
+}
+
+static void ep_coproc_release(ep_coproc_t *cp)
+{
+    pthread_mutex_lock(&g_cp_lock);
+    cp->busy = FALSE;
+    pthread_cond_signal(&g_cp_free);
+    pthread_mutex_unlock(&g_cp_lock);
+}
+
+/* Kills the helper with its process group (the programs it started) */
+static void ep_coproc_stop(ep_coproc_t *cp)
+{
+    close(cp->fd);
+    kill(-cp->pid, SIGKILL);
+    waitpid(cp->pid, NULL, 0);
+    cp->pid = 0;
+    cp->fd = -1;
+}
+
+/* Starts the helper with its stdin and stdout connected to a socket pair
+   (not a pipe - a write to the exited helper must not raise SIGPIPE) */
+static ep_stat_t ep_coproc_start(ep_coproc_t *cp)
+{
+    posix_spawn_file_actions_t fa;
+    posix_spawnattr_t attr;
+    char *argv[] = {"sh", "-c", (char *)g_cp_helper, NULL};
+    int sv[2], res;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0)
+    {
+        ERROR("Could not create socket pair for script helper: %s", strerror(errno));
+        return EPS_SYSTEM_ERROR;
+    }
+
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_adddup2(&fa, sv[1], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&fa, sv[1], STDOUT_FILENO);
+
+    /* Own process group: the helper is killed with its children */
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, 0);
+
+    res = posix_spawn(&cp->pid, "/bin/sh", &fa, &attr, argv, environ);
+    posix_spawn_file_actions_destroy(&fa);
+    posix_spawnattr_destroy(&attr);
+    close(sv[1]);
+
+    if (res != 0)
+    {
+        ERROR("Could not start script helper %s: %s", g_cp_helper, strerror(res));
+        close(sv[0]);
+        cp->pid = 0;
+        return EPS_SYSTEM_ERROR;
+    }
+
+    cp->fd = sv[0];
+    cp->rpos = cp->rlen = 0;
+
+    pthread_mutex_lock(&g_cp_lock);
+    g_cp_stats.spawns++;
+    pthread_mutex_unlock(&g_cp_lock);
+
+    DBG("Script helper %d is started", (int)cp->pid);
+    return EPS_OK;
+}
+
+/* Waits for the events on the helper socket until the deadline */
+static ep_stat_t ep_coproc_wait(ep_coproc_t *cp, short events, long deadline)
+{
+    struct pollfd pfd;
+    long left;
+    int res;
+
+    pfd.fd = cp->fd;
+    pfd.events = events;
+
+    do
+    {
+        if ((left = deadline - ep_time_ms()) < 0)
+            left = 0;
+        res = poll(&pfd, 1, (int)left);
+    }
+    while (res < 0 && errno == EINTR);
+
+    if (res == 0)
+    {
+        cp->timedout = TRUE;
+        return EPS_TIMEOUT;
+    }
+
+    return (res < 0) ? EPS_SYSTEM_ERROR : EPS_OK;
+}
+
+/* EPS_NOTHING_DONE - no byte of the data was sent */
+static ep_stat_t ep_coproc_send(ep_coproc_t *cp, const char *data, size_t len, long deadline)
+{
+    ep_stat_t status = EPS_NOTHING_DONE;
+    ssize_t n;
+
+    while (len > 0)
+    {
+        if (ep_coproc_wait(cp, POLLOUT, deadline) != EPS_OK)
+            return status;
+
+        n = send(cp->fd, data, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN))
+            continue;
+        if (n <= 0)
+            return status;
+        data += n;
+        len -= n;
+        status = EPS_SYSTEM_ERROR;
+    }
+
+    return EPS_OK;
+}
+
+/* Reads up to len bytes of the response (at least one) */
+static ssize_t ep_coproc_recv(ep_coproc_t *cp, char *data, size_t len, long deadline)
+{
+    ssize_t n;
+
+    if (cp->rpos == cp->rlen)
+    {
+        do
+        {
+            if (ep_coproc_wait(cp, POLLIN, deadline) != EPS_OK)
+                return -1;
+            n = recv(cp->fd, cp->rbuf, sizeof(cp->rbuf), MSG_DONTWAIT);
+        }
+        while (n < 0 && (errno == EINTR || errno == EAGAIN));
+
+        if (n <= 0)
+            return -1;
+        cp->rpos = 0;
+        cp->rlen = n;
+    }
+
+    if (len > cp->rlen - cp->rpos)
+        len = cp->rlen - cp->rpos;
+    memcpy(data, cp->rbuf + cp->rpos, len);
+    cp->rpos += len;
+
+    return len;
+}
+
+ep_stat_t ep_coproc_run(const char *cmd, int flags, char *out, size_t out_size, int *res_code)
+{
+    ep_stat_t status = EPS_OK;
+    ep_coproc_t *cp;
+    char hdr[64], skip[256], cmd_log[EP_COPROC_CMD_LOG_LEN];
+    char *nl;
+    unsigned long len, done = 0;
+    size_t cmd_len = strlen(cmd), i = 0;
+    ssize_t n;
+    long timeout = ep_exec_default_timeout();
+    long deadline = ep_time_ms() + timeout;
+    int rc;
+
+    if (!ep_coproc_enabled() || out_size == 0)
+        return EPS_NOT_IMPLEMENTED;
+
+    /* cmd is overwritten by the output if out is its buffer */
+    strcpy_safe(cmd_log, cmd, sizeof(cmd_log));
+
+    if ((cp = ep_coproc_acquire(deadline)) == NULL)
+    {
+        ERROR("No script helper is free in %ld ms", timeout);
+        return EPS_TIMEOUT;
+    }
+
+    if (!cp->pid && ep_coproc_start(cp) != EPS_OK)
+    {
+        status = EPS_NOTHING_DONE;
+        goto ret;
+    }
+
+    /* The command is sent before the output is written to its buffer. It
+       is not delivered if no byte of it was sent (e.g. the helper exited) */
+    snprintf(hdr, sizeof(hdr), "%lu\n", (unsigned long)cmd_len);
+    if ((status = ep_coproc_send(cp, hdr, strlen(hdr), deadline)) != EPS_OK)
+        status = EPS_NOTHING_DONE;
+    else
+        status = ep_coproc_send(cp, cmd, cmd_len, deadline);
+    if (status != EPS_OK)
+        GOTO_RET_WITH_ERROR(status, "Could not send command to script helper");
+
+    /* Response header */
+    while (TRUE)
+    {
+        if (i == sizeof(hdr) - 1 || ep_coproc_recv(cp, &hdr[i], 1, deadline) != 1)
+            GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not read script helper response");
+        if (hdr[i] == '\n')
+            break;
+        i++;
+    }
+    hdr[i] = '\0';
+
+    if (sscanf(hdr, "%d %lu", &rc, &len) != 2)
+        GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Invalid script helper response: %s", hdr);
+
+    /* Output; the part that does not fit the buffer is skipped */
+    while (done < len)
+    {
+        if (done < out_size - 1)
+            n = ep_coproc_recv(cp, out + done, (len < out_size - 1 ? len : out_size - 1) - done,
+                               deadline);
+        else
+            n = ep_coproc_recv(cp, skip, (len - done < sizeof(skip)) ? len - done : sizeof(skip),
+                               deadline);
+
+        if (n <= 0)
+            GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not read script helper output");
+        done += n;
+    }
+
+    done = (len < out_size - 1) ? len : out_size - 1;
+    out[done] = '\0';
+
+    /* The rest of the output is not needed after the first line */
+    if ((flags & EP_EXEC_FIRST_LINE) && (nl = strchr(out, '\n')) != NULL)
+    {
+        *(nl + 1) = '\0';
+        len = done = nl + 1 - out;
+    }
+
+    if (len > done)
+    {
+        WARN("Output of %s is truncated to %lu bytes", cmd_log, done);
+        pthread_mutex_lock(&g_cp_lock);
+        g_cp_stats.truncated++;
+        pthread_mutex_unlock(&g_cp_lock);
+    }
+
+    if (res_code)
+        *res_code = rc;
+
+ret:
+    if (cp->timedout)
+    {
+        ERROR("Script helper %d did not complete %s in %ld ms, killed", (int)cp->pid,
+              cmd_log, timeout);
+        status = EPS_TIMEOUT;
+    }
+
+    if (status != EPS_OK && cp->pid)
+    {
+        ep_coproc_stop(cp);
+        pthread_mutex_lock(&g_cp_lock);
+        g_cp_stats.failures++;
+        if (cp->timedout)
+            g_cp_stats.timeouts++;
+        pthread_mutex_unlock(&g_cp_lock);
+    }
+
+    ep_coproc_release(cp);
+    return status;
+}
+
+void ep_coproc_get_stats(ep_coproc_stats_t *stats)
+{
+    pthread_mutex_lock(&g_cp_lock);
+    *stats = g_cp_stats;
+    pthread_mutex_unlock(&g_cp_lock);
+}
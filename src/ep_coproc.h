@@ -0,0 +1,108 @@
+/* ep_coproc.h
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+#ifndef EP_COPROC_H_
+#define EP_COPROC_H_
+
+#include "ep_common.h"
+
+/*
+ * Pool of script helper coprocesses shared by all workers. A helper is a
+ * long-lived program set by EP_SCRIPT_HELPER (e.g. Lua interpreter that
+ * keeps the backend scripts loaded); it is started once and serves the
+ * method script commands instead of running each of them by the shell.
+ * The protocol on the helper's stdin and stdout:
+ *   request:   <length>\n<command line>
+ *   response:  <exit code> <length>\n<output>
+ * where length is the number of bytes that follow; the output may consist
+ * of several lines. A helper that does not answer properly or in the
+ * timeout of the commands (EP_EXEC_TIMEOUT) is killed and is started again
+ * by the next request
+ */
+
+typedef struct ep_coproc_stats_s {
+    unsigned long calls;
+    unsigned long spawns;
+    unsigned long failures;       /* helpers killed after a failed call */
+    unsigned long timeouts;       /* calls not completed in the timeout */
+    unsigned long truncated;      /* outputs that did not fit the buffer */
+    int num;                      /* size of the pool */
+} ep_coproc_stats_t;
+
+BOOL ep_coproc_enabled(void);
+
+/* Runs the command by a helper; out may be the buffer of cmd. flags:
+   EP_EXEC_FIRST_LINE - only the first line of the output is returned, as
+   by ep_exec_read. EPS_TIMEOUT - the helper (or a free one) did not answer
+   in the timeout, EPS_NOTHING_DONE - the command was not delivered to the
+   helper (it could not be started or no byte of the command was sent).
+   After other failures the command may have been run */
+ep_stat_t ep_coproc_run(const char *cmd, int flags, char *out, size_t out_size, int *res_code);
+
+void ep_coproc_get_stats(ep_coproc_stats_t *stats);
+
+#endif /* EP_COPROC_H_ */
@@ -68,6 +68,7 @@
 #include <string.h>
 
 #include "ep_common.h"
+#include "ep_db_utils.h"
 
 static const char DEFAULT_JOURNAL_MODE[] = "truncate";
 static const char DEFAULT_SYNCHRONOUS[]  = "full";
@@ -177,6 +178,126 @@ ep_stat_t sql_closeConnection(sqlite3 *conn)
 }
 
 
+/*
+ * Returns prepared statement of the query, taken from the cache (if it is
+ * not NULL) or prepared anew. The statement must be returned by
+ * ep_db_stmt_release
+ */
+ep_stat_t ep_db_stmt_prepare(ep_db_stmt_cache_t *cache, sqlite3 *dbconn,
+                             const char *query, sqlite3_stmt **stmt)
+{
+    ep_db_stmt_entry_t *entry = NULL;
+    unsigned int h;
+    int i;
+
+    *stmt = NULL;
+
+    if (!cache)
+        return (sqlite3_prepare_v2(dbconn, query, -1, stmt, NULL) == SQLITE_OK) ?
+               EPS_OK : EPS_SQL_ERROR;
+
+    h = ep_hash_str(EP_HASH_INIT, query);
+    cache->tick++;
+
+    for (i = 0; i < cache->num; i++)
+    {
+        entry = &cache->entries[i];
+        if (entry->hash == h && !entry->in_use &&
+            sqlite3_db_handle(entry->stmt) == dbconn &&
+            !strcmp(sqlite3_sql(entry->stmt), query))
+        {
+            entry->in_use = TRUE;
+            entry->last_used = cache->tick;
+            cache->hits++;
+            *stmt = entry->stmt;
+            return EPS_OK;
+        }
+    }
+
+    cache->misses++;
+
+    if (sqlite3_prepare_v2(dbconn, query, -1, stmt, NULL) != SQLITE_OK)
+        return EPS_SQL_ERROR;
+
+    /* Take a free entry or the least recently used one. If all statements
+       are in use, the new one is not cached */
+    if (cache->num < EP_DB_STMT_CACHE_SIZE)
+        entry = &cache->entries[cache->num++];
+    else
+    {
+        entry = NULL;
+        for (i = 0; i < cache->num; i++)
+        {
+            if (!cache->entries[i].in_use &&
+                (!entry || cache->entries[i].last_used < entry->last_used))
+                entry = &cache->entries[i];
+        }
+
+        if (!entry)
+            return EPS_OK;
+
+        sqlite3_finalize(entry->stmt);
+    }
+
+    entry->stmt = *stmt;
+    entry->hash = h;
+    entry->last_used = cache->tick;
+    entry->in_use = TRUE;
+
+    return EPS_OK;
+}
+
+/*
+ * Resets the cached statement (releasing the DB locks held by it) or
+ * finalizes the statement that is not in the cache
+ */
+void ep_db_stmt_release(ep_db_stmt_cache_t *cache, sqlite3_stmt *stmt)
+{
+    int i;
+
+    if (!stmt)
+        return;
+
+    for (i = 0; cache && i < cache->num; i++)
+    {
+        if (cache->entries[i].stmt == stmt)
+        {
+            sqlite3_reset(stmt);
+            sqlite3_clear_bindings(stmt);
+            cache->entries[i].in_use = FALSE;
+            return;
+        }
+    }
+
+    sqlite3_finalize(stmt);
+}
+
+/*
+ * Finalizes the cached statements of the connection (all statements if
+ * dbconn is NULL); must be called before the connection is closed
+ */
+void ep_db_stmt_cache_flush(ep_db_stmt_cache_t *cache, sqlite3 *dbconn)
+{
+    int i, n = 0;
+
+    if (!cache)
+        return;
+
+    for (i = 0; i < cache->num; i++)
+    {
+        if (!dbconn || sqlite3_db_handle(cache->entries[i].stmt) == dbconn)
+            sqlite3_finalize(cache->entries[i].stmt);
+        else
+            cache->entries[n++] = cache->entries[i];
+    }
+
+    if (cache->num > 0)
+        DBG("Statement cache flushed: %d of %d statements left (hits %lu, misses %lu)",
+            n, cache->num, cache->hits, cache->misses);
+
+    cache->num = n;
+}
+
 /*
  * This is "wrapper" on sqlite3 api for performing SQL write operation:
  *   UPDATE, INSERT, DELETE
@@ -227,7 +348,8 @@ ret:
 /*
  *  Helper function that returns number of entries in the specified table
  */
-ep_stat_t ep_db_get_tbl_row_count(sqlite3 *dbconn, char *tbl_name, int *rowNum)
+ep_stat_t ep_db_get_tbl_row_count(sqlite3 *dbconn, ep_db_stmt_cache_t *cache,
+                                  char *tbl_name, int *rowNum)
 {
     ep_stat_t status = EPS_OK;
     int       res = 0;
@@ -237,7 +359,7 @@ ep_stat_t ep_db_get_tbl_row_count(sqlite3 *dbconn, char *tbl_name, int *rowNum)
     sprintf(query, "SELECT COUNT(*) FROM %s", tbl_name);
     //DBG("Query:   %s", query);
 
-    if (sqlite3_prepare_v2(dbconn, query, -1, &stmt, NULL) != SQLITE_OK)
+    if (ep_db_stmt_prepare(cache, dbconn, query, &stmt) != EPS_OK)
         GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not prepare SQL stmt: %s",
                                             sqlite3_errmsg(dbconn));
 
@@ -251,7 +373,7 @@ ep_stat_t ep_db_get_tbl_row_count(sqlite3 *dbconn, char *tbl_name, int *rowNum)
     //DBG ("Table %s contains %d entries (res code = %d)", tbl_name, *rowNum, res);
 
 ret:
-    if (stmt) sqlite3_finalize(stmt);
+    ep_db_stmt_release(cache, stmt);
     return status;
 }
 
@@ -266,7 +388,8 @@ ret:
  *                           (needed to add WHERE condition to SELECT query)
  *     where_cond (optional) - ready WHERE condition for SELECT query
  */
-ep_stat_t ep_db_get_tbl_row_indexes(sqlite3 *dbconn, char *tbl_name, int index_num,
+ep_stat_t ep_db_get_tbl_row_indexes(sqlite3 *dbconn, ep_db_stmt_cache_t *cache,
+                    char *tbl_name, int index_num,
                     char *index_params[], param_name_index_t index_param_values[],
                     char *where_cond, exact_indexvalues_set_t *indexvalues_set)
 {
@@ -274,6 +397,7 @@ ep_stat_t ep_db_get_tbl_row_indexes(sqlite3 *dbconn, char *tbl_name, int index_n
 
     char query[EP_SQL_REQUEST_BUF_SIZE] = {0};
     int i, size, res, query_size = EP_SQL_REQUEST_BUF_SIZE;
+    int bind_values[2 * MAX_INDECES_PER_OBJECT], bind_num = 0;
 
     if (index_num < 0 || index_num > MAX_INDECES_PER_OBJECT)
     {
@@ -297,9 +421,11 @@ ep_stat_t ep_db_get_tbl_row_indexes(sqlite3 *dbconn, char *tbl_name, int index_n
     /* Add WHERE condition to the formed query ( SELECT ... FROM <TABLE> ) */
     if (where_cond && strlen(where_cond))
     {
-        /* WHERE condition was passed in function args */
+        /* WHERE condition was passed in function args; such query
+           is not cached */
         strcat_safe(query, " ", query_size);
         strcat_safe(query, where_cond, query_size);
+        cache = NULL;
     }
     else
     {
@@ -320,15 +446,18 @@ ep_stat_t ep_db_get_tbl_row_indexes(sqlite3 *dbconn, char *tbl_name, int index_n
                  *  REQ_IDX_TYPE_EXACT, REQ_IDX_TYPE_RANGE, REQ_IDX_TYPE_ALL */
                 if (index_param_values[i].type == REQ_IDX_TYPE_EXACT)
                 {
-                    snprintf(query+strlen(query), query_size, "AND %s = %d ",
-                             index_params[i], index_param_values[i].exact_val.num);
+                    snprintf(query+strlen(query), query_size, "AND %s = ? ",
+                             index_params[i]);
+                    bind_values[bind_num++] = index_param_values[i].exact_val.num;
                 }
                 else if (index_param_values[i].type == REQ_IDX_TYPE_RANGE)
                 {
-                    snprintf(query+strlen(query), query_size, "AND %s >= %d ",
-                             index_params[i], index_param_values[i].range_val.begin);
-                    snprintf(query+strlen(query), query_size, "AND %s <= %d ",
-                             index_params[i], index_param_values[i].range_val.end);
+                    snprintf(query+strlen(query), query_size, "AND %s >= ? ",
+                             index_params[i]);
+                    snprintf(query+strlen(query), query_size, "AND %s <= ? ",
+                             index_params[i]);
+                    bind_values[bind_num++] = index_param_values[i].range_val.begin;
+                    bind_values[bind_num++] = index_param_values[i].range_val.end;
                 }
                 else /* REQ_IDX_TYPE_ALL */
                 {
@@ -345,20 +474,31 @@ ep_stat_t ep_db_get_tbl_row_indexes(sqlite3 *dbconn, char *tbl_name, int index_n
                     return EPS_INVALID_ARGUMENT;
                 }
 
-                snprintf(query+strlen(query), query_size, "AND %s = %d ",
-                         index_params[i], index_param_values[i].exact_val.num);
+                snprintf(query+strlen(query), query_size, "AND %s = ? ",
+                         index_params[i]);
+                bind_values[bind_num++] = index_param_values[i].exact_val.num;
             }
         }
     }
 
     DBG("======== Prepared SQL query (len %d) ========\n\t %s", strlen(query), query);
 
-    if (sqlite3_prepare_v2(dbconn, query, -1, &stmt, NULL) != SQLITE_OK)
+    if (ep_db_stmt_prepare(cache, dbconn, query, &stmt) != EPS_OK)
     {
         ERROR("Could not prepare SQL statement: %s", sqlite3_errmsg(dbconn));
         return EPS_SQL_ERROR;
     }
 
+    for (i = 0; i < bind_num; i++)
+    {
+        if (sqlite3_bind_int(stmt, i + 1, bind_values[i]) != SQLITE_OK)
+        {
+            ERROR("Could not bind index value %d: %s", i, sqlite3_errmsg(dbconn));
+            ep_db_stmt_release(cache, stmt);
+            return EPS_SQL_ERROR;
+        }
+    }
+
     indexvalues_set->inst_num = 0;
     indexvalues_set->index_num = index_num;
 
@@ -394,13 +534,13 @@ ep_stat_t ep_db_get_tbl_row_indexes(sqlite3 *dbconn, char *tbl_name, int index_n
         }
         else
         {
-            if (stmt) sqlite3_finalize(stmt);
             ERROR("Could not execute query: %s", sqlite3_errmsg(dbconn));
+            ep_db_stmt_release(cache, stmt);
             return EPS_SQL_ERROR;
         }
     }
 
-    if (stmt) sqlite3_finalize(stmt);
+    ep_db_stmt_release(cache, stmt);
 
     return EPS_OK;
 }
@@ -419,7 +559,8 @@ ep_stat_t ep_db_get_tbl_row_indexes(sqlite3 *dbconn, char *tbl_name, int index_n
  *  Regardless of the actual column data-type (in db table schema) - column value
  *   is returned in string format (char *column_value).
  */
-ep_stat_t ep_db_get_tbl_row_column(sqlite3 *dbconn, char *tbl_name, int index_num,
+ep_stat_t ep_db_get_tbl_row_column(sqlite3 *dbconn, ep_db_stmt_cache_t *cache,
+                    char *tbl_name, int index_num,
                     char *index_params[], int index_param_values[],
                     char *column_name, char *column_value, int column_value_maxlen)
 {
@@ -442,19 +583,28 @@ ep_stat_t ep_db_get_tbl_row_column(sqlite3 *dbconn, char *tbl_name, int index_nu
     strcat_safe(query, " WHERE 1 ", query_size);
     for (i = 0; i < index_num; i++)
     {
-        snprintf(query+strlen(query), query_size, "AND %s = %d ",
-                 index_params[i], index_param_values[i]);
+        snprintf(query+strlen(query), query_size, "AND %s = ? ", index_params[i]);
     }
 
 
     DBG("======== Prepared SQL query (len %d) ========\n\t %s", strlen(query), query);
 
-    if (sqlite3_prepare_v2(dbconn, query, -1, &stmt, NULL) != SQLITE_OK)
+    if (ep_db_stmt_prepare(cache, dbconn, query, &stmt) != EPS_OK)
     {
         ERROR("Could not prepare SQL statement: %s", sqlite3_errmsg(dbconn));
         return EPS_SQL_ERROR;
     }
 
+    for (i = 0; i < index_num; i++)
+    {
+        if (sqlite3_bind_int(stmt, i + 1, index_param_values[i]) != SQLITE_OK)
+        {
+            ERROR("Could not bind index value %d: %s", i, sqlite3_errmsg(dbconn));
+            ep_db_stmt_release(cache, stmt);
+            return EPS_SQL_ERROR;
+        }
+    }
+
     i = 0;
     /* Run query and save fetched column value */
     while (TRUE)
@@ -481,13 +631,13 @@ ep_stat_t ep_db_get_tbl_row_column(sqlite3 *dbconn, char *tbl_name, int index_nu
         }
         else
         {
-            if (stmt) sqlite3_finalize(stmt);
             ERROR("Could not execute query: %s", sqlite3_errmsg(dbconn));
+            ep_db_stmt_release(cache, stmt);
             return EPS_SQL_ERROR;
         }
     }
 
-    if (stmt) sqlite3_finalize(stmt);
+    ep_db_stmt_release(cache, stmt);
 
     return EPS_OK;
 }
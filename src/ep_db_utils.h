@@ -72,6 +72,48 @@
 
 #include "ep_common.h"
 
+/*
+ * Cache of prepared statements keyed by the SQL text. Values (indexes,
+ * parameter values) are passed to the cached statements as bind parameters,
+ * so the text is the same for all requests of the same shape. The least
+ * recently used statement is finalized when the cache is full. The cache is
+ * not thread-safe: each worker keeps its own one
+ */
+typedef struct ep_db_stmt_entry_s {
+    sqlite3_stmt *stmt;
+    unsigned int hash;            /* hash of the SQL text */
+    unsigned long last_used;
+    BOOL in_use;
+} ep_db_stmt_entry_t;
+
+typedef struct ep_db_stmt_cache_s {
+    int num;
+    unsigned long tick;
+    unsigned long hits;
+    unsigned long misses;
+    ep_db_stmt_entry_t entries[EP_DB_STMT_CACHE_SIZE];
+} ep_db_stmt_cache_t;
+
+/*
+ * Returns prepared statement of the query, taken from the cache (if it is
+ * not NULL) or prepared anew. The statement must be returned by
+ * ep_db_stmt_release
+ */
+ep_stat_t ep_db_stmt_prepare(ep_db_stmt_cache_t *cache, sqlite3 *dbconn,
+                             const char *query, sqlite3_stmt **stmt);
+
+/*
+ * Resets the cached statement (releasing the DB locks held by it) or
+ * finalizes the statement that is not in the cache
+ */
+void ep_db_stmt_release(ep_db_stmt_cache_t *cache, sqlite3_stmt *stmt);
+
+/*
+ * Finalizes the cached statements of the connection (all statements if
+ * dbconn is NULL); must be called before the connection is closed
+ */
+void ep_db_stmt_cache_flush(ep_db_stmt_cache_t *cache, sqlite3 *dbconn);
+
 /*
  * Opens connection to SQLite db and sets timeout and journal mode = truncate
  */
@@ -102,7 +144,8 @@ ep_stat_t ep_db_exec_write_query(sqlite3 *dbconn, char *query, int *modified_row
  *  Helper function that returns number of entries in the
  *  specified table of the specified DB
  */
-ep_stat_t ep_db_get_tbl_row_count(sqlite3 *dbconn, char *tbl_name, int *rowNum);
+ep_stat_t ep_db_get_tbl_row_count(sqlite3 *dbconn, ep_db_stmt_cache_t *cache,
+                                  char *tbl_name, int *rowNum);
 
 /*
  *  Returns (within the output arg *indexvalues_set) the array of Object instances
@@ -114,8 +157,10 @@ ep_stat_t ep_db_get_tbl_row_count(sqlite3 *dbconn, char *tbl_name, int *rowNum);
  *     index_param_values  - exact/ranged/wildcard values of index parameters
  *                           (needed to add WHERE condition to SELECT query)
  *     where_cond (optional) - ready WHERE condition for SELECT query
+ *   The statement is taken from the cache (optional) unless where_cond is set.
  */
-ep_stat_t ep_db_get_tbl_row_indexes(sqlite3 *dbconn, char *tbl_name, int index_num,
+ep_stat_t ep_db_get_tbl_row_indexes(sqlite3 *dbconn, ep_db_stmt_cache_t *cache,
+                    char *tbl_name, int index_num,
                     char *index_params[], param_name_index_t index_param_values[],
                     char *where_cond, exact_indexvalues_set_t *indexvalues_set);
 
@@ -133,7 +178,8 @@ ep_stat_t ep_db_get_tbl_row_indexes(sqlite3 *dbconn, char *tbl_name, int index_n
  *  Regardless of the actual column data-type (in db table schema) - column value
  *   is returned in string format (char *column_value).
  */
-ep_stat_t ep_db_get_tbl_row_column(sqlite3 *dbconn, char *tbl_name, int index_num,
+ep_stat_t ep_db_get_tbl_row_column(sqlite3 *dbconn, ep_db_stmt_cache_t *cache,
+                    char *tbl_name, int index_num,
                     char *index_params[], int index_param_values[],
                     char *column_name, char *column_value, int column_value_maxlen);
 
@@ -154,11 +154,115 @@
 #   define MMX_DB_SYNCHRONOUS getenv("MMX_DB_SYNCHRONOUS")
 #endif
 
+/* Directories of UCI configs and of their uncommitted changes used by
+   libuci (see ep_uci.h); not set - the libuci defaults */
+#ifndef EP_UCI_CONFDIR
+#   define EP_UCI_CONFDIR getenv("MMX_EP_UCI_CONFDIR")
+#endif
+
+#ifndef EP_UCI_SAVEDIR
+#   define EP_UCI_SAVEDIR getenv("MMX_EP_UCI_SAVEDIR")
+#endif
+
+/* Path of ubusd socket used by the in-process ubus client (see
+   ep_ubus.h); not set - the libubus default */
+#ifndef EP_UBUS_SOCKET
+#   define EP_UBUS_SOCKET getenv("MMX_EP_UBUS_SOCKET")
+#endif
+
+/* Timeout of ubus call (msec) */
+#ifndef EP_UBUS_CALL_TIMEOUT
+#   define EP_UBUS_CALL_TIMEOUT (5*1000)
+#endif
+
+/* Helper program serving the method script commands (see ep_coproc.h)
+   and number of its coprocesses; not set - each command is run by shell */
+#ifndef EP_SCRIPT_HELPER
+#   define EP_SCRIPT_HELPER getenv("MMX_EP_SCRIPT_HELPER")
+#endif
+
+#ifndef EP_SCRIPT_HELPER_NUM
+#   define EP_SCRIPT_HELPER_NUM getenv("MMX_EP_SCRIPT_HELPER_NUM")
+#endif
+
+#ifndef EP_SCRIPT_HELPER_DEF_NUM
+#   define EP_SCRIPT_HELPER_DEF_NUM 4
+#endif
+
+/* Size of the output of get-method script read for all parameters of an
+   object instance (with the script helper the output may have several
+   lines) */
+#ifndef EP_SCRIPT_OUTPUT_BUF_SIZE
+#   define EP_SCRIPT_OUTPUT_BUF_SIZE (4*EP_SQL_REQUEST_BUF_SIZE)
+#endif
+
+/* Timeout (msec) of external commands (scripts, uci, ubus), see ep_exec.h */
+#ifndef EP_EXEC_TIMEOUT
+#   define EP_EXEC_TIMEOUT getenv("MMX_EP_EXEC_TIMEOUT")
+#endif
+
+#ifndef EP_EXEC_DEF_TIMEOUT
+#   define EP_EXEC_DEF_TIMEOUT (60*1000)
+#endif
+
 /* timeout of all sql operations */
 #ifndef SQL_TIMEOUT
 #   define SQL_TIMEOUT (5*1000) /* (sec*1000) */
 #endif
 
+/* Number of prepared SQL statements cached by each worker */
+#ifndef EP_DB_STMT_CACHE_SIZE
+#   define EP_DB_STMT_CACHE_SIZE 32
+#endif
+
+/* Size of the worker's table of parsed method strings (templates);
+   up to half of it is filled */
+#ifndef EP_METHOD_TPL_CACHE_SIZE
+#   define EP_METHOD_TPL_CACHE_SIZE 256
+#endif
+
+/* Maximal XML size of a GetParamValue response portion: the values that
+   do not fit are sent in the next portion (moreFlag is set). A smaller
+   size lets the front-end get the first values of a big result sooner */
+#ifndef EP_ANSWER_PORTION_LEN
+#   define EP_ANSWER_PORTION_LEN MAX_MMX_EP_ANSWER_LEN
+#endif
+
+/* Size (bytes) of the worker arena for big per-request arrays. The
+   default is the size needed for the configured limits */
+#ifndef EP_WORKER_ARENA_SIZE
+#   define EP_WORKER_ARENA_SIZE getenv("MMX_EP_WORKER_ARENA_SIZE")
+#endif
+
+/* Number of recently parsed parameter names kept by the worker */
+#ifndef EP_PARAM_NAME_CACHE_SIZE
+#   define EP_PARAM_NAME_CACHE_SIZE 64
+#endif
+
+/* TTL (msec) of the values read by uci, ubus and get-method scripts;
+   0 or not set - the values are cached only for the objects and
+   parameters listed in EP_VALUE_CACHE_OBJECTS */
+#ifndef EP_VALUE_CACHE_TTL
+#   define EP_VALUE_CACHE_TTL getenv("MMX_EP_VALUE_CACHE_TTL")
+#endif
+
+/* Objects and parameters which values are cached, separated by commas or
+   spaces: "Device.Obj.{i}.[=ttl]" or "Device.Obj.{i}.Param[=ttl]". If the
+   TTL is not given, EP_VALUE_CACHE_TTL (or EP_VALUE_CACHE_DEF_TTL) is used.
+   If the list is set, other values are not cached */
+#ifndef EP_VALUE_CACHE_OBJECTS
+#   define EP_VALUE_CACHE_OBJECTS getenv("MMX_EP_VALUE_CACHE_OBJECTS")
+#endif
+
+#ifndef EP_VALUE_CACHE_DEF_TTL
+#   define EP_VALUE_CACHE_DEF_TTL 2000
+#endif
+
+/* Max number of values in the cache */
+#ifndef EP_VALUE_CACHE_SIZE
+#   define EP_VALUE_CACHE_SIZE 1024
+#endif
+
 
 #ifndef USE_SYSLOG
 #   define USE_SYSLOG 0
@@ -172,4 +276,136 @@
 #   define TP_MAX_TASK_QUEUE_SIZE 32 //128
 #endif
 
+/* Upper bound of the number of worker threads (size of the worker tables).
+   EP_TP_WORKER_THREADS_NUM is the default min number of workers; 0 means
+   the number of CPUs */
+#ifndef EP_TP_MAX_WORKER_THREADS_NUM
+#   define EP_TP_MAX_WORKER_THREADS_NUM  32
+#endif
+
+/* Runtime bounds of the worker pool size. Default max is twice the min */
+#ifndef EP_TP_WORKERS_MIN
+#   define EP_TP_WORKERS_MIN getenv("MMX_EP_WORKERS_MIN")
+#endif
+
+#ifndef EP_TP_WORKERS_MAX
+#   define EP_TP_WORKERS_MAX getenv("MMX_EP_WORKERS_MAX")
+#endif
+
+/* The pool starts one more worker when this number of tasks is queued
+   and none of the workers is idle */
+#ifndef TP_GROW_QUEUE_DEPTH
+#   define TP_GROW_QUEUE_DEPTH           4
+#endif
+
+/* Worker above the min number that stays idle for this time exits */
+#ifndef TP_WORKER_IDLE_TIMEOUT
+#   define TP_WORKER_IDLE_TIMEOUT        (30*1000) /* (sec*1000) */
+#endif
+
+/*
+ * Thread pool lanes: weights of weighted fair dequeue, number of workers
+ * reserved for read requests and max number of workers that can be busy
+ * with maintenance tasks (discovery, init actions) at the same time
+ */
+#ifndef TP_LANE_WEIGHT_READ
+#   define TP_LANE_WEIGHT_READ           4
+#endif
+
+#ifndef TP_LANE_WEIGHT_WRITE
+#   define TP_LANE_WEIGHT_WRITE          2
+#endif
+
+#ifndef TP_LANE_WEIGHT_MAINT
+#   define TP_LANE_WEIGHT_MAINT          1
+#endif
+
+#ifndef TP_LANE_READ_RESERVED_WORKERS
+#   define TP_LANE_READ_RESERVED_WORKERS 1
+#endif
+
+#ifndef TP_LANE_MAINT_MAX_WORKERS
+#   define TP_LANE_MAINT_MAX_WORKERS     1
+#endif
+
+#ifndef TP_LANE_SCHED_LEN
+#   define TP_LANE_SCHED_LEN             64
+#endif
+
+/* Min number of objects in GetParamValue request (partial path) to fan out
+   the objects to idle workers as subtasks; 0 disables the fan-out */
+#ifndef EP_GET_FANOUT_MIN_OBJECTS
+#   define EP_GET_FANOUT_MIN_OBJECTS     4
+#endif
+
+/* Max number of datagrams the dispatcher drains by one recvmmsg call.
+   Value 1 means the plain recvfrom per datagram is used */
+#ifndef EP_DISP_RECV_BATCH
+#   define EP_DISP_RECV_BATCH 1
+#endif
+
+/* Max number of dispatcher shards. Each shard is a dispatcher thread with
+   its own UDP socket bound to the EP port (SO_REUSEPORT) that feeds its
+   own group of task queues */
+#ifndef EP_DISP_MAX_SHARDS
+#   define EP_DISP_MAX_SHARDS 4
+#endif
+
+/* Number of dispatcher shards is read from environment (default 1) */
+#define EP_DISP_SHARDS  getenv("MMX_EP_DISP_SHARDS")
+
+/* Max number of message buffers in the thread pool of the given number
+   of shards (queue groups) and workers: the requests admitted to the 3
+   lanes of each shard (see EP_DISP_QUEUE_HIGH_WATERMARK), the batch of
+   each dispatcher shard, one buffer per worker and internal tasks. The
+   buffers are allocated when they are needed */
+#ifndef TP_MSG_POOL_SIZE
+#   define TP_MSG_POOL_SIZE(shards, workers) \
+        ((shards) * (3 * EP_DISP_QUEUE_HIGH_WATERMARK + EP_DISP_RECV_BATCH) + (workers) + 4)
+#endif
+
+/*
+ * Dispatcher admission control
+ */
+
+/* Requests are rejected with "resources exceeded" response when the task
+   queue holds this number of tasks. The value read from environment may
+   only lower it */
+#ifndef EP_DISP_QUEUE_HIGH_WATERMARK
+#   define EP_DISP_QUEUE_HIGH_WATERMARK (TP_MAX_TASK_QUEUE_SIZE * 3 / 4)
+#endif
+
+#ifndef EP_DISP_HIGH_WATERMARK
+#   define EP_DISP_HIGH_WATERMARK getenv("MMX_EP_DISP_HIGH_WATERMARK")
+#endif
+
+/* Per-caller token bucket: sustained requests per second (0 - no limit)
+   and max burst of requests, read from environment */
+#ifndef EP_DISP_CALLER_RATE
+#   define EP_DISP_CALLER_RATE getenv("MMX_EP_DISP_CALLER_RATE")
+#endif
+
+#ifndef EP_DISP_CALLER_BURST
+#   define EP_DISP_CALLER_BURST getenv("MMX_EP_DISP_CALLER_BURST")
+#endif
+
+#ifndef EP_DISP_CALLER_DEF_RATE
+#   define EP_DISP_CALLER_DEF_RATE   0
+#endif
+
+#ifndef EP_DISP_CALLER_DEF_BURST
+#   define EP_DISP_CALLER_DEF_BURST  32
+#endif
+
+/* Max number of callers tracked by the token buckets */
+#ifndef EP_DISP_MAX_CALLERS
+#   define EP_DISP_MAX_CALLERS       16
+#endif
+
+/* Dispatcher ingress statistics are logged after each such number
+   of received requests */
+#ifndef EP_DISP_STATS_INTERVAL
+#   define EP_DISP_STATS_INTERVAL 1024
+#endif
+
 #endif /* DEFINES_H_ */
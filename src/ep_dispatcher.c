@@ -64,13 +64,25 @@
  * - how we can extend the data model to support all parts of your system
  * - professional sub-contract and customization services
  */
+#define _GNU_SOURCE     /* recvmmsg */
+#include <ctype.h>
 #include <signal.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <pthread.h>
 #include "ep_common.h"
 #ifdef MMX_EP_EXT_THRESHOLD
 #include "ep_ext.h"
 #endif
 #include "ep_threadpool.h"
+#include "ep_valcache.h"
+#include "ep_model.h"
+#include "ep_coproc.h"
+#include "ep_exec.h"
 #include "mmx-frontapi.h"
 
 #if defined(__DATE__) && defined(__TIME__)
@@ -79,16 +91,58 @@
 #    define ING_TIMESTAMP "N/A"
 #endif
 
-#define EP_INIT_WAIT_TIMEOUT    6  //secs
+#define EP_INIT_TASK_TIMEOUT    60  //secs, max wait for completion of an init task
 
 #define EP_MAX_STARTTYPE_VALUE  1
 
+#define DISP_NOBUF_WAIT_TIME    10000  //usecs
+
+#define DISP_REJECT_POOL_LEN    16384
+
+#define DISP_EPOLL_MAX_EVENTS   8
+
 volatile BOOL g_disp_loop_terminated = FALSE;
 volatile BOOL g_disp_initialized = FALSE;
 volatile BOOL g_disp_restart = FALSE;
 
 volatile int  g_start_type = 0;   /* 0 - default start, 1 - start with candidate db */
 
+/* Control eventfd: wakes up the dispatcher loops on termination and restart */
+static int g_disp_ctl_fd = -1;
+
+/* Dispatcher shard: thread with its own UDP socket bound to the EP port
+   (SO_REUSEPORT), so the kernel spreads requests over the shards, and its
+   own group of the thread pool queues. Shard 0 runs in the main thread
+   and also serves the Unix socket */
+typedef struct disp_shard_s {
+    int id;
+    int udp_sock;
+    pthread_t tid;
+    BOOL started;
+    tp_threadpool_t *tp;
+
+    /* Buffers for building "busy" responses (used by the shard thread only) */
+    ep_message_t reject_msg;
+    char reject_pool[DISP_REJECT_POOL_LEN];
+    char reject_buf[MAX_MMX_EP_ANSWER_LEN];
+} disp_shard_t;
+
+static disp_shard_t g_disp_shards[EP_DISP_MAX_SHARDS];
+static int g_disp_shard_num = 1;
+
+/* Wakes up the dispatcher loops; async-signal-safe. The counter is not
+   consumed once a flag is set, so the eventfd stays readable for all
+   the shards */
+static void disp_ctl_notify(void)
+{
+    uint64_t one = 1;
+
+    if (g_disp_ctl_fd >= 0 && write(g_disp_ctl_fd, &one, sizeof(one)) < 0)
+    {
+        /* The counter is already non-zero, the loop will wake up anyway */
+    }
+}
+
 
 #define DISP_STR_CONFIG_DISCOVER_MSG "<EP_ApiMsg>" \
     "<hdr>" \
@@ -139,7 +193,10 @@ ep_stat_t disp_get_restart_flag(int *restartFlag)
 ep_stat_t disp_set_restart_flag(int restartType)
 {
     if (g_disp_initialized == TRUE)
+    {
         g_disp_restart = TRUE;
+        disp_ctl_notify();
+    }
 
     if (restartType < 0 || restartType > EP_MAX_STARTTYPE_VALUE)
         g_start_type = 0;
@@ -149,25 +206,486 @@ ep_stat_t disp_set_restart_flag(int restartType)
     return EPS_OK;
 }
 
-static ep_stat_t disp_add_config_discovery_task(tp_threadpool_t *tp)
+/* Selects the thread pool lane by the message type found in the raw XML
+   message, so the request is not parsed twice */
+static tp_lane_t disp_get_msg_lane(const char *xmlmsg)
 {
-    tp_task_t task = { .task_type = TASK_TYPE_RAW };
-    strncpy(task.raw_message, DISP_STR_CONFIG_DISCOVER_MSG, MAX_DISP_MSG_LEN-1);
+    static const char *maint_types[] = {"DiscoverConfig", "InitActions", "Reboot", "Reset"};
+    const char *p = strstr(xmlmsg, "<msgType>");
+    int i;
 
-    return tp_add_task(tp, &task);
+    if (!p)
+        return TP_LANE_WRITE;
+
+    p += strlen("<msgType>");
+    while (isspace((unsigned char)*p)) p++;
+
+    if (!strncmp(p, "Get", strlen("Get")))
+        return TP_LANE_READ;
+
+    for (i = 0; i < (int)(sizeof(maint_types)/sizeof(maint_types[0])); i++)
+    {
+        if (!strncmp(p, maint_types[i], strlen(maint_types[i])))
+            return TP_LANE_MAINT;
+    }
+
+    return TP_LANE_WRITE;
 }
 
-static ep_stat_t disp_add_init_actions_task(tp_threadpool_t *tp)
+/* Adds task with the internally generated XML message. If the completion
+   is passed, it is signalled when the task is done */
+static ep_stat_t disp_add_internal_task(tp_threadpool_t *tp, const char *xmlmsg,
+                                        tp_completion_t *completion)
 {
-    tp_task_t task = { .task_type = TASK_TYPE_RAW };
-    strncpy(task.raw_message, DISP_STR_INITACTIONS_MSG, MAX_DISP_MSG_LEN-1);
+    tp_task_t task = { .task_type = TASK_TYPE_RAW, .lane = TP_LANE_MAINT };
+
+    task.completion = completion;
+
+    if ((task.msgbuf = tp_get_msgbuf(tp)) == NULL)
+    {
+        ERROR("Could not get message buffer for internal task");
+        return EPS_NO_MORE_ROOM;
+    }
+
+    strncpy(task.msgbuf->data, xmlmsg, MAX_DISP_MSG_LEN-1);
+    task.msgbuf->data[MAX_DISP_MSG_LEN-1] = '\0';
 
     return tp_add_task(tp, &task);
 }
 
+static ep_stat_t disp_add_config_discovery_task(tp_threadpool_t *tp, tp_completion_t *completion)
+{
+    return disp_add_internal_task(tp, DISP_STR_CONFIG_DISCOVER_MSG, completion);
+}
+
+static ep_stat_t disp_add_init_actions_task(tp_threadpool_t *tp, tp_completion_t *completion)
+{
+    return disp_add_internal_task(tp, DISP_STR_INITACTIONS_MSG, completion);
+}
+
+
+
+/* Dispatcher ingress statistics */
+typedef struct disp_stats_s {
+    unsigned long recv_calls;     /* receive syscalls that returned data */
+    unsigned long rcvd_msgs;      /* received datagrams */
+    unsigned long logged_msgs;    /* value of rcvd_msgs when last logged */
+
+    unsigned long rejected_queue; /* rejected due to queue high-water mark */
+    unsigned long rejected_rate;  /* rejected by the caller token bucket */
+    unsigned long dropped;        /* dropped without response (hold, queue full) */
+} disp_stats_t;
+
+/* Per-caller token bucket (tokens are kept in 1/1000 units) */
+typedef struct disp_caller_bucket_s {
+    BOOL  in_use;
+    int   caller_id;
+    long  tokens;
+    long  last_ms;                /* time of the last refill */
+} disp_caller_bucket_t;
+
+static disp_caller_bucket_t g_disp_buckets[EP_DISP_MAX_CALLERS];
+
+/* Protects the caller buckets shared by the dispatcher shards */
+static pthread_mutex_t g_disp_admit_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Admission limits; the defaults are overridden from environment
+   by disp_admit_init */
+static int g_disp_high_watermark = EP_DISP_QUEUE_HIGH_WATERMARK;
+static int g_disp_caller_rate = EP_DISP_CALLER_DEF_RATE;
+static int g_disp_caller_burst = EP_DISP_CALLER_DEF_BURST;
+
+/* Reads the admission limits from environment. The high-water mark may
+   only be lowered: the message pool is sized for EP_DISP_QUEUE_HIGH_WATERMARK */
+static void disp_admit_init(void)
+{
+    char *setting;
+
+    if ((setting = EP_DISP_HIGH_WATERMARK) != NULL && atoi(setting) > 0 &&
+        atoi(setting) < EP_DISP_QUEUE_HIGH_WATERMARK)
+        g_disp_high_watermark = atoi(setting);
+
+    if ((setting = EP_DISP_CALLER_RATE) != NULL && atoi(setting) >= 0)
+        g_disp_caller_rate = atoi(setting);
+
+    if ((setting = EP_DISP_CALLER_BURST) != NULL && atoi(setting) > 0)
+        g_disp_caller_burst = atoi(setting);
+
+    DBG("Admission: high-water mark %d, caller rate %d, burst %d",
+         g_disp_high_watermark, g_disp_caller_rate, g_disp_caller_burst);
+}
+
+/* Fast scan of the message header for the caller id (full parsing is done
+   by the workers); -1 is returned if it is not found */
+static int disp_get_caller_id(const char *xmlmsg)
+{
+    const char *p = strstr(xmlmsg, "<callerId>");
+
+    return p ? atoi(p + strlen("<callerId>")) : -1;
+}
+
+/* Takes one token from the caller's bucket. Returns FALSE if the caller
+   has exceeded its rate. Must be called with g_disp_admit_lock */
+static BOOL disp_caller_take_token(int caller_id)
+{
+    disp_caller_bucket_t *b = NULL, *oldest = NULL;
+    long now = ep_time_ms();
+    int i;
+
+    for (i = 0; i < EP_DISP_MAX_CALLERS; i++)
+    {
+        if (g_disp_buckets[i].in_use && g_disp_buckets[i].caller_id == caller_id)
+        {
+            b = &g_disp_buckets[i];
+            break;
+        }
+        if (!oldest || !g_disp_buckets[i].in_use ||
+            (oldest->in_use && g_disp_buckets[i].last_ms < oldest->last_ms))
+            oldest = &g_disp_buckets[i];
+    }
+
+    if (!b)
+    {
+        /* New caller: take a free bucket or the least recently used one */
+        b = oldest;
+        b->in_use = TRUE;
+        b->caller_id = caller_id;
+        b->tokens = g_disp_caller_burst * 1000L;
+        b->last_ms = now;
+    }
+
+    /* Refill: g_disp_caller_rate tokens per second */
+    b->tokens += (now - b->last_ms) * g_disp_caller_rate;
+    if (b->tokens > g_disp_caller_burst * 1000L)
+        b->tokens = g_disp_caller_burst * 1000L;
+    b->last_ms = now;
+
+    if (b->tokens < 1000)
+        return FALSE;
 
+    b->tokens -= 1000;
+    return TRUE;
+}
+
+/* Returns response message type for the request type; 0 - the request
+   type has no response */
+static int disp_resp_msgtype(int msgType)
+{
+    switch (msgType)
+    {
+    case MSGTYPE_GETVALUE:       return MSGTYPE_GETVALUE_RESP;
+    case MSGTYPE_SETVALUE:       return MSGTYPE_SETVALUE_RESP;
+    case MSGTYPE_GETPARAMNAMES:  return MSGTYPE_GETPARAMNAMES_RESP;
+    case MSGTYPE_ADDOBJECT:      return MSGTYPE_ADDOBJECT_RESP;
+    case MSGTYPE_DELOBJECT:      return MSGTYPE_DELOBJECT_RESP;
+    case MSGTYPE_DISCOVERCONFIG: return MSGTYPE_DISCOVERCONFIG_RESP;
+    default:                     return 0;
+    }
+}
 
-static ep_stat_t disp_handle_msg(tp_threadpool_t *tp, const char *xmlmsg)
+/* Answers immediately with "resources exceeded" response, so the caller
+   does not wait for its full timeout. The shard's own buffers are used,
+   so no lock is needed */
+static ep_stat_t disp_send_busy_resp(int shard, int udp_sock, const char *xmlmsg)
+{
+    disp_shard_t *sh = &g_disp_shards[shard];
+    ep_message_t *msg = &sh->reject_msg;
+    struct sockaddr_in client_addr;
+    int resp_type;
+
+    memset((char *)msg, 0, sizeof(ep_message_t));
+    mmx_frontapi_msg_struct_init(msg, sh->reject_pool, sizeof(sh->reject_pool));
+
+    if (mmx_frontapi_message_parse(xmlmsg, msg) != FA_OK)
+    {
+        ERROR("Could not parse rejected message");
+        return EPS_INVALID_FORMAT;
+    }
+
+    if (msg->header.respMode == MMX_API_RESPMODE_NORESP ||
+        (resp_type = disp_resp_msgtype(msg->header.msgType)) == 0)
+        return EPS_NOTHING_DONE;
+
+    msg->header.respFlag = 1;
+    msg->header.msgType = resp_type;
+    msg->header.moreFlag = 0;
+    msg->header.respCode = MMX_API_RC_RESOURCES_EXCEEDED;
+    memset(&msg->body, 0, sizeof(msg->body));
+
+    if (mmx_frontapi_message_build(msg, sh->reject_buf, sizeof(sh->reject_buf)) != FA_OK)
+    {
+        ERROR("Could not build busy response");
+        return EPS_GENERAL_ERROR;
+    }
+
+    client_addr.sin_family = AF_INET;
+    client_addr.sin_port = htons(msg->header.respPort);
+    client_addr.sin_addr.s_addr = msg->header.respIpAddr;
+
+    if (sendto(udp_sock, sh->reject_buf, strlen(sh->reject_buf) + 1, 0,
+               (struct sockaddr *)&client_addr, sizeof(client_addr)) < 0)
+    {
+        ERROR("Could not send busy response: %s", strerror(errno));
+        return EPS_SYSTEM_ERROR;
+    }
+
+    DBG("Busy response sent: txaId %d, callerId %d", msg->header.txaId, msg->header.callerId);
+
+    return EPS_OK;
+}
+
+/* Admission control of the received request. "pending" is number of tasks
+   of the same lane that are about to be added to the queue together with
+   this one. Each lane of each shard has its own queue, so a flood of writes
+   does not cause rejection of reads. Rejected request is answered with
+   "busy" response and its buffer is returned to the pool. Returns TRUE if
+   the request is admitted */
+static BOOL disp_admit_msg(tp_threadpool_t *tp, int shard, int udp_sock, tp_msgbuf_t *msgbuf,
+                           tp_lane_t lane, unsigned int pending, disp_stats_t *stats)
+{
+    BOOL admitted = FALSE;
+    int caller_id;
+
+    if (tp_get_lane_length(tp, shard, lane) + pending >= (unsigned int)g_disp_high_watermark)
+    {
+        stats->rejected_queue++;
+        DBG("Request rejected: task queue of shard %d lane %d reached high-water mark (%d)",
+             shard, lane, g_disp_high_watermark);
+    }
+    else if (g_disp_caller_rate <= 0)
+        return TRUE;
+    else
+    {
+        caller_id = disp_get_caller_id(msgbuf->msg);
+
+        pthread_mutex_lock(&g_disp_admit_lock);
+        admitted = disp_caller_take_token(caller_id);
+        pthread_mutex_unlock(&g_disp_admit_lock);
+
+        if (admitted)
+            return TRUE;
+
+        stats->rejected_rate++;
+        DBG("Request rejected: caller %d exceeded its rate", caller_id);
+    }
+
+    disp_send_busy_resp(shard, udp_sock, msgbuf->msg);
+
+    tp_put_msgbuf(tp, msgbuf);
+
+    return FALSE;
+}
+
+/* Logs number of receive syscalls and queue operations per request,
+   and contention counters of the task queue */
+static void disp_log_stats(tp_threadpool_t *tp, int shard, disp_stats_t *stats)
+{
+    tp_queue_stats_t qstats;
+    ep_valcache_stats_t vcstats;
+    ep_coproc_stats_t cpstats;
+    ep_exec_stats_t exstats;
+    unsigned long calls_x100, ops_x100;
+
+    if (stats->rcvd_msgs == 0)
+        return;
+
+    memset((char *)&qstats, 0, sizeof(qstats));
+    tp_get_queue_stats(tp, &qstats);
+
+    calls_x100 = stats->recv_calls * 100 / stats->rcvd_msgs;
+    ops_x100 = qstats.enq_task_cnt ? (qstats.enq_op_cnt * 100 / qstats.enq_task_cnt) : 0;
+
+    INFO("Dispatcher shard %d ingress (batch %d): %lu requests, %lu recv syscalls "
+         "(%lu.%02lu per request), %lu queue operations for %lu tasks (%lu.%02lu per task)",
+         shard, EP_DISP_RECV_BATCH, stats->rcvd_msgs, stats->recv_calls,
+         calls_x100 / 100, calls_x100 % 100, qstats.enq_op_cnt, qstats.enq_task_cnt,
+         ops_x100 / 100, ops_x100 % 100);
+
+    INFO("Task queue contention: enqueue retries %lu, dequeue retries %lu, "
+         "worker parks %lu, wake-ups %lu, tasks stolen by other groups %lu",
+         qstats.enq_retry_cnt, qstats.deq_retry_cnt, qstats.park_cnt, qstats.wake_cnt,
+         qstats.steal_cnt);
+
+    INFO("Dispatcher shard %d admission: rejected %lu (queue high-water mark), %lu (caller rate), "
+         "dropped %lu", shard, stats->rejected_queue, stats->rejected_rate, stats->dropped);
+
+    if (shard == 0 && ep_valcache_enabled())
+    {
+        ep_valcache_get_stats(&vcstats);
+        INFO("Value cache: %lu hits, %lu misses, %lu values (%lu stored, %lu expired, "
+             "%lu invalidated, %lu not stored - cache is full)", vcstats.hits, vcstats.misses,
+             vcstats.entries, vcstats.stores, vcstats.expired, vcstats.invalidated, vcstats.full);
+    }
+
+    if (shard == 0 && ep_coproc_enabled())
+    {
+        ep_coproc_get_stats(&cpstats);
+        INFO("Script helper: %lu commands, %lu coprocesses started (pool %d), %lu failed "
+             "(%lu timed out), %lu outputs truncated", cpstats.calls, cpstats.spawns,
+             cpstats.num, cpstats.failures, cpstats.timeouts, cpstats.truncated);
+    }
+
+    if (shard == 0)
+    {
+        ep_exec_get_stats(&exstats);
+        if (exstats.calls > 0)
+            INFO("External commands: %lu run (%lu by shell), %lu not started, %lu killed by "
+                 "timeout, spawn time %lu us average, %lu us max", exstats.calls,
+                 exstats.shell_calls, exstats.spawn_errors, exstats.timeouts,
+                 exstats.spawn_us / exstats.calls, exstats.spawn_us_max);
+    }
+
+    stats->logged_msgs = stats->rcvd_msgs;
+}
+
+/* Dispatcher receive state shared by all ingress sockets of the shard */
+typedef struct disp_ctx_s {
+    tp_threadpool_t *tp;
+    int shard;                      /* tasks are added to the queues of the shard */
+    int udp_sock;                   /* "busy" responses are sent from it */
+    disp_stats_t stats;
+
+#if EP_DISP_RECV_BATCH > 1
+    int buf_num;
+    tp_msgbuf_t *bufs[EP_DISP_RECV_BATCH];
+    tp_task_t tasks[EP_DISP_RECV_BATCH];
+
+    struct mmsghdr msgs[EP_DISP_RECV_BATCH];
+    struct iovec iovecs[EP_DISP_RECV_BATCH];
+    /* Client addresses (UDP or Unix) */
+    struct sockaddr_storage client_addrs[EP_DISP_RECV_BATCH];
+#else
+    tp_msgbuf_t *msgbuf;
+#endif
+} disp_ctx_t;
+
+#if EP_DISP_RECV_BATCH > 1
+static void disp_ctx_init(disp_ctx_t *ctx)
+{
+    for (int i = 0; i < EP_DISP_RECV_BATCH; i++)
+    {
+        ctx->iovecs[i].iov_len = MAX_DISP_MSG_LEN - 1;
+        ctx->msgs[i].msg_hdr.msg_iov = &ctx->iovecs[i];
+        ctx->msgs[i].msg_hdr.msg_iovlen = 1;
+        ctx->msgs[i].msg_hdr.msg_name = &ctx->client_addrs[i];
+    }
+}
+
+static void disp_ctx_cleanup(disp_ctx_t *ctx)
+{
+    for (int i = 0; i < ctx->buf_num; i++)
+        tp_put_msgbuf(ctx->tp, ctx->bufs[i]);
+
+    ctx->buf_num = 0;
+}
+
+/* Batched receiving: all datagrams queued on the socket (up to
+   EP_DISP_RECV_BATCH) are received by one recvmmsg call directly into
+   the pool message buffers and added to the task queue at once */
+static void disp_recv(disp_ctx_t *ctx, int sock)
+{
+    tp_threadpool_t *tp = ctx->tp;
+    ep_stat_t status;
+    int i, res, added = 0, task_num = 0;
+    int hold = TRUE, reason = 0;
+    unsigned int lane_pending[TP_LANE_NUM];
+    tp_lane_t lane;
+
+    /* Take buffers instead of the ones passed to the workers */
+    if (ctx->buf_num < EP_DISP_RECV_BATCH)
+        ctx->buf_num += tp_get_msgbufs(tp, &ctx->bufs[ctx->buf_num],
+                                       EP_DISP_RECV_BATCH - ctx->buf_num);
+
+    if (ctx->buf_num == 0)
+    {
+        /* The socket stays readable; it is polled again after the wait */
+        ERROR("No free message buffers in Dispatcher");
+        usleep(DISP_NOBUF_WAIT_TIME);
+        return;
+    }
+
+    for (i = 0; i < ctx->buf_num; i++)
+    {
+        ctx->iovecs[i].iov_base = ctx->bufs[i]->data;
+        ctx->msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+    }
+
+    /* Take all the datagrams that are already queued on the socket */
+    res = recvmmsg(sock, ctx->msgs, ctx->buf_num, MSG_DONTWAIT, NULL);
+    if (res <= 0)
+    {
+        if (res < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            ERROR("Failed to receive messages in Dispatcher: %s", strerror(errno));
+        return;
+    }
+
+    ctx->stats.recv_calls++;
+    ctx->stats.rcvd_msgs += res;
+
+    if ((ep_common_check_hold_status(&hold, &reason) != EPS_OK) || (hold == TRUE))
+    {
+        /* Buffers are kept by dispatcher for the next receiving */
+        DBG("%d request(s) dropped, since Entry-point is on HOLD - reason %d; ",
+             res, reason);
+        ctx->stats.dropped += res;
+        return;
+    }
+
+    memset((char *)lane_pending, 0, sizeof(lane_pending));
+
+    for (i = 0; i < res; i++)
+    {
+        ctx->bufs[i]->data[ctx->msgs[i].msg_len] = '\0';
+        ctx->bufs[i]->msg = ((ep_packet_t *)ctx->bufs[i]->data)->msg;
+
+        DBG("Received %d bytes (%d of %d):\n%s", ctx->msgs[i].msg_len, i + 1, res,
+             ctx->bufs[i]->msg);
+
+        lane = disp_get_msg_lane(ctx->bufs[i]->msg);
+
+        /* Rejected request buffer is returned to the pool */
+        if (!disp_admit_msg(tp, ctx->shard, ctx->udp_sock, ctx->bufs[i], lane,
+                            lane_pending[lane], &ctx->stats))
+            continue;
+
+        ctx->tasks[task_num].task_type = TASK_TYPE_RAW;
+        ctx->tasks[task_num].lane = lane;
+        ctx->tasks[task_num].shard = ctx->shard;
+        ctx->tasks[task_num].msgbuf = ctx->bufs[i];
+        task_num++;
+        lane_pending[lane]++;
+    }
+
+    /* Buffers of the admitted messages are owned by the thread pool now */
+    if (task_num > 0 &&
+        (status = tp_add_tasks(tp, ctx->tasks, task_num, &added)) != EPS_OK)
+    {
+        ERROR("Could not handle %d of %d message(s) (%d)", task_num - added,
+               task_num, status);
+        ctx->stats.dropped += task_num - added;
+    }
+
+    ctx->buf_num -= res;
+    memmove(&ctx->bufs[0], &ctx->bufs[res], ctx->buf_num * sizeof(ctx->bufs[0]));
+}
+#else
+static void disp_ctx_init(disp_ctx_t *ctx)
+{
+    ctx->msgbuf = NULL;
+}
+
+static void disp_ctx_cleanup(disp_ctx_t *ctx)
+{
+    if (ctx->msgbuf)
+        tp_put_msgbuf(ctx->tp, ctx->msgbuf);
+
+    ctx->msgbuf = NULL;
+}
+
+/* Ownership of the message buffer is passed to the thread pool; the buffer
+   is returned to the pool if the request is dropped */
+static ep_stat_t disp_handle_msg(tp_threadpool_t *tp, int shard, tp_msgbuf_t *msgbuf,
+                                 tp_lane_t lane)
 {
     // TODO flags
     ep_stat_t status = EPS_OK;
@@ -180,69 +698,257 @@ static ep_stat_t disp_handle_msg(tp_threadpool_t *tp, const char *xmlmsg)
     if ((ep_common_check_hold_status(&hold, &reason) == EPS_OK) && (hold == FALSE))
     {
         task.task_type = TASK_TYPE_RAW;
-        strncpy(task.raw_message, ((ep_packet_t *)xmlmsg)->msg, MAX_DISP_MSG_LEN-1);
+        task.lane = lane;
+        task.shard = shard;
+        task.msgbuf = msgbuf;
         status = tp_add_task(tp, &task);
     }
     else
     {
         DBG("Request dropped, since Entry-point is on HOLD - reason %d; ", reason);
+        tp_put_msgbuf(tp, msgbuf);
         status = EPS_EP_HOLD;
     }
 
     return status;
 }
 
-static ep_stat_t disp_loop(tp_threadpool_t *tp, int udp_sock, int ipc_sock)
+static void disp_recv(disp_ctx_t *ctx, int sock)
 {
+    tp_threadpool_t *tp = ctx->tp;
     ep_stat_t status;
+    tp_lane_t lane;
+    int res;
 
-    char msg_buffer[MAX_DISP_MSG_LEN];
-    /* Client address */
-    struct sockaddr_in client_addr;
-    socklen_t client_addr_len;
-    client_addr_len = sizeof(struct sockaddr_in);
+    /* Datagram is received directly into the pool buffer */
+    if (!ctx->msgbuf && (ctx->msgbuf = tp_get_msgbuf(tp)) == NULL)
+    {
+        /* The socket stays readable; it is polled again after the wait */
+        ERROR("No free message buffers in Dispatcher");
+        usleep(DISP_NOBUF_WAIT_TIME);
+        return;
+    }
 
-    while (!g_disp_loop_terminated && !g_disp_restart)
+    res = recv(sock, ctx->msgbuf->data, MAX_DISP_MSG_LEN - 1, MSG_DONTWAIT);
+    if (res < 0)
     {
-        //DBG("dispatcher loop cycle %d", cnt++);
-        /* Listen to UDP socket */
-        int res = recvfrom(udp_sock, msg_buffer, MAX_DISP_MSG_LEN, 0,
-                            (struct sockaddr *) &client_addr, &client_addr_len);
-        if (res < 0)
-        {
-            if (errno != 0 && errno != EAGAIN)
-                ERROR("Failed to receive a message in Dispatcher: %s",
-                                                               strerror(errno));
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            ERROR("Failed to receive a message in Dispatcher: %s", strerror(errno));
+        return;
+    }
+
+    ctx->msgbuf->data[res] = '\0';
+    ctx->msgbuf->msg = ((ep_packet_t *)ctx->msgbuf->data)->msg;
+
+    ctx->stats.recv_calls++;
+    ctx->stats.rcvd_msgs++;
+
+    DBG("Received %d bytes:\n%s", res, ctx->msgbuf->msg);
+
+    lane = disp_get_msg_lane(ctx->msgbuf->msg);
+
+    /* The buffer is owned by the thread pool now (or returned to the
+       pool if the request is rejected) */
+    if (!disp_admit_msg(tp, ctx->shard, ctx->udp_sock, ctx->msgbuf, lane, 0, &ctx->stats))
+    {
+        ctx->msgbuf = NULL;
+        return;
+    }
+
+    status = disp_handle_msg(tp, ctx->shard, ctx->msgbuf, lane);
+    ctx->msgbuf = NULL;
+
+    if (status != EPS_OK)
+    {
+        ERROR("Could not handle the message (%d)", status);
+        ctx->stats.dropped++;
+    }
+}
+#endif /* EP_DISP_RECV_BATCH > 1 */
+
+/* Event-driven dispatcher loop of one shard. Front API requests are
+   received from the UDP socket of the shard and from the Unix datagram
+   socket (fast path for local front-ends, -1 for all shards except 0);
+   termination and restart requests come through the control eventfd,
+   so the loop sleeps in epoll_wait without any timeout */
+static ep_stat_t disp_loop(tp_threadpool_t *tp, int shard, int udp_sock, int ipc_sock)
+{
+    disp_ctx_t ctx;
+    struct epoll_event ev, events[DISP_EPOLL_MAX_EVENTS];
+    int fds[] = {udp_sock, ipc_sock, g_disp_ctl_fd};
+    int epfd, i, n;
+    uint64_t cnt;
+
+    memset((char *)&ctx, 0, sizeof(ctx));
+    ctx.tp = tp;
+    ctx.shard = shard;
+    ctx.udp_sock = udp_sock;
+    disp_ctx_init(&ctx);
+
+    if ((epfd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+    {
+        ERROR("Could not create epoll instance: %s", strerror(errno));
+        return EPS_SYSTEM_ERROR;
+    }
+
+    for (i = 0; i < (int)(sizeof(fds)/sizeof(fds[0])); i++)
+    {
+        if (fds[i] < 0)
             continue;
-        }
 
-        msg_buffer[res] = '\0';
+        memset((char *)&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = fds[i];
 
-        DBG("Received %d bytes:\n%s", res, ((ep_packet_t *)msg_buffer)->msg);
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, fds[i], &ev) < 0)
+        {
+            ERROR("Could not add fd %d to epoll: %s", fds[i], strerror(errno));
+            close(epfd);
+            return EPS_SYSTEM_ERROR;
+        }
+    }
 
-        if ((status = disp_handle_msg(tp, msg_buffer)) != EPS_OK)
+    while (!g_disp_loop_terminated && !g_disp_restart)
+    {
+        n = epoll_wait(epfd, events, DISP_EPOLL_MAX_EVENTS, -1);
+        if (n < 0)
         {
-            ERROR("Could not handle the message (%d)", status);
+            if (errno != EINTR)
+                ERROR("epoll_wait failed in Dispatcher: %s", strerror(errno));
             continue;
         }
+
+        for (i = 0; i < n; i++)
+        {
+            if (events[i].data.fd == g_disp_ctl_fd)
+            {
+                /* Flags are checked by the loop condition; the counter is
+                   left for the other shards then */
+                if (!g_disp_loop_terminated && !g_disp_restart &&
+                    read(g_disp_ctl_fd, &cnt, sizeof(cnt)) < 0 && errno != EAGAIN)
+                    ERROR("Could not read control eventfd: %s", strerror(errno));
+                continue;
+            }
+
+            disp_recv(&ctx, events[i].data.fd);
+        }
+
+        if (ctx.stats.rcvd_msgs - ctx.stats.logged_msgs >= EP_DISP_STATS_INTERVAL)
+            disp_log_stats(tp, shard, &ctx.stats);
     }
 
-    DBG("Exit from disp loop. Termination flag %d, restart flag %d",
-         g_disp_loop_terminated, g_disp_restart);
+    disp_ctx_cleanup(&ctx);
+    close(epfd);
+
+    disp_log_stats(tp, shard, &ctx.stats);
+
+    DBG("Exit from disp loop of shard %d. Termination flag %d, restart flag %d",
+         shard, g_disp_loop_terminated, g_disp_restart);
 
     return EPS_OK;
 }
 
-/* Create sockets */
-static ep_stat_t disp_sockets_init(int *udp_sock, int *ipc_sock)
+static ep_stat_t disp_set_nonblocking(int sock)
 {
-    ep_stat_t status;
+    int flags = fcntl(sock, F_GETFL, 0);
 
-    status = udp_socket_init(udp_sock, MMX_EP_ADDR, MMX_EP_PORT);
-    if (status != EPS_OK)
+    if (flags < 0 || fcntl(sock, F_SETFL, flags | O_NONBLOCK) < 0)
     {
-        ERROR("Failed to create UDP socket (%d)", status);
-        return status;
+        ERROR("Could not set socket %d non-blocking: %s", sock, strerror(errno));
+        return EPS_SYSTEM_ERROR;
+    }
+
+    return EPS_OK;
+}
+
+/* Number of dispatcher shards is taken from environment */
+static int disp_get_shards_num(void)
+{
+    char *setting;
+    int num = 1;
+
+    if ((setting = EP_DISP_SHARDS) != NULL && atoi(setting) > 0)
+        num = atoi(setting);
+
+    if (num > EP_DISP_MAX_SHARDS)
+        num = EP_DISP_MAX_SHARDS;
+
+#ifndef SO_REUSEPORT
+    if (num > 1)
+    {
+        WARN("SO_REUSEPORT is not supported. Dispatcher is not sharded");
+        num = 1;
+    }
+#endif
+
+    return num;
+}
+
+#ifdef SO_REUSEPORT
+/* Creates UDP socket of the shard bound to the EP port. All the shard
+   sockets share the port, the kernel balances datagrams between them */
+static ep_stat_t disp_shard_socket_init(int *udp_sock)
+{
+    struct sockaddr_in addr;
+    int sock, on = 1;
+
+    if ((sock = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
+    {
+        ERROR("Could not create UDP socket: %s", strerror(errno));
+        return EPS_SYSTEM_ERROR;
+    }
+
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0)
+    {
+        ERROR("Could not set SO_REUSEPORT: %s", strerror(errno));
+        close(sock);
+        return EPS_SYSTEM_ERROR;
+    }
+
+    memset((char *)&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(MMX_EP_PORT);
+    addr.sin_addr.s_addr = htonl(MMX_EP_ADDR);
+
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        ERROR("Could not bind UDP socket to port %d: %s", MMX_EP_PORT, strerror(errno));
+        close(sock);
+        return EPS_SYSTEM_ERROR;
+    }
+
+    *udp_sock = sock;
+
+    return EPS_OK;
+}
+#endif
+
+/* Create sockets of the shards and the control eventfd */
+static ep_stat_t disp_sockets_init(int *ipc_sock)
+{
+    ep_stat_t status = EPS_OK;
+    int i;
+
+    for (i = 0; i < g_disp_shard_num; i++)
+    {
+        g_disp_shards[i].id = i;
+        g_disp_shards[i].started = FALSE;
+
+#ifdef SO_REUSEPORT
+        if (g_disp_shard_num > 1)
+            status = disp_shard_socket_init(&(g_disp_shards[i].udp_sock));
+        else
+#endif
+            status = udp_socket_init(&(g_disp_shards[i].udp_sock), MMX_EP_ADDR, MMX_EP_PORT);
+
+        if (status != EPS_OK)
+        {
+            ERROR("Failed to create UDP socket of shard %d (%d)", i, status);
+            return status;
+        }
+
+        if ((status = disp_set_nonblocking(g_disp_shards[i].udp_sock)) != EPS_OK)
+            return status;
     }
 
     status = unix_socket_init(ipc_sock, SUN_DISP_NAME);
@@ -252,21 +958,91 @@ static ep_stat_t disp_sockets_init(int *udp_sock, int *ipc_sock)
         return status;
     }
 
-    /* set timeout on udp socket */
-    struct timeval timeout;
-    timeout.tv_sec = DISP_SOCK_TIMEOUT;
-    timeout.tv_usec = 0;
+    /* Sockets are polled by epoll, so receiving never blocks */
+    if ((status = disp_set_nonblocking(*ipc_sock)) != EPS_OK)
+        return status;
 
-    if (setsockopt(*udp_sock, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeout,
-                                                           sizeof(timeout)) < 0)
+    g_disp_ctl_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_disp_ctl_fd < 0)
     {
-        ERROR("Dispatcher's udp sock timeout setting failed: %s", strerror(errno));
+        ERROR("Failed to create control eventfd: %s", strerror(errno));
         return EPS_SYSTEM_ERROR;
     }
 
     return EPS_OK;
 }
 
+static void disp_sockets_close(int ipc_sock)
+{
+    for (int i = 0; i < g_disp_shard_num; i++)
+    {
+        if (g_disp_shards[i].udp_sock >= 0)
+            close(g_disp_shards[i].udp_sock);
+        g_disp_shards[i].udp_sock = -1;
+    }
+
+    close(ipc_sock);
+    close(g_disp_ctl_fd); g_disp_ctl_fd = -1;
+}
+
+static void *disp_shard_thread(void *arg)
+{
+    disp_shard_t *shard = (disp_shard_t *)arg;
+    char name[8];
+
+    snprintf(name, sizeof(name), "DS%d", shard->id);
+    tiddb_add(name);
+
+    disp_loop(shard->tp, shard->id, shard->udp_sock, -1);
+
+    tiddb_del();
+    return NULL;
+}
+
+/* Starts dispatcher threads of the shards except shard 0 that runs in
+   the main thread */
+static void disp_shards_start(tp_threadpool_t *tp)
+{
+    pthread_attr_t tattr;
+    int i, ret;
+
+    pthread_attr_init(&tattr);
+    pthread_attr_setstacksize(&tattr, EP_PTHREAD_STACK_SIZE);
+
+    for (i = 1; i < g_disp_shard_num; i++)
+    {
+        g_disp_shards[i].tp = tp;
+
+        ret = pthread_create(&(g_disp_shards[i].tid), &tattr, disp_shard_thread,
+                             (void *)&g_disp_shards[i]);
+        if (ret != 0)
+        {
+            /* Once the socket is closed, the kernel balances its requests
+               to the sockets of other shards */
+            ERROR("Could not create dispatcher thread of shard %d: %s", i, strerror(ret));
+            close(g_disp_shards[i].udp_sock);
+            g_disp_shards[i].udp_sock = -1;
+            continue;
+        }
+
+        g_disp_shards[i].started = TRUE;
+    }
+
+    pthread_attr_destroy(&tattr);
+}
+
+static void disp_shards_stop(void)
+{
+    for (int i = 1; i < g_disp_shard_num; i++)
+    {
+        if (g_disp_shards[i].started)
+        {
+            pthread_join(g_disp_shards[i].tid, NULL);
+            g_disp_shards[i].started = FALSE;
+        }
+    }
+}
+
 #if !DEBUG
 /* Makes us a daemon */
 static ep_stat_t m_daemonize()
@@ -298,7 +1074,6 @@ static ep_stat_t m_daemonize()
 static ep_stat_t disp_restart_ep()
 {
     char buf[256] = {0};
-    FILE *fp;
 
     memset((char*)buf, 0, sizeof(buf));
 
@@ -311,17 +1086,27 @@ static ep_stat_t disp_restart_ep()
     DBG("Restart command: %s", buf);
 
     /* Perform the prepared command */
-    fp = popen(buf, "r");
-    if (!fp)
+    if (ep_exec_run(buf, NULL, 0, EP_EXEC_NO_OUTPUT, 0, NULL, NULL, NULL) != EPS_OK)
     {
         DBG("Could not execute prepared command");
         return EPS_SYSTEM_ERROR;
     }
-    pclose(fp);
 
     return EPS_OK;
 }
 
+/* Waits until the init task is done by a worker. Returns time of the
+   wait in msecs */
+static long disp_wait_init_task(tp_completion_t *completion, const char *name)
+{
+    long start = ep_time_ms();
+
+    if (tp_completion_wait(completion, EP_INIT_TASK_TIMEOUT * 1000) != EPS_OK)
+        WARN("%s is not done in %d secs. Continuing", name, EP_INIT_TASK_TIMEOUT);
+
+    return ep_time_ms() - start;
+}
+
 static void m_handle_error_signal(int signo)
 {
     CRITICAL("Caught error signal %d (%s)", signo, strsignal(signo));
@@ -332,6 +1117,7 @@ static void m_handle_term_signal(int signo)
 {
     CRITICAL("Caught termination signal %d (%s)", signo, strsignal(signo));
     g_disp_loop_terminated = TRUE;
+    disp_ctl_notify();
 }
 
 /* TODO check Signal handlers work properly */
@@ -355,8 +1141,12 @@ static void m_setup_signals(void)
 int main(int argc, char **argv)
 {
     ep_stat_t status = EPS_OK;
-    int udp_sock, ipc_sock;
+    int ipc_sock;
     tp_threadpool_t *tp = NULL;
+    /* Init tasks are signalled by workers, so the completions must stay
+       valid even if the wait times out */
+    tp_completion_t init_actions_done, discovery_done;
+    long start_ms, init_actions_ms = 0, discovery_ms = 0;
 
 #if USE_SYSLOG
     ep_openlog();
@@ -366,7 +1156,17 @@ int main(int argc, char **argv)
     DBG("define MMXBA_MAX_NUMBER_OF_SET_PARAMS = [%d]", MMXBA_MAX_NUMBER_OF_SET_PARAMS);
     DBG("define MAX_PARAMS_PER_OBJECT = [%d]", MAX_PARAMS_PER_OBJECT);
     DBG("define EP_TP_WORKER_THREADS_NUM = [%d]", EP_TP_WORKER_THREADS_NUM);
+    DBG("define EP_TP_MAX_WORKER_THREADS_NUM = [%d]", EP_TP_MAX_WORKER_THREADS_NUM);
     DBG("define EP_PTHREAD_STACK_SIZE = [%d]", EP_PTHREAD_STACK_SIZE);
+    DBG("define EP_DISP_RECV_BATCH = [%d]", EP_DISP_RECV_BATCH);
+    DBG("define EP_DISP_MAX_SHARDS = [%d]", EP_DISP_MAX_SHARDS);
+    DBG("define EP_DISP_QUEUE_HIGH_WATERMARK = [%d]", EP_DISP_QUEUE_HIGH_WATERMARK);
+    DBG("define EP_DISP_CALLER_DEF_RATE/BURST = [%d/%d]", EP_DISP_CALLER_DEF_RATE,
+         EP_DISP_CALLER_DEF_BURST);
+    DBG("define TP_LANE_WEIGHT_READ/WRITE/MAINT = [%d/%d/%d]", TP_LANE_WEIGHT_READ,
+         TP_LANE_WEIGHT_WRITE, TP_LANE_WEIGHT_MAINT);
+    DBG("define TP_LANE_READ_RESERVED_WORKERS = [%d]", TP_LANE_READ_RESERVED_WORKERS);
+    DBG("define TP_LANE_MAINT_MAX_WORKERS = [%d]", TP_LANE_MAINT_MAX_WORKERS);
 
 #if !DEBUG
     if (m_daemonize())
@@ -379,6 +1179,7 @@ int main(int argc, char **argv)
 ep_disp_init:
 
     g_disp_initialized = FALSE;
+    start_ms = ep_time_ms();
 
     status = ep_common_init();
     if (status != EPS_OK)
@@ -391,31 +1192,44 @@ ep_disp_init:
 
     INFO(" ++++++ Entry point started (compiled on %s) ++++++", ING_TIMESTAMP);
 
-    if (disp_sockets_init(&udp_sock, &ipc_sock))
+    g_disp_shard_num = disp_get_shards_num();
+    disp_admit_init();
+
+    /* The models and values cached before the restart are not used: the
+       DBs are reinitialized by the init tasks */
+    ep_model_invalidate_all();
+    ep_valcache_invalidate("");
+
+    if (disp_sockets_init(&ipc_sock))
     {
         CRITICAL("Could not initialize sockets for EP dispatcher. Exiting");
         exit(EXIT_FAILURE);
     }
-    DBG("EP sockets created: udp sock %d, ipc sock %d", udp_sock, ipc_sock);
+    DBG("EP sockets created: %d udp socket(s) (shard 0 sock %d), ipc sock %d",
+         g_disp_shard_num, g_disp_shards[0].udp_sock, ipc_sock);
 
     m_setup_signals();
 
-    /* Start pool of worker threads */
-    if (tp_init(&tp) != EPS_OK)
+    /* Start pool of worker threads: one group of queues per shard */
+    if (tp_init(&tp, g_disp_shard_num) != EPS_OK)
     {
         ERROR("Could not initialize thread pool");
         exit(EXIT_FAILURE);
     }
-    sleep(1);
 
-    /* Perform init actions and wait to allow normal work of init actions*/
-    disp_add_init_actions_task(tp);
-    sleep(1);
+    /* Perform init actions, then discover configuration. Requests are
+       served as soon as both tasks are done by the workers */
+    tp_completion_init(&init_actions_done);
+    if (disp_add_init_actions_task(tp, &init_actions_done) == EPS_OK)
+        init_actions_ms = disp_wait_init_task(&init_actions_done, "InitActions");
+    else
+        ERROR("Could not add InitActions task");
 
-    /* Add DiscoverConfig task to the queue and wait
-       before starting the main dispatcher loop      */
-    disp_add_config_discovery_task(tp);
-    sleep(EP_INIT_WAIT_TIMEOUT);
+    tp_completion_init(&discovery_done);
+    if (disp_add_config_discovery_task(tp, &discovery_done) == EPS_OK)
+        discovery_ms = disp_wait_init_task(&discovery_done, "DiscoverConfig");
+    else
+        ERROR("Could not add DiscoverConfig task");
 
 #ifdef MMX_EP_EXT_THRESHOLD
     ep_ext_init(tp);
@@ -423,8 +1237,15 @@ ep_disp_init:
 
     g_disp_initialized = TRUE;
 
-    DBG("Entering main loop - listening on port %d)", MMX_EP_PORT);
-    disp_loop(tp, udp_sock, ipc_sock);
+    INFO("Entry point is ready in %ld ms (InitActions %ld ms, DiscoverConfig %ld ms)",
+          ep_time_ms() - start_ms, init_actions_ms, discovery_ms);
+
+    disp_shards_start(tp);
+
+    DBG("Entering main loop - listening on port %d, %d shard(s)", MMX_EP_PORT,
+         g_disp_shard_num);
+    disp_loop(tp, 0, g_disp_shards[0].udp_sock, ipc_sock);
+    disp_shards_stop();
     DBG("Leaving main dispatcher loop");
 
 #ifdef MMX_EP_EXT_THRESHOLD
@@ -437,8 +1258,7 @@ ep_disp_init:
         exit(EXIT_FAILURE);
     }
 
-    close(udp_sock); udp_sock = 0;
-    close(ipc_sock); ipc_sock = 0;
+    disp_sockets_close(ipc_sock); ipc_sock = 0;
 
     if (g_disp_restart == TRUE)
     {
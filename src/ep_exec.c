@@ -0,0 +1,480 @@
+/* ep_exec.c
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+
+
+/*
+ * External command runner
+ */
+
+#define _GNU_SOURCE     /* pipe2 */
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+#include "ep_exec.h"
+
+#define EP_EXEC_MAX_ARGS        64
+#define EP_EXEC_READ_SIZE       4096
+#define EP_EXEC_POLL_MS         100    /* the command's exit is checked each period */
+
+/* Characters that need the shell to run the command */
+#define EP_EXEC_SHELL_CHARS     "|&;<>()$`\\\"'*?[]#~{}\n"
+
+extern char **environ;
+
+static pthread_mutex_t g_ex_lock = PTHREAD_MUTEX_INITIALIZER;
+static ep_exec_stats_t g_ex_stats;
+
+/* Output collected by ep_exec_read/ep_exec_read_alloc */
+typedef struct ep_exec_buf_s {
+    char *buf;
+    size_t len;
+    size_t size;
+    BOOL fixed;                   /* buf is given by the caller */
+    BOOL done;                    /* the first line is collected */
+    BOOL first_line;
+    BOOL nomem;
+} ep_exec_buf_t;
+
+long ep_exec_default_timeout(void)
+{
+    char *str;
+
+    if ((str = EP_EXEC_TIMEOUT) != NULL && atol(str) > 0)
+        return atol(str);
+
+    return EP_EXEC_DEF_TIMEOUT;
+}
+
+/* Splits the plain command to words; FALSE - the shell is needed */
+static BOOL ep_exec_split(char *buf, char **argv)
+{
+    char *strtok_ctx, *word;
+    int argc = 0;
+
+    if (strpbrk(buf, EP_EXEC_SHELL_CHARS))
+        return FALSE;
+
+    for (word = strtok_r(buf, " \t", &strtok_ctx); word; word = strtok_r(NULL, " \t", &strtok_ctx))
+    {
+        /* Variable assignments and too long commands */
+        if ((argc == 0 && strchr(word, '=')) || argc == EP_EXEC_MAX_ARGS)
+            return FALSE;
+        argv[argc++] = word;
+    }
+    argv[argc] = NULL;
+
+    return (argc > 0) ? TRUE : FALSE;
+}
+
+/* Writes the input to the command's stdin; SIGPIPE of a command that does
+   not read its input is blocked and consumed */
+static ssize_t ep_exec_write(int fd, const char *data, size_t len)
+{
+    sigset_t pipe_set, old_set;
+    struct timespec zero = {0, 0};
+    ssize_t n;
+
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_set, &old_set);
+
+    n = write(fd, data, len);
+    if (n < 0 && errno == EPIPE)
+    {
+        while (sigtimedwait(&pipe_set, NULL, &zero) < 0 && errno == EINTR)
+            ;
+        errno = EPIPE;
+    }
+
+    pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+    return n;
+}
+
+static void ep_exec_close(int *fd)
+{
+    if (*fd >= 0)
+        close(*fd);
+    *fd = -1;
+}
+
+ep_stat_t ep_exec_run(const char *cmd, const char *input, size_t input_len, int flags,
+                      long timeout_ms, ep_exec_reader_fn reader, void *ctx, int *exit_code)
+{
+    ep_stat_t status = EPS_OK;
+    char buf[EP_SQL_REQUEST_BUF_SIZE], data[EP_EXEC_READ_SIZE];
+    char *argv[EP_EXEC_MAX_ARGS + 1];
+    char *sh_argv[] = {"sh", "-c", (char *)cmd, NULL};
+    int out_pipe[2] = {-1, -1}, in_pipe[2] = {-1, -1};
+    int res, wstatus = 0, nfds;
+    BOOL shell, exited = FALSE;
+    long deadline, left, spawn_us, wait_us = 50;
+    struct timespec t0, t1, pause;
+    struct pollfd pfd[2];
+    posix_spawn_file_actions_t fa;
+    posix_spawnattr_t attr;
+    pid_t pid = 0;
+    ssize_t n;
+
+    if (exit_code)
+        *exit_code = -1;
+
+    if (timeout_ms <= 0)
+        timeout_ms = ep_exec_default_timeout();
+
+    strcpy_safe(buf, cmd, sizeof(buf));
+    shell = (strlen(cmd) >= sizeof(buf) || !ep_exec_split(buf, argv)) ? TRUE : FALSE;
+
+    if ((!(flags & EP_EXEC_NO_OUTPUT) && pipe2(out_pipe, O_CLOEXEC) < 0) ||
+        (input && pipe2(in_pipe, O_CLOEXEC) < 0))
+        GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not create pipe: %s", strerror(errno));
+
+    posix_spawn_file_actions_init(&fa);
+    if (input)
+        posix_spawn_file_actions_adddup2(&fa, in_pipe[0], STDIN_FILENO);
+    else
+        posix_spawn_file_actions_addopen(&fa, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+
+    if (flags & EP_EXEC_NO_OUTPUT)
+        posix_spawn_file_actions_addopen(&fa, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    else
+        posix_spawn_file_actions_adddup2(&fa, out_pipe[1], STDOUT_FILENO);
+
+    if ((flags & EP_EXEC_STDERR) && !(flags & EP_EXEC_NO_OUTPUT))
+        posix_spawn_file_actions_adddup2(&fa, out_pipe[1], STDERR_FILENO);
+
+    /* Own process group: the command is killed with its children */
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, 0);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if (shell)
+        res = posix_spawn(&pid, "/bin/sh", &fa, &attr, sh_argv, environ);
+    else
+        res = posix_spawnp(&pid, argv[0], &fa, &attr, argv, environ);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    posix_spawn_file_actions_destroy(&fa);
+    posix_spawnattr_destroy(&attr);
+    ep_exec_close(&out_pipe[1]);
+    ep_exec_close(&in_pipe[0]);
+
+    spawn_us = (t1.tv_sec - t0.tv_sec) * 1000000 + (t1.tv_nsec - t0.tv_nsec) / 1000;
+
+    pthread_mutex_lock(&g_ex_lock);
+    g_ex_stats.calls++;
+    if (shell) g_ex_stats.shell_calls++;
+    if (res != 0) g_ex_stats.spawn_errors++;
+    g_ex_stats.spawn_us += spawn_us;
+    if ((unsigned long)spawn_us > g_ex_stats.spawn_us_max)
+        g_ex_stats.spawn_us_max = spawn_us;
+    pthread_mutex_unlock(&g_ex_lock);
+
+    if (res != 0)
+    {
+        pid = 0;
+        GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not run %s: %s", cmd, strerror(res));
+    }
+
+    if (out_pipe[0] >= 0) fcntl(out_pipe[0], F_SETFL, O_NONBLOCK);
+    if (in_pipe[1] >= 0)  fcntl(in_pipe[1], F_SETFL, O_NONBLOCK);
+
+    /* Stream the input and the output until the command exits or closes
+       its output */
+    deadline = ep_time_ms() + timeout_ms;
+    while (out_pipe[0] >= 0 || in_pipe[1] >= 0)
+    {
+        if ((left = deadline - ep_time_ms()) <= 0)
+            break;
+
+        nfds = 0;
+        if (out_pipe[0] >= 0)
+        {
+            pfd[nfds].fd = out_pipe[0];
+            pfd[nfds++].events = POLLIN;
+        }
+        if (in_pipe[1] >= 0)
+        {
+            pfd[nfds].fd = in_pipe[1];
+            pfd[nfds++].events = POLLOUT;
+        }
+
+        res = poll(pfd, nfds, (left < EP_EXEC_POLL_MS) ? left : EP_EXEC_POLL_MS);
+        if (res < 0 && errno != EINTR)
+            GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "poll failed: %s", strerror(errno));
+
+        if (res <= 0)
+        {
+            /* The command exited, but its background children keep the
+               output open: take the rest and stop reading */
+            if (!exited && waitpid(pid, &wstatus, WNOHANG) == pid)
+            {
+                exited = TRUE;
+                while (out_pipe[0] >= 0 && (n = read(out_pipe[0], data, sizeof(data))) > 0)
+                {
+                    if (reader) reader(ctx, data, n);
+                }
+                ep_exec_close(&out_pipe[0]);
+                ep_exec_close(&in_pipe[1]);
+            }
+            continue;
+        }
+
+        for (nfds--; nfds >= 0; nfds--)
+        {
+            if (pfd[nfds].fd == in_pipe[1] && pfd[nfds].revents)
+            {
+                n = ep_exec_write(in_pipe[1], input, input_len);
+                if (n < 0 && errno != EAGAIN && errno != EINTR)
+                {
+                    WARN("Input of %s is not written: %s", cmd, strerror(errno));
+                    ep_exec_close(&in_pipe[1]);
+                }
+                else if (n > 0)
+                {
+                    input += n;
+                    input_len -= n;
+                }
+                if (input_len == 0)
+                    ep_exec_close(&in_pipe[1]);
+            }
+            else if (pfd[nfds].fd == out_pipe[0] && pfd[nfds].revents)
+            {
+                n = read(out_pipe[0], data, sizeof(data));
+                if (n > 0)
+                {
+                    if (reader) reader(ctx, data, n);
+                }
+                else if (n == 0 || (errno != EAGAIN && errno != EINTR))
+                    ep_exec_close(&out_pipe[0]);
+            }
+        }
+    }
+
+    /* Wait for the exit of the command */
+    while (!exited)
+    {
+        if ((res = waitpid(pid, &wstatus, WNOHANG)) == pid)
+        {
+            exited = TRUE;
+            break;
+        }
+        if (res < 0 && errno != EINTR)
+            GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not wait for %s: %s", cmd, strerror(errno));
+
+        if ((left = deadline - ep_time_ms()) <= 0)
+        {
+            status = EPS_TIMEOUT;
+            ERROR("%s did not complete in %ld ms, killed", cmd, timeout_ms);
+            pthread_mutex_lock(&g_ex_lock);
+            g_ex_stats.timeouts++;
+            pthread_mutex_unlock(&g_ex_lock);
+
+            kill(-pid, SIGKILL);
+            waitpid(pid, &wstatus, 0);
+            exited = TRUE;
+            break;
+        }
+
+        /* Short pauses first, the command usually exits with its output */
+        pause.tv_sec = 0;
+        pause.tv_nsec = ((wait_us < left * 1000) ? wait_us : left * 1000) * 1000;
+        nanosleep(&pause, NULL);
+        if (wait_us < EP_EXEC_POLL_MS * 1000 / 10)
+            wait_us *= 2;
+    }
+
+    if (status == EPS_OK && exit_code)
+    {
+        if (WIFEXITED(wstatus))
+            *exit_code = WEXITSTATUS(wstatus);
+        else if (WIFSIGNALED(wstatus))
+            *exit_code = 128 + WTERMSIG(wstatus);
+    }
+    pid = 0;
+
+ret:
+    if (pid > 0)
+    {
+        kill(-pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+    }
+    ep_exec_close(&out_pipe[0]);
+    ep_exec_close(&out_pipe[1]);
+    ep_exec_close(&in_pipe[0]);
+    ep_exec_close(&in_pipe[1]);
+
+    return status;
+}
+
+static void ep_exec_collect(void *ctx, const char *data, size_t len)
+{
+    ep_exec_buf_t *b = (ep_exec_buf_t *)ctx;
+    const char *nl;
+    char *new_buf;
+    size_t new_size;
+
+    if (b->done || b->nomem)
+        return;
+
+    if (b->first_line && (nl = memchr(data, '\n', len)) != NULL)
+    {
+        len = nl - data + 1;
+        b->done = TRUE;
+    }
+
+    if (b->len + len + 1 > b->size)
+    {
+        if (b->fixed)
+        {
+            len = b->size - b->len - 1;
+            b->done = TRUE;
+        }
+        else
+        {
+            new_size = b->size ? b->size * 2 : EP_EXEC_READ_SIZE;
+            while (new_size < b->len + len + 1)
+                new_size *= 2;
+            if ((new_buf = realloc(b->buf, new_size)) == NULL)
+            {
+                b->nomem = TRUE;
+                return;
+            }
+            b->buf = new_buf;
+            b->size = new_size;
+        }
+    }
+
+    memcpy(b->buf + b->len, data, len);
+    b->len += len;
+    b->buf[b->len] = '\0';
+}
+
+ep_stat_t ep_exec_read(const char *cmd, int flags, char *out, size_t out_size, int *exit_code)
+{
+    char cmd_buf[EP_SQL_REQUEST_BUF_SIZE];
+    ep_exec_buf_t b;
+
+    if (out_size == 0)
+        return EPS_INVALID_ARGUMENT;
+
+    memset(&b, 0, sizeof(b));
+    b.buf = out;
+    b.size = out_size;
+    b.fixed = TRUE;
+    b.first_line = (flags & EP_EXEC_FIRST_LINE) ? TRUE : FALSE;
+
+    /* The command may be prepared in the output buffer */
+    if (cmd == out)
+    {
+        strcpy_safe(cmd_buf, cmd, sizeof(cmd_buf));
+        cmd = cmd_buf;
+    }
+    out[0] = '\0';
+
+    return ep_exec_run(cmd, NULL, 0, flags, 0, ep_exec_collect, &b, exit_code);
+}
+
+ep_stat_t ep_exec_read_alloc(const char *cmd, const char *input, size_t input_len, int flags,
+                             char **out, int *exit_code)
+{
+    ep_stat_t status;
+    ep_exec_buf_t b;
+
+    memset(&b, 0, sizeof(b));
+    b.first_line = (flags & EP_EXEC_FIRST_LINE) ? TRUE : FALSE;
+
+    status = ep_exec_run(cmd, input, input_len, flags, 0, ep_exec_collect, &b, exit_code);
+
+    if (status == EPS_OK && b.nomem)
+        status = EPS_OUTOFMEMORY;
+
+    if (status == EPS_OK && !b.buf && !(b.buf = strdup("")))
+        status = EPS_OUTOFMEMORY;
+
+    if (status != EPS_OK)
+    {
+        free(b.buf);
+        b.buf = NULL;
+    }
+
+    *out = b.buf;
+    return status;
+}
+
+void ep_exec_get_stats(ep_exec_stats_t *stats)
+{
+    pthread_mutex_lock(&g_ex_lock);
+    *stats = g_ex_stats;
+    pthread_mutex_unlock(&g_ex_lock);
+}
@@ -0,0 +1,118 @@
+/* ep_exec.h
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+#ifndef EP_EXEC_H_
+#define EP_EXEC_H_
+
+#include "ep_common.h"
+
+/*
+ * Execution of external commands (method scripts, uci, ubus, init.d).
+ * The command is started by posix_spawn: directly if it is a plain list
+ * of words, otherwise by "/bin/sh -c". Its output is read through a
+ * non-blocking pipe and passed to the reader as it arrives. The command
+ * is killed (with its process group) if it does not complete in the
+ * timeout (EP_EXEC_TIMEOUT). The output is read until the command exits,
+ * so the processes it leaves in background do not hold the caller
+ */
+
+/* Flags of ep_exec_run */
+#define EP_EXEC_STDERR      0x01  /* stderr is read together with stdout */
+#define EP_EXEC_FIRST_LINE  0x02  /* only the first line is collected (ep_exec_read) */
+#define EP_EXEC_NO_OUTPUT   0x04  /* output is not read (goes to /dev/null) */
+
+/* Receives a portion of the command's output */
+typedef void (*ep_exec_reader_fn)(void *ctx, const char *data, size_t len);
+
+typedef struct ep_exec_stats_s {
+    unsigned long calls;
+    unsigned long shell_calls;    /* commands run by the shell */
+    unsigned long spawn_errors;
+    unsigned long timeouts;
+    unsigned long spawn_us;       /* total time of posix_spawn calls */
+    unsigned long spawn_us_max;
+} ep_exec_stats_t;
+
+/* Runs the command; input (if any) is written to its stdin. exit_code is
+   the exit status of the command (128 + signal if it was killed).
+   timeout_ms 0 - the default timeout. EPS_TIMEOUT - the command was killed */
+ep_stat_t ep_exec_run(const char *cmd, const char *input, size_t input_len, int flags,
+                      long timeout_ms, ep_exec_reader_fn reader, void *ctx, int *exit_code);
+
+/* Runs the command and collects its output in the buffer (truncated) */
+ep_stat_t ep_exec_read(const char *cmd, int flags, char *out, size_t out_size, int *exit_code);
+
+/* Runs the command and returns its output in allocated string */
+ep_stat_t ep_exec_read_alloc(const char *cmd, const char *input, size_t input_len, int flags,
+                             char **out, int *exit_code);
+
+/* Timeout of the commands (EP_EXEC_TIMEOUT or the default one), ms */
+long ep_exec_default_timeout(void);
+
+void ep_exec_get_stats(ep_exec_stats_t *stats);
+
+#endif /* EP_EXEC_H_ */
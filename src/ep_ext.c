@@ -216,15 +216,27 @@ static int make_request(mmx_ep_connection_t *conn, ep_message_t *msg, int *more)
 {
     int res;
     size_t rcvd;
+    char resp_buf[MAX_DISP_MSG_LEN];
     tp_task_t task = {.task_type = TASK_TYPE_RAW};
 
-    res = mmx_frontapi_message_build(msg, task.raw_message, MAX_DISP_MSG_LEN);
+    task.lane = (msg->header.msgType == MSGTYPE_GETVALUE ||
+                 msg->header.msgType == MSGTYPE_GETPARAMNAMES) ? TP_LANE_READ : TP_LANE_WRITE;
+
+    if ((task.msgbuf = tp_get_msgbuf(tpool)) == NULL)
+    {
+        ERROR("Could not get message buffer");
+        return FA_GENERAL_ERROR;
+    }
+
+    res = mmx_frontapi_message_build(msg, task.msgbuf->data, MAX_DISP_MSG_LEN);
     if (res != FA_OK)
     {
         ERROR("mmx_frontapi_message_build failed (%d)", res);
+        tp_put_msgbuf(tpool, task.msgbuf);
         return res;
     }
 
+    /* The message buffer is owned by the thread pool now */
     res = tp_add_task(tpool, &task);
     if (res != EPS_OK)
     {
@@ -232,14 +244,14 @@ static int make_request(mmx_ep_connection_t *conn, ep_message_t *msg, int *more)
         return res;
     }
 
-    res = mmx_frontapi_receive_resp(conn, msg->header.txaId, task.raw_message, MAX_DISP_MSG_LEN, &rcvd);
+    res = mmx_frontapi_receive_resp(conn, msg->header.txaId, resp_buf, sizeof(resp_buf), &rcvd);
     if (res != FA_OK)
     {
         ERROR("mmx_frontapi_receive_resp failed (%d)", res);
         return res;
     }
 
-    res = mmx_frontapi_message_parse(task.raw_message, msg);
+    res = mmx_frontapi_message_parse(resp_buf, msg);
     if (res != FA_OK)
     {
         ERROR("mmx_frontapi_message_parse failed (%d)", res);
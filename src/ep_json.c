@@ -0,0 +1,360 @@
+/* ep_json.c
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+
+
+/*
+ * Minimal JSON reader used to extract values from ubus call results
+ */
+
+#include <ctype.h>
+
+#include "ep_json.h"
+
+#define EP_JSON_MAX_DEPTH   32
+
+static const char *ep_json_ws(const char *p)
+{
+    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+        p++;
+    return p;
+}
+
+/* p points to the opening quote; returns the position after the closing one */
+static const char *ep_json_skip_string(const char *p)
+{
+    for (p++; *p && *p != '"'; p++)
+    {
+        if (*p == '\\' && *(++p) == '\0')
+            return NULL;
+    }
+    return (*p == '"') ? p + 1 : NULL;
+}
+
+/* Returns the position after the value beginning at p, NULL - invalid JSON */
+static const char *ep_json_skip_value(const char *p, int depth)
+{
+    char close;
+
+    p = ep_json_ws(p);
+
+    if (*p == '"')
+        return ep_json_skip_string(p);
+
+    if (*p == '{' || *p == '[')
+    {
+        if (depth >= EP_JSON_MAX_DEPTH)
+            return NULL;
+
+        close = (*p == '{') ? '}' : ']';
+        p = ep_json_ws(p + 1);
+        if (*p == close)
+            return p + 1;
+
+        while (TRUE)
+        {
+            if (close == '}')
+            {
+                if (*p != '"' || !(p = ep_json_skip_string(p)))
+                    return NULL;
+                p = ep_json_ws(p);
+                if (*p++ != ':')
+                    return NULL;
+            }
+            if (!(p = ep_json_skip_value(p, depth + 1)))
+                return NULL;
+
+            p = ep_json_ws(p);
+            if (*p == close)
+                return p + 1;
+            if (*p != ',')
+                return NULL;
+            p = ep_json_ws(p + 1);
+        }
+    }
+
+    /* Number, true, false or null */
+    if (!*p || !strchr("-0123456789tfn", *p))
+        return NULL;
+    while (*p && !strchr(",]} \t\r\n", *p))
+        p++;
+    return p;
+}
+
+/* Checks that the string at p (opening quote) is equal to the name */
+static BOOL ep_json_name_eq(const char *p, const char *name, size_t name_len)
+{
+    return (!strncmp(p + 1, name, name_len) && p[name_len + 1] == '"') ? TRUE : FALSE;
+}
+
+/* Finds the member with the name in the value at p and in its nested
+   values; returns the position of the member's value */
+static const char *ep_json_find(const char *p, const char *name, size_t name_len, int depth)
+{
+    const char *v, *found;
+    char close;
+    BOOL is_obj;
+
+    p = ep_json_ws(p);
+    if ((*p != '{' && *p != '[') || depth >= EP_JSON_MAX_DEPTH)
+        return NULL;
+
+    is_obj = (*p == '{') ? TRUE : FALSE;
+    close = is_obj ? '}' : ']';
+    p = ep_json_ws(p + 1);
+
+    while (*p && *p != close)
+    {
+        v = p;
+        if (is_obj)
+        {
+            if (*p != '"' || !(v = ep_json_skip_string(p)))
+                return NULL;
+            v = ep_json_ws(v);
+            if (*v++ != ':')
+                return NULL;
+            v = ep_json_ws(v);
+
+            if (ep_json_name_eq(p, name, name_len))
+                return v;
+        }
+
+        if ((found = ep_json_find(v, name, name_len, depth + 1)) != NULL)
+            return found;
+
+        if (!(p = ep_json_skip_value(v, depth + 1)))
+            return NULL;
+        p = ep_json_ws(p);
+        if (*p == ',')
+            p = ep_json_ws(p + 1);
+        else if (*p != close)
+            return NULL;
+    }
+
+    return NULL;
+}
+
+/* Returns the position of the member (object) or element (array) of the
+   value at p given by the path segment */
+static const char *ep_json_child(const char *p, const char *seg, size_t seg_len)
+{
+    const char *v;
+    char *end;
+    long pos = -1;
+
+    p = ep_json_ws(p);
+    if (*p == '[')
+    {
+        pos = strtol(seg, &end, 10);
+        if (end != seg + seg_len || pos < 0)
+            return NULL;
+    }
+    else if (*p != '{')
+        return NULL;
+
+    p = ep_json_ws(p + 1);
+    while (*p && *p != ']' && *p != '}')
+    {
+        v = p;
+        if (pos < 0)
+        {
+            if (*p != '"' || !(v = ep_json_skip_string(p)))
+                return NULL;
+            v = ep_json_ws(v);
+            if (*v++ != ':')
+                return NULL;
+            v = ep_json_ws(v);
+
+            if (ep_json_name_eq(p, seg, seg_len))
+                return v;
+        }
+        else if (pos-- == 0)
+            return v;
+
+        if (!(p = ep_json_skip_value(v, 0)))
+            return NULL;
+        p = ep_json_ws(p);
+        if (*p == ',')
+            p = ep_json_ws(p + 1);
+        else if (*p != ']' && *p != '}')
+            return NULL;
+    }
+
+    return NULL;
+}
+
+/* Copies the string at p (opening quote) without escapes */
+static void ep_json_unescape(const char *p, char *value, size_t value_size)
+{
+    size_t n = 0;
+    unsigned int c;
+    int i;
+    char hex[5] = {0};
+
+    for (p++; *p && *p != '"' && n + 1 < value_size; p++)
+    {
+        if (*p != '\\')
+        {
+            value[n++] = *p;
+            continue;
+        }
+
+        switch (*(++p))
+        {
+            case 'b': value[n++] = '\b'; break;
+            case 'f': value[n++] = '\f'; break;
+            case 'n': value[n++] = '\n'; break;
+            case 'r': value[n++] = '\r'; break;
+            case 't': value[n++] = '\t'; break;
+            case 'u':
+                /* The digits are checked one by one, so the scan stops
+                   at the end of the text */
+                for (i = 1; i <= 4 && isxdigit((unsigned char)p[i]); i++)
+                    ;
+                if (i <= 4)
+                {
+                    value[n++] = 'u';
+                    break;
+                }
+                memcpy(hex, p + 1, 4);
+                c = (unsigned int)strtoul(hex, NULL, 16);
+                p += 4;
+                /* UTF-8 encoding (surrogate pairs are not combined);
+                   \u0000 is skipped, it would end the value */
+                if (c == 0)
+                    break;
+                if (c < 0x80)
+                    value[n++] = (char)c;
+                else if (c < 0x800 && n + 2 < value_size)
+                {
+                    value[n++] = (char)(0xC0 | (c >> 6));
+                    value[n++] = (char)(0x80 | (c & 0x3F));
+                }
+                else if (c >= 0x800 && n + 3 < value_size)
+                {
+                    value[n++] = (char)(0xE0 | (c >> 12));
+                    value[n++] = (char)(0x80 | ((c >> 6) & 0x3F));
+                    value[n++] = (char)(0x80 | (c & 0x3F));
+                }
+                break;
+            case '\0':
+                p--;
+                break;
+            default: /* '"', '\\', '/' */
+                value[n++] = *p;
+                break;
+        }
+    }
+
+    value[n] = '\0';
+}
+
+ep_stat_t ep_json_get(const char *json, const char *key, char *value, size_t value_size)
+{
+    const char *p, *end, *seg, *next;
+    size_t len;
+
+    if (!json || !key || !value || value_size == 0)
+        return EPS_INVALID_ARGUMENT;
+
+    value[0] = '\0';
+
+    if (!strchr(key, '/'))
+    {
+        p = ep_json_find(json, key, strlen(key), 0);
+    }
+    else
+    {
+        for (p = json, seg = key; p && seg; seg = next)
+        {
+            next = strchr(seg, '/');
+            len = next ? (size_t)(next++ - seg) : strlen(seg);
+            p = ep_json_child(p, seg, len);
+        }
+    }
+
+    if (p == NULL)
+        return EPS_NOT_FOUND;
+
+    if (!(end = ep_json_skip_value(p, 0)))
+        return EPS_INVALID_FORMAT;
+
+    if (*p == '"')
+    {
+        ep_json_unescape(p, value, value_size);
+    }
+    else
+    {
+        len = end - p;
+        if (len >= value_size)
+            len = value_size - 1;
+        memcpy(value, p, len);
+        value[len] = '\0';
+    }
+
+    return EPS_OK;
+}
@@ -0,0 +1,607 @@
+/* ep_model.c
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+
+/*
+ * Management model cache
+ */
+
+#include <ctype.h>
+#include <pthread.h>
+#include <strings.h>
+
+#include "ep_model.h"
+
+#define EP_MODEL_INIT_OBJ_SIZE    256
+#define EP_MODEL_INIT_PARAM_SIZE  16
+#define EP_MODEL_INIT_NODE_SIZE   512
+
+static pthread_mutex_t g_model_lock = PTHREAD_MUTEX_INITIALIZER;
+static ep_model_t *g_models[EP_MODEL_DBTYPES_NUM];
+static BOOL g_model_failed[EP_MODEL_DBTYPES_NUM];
+static volatile int g_model_gen[EP_MODEL_DBTYPES_NUM];
+
+static ep_model_t *ep_model_create(int db_type)
+{
+    ep_model_t *model = (ep_model_t *)calloc(1, sizeof(ep_model_t));
+
+    if (!model)
+        return NULL;
+
+    model->db_type = db_type;
+    model->refcnt = 1;
+
+    return model;
+}
+
+static void ep_model_destroy(ep_model_t *model)
+{
+    int i;
+
+    for (i = 0; i < model->obj_num; i++)
+    {
+        free(model->objs[i].params);
+        free(model->objs[i].idx_params);
+    }
+
+    free(model->objs);
+    free(model->hash);
+    free(model->trie);
+    free(model->trie_subs);
+    free(model);
+}
+
+/* Adds the object to the end of the model. Position of the object is
+   returned in obj_pos */
+ep_stat_t ep_model_obj_add(ep_model_t *model, const obj_info_t *info, int *obj_pos)
+{
+    ep_model_obj_t *objs;
+    int size;
+
+    RETURN_ERROR_IF_NULL(model);
+    RETURN_ERROR_IF_NULL(info);
+
+    if (model->obj_num == model->obj_size)
+    {
+        size = model->obj_size ? 2 * model->obj_size : EP_MODEL_INIT_OBJ_SIZE;
+        objs = (ep_model_obj_t *)realloc(model->objs, size * sizeof(ep_model_obj_t));
+        if (!objs)
+            return EPS_OUTOFMEMORY;
+
+        model->objs = objs;
+        model->obj_size = size;
+    }
+
+    memset(&model->objs[model->obj_num], 0, sizeof(ep_model_obj_t));
+    model->objs[model->obj_num].info = *info;
+    model->objs[model->obj_num].params_valid = TRUE;
+
+    if (obj_pos)
+        *obj_pos = model->obj_num;
+    model->obj_num++;
+
+    return EPS_OK;
+}
+
+ep_stat_t ep_model_param_add(ep_model_t *model, int obj_pos, const param_info_t *param)
+{
+    ep_model_obj_t *obj;
+    param_info_t *params;
+    int *idx_params, size;
+
+    RETURN_ERROR_IF_NULL(model);
+    RETURN_ERROR_IF_NULL(param);
+
+    if (obj_pos < 0 || obj_pos >= model->obj_num)
+        return EPS_INVALID_ARGUMENT;
+
+    obj = &model->objs[obj_pos];
+
+    if (obj->param_num == obj->param_size)
+    {
+        size = obj->param_size ? 2 * obj->param_size : EP_MODEL_INIT_PARAM_SIZE;
+        params = (param_info_t *)realloc(obj->params, size * sizeof(param_info_t));
+        if (!params)
+            return EPS_OUTOFMEMORY;
+
+        obj->params = params;
+        obj->param_size = size;
+    }
+
+    if (param->isIndex)
+    {
+        idx_params = (int *)realloc(obj->idx_params, (obj->idx_num + 1) * sizeof(int));
+        if (!idx_params)
+            return EPS_OUTOFMEMORY;
+
+        obj->idx_params = idx_params;
+        obj->idx_params[obj->idx_num++] = obj->param_num;
+    }
+
+    obj->params[obj->param_num++] = *param;
+    model->param_num++;
+
+    return EPS_OK;
+}
+
+/* Counts index placeholders of the object name and checks whether the
+   name ends with the placeholder (i.e. "suffix" after the last ".{i}."
+   is empty) */
+static void ep_model_obj_placeholders(ep_model_obj_t *obj)
+{
+    const char *p = obj->info.objName, *p_ph;
+    int i;
+
+    obj->ph_num = 0;
+    while ((p = strstr(p, INDEX_PLACEHOLDER)) != NULL)
+    {
+        obj->ph_num++;
+        p += LEN_PLACEHOLDER;
+    }
+
+    p = obj->info.objName;
+    for (i = 0; i < obj->ph_num; i++)
+    {
+        if ((p_ph = strstr(p, "."INDEX_PLACEHOLDER".")) == NULL)
+            break;
+        p = p_ph + strlen("."INDEX_PLACEHOLDER".");
+    }
+
+    obj->is_multi = (obj->ph_num > 0 && i == obj->ph_num && *p == '\0');
+}
+
+/* Returns the child node of the segment; the node is added if "add" is set.
+   -1 is returned if there is no such node (or the node cannot be added) */
+static int ep_model_trie_child(ep_model_t *model, int node, const char *seg,
+                               int seg_len, BOOL add)
+{
+    ep_model_node_t *trie;
+    int i, size;
+
+    for (i = model->trie[node].child; i >= 0; i = model->trie[i].next)
+    {
+        if (model->trie[i].seg_len == seg_len &&
+            !strncasecmp(model->trie[i].seg, seg, seg_len))
+            return i;
+    }
+
+    if (!add)
+        return -1;
+
+    if (model->node_num == model->node_size)
+    {
+        size = 2 * model->node_size;
+        trie = (ep_model_node_t *)realloc(model->trie, size * sizeof(ep_model_node_t));
+        if (!trie)
+            return -1;
+
+        model->trie = trie;
+        model->node_size = size;
+    }
+
+    i = model->node_num++;
+    model->trie[i].seg = seg;
+    model->trie[i].seg_len = seg_len;
+    model->trie[i].child = -1;
+    model->trie[i].next = model->trie[node].child;
+    model->trie[i].sub_num = 0;
+    model->trie[i].sub_off = 0;
+    model->trie[node].child = i;
+
+    return i;
+}
+
+/* Walks the trie along the object name (adding the missing nodes on the
+   first pass) and puts the object to the subtree of each node on the way.
+   The tail of the name that is not terminated by '.' does not make a node */
+static ep_stat_t ep_model_trie_add(ep_model_t *model, int obj_pos, BOOL fill)
+{
+    const char *p = model->objs[obj_pos].info.objName, *dot;
+    int node = 0;
+
+    for (;;)
+    {
+        if (fill)
+            model->trie_subs[model->trie[node].sub_off + model->trie[node].sub_num] = obj_pos;
+        model->trie[node].sub_num++;
+
+        if ((dot = strchr(p, '.')) == NULL)
+            break;
+
+        if ((node = ep_model_trie_child(model, node, p, dot - p, !fill)) < 0)
+            return fill ? EPS_GENERAL_ERROR : EPS_OUTOFMEMORY;
+
+        p = dot + 1;
+    }
+
+    return EPS_OK;
+}
+
+/* Builds the object name trie. The objects are added in the model order,
+   so the subtree of each node lists the objects in the meta DB order */
+static ep_stat_t ep_model_trie_build(ep_model_t *model)
+{
+    ep_stat_t status;
+    int i, off = 0;
+
+    model->trie = (ep_model_node_t *)malloc(EP_MODEL_INIT_NODE_SIZE * sizeof(ep_model_node_t));
+    if (!model->trie)
+        return EPS_OUTOFMEMORY;
+
+    model->node_size = EP_MODEL_INIT_NODE_SIZE;
+    model->node_num = 1;
+    memset(&model->trie[0], 0, sizeof(ep_model_node_t));
+    model->trie[0].child = model->trie[0].next = -1;
+
+    /* The first pass adds the nodes and counts the subtree sizes */
+    for (i = 0; i < model->obj_num; i++)
+    {
+        if ((status = ep_model_trie_add(model, i, FALSE)) != EPS_OK)
+            return status;
+    }
+
+    for (i = 0; i < model->node_num; i++)
+    {
+        model->trie[i].sub_off = off;
+        off += model->trie[i].sub_num;
+        model->trie[i].sub_num = 0;
+    }
+
+    if ((model->trie_subs = (int *)malloc((off ? off : 1) * sizeof(int))) == NULL)
+        return EPS_OUTOFMEMORY;
+
+    /* The second pass fills the subtrees */
+    for (i = 0; i < model->obj_num; i++)
+    {
+        if ((status = ep_model_trie_add(model, i, TRUE)) != EPS_OK)
+            return status;
+    }
+
+    model->mem_size += model->node_size * sizeof(ep_model_node_t) + off * sizeof(int);
+
+    return EPS_OK;
+}
+
+/* Builds hash and trie of the object names; called once all objects are added */
+static ep_stat_t ep_model_finalize(ep_model_t *model)
+{
+    unsigned int size = 16, h;
+    int i;
+
+    while (size < 2 * (unsigned int)model->obj_num)
+        size <<= 1;
+
+    if ((model->hash = (int *)calloc(size, sizeof(int))) == NULL)
+        return EPS_OUTOFMEMORY;
+
+    model->hash_size = size;
+    model->mem_size = sizeof(ep_model_t) + size * sizeof(int) +
+                      model->obj_size * sizeof(ep_model_obj_t);
+
+    for (i = 0; i < model->obj_num; i++)
+    {
+        /* The first object of the same name is found by lookup */
+        for (h = ep_hash_str(EP_HASH_INIT, model->objs[i].info.objName) & (size - 1);
+             model->hash[h] != 0; h = (h + 1) & (size - 1))
+        {
+            if (!strcmp(model->objs[model->hash[h] - 1].info.objName,
+                        model->objs[i].info.objName))
+                break;
+        }
+
+        if (model->hash[h] == 0)
+            model->hash[h] = i + 1;
+
+        ep_model_obj_placeholders(&model->objs[i]);
+
+        model->mem_size += model->objs[i].param_size * sizeof(param_info_t) +
+                           model->objs[i].idx_num * sizeof(int);
+    }
+
+    return ep_model_trie_build(model);
+}
+
+/* Object lookup by exact name. NULL is returned if the object is not found */
+const ep_model_obj_t *ep_model_find_obj(const ep_model_t *model, const char *obj_name)
+{
+    unsigned int h;
+
+    if (!model || !model->hash || !obj_name)
+        return NULL;
+
+    for (h = ep_hash_str(EP_HASH_INIT, obj_name) & (model->hash_size - 1);
+         model->hash[h] != 0; h = (h + 1) & (model->hash_size - 1))
+    {
+        if (!strcmp(model->objs[model->hash[h] - 1].info.objName, obj_name))
+            return &model->objs[model->hash[h] - 1];
+    }
+
+    return NULL;
+}
+
+/* Matches the name the same way as SQL "ObjName LIKE 'prefix%'" does:
+   case insensitive, '_' matches any character */
+static BOOL ep_model_like_prefix(const char *name, const char *prefix)
+{
+    for (; *prefix; prefix++, name++)
+    {
+        if (*name == '\0')
+            return FALSE;
+
+        if (*prefix != '_' &&
+            tolower((unsigned char)*prefix) != tolower((unsigned char)*name))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* Matches the segment of the trie node the same way as LIKE does */
+static BOOL ep_model_like_seg(const ep_model_node_t *node, const char *seg, int seg_len)
+{
+    int i;
+
+    if (node->seg_len != seg_len)
+        return FALSE;
+
+    for (i = 0; i < seg_len; i++)
+    {
+        if (seg[i] != '_' &&
+            tolower((unsigned char)seg[i]) != tolower((unsigned char)node->seg[i]))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* Looks up the trie node which subtree contains exactly the objects matched
+   by the prefix. Returns number of such nodes found (up to 2); "found" is
+   set to the node if there is the only one */
+static int ep_model_trie_lookup(const ep_model_t *model, int node, const char *prefix,
+                                int *found)
+{
+    const char *dot;
+    int i, cnt = 0;
+
+    if (*prefix == '\0')
+    {
+        *found = node;
+        return 1;
+    }
+
+    /* Prefix ending in the middle of a segment is not resolved by the trie */
+    if ((dot = strchr(prefix, '.')) == NULL)
+        return 2;
+
+    for (i = model->trie[node].child; i >= 0 && cnt < 2; i = model->trie[i].next)
+    {
+        if (ep_model_like_seg(&model->trie[i], prefix, dot - prefix))
+            cnt += ep_model_trie_lookup(model, i, dot + 1, found);
+    }
+
+    return cnt;
+}
+
+/* Starts iteration over the objects which names begin with the prefix, in
+   the meta DB order. The objects are taken from the subtree of the trie
+   node; the names are scanned only if the prefix does not map to a single
+   node (it ends in the middle of a segment or '_' matches several ones) */
+void ep_model_iter_init(ep_model_iter_t *it, const ep_model_t *model, const char *prefix)
+{
+    int node = 0;
+
+    memset(it, 0, sizeof(ep_model_iter_t));
+    it->model = model;
+    it->prefix = prefix;
+
+    if (!model || !model->trie || !prefix)
+        return;
+
+    switch (ep_model_trie_lookup(model, 0, prefix, &node))
+    {
+        case 0:
+            it->list = model->trie_subs;
+            break;
+
+        case 1:
+            it->list = model->trie_subs + model->trie[node].sub_off;
+            it->num = model->trie[node].sub_num;
+            break;
+
+        default:
+            it->num = model->obj_num;
+            break;
+    }
+}
+
+/* Returns position of the next object, or -1 if there are no more objects */
+int ep_model_iter_next(ep_model_iter_t *it)
+{
+    if (it->list)
+        return (it->pos < it->num) ? it->list[it->pos++] : -1;
+
+    for (; it->pos < it->num; it->pos++)
+    {
+        if (ep_model_like_prefix(it->model->objs[it->pos].info.objName, it->prefix))
+            return it->pos++;
+    }
+
+    return -1;
+}
+
+int ep_model_count_prefix_objs(const ep_model_t *model, const char *prefix)
+{
+    ep_model_iter_t it;
+    int cnt = 0;
+
+    ep_model_iter_init(&it, model, prefix);
+    if (it.list)
+        return it.num;
+
+    while (ep_model_iter_next(&it) >= 0)
+        cnt++;
+
+    return cnt;
+}
+
+/* Returns the model of the DB type with a reference taken; the reference
+   must be dropped by ep_model_release. If the model is not built yet, it
+   is loaded by "load" callback (other workers wait for the load instead
+   of querying the meta DB in parallel). NULL is returned if the model
+   cannot be built; the load is not retried until the model is invalidated */
+ep_model_t *ep_model_acquire(int db_type, ep_model_load_fn load, void *ctx)
+{
+    ep_model_t *model;
+    long start;
+
+    if (db_type < 0 || db_type >= EP_MODEL_DBTYPES_NUM || !load)
+        return NULL;
+
+    pthread_mutex_lock(&g_model_lock);
+
+    if (!g_models[db_type] && !g_model_failed[db_type])
+    {
+        start = ep_time_ms();
+
+        if ((model = ep_model_create(db_type)) == NULL)
+            ERROR("Could not allocate management model");
+        else if (load(ctx, model) != EPS_OK || ep_model_finalize(model) != EPS_OK)
+        {
+            ERROR("Could not load management model of DB type %d. Meta DB is queried "
+                  "by requests", db_type);
+            ep_model_destroy(model);
+        }
+        else
+        {
+            g_models[db_type] = model;
+            INFO("Management model of DB type %d loaded in %ld ms: %d objects, "
+                 "%d parameters, %d name trie nodes, %lu KB", db_type,
+                 ep_time_ms() - start, model->obj_num, model->param_num,
+                 model->node_num, (unsigned long)(model->mem_size / 1024));
+        }
+
+        g_model_failed[db_type] = (g_models[db_type] == NULL);
+    }
+
+    if ((model = g_models[db_type]) != NULL)
+        __atomic_add_fetch(&(model->refcnt), 1, __ATOMIC_SEQ_CST);
+
+    pthread_mutex_unlock(&g_model_lock);
+
+    return model;
+}
+
+void ep_model_release(ep_model_t *model)
+{
+    if (model && __atomic_sub_fetch(&(model->refcnt), 1, __ATOMIC_SEQ_CST) == 0)
+        ep_model_destroy(model);
+}
+
+/* Drops the model of the DB type (e.g. the DB files were replaced). The
+   model is freed once all workers release it; the next acquire loads
+   a new one */
+void ep_model_invalidate(int db_type)
+{
+    ep_model_t *model;
+
+    if (db_type < 0 || db_type >= EP_MODEL_DBTYPES_NUM)
+        return;
+
+    pthread_mutex_lock(&g_model_lock);
+
+    model = g_models[db_type];
+    g_models[db_type] = NULL;
+    g_model_failed[db_type] = FALSE;
+    __atomic_add_fetch(&g_model_gen[db_type], 1, __ATOMIC_SEQ_CST);
+
+    pthread_mutex_unlock(&g_model_lock);
+
+    if (model)
+        DBG("Management model of DB type %d invalidated", db_type);
+
+    ep_model_release(model);
+}
+
+/* Drops the models of all DB types (the meta DBs may be replaced while
+   the EP is restarted) */
+void ep_model_invalidate_all(void)
+{
+    int db_type;
+
+    for (db_type = 0; db_type < EP_MODEL_DBTYPES_NUM; db_type++)
+        ep_model_invalidate(db_type);
+}
+
+/* Generation of the model of the DB type: changed on each invalidation,
+   so workers can check whether their model is current without locking */
+int ep_model_generation(int db_type)
+{
+    if (db_type < 0 || db_type >= EP_MODEL_DBTYPES_NUM)
+        return 0;
+
+    return __atomic_load_n(&g_model_gen[db_type], __ATOMIC_SEQ_CST);
+}
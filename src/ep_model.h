@@ -0,0 +1,156 @@
+/* ep_model.h
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+#ifndef EP_MODEL_H_
+#define EP_MODEL_H_
+
+#include "ep_common.h"
+
+/* Number of MMX DB types (running, candidate, startup); the model is
+   kept separately for meta DB of each type */
+#define EP_MODEL_DBTYPES_NUM  3
+
+/*
+ * Management model cache: immutable in-memory copy of the meta DB
+ * (objects of MMX_Objects_InfoTbl and parameters of their info tables).
+ * The model is built once per DB type and shared by all workers; a worker
+ * keeps a reference to the model until it is invalidated
+ */
+typedef struct ep_model_obj_s {
+    obj_info_t info;
+    BOOL params_valid;            /* parameters are loaded to the model */
+    int param_num;
+    int param_size;
+    param_info_t *params;         /* all parameters, in the meta DB order */
+    int idx_num;
+    int *idx_params;              /* positions of the index parameters */
+    int ph_num;                   /* number of index placeholders in the name */
+    BOOL is_multi;                /* name ends with the index placeholder */
+} ep_model_obj_t;
+
+/* Node of the object name trie: one node per name segment ("{i}" is a
+   segment as well), segments are compared case insensitively */
+typedef struct ep_model_node_s {
+    const char *seg;              /* points to the name of the first object */
+    int seg_len;
+    int child;                    /* first child node, -1 - none */
+    int next;                     /* next sibling node, -1 - none */
+    int sub_num;
+    int sub_off;                  /* objects of the subtree in trie_subs */
+} ep_model_node_t;
+
+typedef struct ep_model_s {
+    int db_type;
+    int obj_num;
+    int obj_size;
+    ep_model_obj_t *objs;         /* objects, in the meta DB order */
+    unsigned int hash_size;       /* power of 2 */
+    int *hash;                    /* object position + 1, 0 - empty */
+    int param_num;                /* total number of parameters */
+    int node_num;
+    int node_size;
+    ep_model_node_t *trie;        /* node 0 is the root */
+    int *trie_subs;               /* object positions of the subtrees, ascending */
+    size_t mem_size;
+    volatile int refcnt;
+} ep_model_t;
+
+/* Iterator over the objects which names begin with the prefix */
+typedef struct ep_model_iter_s {
+    const ep_model_t *model;
+    const char *prefix;
+    const int *list;              /* trie subtree; NULL - names are scanned */
+    int num;
+    int pos;
+} ep_model_iter_t;
+
+/* Fills the new model from the meta DB (see ep_model_acquire) */
+typedef ep_stat_t (*ep_model_load_fn)(void *ctx, ep_model_t *model);
+
+ep_stat_t ep_model_obj_add(ep_model_t *model, const obj_info_t *info, int *obj_pos);
+
+ep_stat_t ep_model_param_add(ep_model_t *model, int obj_pos, const param_info_t *param);
+
+const ep_model_obj_t *ep_model_find_obj(const ep_model_t *model, const char *obj_name);
+
+void ep_model_iter_init(ep_model_iter_t *it, const ep_model_t *model, const char *prefix);
+
+int ep_model_iter_next(ep_model_iter_t *it);
+
+int ep_model_count_prefix_objs(const ep_model_t *model, const char *prefix);
+
+ep_model_t *ep_model_acquire(int db_type, ep_model_load_fn load, void *ctx);
+
+void ep_model_release(ep_model_t *model);
+
+void ep_model_invalidate(int db_type);
+
+void ep_model_invalidate_all(void);
+
+int ep_model_generation(int db_type);
+
+#endif /* EP_MODEL_H_ */
@@ -0,0 +1,179 @@
+/* ep_msg_pool.c
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+
+/*
+ * Thread pool message buffers pool
+ */
+
+#include "ep_threadpool.h"
+#include "ep_common.h"
+
+ep_stat_t tp_msgpool_init(tp_msgpool_t *pool, unsigned int max_num)
+{
+    memset(pool, 0, sizeof(tp_msgpool_t));
+
+    if ((pool->bufs = (tp_msgbuf_t **)calloc(max_num, sizeof(tp_msgbuf_t *))) == NULL)
+    {
+        ERROR("Could not allocate message pool of %u buffers", max_num);
+        return EPS_OUTOFMEMORY;
+    }
+    pool->max_num = max_num;
+
+    if (pthread_mutex_init(&(pool->mutex), NULL))
+    {
+        ERROR("Could not initialize mutex: %s", strerror(errno));
+        free(pool->bufs);
+        pool->bufs = NULL;
+        return EPS_SYSTEM_ERROR;
+    }
+
+    return EPS_OK;
+}
+
+ep_stat_t tp_msgpool_destroy(tp_msgpool_t *pool)
+{
+    unsigned int i;
+
+    if (pool->buf_num > 0)
+        DBG("Message pool: %u of %u buffers were allocated", pool->buf_num, pool->max_num);
+
+    for (i = 0; i < pool->buf_num; i++)
+        free(pool->bufs[i]);
+
+    free(pool->bufs);
+    pool->bufs = NULL;
+    pool->buf_num = 0;
+    pool->free_list = NULL;
+    pool->free_num = 0;
+
+    pthread_mutex_destroy(&(pool->mutex));
+    return EPS_OK;
+}
+
+/*
+ * Takes up to num buffers from the pool within one critical section.
+ * Returns number of buffers placed to bufs array (0 if the pool is empty)
+ */
+int tp_msgpool_get(tp_msgpool_t *pool, tp_msgbuf_t *bufs[], int num)
+{
+    int i, j;
+
+    if (!pool || !bufs || num <= 0)
+        return 0;
+
+    if (pthread_mutex_lock(&(pool->mutex)))
+    {
+        ERROR("Could not lock pool mutex: %s", strerror(errno));
+        return 0;
+    }
+
+    for (i = 0; i < num && pool->free_list; i++)
+    {
+        bufs[i] = pool->free_list;
+        pool->free_list = bufs[i]->next;
+        -- pool->free_num;
+    }
+
+    /* The free buffers are over: the pool grows up to its limit */
+    for (; i < num && pool->buf_num < pool->max_num; i++)
+    {
+        if ((bufs[i] = (tp_msgbuf_t *)malloc(sizeof(tp_msgbuf_t))) == NULL)
+            break;
+        pool->bufs[pool->buf_num++] = bufs[i];
+    }
+
+    pthread_mutex_unlock(&(pool->mutex));
+
+    for (j = 0; j < i; j++)
+    {
+        bufs[j]->next = NULL;
+        bufs[j]->msg = bufs[j]->data;
+        bufs[j]->data[0] = '\0';
+    }
+
+    return i;
+}
+
+/* Returns the buffer to the pool */
+void tp_msgpool_put(tp_msgpool_t *pool, tp_msgbuf_t *buf)
+{
+    if (!pool || !buf)
+        return;
+
+    if (pthread_mutex_lock(&(pool->mutex)))
+    {
+        ERROR("Could not lock pool mutex: %s", strerror(errno));
+        return;
+    }
+
+    buf->next = pool->free_list;
+    pool->free_list = buf;
+    ++ pool->free_num;
+
+    pthread_mutex_unlock(&(pool->mutex));
+}
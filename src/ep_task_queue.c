@@ -69,110 +69,324 @@
  * Thread pool queue
  */
 
+#define _GNU_SOURCE     /* syscall */
+#include <unistd.h>
+#include <limits.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
 #include "ep_threadpool.h"
 #include "ep_common.h"
 
-ep_stat_t tp_queue_init(tp_queue_t *q, BOOL blocking)
+#define TP_STAT_ADD(q, field, val) \
+            __atomic_fetch_add(&((q)->stats.field), (val), __ATOMIC_RELAXED)
+
+static inline int tp_futex_wait(volatile int *addr, int val, const struct timespec *timeout)
 {
-    memset(q, 0, sizeof(tp_queue_t));
+    return syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, timeout, NULL, 0);
+}
 
-    if (pthread_cond_init(&(q->cv_got_task), NULL))
-    {
-        ERROR("Could not initialize condition variable: %s", strerror(errno));
-        return EPS_SYSTEM_ERROR;
-    }
+static inline void tp_futex_wake(volatile int *addr, int num)
+{
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, num, NULL, NULL, 0);
+}
+
+/*
+ * Event for parking idle consumers. The consumer registers itself by
+ * tp_event_prepare, checks its condition once more and then either
+ * parks by tp_event_wait or unregisters by tp_event_cancel. A notification
+ * sent after tp_event_prepare is never lost.
+ */
+int tp_event_prepare(tp_event_t *ev)
+{
+    int key = __atomic_load_n(&(ev->seq), __ATOMIC_SEQ_CST);
+
+    __atomic_fetch_add(&(ev->waiters), 1, __ATOMIC_SEQ_CST);
+
+    return key;
+}
+
+void tp_event_wait(tp_event_t *ev, int key)
+{
+    __atomic_fetch_add(&(ev->park_cnt), 1, __ATOMIC_RELAXED);
+    tp_futex_wait(&(ev->seq), key, NULL);
+    __atomic_fetch_sub(&(ev->waiters), 1, __ATOMIC_SEQ_CST);
+}
+
+/* The same as tp_event_wait, but EPS_TIMEOUT is returned if there was no
+   notification during timeout_ms */
+ep_stat_t tp_event_timedwait(tp_event_t *ev, int key, int timeout_ms)
+{
+    struct timespec timeout;
+    int res;
+
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+
+    __atomic_fetch_add(&(ev->park_cnt), 1, __ATOMIC_RELAXED);
+    res = tp_futex_wait(&(ev->seq), key, &timeout);
+    __atomic_fetch_sub(&(ev->waiters), 1, __ATOMIC_SEQ_CST);
+
+    return (res < 0 && errno == ETIMEDOUT) ? EPS_TIMEOUT : EPS_OK;
+}
+
+void tp_event_cancel(tp_event_t *ev)
+{
+    __atomic_fetch_sub(&(ev->waiters), 1, __ATOMIC_SEQ_CST);
+}
+
+/* Wakes up to num parked consumers */
+void tp_event_notify(tp_event_t *ev, int num)
+{
+    __atomic_fetch_add(&(ev->seq), 1, __ATOMIC_SEQ_CST);
 
-    if (pthread_mutex_init(&(q->mutex), NULL))
+    if (__atomic_load_n(&(ev->waiters), __ATOMIC_SEQ_CST) > 0)
     {
-        ERROR("Could not initialize mutex: %s", strerror(errno));
-        return EPS_SYSTEM_ERROR;
+        tp_futex_wake(&(ev->seq), num);
+        __atomic_fetch_add(&(ev->wake_cnt), 1, __ATOMIC_RELAXED);
     }
+}
+
+/* Signals parked consumers that num new tasks are available */
+static void tp_queue_notify(tp_queue_t *q, int num)
+{
+    if (__atomic_load_n(&(q->is_blocking), __ATOMIC_SEQ_CST))
+        tp_event_notify(&(q->ev), num);
+}
+
+ep_stat_t tp_queue_init(tp_queue_t *q, BOOL blocking)
+{
+    unsigned int i;
+
+    memset(q, 0, sizeof(tp_queue_t));
+
+    for (i = 0; i < TP_MAX_TASK_QUEUE_SIZE; i++)
+        q->cells[i].seq = i;
 
     q->is_blocking = blocking;
 
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
     return EPS_OK;
 }
 
 ep_stat_t tp_queue_destroy(tp_queue_t *q)
 {
-    pthread_mutex_destroy(&(q->mutex));
-    pthread_cond_destroy(&(q->cv_got_task));
     return EPS_OK;
 }
 
 ep_stat_t tp_queue_enqueue(tp_queue_t *q, tp_task_t *elem)
 {
+    tp_queue_cell_t *cell;
+    unsigned int pos, seq;
+    int diff;
+
     RETURN_ERROR_IF_NULL(q);
     RETURN_ERROR_IF_NULL(elem);
 
-    LOCK_OR_RETURN(q->mutex);
+    pos = __atomic_load_n(&(q->tail), __ATOMIC_RELAXED);
 
-    if (q->length >= TP_MAX_TASK_QUEUE_SIZE)
+    while (TRUE)
     {
-        INFO("Max queue size (%d) is reached. Could not enqueue.", TP_MAX_TASK_QUEUE_SIZE);
-        UNLOCK_OR_RETURN(q->mutex);
-        return EPS_FULL;
+        cell = &(q->cells[pos & TP_QUEUE_MASK]);
+        seq = __atomic_load_n(&(cell->seq), __ATOMIC_ACQUIRE);
+        diff = (int)(seq - pos);
+
+        if (diff == 0)
+        {
+            /* The slot is free: try to reserve it */
+            if (__atomic_compare_exchange_n(&(q->tail), &pos, pos + 1, TRUE,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+            TP_STAT_ADD(q, enq_retry_cnt, 1);
+        }
+        else if (diff < 0)
+        {
+            INFO("Max queue size (%d) is reached. Could not enqueue.", TP_MAX_TASK_QUEUE_SIZE);
+            return EPS_FULL;
+        }
+        else
+        {
+            pos = __atomic_load_n(&(q->tail), __ATOMIC_RELAXED);
+        }
     }
 
-    memcpy(&(q->elems[q->tail]), elem, sizeof(tp_task_t));
-    q->tail = (q->tail + 1) % TP_MAX_TASK_QUEUE_SIZE;
-    ++ q->length;
-
-    /* If this is the first task in the queue, then signal worker threads that
-     *  there is job for them
-     */
-    if (q->is_blocking && q->length == 1)
-    {
-        pthread_cond_broadcast(&(q->cv_got_task));
-    }
+    memcpy(&(cell->task), elem, sizeof(tp_task_t));
+    __atomic_store_n(&(cell->seq), pos + 1, __ATOMIC_RELEASE);
 
-    /*D("< queue size: %u", q->length);*/
+    TP_STAT_ADD(q, enq_op_cnt, 1);
+    TP_STAT_ADD(q, enq_task_cnt, 1);
 
-    UNLOCK_OR_RETURN(q->mutex);
+    tp_queue_notify(q, 1);
 
     return EPS_OK;
 }
 
-ep_stat_t tp_queue_dequeue(tp_queue_t *q, tp_task_t *t)
+/*
+ * Enqueues up to num tasks by one reservation of consecutive slots.
+ * Number of really enqueued tasks is returned in "enqueued";
+ * EPS_FULL is returned if not all tasks fit into the queue.
+ */
+ep_stat_t tp_queue_enqueue_batch(tp_queue_t *q, tp_task_t *elems, int num, int *enqueued)
 {
+    unsigned int pos, seq;
+    int i, cnt;
+
     RETURN_ERROR_IF_NULL(q);
+    RETURN_ERROR_IF_NULL(elems);
+
+    if (enqueued) *enqueued = 0;
 
-    LOCK_OR_RETURN(q->mutex);
+    if (num <= 0)
+        return EPS_NOTHING_DONE;
 
-    while (q->is_blocking && q->length <= 0)
+    pos = __atomic_load_n(&(q->tail), __ATOMIC_RELAXED);
+
+    while (TRUE)
     {
-        /*D("Queue is empty. Waiting for a task");*/
-        pthread_cond_wait(&(q->cv_got_task), &(q->mutex));
+        /* Count free slots starting from the current enqueue position */
+        for (cnt = 0; cnt < num && cnt < TP_MAX_TASK_QUEUE_SIZE; cnt++)
+        {
+            seq = __atomic_load_n(&(q->cells[(pos + cnt) & TP_QUEUE_MASK].seq),
+                                  __ATOMIC_ACQUIRE);
+            if (seq != pos + cnt)
+                break;
+        }
+
+        if (cnt == 0)
+        {
+            seq = __atomic_load_n(&(q->cells[pos & TP_QUEUE_MASK].seq), __ATOMIC_ACQUIRE);
+            if ((int)(seq - pos) < 0)
+            {
+                INFO("Max queue size (%d) is reached. Could not enqueue %d task(s).",
+                      TP_MAX_TASK_QUEUE_SIZE, num);
+                return EPS_FULL;
+            }
+
+            /* Another producer has taken the position */
+            pos = __atomic_load_n(&(q->tail), __ATOMIC_RELAXED);
+            continue;
+        }
+
+        if (__atomic_compare_exchange_n(&(q->tail), &pos, pos + cnt, TRUE,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            break;
+        TP_STAT_ADD(q, enq_retry_cnt, 1);
     }
 
-    if (q->length <= 0)
+    for (i = 0; i < cnt; i++)
     {
-        DBG("Queue is empty. Return NULL");
-        UNLOCK_OR_RETURN(q->mutex);
-        return EPS_EMPTY;
+        tp_queue_cell_t *cell = &(q->cells[(pos + i) & TP_QUEUE_MASK]);
+
+        memcpy(&(cell->task), &elems[i], sizeof(tp_task_t));
+        __atomic_store_n(&(cell->seq), pos + i + 1, __ATOMIC_RELEASE);
+    }
+
+    TP_STAT_ADD(q, enq_op_cnt, 1);
+    TP_STAT_ADD(q, enq_task_cnt, cnt);
+
+    tp_queue_notify(q, cnt);
+
+    if (enqueued) *enqueued = cnt;
+
+    if (cnt < num)
+    {
+        INFO("Max queue size (%d) is reached. Could not enqueue %d task(s).",
+              TP_MAX_TASK_QUEUE_SIZE, num - cnt);
+        return EPS_FULL;
     }
 
-    memcpy(t, &(q->elems[q->head]), sizeof(tp_task_t));
-    q->head = (q->head+1) % TP_MAX_TASK_QUEUE_SIZE;
-    -- q->length;
+    return EPS_OK;
+}
+
+/* Non-blocking dequeue attempt; EPS_EMPTY is returned if there is no task */
+ep_stat_t tp_queue_try_dequeue(tp_queue_t *q, tp_task_t *t)
+{
+    tp_queue_cell_t *cell;
+    unsigned int pos, seq;
+    int diff;
+
+    RETURN_ERROR_IF_NULL(q);
+    RETURN_ERROR_IF_NULL(t);
+
+    pos = __atomic_load_n(&(q->head), __ATOMIC_RELAXED);
 
-    /*D("> queue size: %u", q->length);*/
+    while (TRUE)
+    {
+        cell = &(q->cells[pos & TP_QUEUE_MASK]);
+        seq = __atomic_load_n(&(cell->seq), __ATOMIC_ACQUIRE);
+        diff = (int)(seq - (pos + 1));
+
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&(q->head), &pos, pos + 1, TRUE,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+            TP_STAT_ADD(q, deq_retry_cnt, 1);
+        }
+        else if (diff < 0)
+        {
+            return EPS_EMPTY;
+        }
+        else
+        {
+            pos = __atomic_load_n(&(q->head), __ATOMIC_RELAXED);
+        }
+    }
 
-    UNLOCK_OR_RETURN(q->mutex);
+    memcpy(t, &(cell->task), sizeof(tp_task_t));
+    /* Release the slot for the enqueue position of the next round */
+    __atomic_store_n(&(cell->seq), pos + TP_QUEUE_MASK + 1, __ATOMIC_RELEASE);
 
     return EPS_OK;
 }
 
+ep_stat_t tp_queue_dequeue(tp_queue_t *q, tp_task_t *t)
+{
+    int key;
+
+    RETURN_ERROR_IF_NULL(q);
+    RETURN_ERROR_IF_NULL(t);
+
+    while (TRUE)
+    {
+        if (tp_queue_try_dequeue(q, t) == EPS_OK)
+            return EPS_OK;
+
+        if (!__atomic_load_n(&(q->is_blocking), __ATOMIC_SEQ_CST))
+            break;
+
+        /* Register as waiter and check the queue once more before parking,
+           so a task enqueued meanwhile is not missed */
+        key = tp_event_prepare(&(q->ev));
+
+        if (tp_queue_try_dequeue(q, t) == EPS_OK)
+        {
+            tp_event_cancel(&(q->ev));
+            return EPS_OK;
+        }
+
+        if (__atomic_load_n(&(q->is_blocking), __ATOMIC_SEQ_CST))
+        {
+            /*D("Queue is empty. Waiting for a task");*/
+            tp_event_wait(&(q->ev), key);
+        }
+        else
+            tp_event_cancel(&(q->ev));
+    }
+
+    DBG("Queue is empty. Return NULL");
+    return EPS_EMPTY;
+}
+
 ep_stat_t tp_queue_set_nonblocking(tp_queue_t *q)
 {
     RETURN_ERROR_IF_NULL(q);
 
-    if (q->is_blocking)
+    if (__atomic_exchange_n(&(q->is_blocking), FALSE, __ATOMIC_SEQ_CST))
     {
-        LOCK_OR_RETURN(q->mutex);
-        q->is_blocking = FALSE;
-        pthread_cond_broadcast(&(q->cv_got_task));
-        UNLOCK_OR_RETURN(q->mutex);
+        /* Wake up all parked consumers */
+        tp_event_notify(&(q->ev), INT_MAX);
         return EPS_OK;
     }
 
@@ -181,20 +395,46 @@ ep_stat_t tp_queue_set_nonblocking(tp_queue_t *q)
 
 ep_stat_t tp_queue_status(tp_queue_t *q)
 {
+    unsigned int length;
+
     RETURN_ERROR_IF_NULL(q);
 
-    LOCK_OR_RETURN(q->mutex);
+    length = __atomic_load_n(&(q->tail), __ATOMIC_ACQUIRE) -
+             __atomic_load_n(&(q->head), __ATOMIC_ACQUIRE);
 
-    ep_stat_t status;
+    if (length == 0 || length > TP_MAX_TASK_QUEUE_SIZE)
+        return EPS_EMPTY;
+    else if (length == TP_MAX_TASK_QUEUE_SIZE)
+        return EPS_FULL;
 
-    if (q->length == 0)
-        status = EPS_EMPTY;
-    else if (q->length == TP_MAX_TASK_QUEUE_SIZE)
-        status = EPS_FULL;
-    else
-        status = EPS_OK;
+    return EPS_OK;
+}
+
+/* Returns number of tasks in the queue (including slots being filled) */
+unsigned int tp_queue_length(tp_queue_t *q)
+{
+    unsigned int length;
 
-    UNLOCK_OR_RETURN(q->mutex);
+    if (!q)
+        return 0;
+
+    length = __atomic_load_n(&(q->tail), __ATOMIC_ACQUIRE) -
+             __atomic_load_n(&(q->head), __ATOMIC_ACQUIRE);
+
+    return (length > TP_MAX_TASK_QUEUE_SIZE) ? 0 : length;
+}
 
-    return status;
+ep_stat_t tp_queue_get_stats(tp_queue_t *q, tp_queue_stats_t *stats)
+{
+    RETURN_ERROR_IF_NULL(q);
+    RETURN_ERROR_IF_NULL(stats);
+
+    stats->enq_op_cnt    = __atomic_load_n(&(q->stats.enq_op_cnt), __ATOMIC_RELAXED);
+    stats->enq_task_cnt  = __atomic_load_n(&(q->stats.enq_task_cnt), __ATOMIC_RELAXED);
+    stats->enq_retry_cnt = __atomic_load_n(&(q->stats.enq_retry_cnt), __ATOMIC_RELAXED);
+    stats->deq_retry_cnt = __atomic_load_n(&(q->stats.deq_retry_cnt), __ATOMIC_RELAXED);
+    stats->park_cnt      = __atomic_load_n(&(q->ev.park_cnt), __ATOMIC_RELAXED);
+    stats->wake_cnt      = __atomic_load_n(&(q->ev.wake_cnt), __ATOMIC_RELAXED);
+
+    return EPS_OK;
 }
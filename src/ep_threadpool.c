@@ -65,42 +65,326 @@
  * - professional sub-contract and customization services
  */
 
+#include <limits.h>
+
 #include "ep_threadpool.h"
 #include "ep_common.h"
 
 
-ep_stat_t tp_init(tp_threadpool_t **res)
+/* Builds the lane dispatch order by smooth weighted round-robin, so lanes
+   of the same weight interleave instead of following in bursts */
+static void tp_sched_init(tp_threadpool_t *tp)
 {
-    ep_stat_t status;
-    pthread_attr_t tattr;
-    int ret;
+    int weight[TP_LANE_NUM] = {TP_LANE_WEIGHT_READ, TP_LANE_WEIGHT_WRITE,
+                               TP_LANE_WEIGHT_MAINT};
+    int current[TP_LANE_NUM] = {0};
+    int total = 0, best, n;
 
-    tp_threadpool_t *tp = (tp_threadpool_t *)calloc(1, sizeof(tp_threadpool_t));
-    if (!tp)
+    for (int l = 0; l < TP_LANE_NUM; l++)
+        total += weight[l];
+
+    for (n = 0; n < total && n < TP_LANE_SCHED_LEN; n++)
     {
-        ERROR("Could not create threadpool: Could not allocate memory");
-        return EPS_OUTOFMEMORY;
+        best = 0;
+        for (int l = 0; l < TP_LANE_NUM; l++)
+        {
+            current[l] += weight[l];
+            if (current[l] > current[best])
+                best = l;
+        }
+
+        current[best] -= total;
+        tp->sched[n] = (tp_lane_t)best;
     }
 
-    if ((status = tp_queue_init(&(tp->task_queue), TRUE)) != EPS_OK)
+    if (n == 0)
+        tp->sched[n++] = TP_LANE_READ;
+
+    tp->sched_len = n;
+}
+
+/* Sets max number of workers that can be busy with tasks of each lane.
+   Reads are never limited; writes and maintenance leave the reserved
+   workers to reads. Called each time the number of workers changes */
+static void tp_lanes_limits_init(tp_threadpool_t *tp)
+{
+    int workers = tp->workers_num;
+    int reserved = TP_LANE_READ_RESERVED_WORKERS;
+    int nonread_max, maint_max;
+
+    if (reserved > workers - 1)
+        reserved = workers - 1;
+    if (reserved < 0)
+        reserved = 0;
+
+    nonread_max = (workers - reserved > 1) ? workers - reserved : 1;
+    maint_max = (TP_LANE_MAINT_MAX_WORKERS < nonread_max) ?
+                 TP_LANE_MAINT_MAX_WORKERS : nonread_max;
+    if (maint_max < 1)
+        maint_max = 1;
+
+    __atomic_store_n(&(tp->nonread_max), nonread_max, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&(tp->lane_max[TP_LANE_READ]), EP_TP_MAX_WORKER_THREADS_NUM, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&(tp->lane_max[TP_LANE_WRITE]), nonread_max, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&(tp->lane_max[TP_LANE_MAINT]), maint_max, __ATOMIC_SEQ_CST);
+}
+
+/* Min number of workers is taken from environment, then from
+   EP_TP_WORKER_THREADS_NUM, then from the number of CPUs */
+static void tp_workers_bounds_init(tp_threadpool_t *tp)
+{
+    char *setting;
+    int min = EP_TP_WORKER_THREADS_NUM, max = 0;
+
+    if (min <= 0)
+        min = get_nprocs();
+
+    if ((setting = EP_TP_WORKERS_MIN) != NULL && atoi(setting) > 0)
+        min = atoi(setting);
+
+    if ((setting = EP_TP_WORKERS_MAX) != NULL && atoi(setting) > 0)
+        max = atoi(setting);
+
+    if (min < 1)
+        min = 1;
+    if (min > EP_TP_MAX_WORKER_THREADS_NUM)
+        min = EP_TP_MAX_WORKER_THREADS_NUM;
+
+    if (max == 0)
+        max = 2 * min;
+    if (max < min)
+        max = min;
+    if (max > EP_TP_MAX_WORKER_THREADS_NUM)
+        max = EP_TP_MAX_WORKER_THREADS_NUM;
+
+    tp->workers_min = min;
+    tp->workers_max = max;
+}
+
+/* Starts worker thread in a free slot. Must be called with workers_lock */
+static ep_stat_t tp_start_worker(tp_threadpool_t *tp)
+{
+    tp_worker_slot_t *slot = NULL;
+    pthread_attr_t tattr;
+    int i, ret;
+
+    for (i = 0; i < EP_TP_MAX_WORKER_THREADS_NUM; i++)
     {
-        ERROR("Could not create threadpool: Could not initialize task queue");
-        return status;
+        if (tp->workers[i].state != TP_WORKER_RUNNING)
+        {
+            slot = &(tp->workers[i]);
+            break;
+        }
     }
 
-    ret = pthread_attr_init(&tattr);
+    if (!slot)
+        return EPS_NO_MORE_ROOM;
+
+    /* The thread of the slot retired earlier */
+    if (slot->state == TP_WORKER_EXITED)
+        pthread_join(slot->tid, NULL);
 
+    slot->tp = tp;
+    slot->w_num = i + 1;
+    slot->group = i % tp->group_num;
+    slot->state = TP_WORKER_RUNNING;
+
+    pthread_attr_init(&tattr);
     pthread_attr_setstacksize(&tattr, EP_PTHREAD_STACK_SIZE);
 
-    for (int i = 0; i < EP_TP_WORKER_THREADS_NUM; i ++)
+    ret = pthread_create(&(slot->tid), &tattr, tp_worker, (void *)slot);
+    pthread_attr_destroy(&tattr);
+
+    if (ret != 0)
     {
-        pthread_create(&(tp->workers[i]), &tattr, tp_worker, (void *)tp);
+        ERROR("Could not create worker thread: %s", strerror(ret));
+        slot->state = TP_WORKER_FREE;
+        return EPS_SYSTEM_ERROR;
     }
 
-    *res = tp;
+    tp->workers_num++;
+    tp_lanes_limits_init(tp);
+
     return EPS_OK;
 }
 
+/* Starts one more worker if tasks are waiting in the queue while none of
+   the workers is idle. Called by producers after adding tasks */
+static void tp_grow(tp_threadpool_t *tp)
+{
+    unsigned int len;
+
+    if (tp->stopped ||
+        __atomic_load_n(&(tp->workers_num), __ATOMIC_SEQ_CST) >= tp->workers_max ||
+        __atomic_load_n(&(tp->ev.waiters), __ATOMIC_SEQ_CST) > 0 ||
+        (len = tp_get_queue_length(tp)) < TP_GROW_QUEUE_DEPTH)
+        return;
+
+    /* Another producer is resizing the pool right now */
+    if (pthread_mutex_trylock(&(tp->workers_lock)) != 0)
+        return;
+
+    /* No worker is started once the pool is stopped (see tp_destroy) */
+    if (!tp->stopped && tp->workers_num < tp->workers_max && tp_start_worker(tp) == EPS_OK)
+    {
+        tp->grow_cnt++;
+        INFO("Thread pool grown to %d workers (%u tasks queued)", tp->workers_num, len);
+    }
+
+    pthread_mutex_unlock(&(tp->workers_lock));
+}
+
+/* Decides whether the idle worker should exit. TRUE is returned if the
+   worker is retired; it is not counted as running any more */
+static BOOL tp_shrink(tp_threadpool_t *tp)
+{
+    BOOL retired = FALSE;
+
+    pthread_mutex_lock(&(tp->workers_lock));
+
+    if (!tp->stopped && tp->workers_num > tp->workers_min)
+    {
+        tp->workers_num--;
+        tp_lanes_limits_init(tp);
+        tp->shrink_cnt++;
+        retired = TRUE;
+    }
+
+    pthread_mutex_unlock(&(tp->workers_lock));
+
+    if (retired)
+        INFO("Thread pool shrunk to %d workers", tp->workers_num);
+
+    return retired;
+}
+
+ep_stat_t tp_init(tp_threadpool_t **res, int group_num)
+{
+    ep_stat_t status = EPS_OK;
+    tp_threadpool_t *tp;
+    BOOL pool_inited = FALSE, lock_inited = FALSE;
+    int queue_num = 0;    /* lane queues initialized, group by group */
+
+    if ((tp = (tp_threadpool_t *)calloc(1, sizeof(tp_threadpool_t))) == NULL)
+        GOTO_RET_WITH_ERROR(EPS_OUTOFMEMORY, "Could not create threadpool: Could not allocate memory");
+
+    if (group_num < 1)
+        group_num = 1;
+    if (group_num > EP_DISP_MAX_SHARDS)
+        group_num = EP_DISP_MAX_SHARDS;
+    tp->group_num = group_num;
+
+    tp_workers_bounds_init(tp);
+
+    /* The pool is sized for the shards and workers actually used */
+    if ((status = tp_msgpool_init(&(tp->msg_pool),
+                                  TP_MSG_POOL_SIZE(tp->group_num, tp->workers_max))) != EPS_OK)
+        GOTO_RET_WITH_ERROR(status, "Could not create threadpool: Could not initialize message pool");
+    pool_inited = TRUE;
+
+    for (int g = 0; g < tp->group_num; g++)
+    {
+        for (int l = 0; l < TP_LANE_NUM; l++)
+        {
+            /* Workers are parked on the pool event, not on the lane queues */
+            if ((status = tp_queue_init(&(tp->lanes[g][l]), FALSE)) != EPS_OK)
+                GOTO_RET_WITH_ERROR(status, "Could not create threadpool: Could not initialize "
+                                    "task queue of group %d lane %d", g, l);
+            queue_num++;
+        }
+    }
+
+    tp_sched_init(tp);
+
+    pthread_mutex_init(&(tp->workers_lock), NULL);
+    lock_inited = TRUE;
+    pthread_mutex_lock(&(tp->workers_lock));
+
+    for (int i = 0; i < tp->workers_min; i ++)
+    {
+        if ((status = tp_start_worker(tp)) != EPS_OK)
+            break;
+    }
+
+    pthread_mutex_unlock(&(tp->workers_lock));
+
+    /* Some workers are enough, more are started on demand */
+    if (tp->workers_num == 0)
+        GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not create threadpool: Could not start workers");
+    status = EPS_OK;
+
+    INFO("Thread pool started: %d workers (min %d, max %d), %d queue group(s), "
+         "up to %u message buffers", tp->workers_num, tp->workers_min, tp->workers_max,
+         tp->group_num, tp->msg_pool.max_num);
+
+    *res = tp;
+
+ret:
+    /* No worker is running if the pool is not created */
+    if (status != EPS_OK && tp)
+    {
+        for (int i = 0; i < queue_num; i++)
+            tp_queue_destroy(&(tp->lanes[i / TP_LANE_NUM][i % TP_LANE_NUM]));
+        if (pool_inited)
+            tp_msgpool_destroy(&(tp->msg_pool));
+        if (lock_inited)
+            pthread_mutex_destroy(&(tp->workers_lock));
+        free(tp);
+    }
+
+    return status;
+}
+
+/* Takes one buffer from the message pool; NULL is returned if the pool
+   is exhausted */
+tp_msgbuf_t *tp_get_msgbuf(tp_threadpool_t *tp)
+{
+    tp_msgbuf_t *buf = NULL;
+
+    if (!tp || tp_msgpool_get(&(tp->msg_pool), &buf, 1) != 1)
+        return NULL;
+
+    return buf;
+}
+
+/* Takes up to num buffers from the message pool by one pool lock.
+   Returns number of the taken buffers */
+int tp_get_msgbufs(tp_threadpool_t *tp, tp_msgbuf_t *bufs[], int num)
+{
+    if (!tp)
+        return 0;
+
+    return tp_msgpool_get(&(tp->msg_pool), bufs, num);
+}
+
+void tp_put_msgbuf(tp_threadpool_t *tp, tp_msgbuf_t *buf)
+{
+    if (tp)
+        tp_msgpool_put(&(tp->msg_pool), buf);
+}
+
+/* Releases message buffer of the task that was not added to the queue */
+static void tp_drop_task(tp_threadpool_t *tp, tp_task_t *task)
+{
+    if (task->task_type == TASK_TYPE_RAW && task->msgbuf)
+    {
+        tp_put_msgbuf(tp, task->msgbuf);
+        task->msgbuf = NULL;
+    }
+}
+
+static tp_lane_t tp_task_lane(tp_task_t *task)
+{
+    return (task->lane >= 0 && task->lane < TP_LANE_NUM) ? task->lane : TP_LANE_WRITE;
+}
+
+static int tp_task_group(tp_threadpool_t *tp, tp_task_t *task)
+{
+    return (task->shard >= 0 && task->shard < tp->group_num) ? task->shard : 0;
+}
+
+/* Ownership of the task message buffer is always passed to the thread
+   pool: if the task cannot be added, the buffer is returned to the pool */
 ep_stat_t tp_add_task(tp_threadpool_t *tp, tp_task_t *task)
 {
     ep_stat_t status;
@@ -108,46 +392,408 @@ ep_stat_t tp_add_task(tp_threadpool_t *tp, tp_task_t *task)
     RETURN_ERROR_IF_NULL(tp);
     RETURN_ERROR_IF_NULL(task);
 
-    if ((status = tp_queue_enqueue(&(tp->task_queue), task)) == EPS_FULL)
+    task->lane = tp_task_lane(task);
+    task->shard = tp_task_group(tp, task);
+
+    if ((status = tp_queue_enqueue(&(tp->lanes[task->shard][task->lane]), task)) == EPS_FULL)
     {
-        ERROR("The queue is full. Task dropped");
+        ERROR("The queue of group %d lane %d is full. Task dropped", task->shard, task->lane);
+        tp_drop_task(tp, task);
         return status;
     }
     else if (status != EPS_OK)
     {
         ERROR("Could not add task");
+        tp_drop_task(tp, task);
         return status;
     }
 
+    tp_event_notify(&(tp->ev), 1);
+    tp_grow(tp);
+
     return EPS_OK;
 }
 
-ep_stat_t tp_get_task(tp_threadpool_t *tp, tp_task_t *task)
+/* Tasks are grouped by queues (group and lane) and each of them is added
+   by one batch enqueue. Order of the tasks of the same queue is kept */
+ep_stat_t tp_add_tasks(tp_threadpool_t *tp, tp_task_t *tasks, int num, int *added)
 {
+    ep_stat_t status, res = EPS_OK;
+    tp_task_t lane_tasks[TP_MAX_TASK_QUEUE_SIZE];
+    int lane_num, cnt, total = 0;
+
+    RETURN_ERROR_IF_NULL(tp);
+    RETURN_ERROR_IF_NULL(tasks);
+
+    for (int q = 0; q < tp->group_num * TP_LANE_NUM; q++)
+    {
+        int g = q / TP_LANE_NUM, l = q % TP_LANE_NUM;
+
+        lane_num = 0;
+        for (int i = 0; i < num; i++)
+        {
+            if (tp_task_group(tp, &tasks[i]) != g || tp_task_lane(&tasks[i]) != (tp_lane_t)l)
+                continue;
+
+            tasks[i].shard = g;
+            tasks[i].lane = (tp_lane_t)l;
+
+            /* The lane cannot hold more tasks than its queue size anyway */
+            if (lane_num < TP_MAX_TASK_QUEUE_SIZE)
+                lane_tasks[lane_num++] = tasks[i];
+            else
+                tp_drop_task(tp, &tasks[i]);
+        }
+
+        if (lane_num == 0)
+            continue;
+
+        cnt = 0;
+        status = tp_queue_enqueue_batch(&(tp->lanes[g][l]), lane_tasks, lane_num, &cnt);
+        total += cnt;
+
+        for (int i = cnt; i < lane_num; i++)
+            tp_drop_task(tp, &lane_tasks[i]);
+
+        if (status != EPS_OK && res == EPS_OK)
+            res = status;
+    }
+
+    if (total > 0)
+    {
+        tp_event_notify(&(tp->ev), total);
+        tp_grow(tp);
+    }
+
+    if (added) *added = total;
+
+    if (res == EPS_FULL || (res == EPS_OK && total < num))
+    {
+        ERROR("The queue is full. %d of %d task(s) dropped", num - total, num);
+        return EPS_FULL;
+    }
+    else if (res != EPS_OK)
+    {
+        ERROR("Could not add tasks");
+        return res;
+    }
+
+    return EPS_OK;
+}
+
+/* Returns the task queue statistics summed over all queues */
+ep_stat_t tp_get_queue_stats(tp_threadpool_t *tp, tp_queue_stats_t *stats)
+{
+    tp_queue_stats_t lane_stats;
     ep_stat_t status;
 
     RETURN_ERROR_IF_NULL(tp);
+    RETURN_ERROR_IF_NULL(stats);
+
+    memset(stats, 0, sizeof(tp_queue_stats_t));
 
-    if ((status = tp_queue_dequeue(&(tp->task_queue), task)) != EPS_OK)
+    for (int q = 0; q < tp->group_num * TP_LANE_NUM; q++)
     {
-        if (!tp->stopped) ERROR("Could not acquire task");
-        return status;
+        status = tp_queue_get_stats(&(tp->lanes[q / TP_LANE_NUM][q % TP_LANE_NUM]), &lane_stats);
+        if (status != EPS_OK)
+            return status;
+
+        stats->enq_op_cnt    += lane_stats.enq_op_cnt;
+        stats->enq_task_cnt  += lane_stats.enq_task_cnt;
+        stats->enq_retry_cnt += lane_stats.enq_retry_cnt;
+        stats->deq_retry_cnt += lane_stats.deq_retry_cnt;
+    }
+
+    /* Workers are parked on the pool event */
+    stats->park_cnt = __atomic_load_n(&(tp->ev.park_cnt), __ATOMIC_RELAXED);
+    stats->wake_cnt = __atomic_load_n(&(tp->ev.wake_cnt), __ATOMIC_RELAXED);
+    stats->steal_cnt = __atomic_load_n(&(tp->steal_cnt), __ATOMIC_RELAXED);
+
+    return EPS_OK;
+}
+
+unsigned int tp_get_queue_length(tp_threadpool_t *tp)
+{
+    unsigned int len = 0;
+
+    if (!tp)
+        return 0;
+
+    for (int g = 0; g < tp->group_num; g++)
+        for (int l = 0; l < TP_LANE_NUM; l++)
+            len += tp_queue_length(&(tp->lanes[g][l]));
+
+    return len;
+}
+
+unsigned int tp_get_lane_length(tp_threadpool_t *tp, int group, tp_lane_t lane)
+{
+    if (!tp || group < 0 || group >= tp->group_num || lane < 0 || lane >= TP_LANE_NUM)
+        return 0;
+
+    return tp_queue_length(&(tp->lanes[group][lane]));
+}
+
+/* Reserves a worker slot of the lane. FALSE is returned if the lane has
+   reached its limit of busy workers */
+static BOOL tp_lane_acquire(tp_threadpool_t *tp, tp_lane_t lane)
+{
+    if (lane != TP_LANE_READ)
+    {
+        if (__atomic_fetch_add(&(tp->busy_nonread), 1, __ATOMIC_SEQ_CST) >= tp->nonread_max)
+        {
+            __atomic_fetch_sub(&(tp->busy_nonread), 1, __ATOMIC_SEQ_CST);
+            return FALSE;
+        }
+    }
+
+    if (__atomic_fetch_add(&(tp->busy[lane]), 1, __ATOMIC_SEQ_CST) >= tp->lane_max[lane])
+    {
+        __atomic_fetch_sub(&(tp->busy[lane]), 1, __ATOMIC_SEQ_CST);
+        if (lane != TP_LANE_READ)
+            __atomic_fetch_sub(&(tp->busy_nonread), 1, __ATOMIC_SEQ_CST);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void tp_lane_release(tp_threadpool_t *tp, tp_lane_t lane)
+{
+    __atomic_fetch_sub(&(tp->busy[lane]), 1, __ATOMIC_SEQ_CST);
+    if (lane != TP_LANE_READ)
+        __atomic_fetch_sub(&(tp->busy_nonread), 1, __ATOMIC_SEQ_CST);
+}
+
+/* Weighted fair dequeue from the lanes of one group: the lane scheduled
+   for this turn is tried first, then the rest of lanes by priority */
+static ep_stat_t tp_take_group_task(tp_threadpool_t *tp, int group, tp_lane_t first,
+                                    tp_task_t *task)
+{
+    tp_lane_t lane;
+
+    for (int i = -1; i < TP_LANE_NUM; i++)
+    {
+        lane = (i < 0) ? first : (tp_lane_t)i;
+        if (i >= 0 && lane == first)
+            continue;
+
+        if (tp_queue_length(&(tp->lanes[group][lane])) == 0)
+            continue;
+
+        if (!tp_lane_acquire(tp, lane))
+            continue;
+
+        if (tp_queue_try_dequeue(&(tp->lanes[group][lane]), task) == EPS_OK)
+        {
+            task->lane = lane;
+            task->shard = group;
+            return EPS_OK;
+        }
+
+        tp_lane_release(tp, lane);
+    }
+
+    return EPS_EMPTY;
+}
+
+/* The home group of the worker is served first; when it has nothing the
+   worker may take, tasks are stolen from the other groups, so a worker
+   never idles while there is a task it is allowed to take */
+static ep_stat_t tp_take_task(tp_threadpool_t *tp, int group, tp_task_t *task)
+{
+    unsigned int tick = __atomic_fetch_add(&(tp->sched_tick), 1, __ATOMIC_RELAXED);
+    tp_lane_t first = tp->sched[tick % tp->sched_len];
+
+    for (int i = 0; i < tp->group_num; i++)
+    {
+        if (tp_take_group_task(tp, (group + i) % tp->group_num, first, task) == EPS_OK)
+        {
+            if (i > 0)
+                __atomic_fetch_add(&(tp->steal_cnt), 1, __ATOMIC_RELAXED);
+            return EPS_OK;
+        }
+    }
+
+    return EPS_EMPTY;
+}
+
+/* Blocks until a task is available or the thread pool is stopped.
+   Every acquired task must be finished by tp_task_done.
+   EPS_TIMEOUT is returned if the worker stayed idle for
+   TP_WORKER_IDLE_TIMEOUT and was retired by the pool; the worker must exit.
+   "group" is the home group of the worker (see tp_take_task) */
+ep_stat_t tp_get_task(tp_threadpool_t *tp, int group, tp_task_t *task)
+{
+    long idle_since = 0;
+    int key;
+
+    RETURN_ERROR_IF_NULL(tp);
+    RETURN_ERROR_IF_NULL(task);
+
+    if (group < 0 || group >= tp->group_num)
+        group = 0;
+
+    while (!__atomic_load_n(&(tp->stopped), __ATOMIC_SEQ_CST))
+    {
+        if (tp_take_task(tp, group, task) == EPS_OK)
+            return EPS_OK;
+
+        /* Register as waiter and check the lanes once more before parking,
+           so a task added (or a worker slot released) meanwhile is not missed */
+        key = tp_event_prepare(&(tp->ev));
+
+        if (tp_take_task(tp, group, task) == EPS_OK)
+        {
+            tp_event_cancel(&(tp->ev));
+            return EPS_OK;
+        }
+
+        if (__atomic_load_n(&(tp->stopped), __ATOMIC_SEQ_CST))
+        {
+            tp_event_cancel(&(tp->ev));
+            break;
+        }
+
+        if (idle_since == 0)
+            idle_since = ep_time_ms();
+
+        if (tp_event_timedwait(&(tp->ev), key, TP_WORKER_IDLE_TIMEOUT) == EPS_TIMEOUT &&
+            ep_time_ms() - idle_since >= TP_WORKER_IDLE_TIMEOUT && tp_shrink(tp))
+        {
+            return EPS_TIMEOUT;
+        }
+    }
+
+    return EPS_EMPTY;
+}
+
+void tp_completion_init(tp_completion_t *c)
+{
+    memset((char *)c, 0, sizeof(tp_completion_t));
+}
+
+static void tp_completion_signal(tp_completion_t *c)
+{
+    __atomic_store_n(&(c->done), TRUE, __ATOMIC_SEQ_CST);
+    tp_event_notify(&(c->ev), INT_MAX);
+}
+
+/* Waits until the task of the completion is done. EPS_TIMEOUT is returned
+   if it is not done within timeout_ms */
+ep_stat_t tp_completion_wait(tp_completion_t *c, int timeout_ms)
+{
+    long deadline = ep_time_ms() + timeout_ms, left;
+    int key;
+
+    RETURN_ERROR_IF_NULL(c);
+
+    while (!__atomic_load_n(&(c->done), __ATOMIC_SEQ_CST))
+    {
+        if ((left = deadline - ep_time_ms()) <= 0)
+            return EPS_TIMEOUT;
+
+        key = tp_event_prepare(&(c->ev));
+
+        if (__atomic_load_n(&(c->done), __ATOMIC_SEQ_CST))
+        {
+            tp_event_cancel(&(c->ev));
+            break;
+        }
+
+        tp_event_timedwait(&(c->ev), key, (int)left);
     }
 
     return EPS_OK;
 }
 
+/* Releases the worker slot of the task lane and signals the task
+   completion. If tasks of limited lanes are waiting, a parked worker is
+   woken to take them */
+void tp_task_done(tp_threadpool_t *tp, tp_task_t *task)
+{
+    if (!tp || !task)
+        return;
+
+    tp_lane_release(tp, tp_task_lane(task));
+
+    if (task->completion)
+        tp_completion_signal(task->completion);
+
+    if (task->lane == TP_LANE_READ)
+        return;
+
+    for (int g = 0; g < tp->group_num; g++)
+    {
+        if (tp_queue_length(&(tp->lanes[g][TP_LANE_WRITE])) > 0 ||
+            tp_queue_length(&(tp->lanes[g][TP_LANE_MAINT])) > 0)
+        {
+            tp_event_notify(&(tp->ev), 1);
+            break;
+        }
+    }
+}
+
+/* Called by the worker thread before it exits. "retired" tells that the
+   worker exits since tp_get_task returned EPS_TIMEOUT (it is already not
+   counted as running), otherwise the worker failed and is uncounted here.
+   The backend request counter is kept in the slot, so the next worker of
+   the slot does not reuse sequence numbers of requests that may still be
+   answered */
+void tp_worker_exit(tp_worker_slot_t *slot, int be_req_cnt, BOOL retired)
+{
+    tp_threadpool_t *tp;
+
+    if (!slot || !(tp = slot->tp))
+        return;
+
+    if (!retired && !tp->stopped)
+    {
+        pthread_mutex_lock(&(tp->workers_lock));
+        tp->workers_num--;
+        tp_lanes_limits_init(tp);
+        pthread_mutex_unlock(&(tp->workers_lock));
+    }
+
+    slot->be_req_cnt = be_req_cnt;
+    __atomic_store_n(&(slot->state), TP_WORKER_EXITED, __ATOMIC_SEQ_CST);
+}
+
 ep_stat_t tp_destroy(tp_threadpool_t *tp)
 {
-    tp->stopped = TRUE;
-    tp_queue_set_nonblocking(&(tp->task_queue));
+    pthread_t tids[EP_TP_MAX_WORKER_THREADS_NUM];
+    int tid_num = 0;
+
+    __atomic_store_n(&(tp->stopped), TRUE, __ATOMIC_SEQ_CST);
+    tp_event_notify(&(tp->ev), INT_MAX);
+
+    /* Exiting workers may take workers_lock (tp_shrink, tp_worker_exit),
+       so they are joined out of the lock. No worker is started after the
+       pool is stopped, the taken set of threads is final */
+    pthread_mutex_lock(&(tp->workers_lock));
 
-    for (int i = 0; i < EP_TP_WORKER_THREADS_NUM; i ++)
+    for (int i = 0; i < EP_TP_MAX_WORKER_THREADS_NUM; i ++)
     {
-        pthread_join(tp->workers[i], NULL);
+        if (tp->workers[i].state != TP_WORKER_FREE)
+        {
+            tids[tid_num++] = tp->workers[i].tid;
+            tp->workers[i].state = TP_WORKER_FREE;
+        }
     }
 
-    tp_queue_destroy(&(tp->task_queue));
+    pthread_mutex_unlock(&(tp->workers_lock));
+
+    for (int i = 0; i < tid_num; i ++)
+        pthread_join(tids[i], NULL);
+
+    INFO("Thread pool stopped: grown %lu times, shrunk %lu times, %lu tasks stolen",
+          tp->grow_cnt, tp->shrink_cnt, tp->steal_cnt);
+
+    for (int g = 0; g < tp->group_num; g++)
+        for (int l = 0; l < TP_LANE_NUM; l++)
+            tp_queue_destroy(&(tp->lanes[g][l]));
+    tp_msgpool_destroy(&(tp->msg_pool));
+    pthread_mutex_destroy(&(tp->workers_lock));
     free(tp);
 
     return EPS_OK;
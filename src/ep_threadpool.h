@@ -86,55 +86,237 @@
 } while(0)
 
 
+/* Message buffer. At any moment the buffer has exactly one owner: the pool,
+   the dispatcher (while receiving), the task queue or a worker thread.
+   Only the pointer to the buffer is passed from owner to owner */
+typedef struct tp_msgbuf_s {
+    struct tp_msgbuf_s *next;       /* link in the pool free list */
+    char *msg;                      /* start of the XML message in data */
+    char data[MAX_DISP_MSG_LEN];
+} tp_msgbuf_t;
+
+/* Buffers are allocated on demand up to max_num (see TP_MSG_POOL_SIZE)
+   and kept in the pool until it is destroyed */
+typedef struct tp_msgpool_s {
+    tp_msgbuf_t **bufs;             /* allocated buffers */
+    unsigned int buf_num;
+    unsigned int max_num;
+    tp_msgbuf_t *free_list;
+    unsigned int free_num;
+
+    pthread_mutex_t mutex;
+} tp_msgpool_t;
+
+/* Task lanes (scheduling classes) of the thread pool */
+typedef enum {
+    TP_LANE_READ = 0,       /* GetParamValue, GetParamNames */
+    TP_LANE_WRITE,          /* SetParamValue, AddObject, DelObject */
+    TP_LANE_MAINT,          /* DiscoverConfig, InitActions, Reboot, Reset */
+    TP_LANE_NUM
+} tp_lane_t;
+
 typedef struct tp_task_s {
     enum {
         TASK_TYPE_RAW,
         TASK_TYPE_SUBTASK,
     } task_type;
 
+    tp_lane_t lane;
+    int shard;                      /* dispatcher shard: group of lane queues
+                                       the task is added to */
+    struct tp_completion_s *completion; /* signalled when the task is done
+                                           (optional) */
+
     union {
-        char raw_message[MAX_DISP_MSG_LEN];
+        tp_msgbuf_t *msgbuf;        /* raw message owned by the task */
+        void *subtask;              /* subtask data, owned by the worker
+                                       that created the subtask */
 
     };
 } tp_task_t;
 
+#if (TP_MAX_TASK_QUEUE_SIZE & (TP_MAX_TASK_QUEUE_SIZE - 1)) != 0
+#   error "TP_MAX_TASK_QUEUE_SIZE must be a power of 2"
+#endif
+
+#define TP_QUEUE_MASK       (TP_MAX_TASK_QUEUE_SIZE - 1)
+#define TP_CACHELINE_SIZE   64
+
+/* Queue slot: seq tells whether the slot is free for the enqueue position
+   (seq == pos) or holds the task for the dequeue position (seq == pos + 1) */
+typedef struct tp_queue_cell_s {
+    volatile unsigned int seq;
+    tp_task_t task;
+} tp_queue_cell_t;
+
+/* Parking place of idle consumers (see tp_event_prepare) */
+typedef struct tp_event_s {
+    volatile int seq;               /* futex word, changed on each notification */
+    volatile int waiters;           /* number of registered consumers */
+
+    unsigned long park_cnt;         /* number of times a consumer was parked */
+    unsigned long wake_cnt;         /* number of futex wake-up calls */
+} tp_event_t;
+
+/* Completion of a task: the producer may wait until a worker has finished
+   the task (see tp_task_done) */
+typedef struct tp_completion_s {
+    volatile BOOL done;
+    tp_event_t ev;
+} tp_completion_t;
+
+/* Queue statistics (updated by relaxed atomic operations) */
+typedef struct tp_queue_stats_s {
+    unsigned long enq_op_cnt;       /* number of successful enqueue operations */
+    unsigned long enq_task_cnt;     /* number of enqueued tasks */
+    unsigned long enq_retry_cnt;    /* enqueue CAS retries due to contention */
+    unsigned long deq_retry_cnt;    /* dequeue CAS retries due to contention */
+    unsigned long park_cnt;         /* number of times a worker was parked */
+    unsigned long wake_cnt;         /* number of futex wake-up calls */
+    unsigned long steal_cnt;        /* tasks taken from queues of other groups */
+} tp_queue_stats_t;
+
+/* Bounded lock-free multi-producer/multi-consumer ring (sequence numbered
+   slots). Idle consumers of a blocking queue are parked on the queue
+   event; each enqueued task wakes at most one of them */
 typedef struct tp_queue_s {
-    tp_task_t elems[TP_MAX_TASK_QUEUE_SIZE];
-    unsigned int tail;
-    unsigned int head;
-    unsigned int length;
+    tp_queue_cell_t cells[TP_MAX_TASK_QUEUE_SIZE];
 
-    pthread_mutex_t mutex;
+    char pad0[TP_CACHELINE_SIZE];
+    volatile unsigned int tail;     /* next enqueue position */
+    char pad1[TP_CACHELINE_SIZE];
+    volatile unsigned int head;     /* next dequeue position */
+    char pad2[TP_CACHELINE_SIZE];
+
+    tp_event_t ev;                  /* consumers of a blocking queue wait here */
 
     volatile BOOL is_blocking;
-    pthread_cond_t cv_got_task;
+
+    tp_queue_stats_t stats;
 } tp_queue_t;
 
+/* Worker thread slot. Slot defines the worker number, so the worker ports
+   and backend request sequence numbers do not collide while the pool grows
+   and shrinks */
+typedef enum {
+    TP_WORKER_FREE = 0,
+    TP_WORKER_RUNNING,
+    TP_WORKER_EXITED                /* thread finished, not joined yet */
+} tp_worker_state_t;
+
+typedef struct tp_worker_slot_s {
+    struct tp_threadpool_s *tp;
+    pthread_t tid;
+    volatile tp_worker_state_t state;
+    int w_num;                      /* worker number, 1..EP_TP_MAX_WORKER_THREADS_NUM */
+    int group;                      /* home group of lane queues */
+    int be_req_cnt;                 /* last backend request seq number of the slot */
+} tp_worker_slot_t;
+
 typedef struct tp_threadpool_s {
-    tp_queue_t task_queue;
-    pthread_t workers[EP_TP_WORKER_THREADS_NUM];
+    /* Non-blocking queue per lane for each group. Every dispatcher shard
+       feeds its own group; workers serve their home group first and steal
+       from the other groups when it is empty */
+    tp_queue_t lanes[EP_DISP_MAX_SHARDS][TP_LANE_NUM];
+    int group_num;
+    volatile unsigned long steal_cnt;
+
+    tp_event_t ev;                  /* idle workers are parked here */
+
+    /* Workers busy with tasks of the lanes and their limits */
+    volatile int busy[TP_LANE_NUM];
+    volatile int busy_nonread;
+    int lane_max[TP_LANE_NUM];
+    int nonread_max;
+
+    /* Weighted round-robin order of lanes for dequeue */
+    tp_lane_t sched[TP_LANE_SCHED_LEN];
+    int sched_len;
+    volatile unsigned int sched_tick;
+
+    tp_msgpool_t msg_pool;
+
+    /* Elastic set of workers: grows up to workers_max when tasks wait in
+       the queue and no worker is idle, shrinks down to workers_min when
+       workers stay idle */
+    tp_worker_slot_t workers[EP_TP_MAX_WORKER_THREADS_NUM];
+    pthread_mutex_t workers_lock;   /* protects resizing of the pool */
+    volatile int workers_num;       /* number of running (not retiring) workers */
+    int workers_min;
+    int workers_max;
+    unsigned long grow_cnt;
+    unsigned long shrink_cnt;
+
     volatile BOOL stopped;
 } tp_threadpool_t;
 
 void *tp_worker(void *);
 
+int tp_event_prepare(tp_event_t *ev);
+
+void tp_event_wait(tp_event_t *ev, int key);
+
+ep_stat_t tp_event_timedwait(tp_event_t *ev, int key, int timeout_ms);
+
+void tp_event_cancel(tp_event_t *ev);
+
+void tp_event_notify(tp_event_t *ev, int num);
+
 ep_stat_t tp_queue_init(tp_queue_t *q, BOOL blocking);
 
 ep_stat_t tp_queue_enqueue(tp_queue_t *q, tp_task_t *elem);
 
+ep_stat_t tp_queue_enqueue_batch(tp_queue_t *q, tp_task_t *elems, int num, int *enqueued);
+
 ep_stat_t tp_queue_dequeue(tp_queue_t *q, tp_task_t *t);
 
+ep_stat_t tp_queue_try_dequeue(tp_queue_t *q, tp_task_t *t);
+
 ep_stat_t tp_queue_status(tp_queue_t *q);
 
+ep_stat_t tp_queue_get_stats(tp_queue_t *q, tp_queue_stats_t *stats);
+
+unsigned int tp_queue_length(tp_queue_t *q);
+
 ep_stat_t tp_queue_set_nonblocking(tp_queue_t *q);
 
 ep_stat_t tp_queue_destroy(tp_queue_t *q);
 
-ep_stat_t tp_init(tp_threadpool_t **tp);
+ep_stat_t tp_msgpool_init(tp_msgpool_t *pool, unsigned int max_num);
+
+int tp_msgpool_get(tp_msgpool_t *pool, tp_msgbuf_t *bufs[], int num);
+
+void tp_msgpool_put(tp_msgpool_t *pool, tp_msgbuf_t *buf);
+
+ep_stat_t tp_msgpool_destroy(tp_msgpool_t *pool);
+
+ep_stat_t tp_init(tp_threadpool_t **tp, int group_num);
+
+tp_msgbuf_t *tp_get_msgbuf(tp_threadpool_t *tp);
+
+int tp_get_msgbufs(tp_threadpool_t *tp, tp_msgbuf_t *bufs[], int num);
+
+void tp_put_msgbuf(tp_threadpool_t *tp, tp_msgbuf_t *buf);
 
 ep_stat_t tp_add_task(tp_threadpool_t *tp, tp_task_t *task);
 
-ep_stat_t tp_get_task(tp_threadpool_t *tp, tp_task_t *task);
+ep_stat_t tp_add_tasks(tp_threadpool_t *tp, tp_task_t *tasks, int num, int *added);
+
+ep_stat_t tp_get_queue_stats(tp_threadpool_t *tp, tp_queue_stats_t *stats);
+
+unsigned int tp_get_queue_length(tp_threadpool_t *tp);
+
+unsigned int tp_get_lane_length(tp_threadpool_t *tp, int group, tp_lane_t lane);
+
+ep_stat_t tp_get_task(tp_threadpool_t *tp, int group, tp_task_t *task);
+
+void tp_task_done(tp_threadpool_t *tp, tp_task_t *task);
+
+void tp_completion_init(tp_completion_t *c);
+
+ep_stat_t tp_completion_wait(tp_completion_t *c, int timeout_ms);
+
+void tp_worker_exit(tp_worker_slot_t *slot, int be_req_cnt, BOOL retired);
 
 ep_stat_t tp_destroy(tp_threadpool_t *tp);
 
@@ -0,0 +1,204 @@
+/* ep_ubus.c
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+
+
+/*
+ * ubus calls through libubus
+ */
+
+#include <libubus.h>
+#include <libubox/blobmsg_json.h>
+
+#include "ep_ubus.h"
+
+struct ep_ubus_s {
+    struct ubus_context *ctx;     /* connected by the first call */
+    struct blob_buf msg;
+    char *result;                 /* result of the current call */
+};
+
+static ep_stat_t ep_ubus_status(int res)
+{
+    switch (res)
+    {
+        case UBUS_STATUS_OK:               return EPS_OK;
+        case UBUS_STATUS_NOT_FOUND:
+        case UBUS_STATUS_METHOD_NOT_FOUND: return EPS_NOT_FOUND;
+        case UBUS_STATUS_INVALID_ARGUMENT: return EPS_INVALID_ARGUMENT;
+        case UBUS_STATUS_PERMISSION_DENIED: return EPS_NO_PERMISSION;
+        case UBUS_STATUS_TIMEOUT:          return EPS_TIMEOUT;
+        case UBUS_STATUS_NOT_SUPPORTED:    return EPS_NOT_IMPLEMENTED;
+        default:                           return EPS_SYSTEM_ERROR;
+    }
+}
+
+static struct ubus_context *ep_ubus_context(ep_ubus_t *ubus)
+{
+    if (ubus->ctx)
+        return ubus->ctx;
+
+    if ((ubus->ctx = ubus_connect(EP_UBUS_SOCKET)) == NULL)
+        ERROR("Could not connect to ubus");
+
+    return ubus->ctx;
+}
+
+static void ep_ubus_data_cb(struct ubus_request *req, int type, struct blob_attr *msg)
+{
+    ep_ubus_t *ubus = (ep_ubus_t *)req->priv;
+
+    (void)type;
+    if (!msg)
+        return;
+
+    free(ubus->result);
+    ubus->result = blobmsg_format_json(msg, true);
+}
+
+ep_ubus_t *ep_ubus_create(void)
+{
+    return calloc(1, sizeof(ep_ubus_t));
+}
+
+void ep_ubus_destroy(ep_ubus_t *ubus)
+{
+    if (!ubus)
+        return;
+
+    if (ubus->ctx)
+        ubus_free(ubus->ctx);
+    blob_buf_free(&ubus->msg);
+    free(ubus->result);
+    free(ubus);
+}
+
+ep_stat_t ep_ubus_call(ep_ubus_t *ubus, const char *call, char **result)
+{
+    ep_stat_t status = EPS_OK;
+    char buf[EP_SQL_REQUEST_BUF_SIZE];
+    char *obj, *method, *args, *strtok_ctx;
+    uint32_t id;
+    int res, attempt;
+
+    *result = NULL;
+
+    strcpy_safe(buf, call, sizeof(buf));
+    obj = strtok_r(buf, " \t", &strtok_ctx);
+    method = strtok_r(NULL, " \t", &strtok_ctx);
+    args = strtok_r(NULL, "", &strtok_ctx);
+    if (!obj || !method)
+        GOTO_RET_WITH_ERROR(EPS_INVALID_FORMAT, "Object or method is missing in ubus call %s", call);
+
+    /* The message may be quoted as for the shell */
+    if (args)
+    {
+        trim(args);
+        trim_quotes(args);
+        if (strlen(args) == 0)
+            args = NULL;
+    }
+
+    blob_buf_init(&ubus->msg, 0);
+    if (args && !blobmsg_add_json_from_string(&ubus->msg, args))
+        GOTO_RET_WITH_ERROR(EPS_INVALID_FORMAT, "Invalid JSON message in ubus call %s", call);
+
+    /* The connection is reopened once if ubusd was restarted */
+    for (attempt = 0; attempt < 2; attempt++)
+    {
+        if (!ep_ubus_context(ubus))
+            GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "ubus is not available");
+
+        res = ubus_lookup_id(ubus->ctx, obj, &id);
+        if (res == UBUS_STATUS_OK)
+        {
+            free(ubus->result);
+            ubus->result = NULL;
+            res = ubus_invoke(ubus->ctx, id, method, ubus->msg.head,
+                              ep_ubus_data_cb, ubus, EP_UBUS_CALL_TIMEOUT);
+        }
+
+        if (res != UBUS_STATUS_CONNECTION_FAILED)
+            break;
+
+        WARN("ubus connection is lost, reconnecting");
+        ubus_free(ubus->ctx);
+        ubus->ctx = NULL;
+    }
+
+    if (res != UBUS_STATUS_OK)
+        GOTO_RET_WITH_ERROR(ep_ubus_status(res), "ubus call %s failed: %s", call, ubus_strerror(res));
+
+    /* Method without reply data */
+    *result = ubus->result ? ubus->result : strdup("{}");
+    ubus->result = NULL;
+    if (*result == NULL)
+        status = EPS_OUTOFMEMORY;
+
+ret:
+    return status;
+}
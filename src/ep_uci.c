@@ -0,0 +1,371 @@
+/* ep_uci.c
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+
+
+/*
+ * UCI configs access through libuci
+ */
+
+#include <uci.h>
+
+#include "ep_uci.h"
+
+#define EP_UCI_MAX_PACKAGES     16
+#define EP_UCI_PATH_LEN         512
+
+/* Previous value of the option changed by ep_uci_set */
+typedef struct ep_uci_undo_s {
+    char *path;
+    char *value;                  /* NULL - the option did not exist */
+    BOOL is_list;                 /* list value cannot be restored */
+} ep_uci_undo_t;
+
+struct ep_uci_s {
+    struct uci_context *ctx;      /* created on the first access in a request */
+    struct uci_package *changed[EP_UCI_MAX_PACKAGES];
+    int changed_num;
+    ep_uci_undo_t *undo;
+    int undo_num;
+    int undo_size;
+};
+
+static void ep_uci_error(ep_uci_t *uci, const char *op, const char *path)
+{
+    char *err = NULL;
+
+    uci_get_errorstr(uci->ctx, &err, NULL);
+    ERROR("uci %s %s failed: %s", op, path, err ? err : "unknown error");
+    free(err);
+}
+
+static struct uci_context *ep_uci_context(ep_uci_t *uci)
+{
+    char *dir;
+
+    if (uci->ctx)
+        return uci->ctx;
+
+    if ((uci->ctx = uci_alloc_context()) == NULL)
+    {
+        ERROR("Could not allocate uci context");
+        return NULL;
+    }
+
+    if ((dir = EP_UCI_CONFDIR) != NULL && strlen(dir) > 0)
+        uci_set_confdir(uci->ctx, dir);
+
+    if ((dir = EP_UCI_SAVEDIR) != NULL && strlen(dir) > 0)
+        uci_set_savedir(uci->ctx, dir);
+
+    return uci->ctx;
+}
+
+/* Resolves "package.section[.option]" path; the package is loaded by the
+   first lookup of the request. buf keeps the parsed path */
+static int ep_uci_lookup(ep_uci_t *uci, const char *path, char *buf, size_t buf_size,
+                         struct uci_ptr *ptr)
+{
+    char *p;
+
+    if (!ep_uci_context(uci))
+        return UCI_ERR_MEM;
+
+    if (strlen(path) >= buf_size)
+        return UCI_ERR_INVAL;
+
+    strcpy_safe(buf, path, buf_size);
+    p = trim(buf);
+
+    memset(ptr, 0, sizeof(*ptr));
+    return uci_lookup_ptr(uci->ctx, ptr, p, true);
+}
+
+static void ep_uci_undo_clear(ep_uci_t *uci)
+{
+    while (uci->undo_num > 0)
+    {
+        uci->undo_num--;
+        free(uci->undo[uci->undo_num].path);
+        free(uci->undo[uci->undo_num].value);
+    }
+}
+
+ep_uci_t *ep_uci_create(void)
+{
+    return (ep_uci_t *)calloc(1, sizeof(ep_uci_t));
+}
+
+void ep_uci_destroy(ep_uci_t *uci)
+{
+    if (!uci)
+        return;
+
+    ep_uci_reset(uci);
+    free(uci->undo);
+    free(uci);
+}
+
+/* Drops the loaded packages; changes that were not committed are lost */
+void ep_uci_reset(ep_uci_t *uci)
+{
+    if (!uci)
+        return;
+
+    if (uci->changed_num > 0)
+        WARN("%d uci packages were changed but not committed", uci->changed_num);
+
+    ep_uci_undo_clear(uci);
+    uci->changed_num = 0;
+
+    if (uci->ctx)
+    {
+        uci_free_context(uci->ctx);
+        uci->ctx = NULL;
+    }
+}
+
+/* Gets value of the option (list items are separated by spaces) or type
+   of the section, like "uci get" does. value may be the path buffer */
+ep_stat_t ep_uci_get(ep_uci_t *uci, const char *path, char *value, size_t value_size)
+{
+    struct uci_ptr ptr;
+    struct uci_element *e;
+    char buf[EP_UCI_PATH_LEN];
+
+    if (ep_uci_lookup(uci, path, buf, sizeof(buf), &ptr) != UCI_OK)
+    {
+        DBG("Could not look up uci %s", path);
+        return EPS_INVALID_ARGUMENT;
+    }
+
+    value[0] = '\0';
+
+    if (!(ptr.flags & UCI_LOOKUP_COMPLETE))
+        return EPS_NOT_FOUND;
+
+    switch (ptr.last->type)
+    {
+        case UCI_TYPE_SECTION:
+            strcpy_safe(value, ptr.s->type, value_size);
+            break;
+
+        case UCI_TYPE_OPTION:
+            if (ptr.o->type == UCI_TYPE_STRING)
+            {
+                strcpy_safe(value, ptr.o->v.string, value_size);
+                break;
+            }
+
+            uci_foreach_element(&ptr.o->v.list, e)
+            {
+                if (value[0])
+                    strcat_safe(value, " ", value_size);
+                strcat_safe(value, e->name, value_size);
+            }
+            break;
+
+        default:
+            return EPS_NOT_FOUND;
+    }
+
+    return EPS_OK;
+}
+
+/* Sets the option value in the loaded package. The previous value is
+   saved for ep_uci_rollback; the package is written by ep_uci_commit */
+ep_stat_t ep_uci_set(ep_uci_t *uci, const char *path, const char *value)
+{
+    struct uci_ptr ptr;
+    ep_uci_undo_t *undo;
+    char buf[EP_UCI_PATH_LEN];
+    int i;
+
+    if (ep_uci_lookup(uci, path, buf, sizeof(buf), &ptr) != UCI_OK)
+    {
+        ep_uci_error(uci, "set", path);
+        return EPS_INVALID_ARGUMENT;
+    }
+
+    if (uci->undo_num == uci->undo_size)
+    {
+        undo = (ep_uci_undo_t *)realloc(uci->undo, (uci->undo_size + 16) * sizeof(ep_uci_undo_t));
+        if (!undo)
+            return EPS_OUTOFMEMORY;
+        uci->undo = undo;
+        uci->undo_size += 16;
+    }
+
+    undo = &(uci->undo[uci->undo_num]);
+    memset(undo, 0, sizeof(*undo));
+    if ((undo->path = strdup(path)) == NULL)
+        return EPS_OUTOFMEMORY;
+
+    if (ptr.o && ptr.o->type == UCI_TYPE_STRING)
+    {
+        if ((undo->value = strdup(ptr.o->v.string)) == NULL)
+        {
+            free(undo->path);
+            return EPS_OUTOFMEMORY;
+        }
+    }
+    else if (ptr.o)
+        undo->is_list = TRUE;
+
+    ptr.value = value;
+    if (uci_set(uci->ctx, &ptr) != UCI_OK)
+    {
+        ep_uci_error(uci, "set", path);
+        free(undo->path);
+        free(undo->value);
+        return EPS_SYSTEM_ERROR;
+    }
+    uci->undo_num++;
+
+    for (i = 0; i < uci->changed_num; i++)
+    {
+        if (uci->changed[i] == ptr.p)
+            return EPS_OK;
+    }
+
+    if (uci->changed_num == EP_UCI_MAX_PACKAGES)
+    {
+        /* Should not happen: the package is written right away */
+        WARN("Too many changed uci packages, commit %s", ptr.p->e.name);
+        if (uci_commit(uci->ctx, &ptr.p, false) != UCI_OK)
+        {
+            ep_uci_error(uci, "commit", ptr.p->e.name);
+            return EPS_SYSTEM_ERROR;
+        }
+        return EPS_OK;
+    }
+
+    uci->changed[uci->changed_num++] = ptr.p;
+
+    return EPS_OK;
+}
+
+/* Position in the list of changes for ep_uci_rollback */
+int ep_uci_mark(ep_uci_t *uci)
+{
+    return uci->undo_num;
+}
+
+/* Restores the options changed after the mark (in the loaded packages) */
+void ep_uci_rollback(ep_uci_t *uci, int mark)
+{
+    struct uci_ptr ptr;
+    ep_uci_undo_t *undo;
+    char buf[EP_UCI_PATH_LEN];
+
+    while (uci->undo_num > mark)
+    {
+        undo = &(uci->undo[--uci->undo_num]);
+
+        if (undo->is_list)
+            WARN("Previous value of uci list %s cannot be restored", undo->path);
+        else if (ep_uci_lookup(uci, undo->path, buf, sizeof(buf), &ptr) != UCI_OK)
+            ep_uci_error(uci, "revert", undo->path);
+        else if (undo->value)
+        {
+            ptr.value = undo->value;
+            if (uci_set(uci->ctx, &ptr) != UCI_OK)
+                ep_uci_error(uci, "revert", undo->path);
+        }
+        else if (ptr.o)
+        {
+            if (uci_delete(uci->ctx, &ptr) != UCI_OK)
+                ep_uci_error(uci, "revert", undo->path);
+        }
+
+        free(undo->path);
+        free(undo->value);
+    }
+}
+
+/* Writes the packages changed in the request */
+ep_stat_t ep_uci_commit(ep_uci_t *uci)
+{
+    ep_stat_t status = EPS_OK;
+    int i;
+
+    for (i = 0; i < uci->changed_num; i++)
+    {
+        DBG("uci commit %s", uci->changed[i]->e.name);
+        if (uci_commit(uci->ctx, &(uci->changed[i]), false) != UCI_OK)
+        {
+            ep_uci_error(uci, "commit", uci->changed[i]->e.name);
+            status = EPS_SYSTEM_ERROR;
+        }
+    }
+
+    /* The changes are written, nothing to roll back */
+    uci->changed_num = 0;
+    ep_uci_undo_clear(uci);
+
+    return status;
+}
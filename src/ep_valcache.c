@@ -0,0 +1,486 @@
+/* ep_valcache.c
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+
+
+/*
+ * Value cache of the parameters read by external commands
+ */
+
+#include <pthread.h>
+
+#include "ep_valcache.h"
+
+#define EP_VALCACHE_SHARDS      16
+#define EP_VALCACHE_MAX_RULES   64
+
+typedef struct ep_valcache_entry_s {
+    struct ep_valcache_entry_s *next;
+    unsigned int hash;
+    long expire_ms;
+    char *param_name;
+    char *cmd;
+    char *value;
+    char obj_name[];              /* the other strings follow the object name */
+} ep_valcache_entry_t;
+
+typedef struct ep_valcache_shard_s {
+    pthread_mutex_t lock;
+    ep_valcache_entry_t **buckets;
+    int entry_num;
+    ep_valcache_stats_t stats;
+} ep_valcache_shard_t;
+
+/* Object or parameter which values are cached */
+typedef struct ep_valcache_rule_s {
+    const char *name;
+    long ttl_ms;
+} ep_valcache_rule_t;
+
+static pthread_once_t g_vc_once = PTHREAD_ONCE_INIT;
+static BOOL g_vc_enabled;
+static long g_vc_ttl;
+static int g_vc_rule_num;
+static ep_valcache_rule_t g_vc_rules[EP_VALCACHE_MAX_RULES];
+static unsigned int g_vc_bucket_num;    /* per shard, power of 2 */
+static int g_vc_shard_max;              /* max entries per shard */
+static ep_valcache_shard_t g_vc_shards[EP_VALCACHE_SHARDS];
+static volatile int g_vc_gen;           /* changed on each invalidation */
+
+static unsigned int ep_valcache_hash(const char *obj_name, const char *param_name,
+                                     const char *cmd)
+{
+    const char *strs[3] = {obj_name, param_name, cmd};
+    unsigned int h = EP_HASH_INIT;
+    int i;
+
+    for (i = 0; i < 3; i++)
+        h = ep_hash_str(ep_hash_str(h, strs[i]), "\n");
+
+    return h;
+}
+
+/* Parses EP_VALUE_CACHE_OBJECTS list; the rules point to the copy of
+   the list that is kept for the process lifetime */
+static void ep_valcache_parse_rules(const char *str)
+{
+    char *list, *token, *strtok_ctx, *p;
+    long ttl;
+
+    if ((list = strdup(str)) == NULL)
+    {
+        ERROR("Could not allocate value cache rules");
+        return;
+    }
+
+    for (token = strtok_r(list, ", \t", &strtok_ctx); token;
+         token = strtok_r(NULL, ", \t", &strtok_ctx))
+    {
+        ttl = (g_vc_ttl > 0) ? g_vc_ttl : EP_VALUE_CACHE_DEF_TTL;
+
+        if ((p = strchr(token, '=')) != NULL)
+        {
+            *p = '\0';
+            ttl = atol(p + 1);
+        }
+
+        if (strlen(token) == 0 || ttl <= 0)
+        {
+            WARN("Invalid value cache rule %s. Ignore", token);
+            continue;
+        }
+
+        if (g_vc_rule_num >= EP_VALCACHE_MAX_RULES)
+        {
+            WARN("Too many value cache rules, only %d are used", EP_VALCACHE_MAX_RULES);
+            break;
+        }
+
+        g_vc_rules[g_vc_rule_num].name = token;
+        g_vc_rules[g_vc_rule_num].ttl_ms = ttl;
+        g_vc_rule_num++;
+    }
+}
+
+static void ep_valcache_init(void)
+{
+    char *str;
+    int i;
+
+    if ((str = EP_VALUE_CACHE_TTL) != NULL && atol(str) > 0)
+        g_vc_ttl = atol(str);
+
+    if ((str = EP_VALUE_CACHE_OBJECTS) != NULL)
+        ep_valcache_parse_rules(str);
+
+    if (g_vc_ttl <= 0 && g_vc_rule_num == 0)
+        return;
+
+    g_vc_shard_max = (EP_VALUE_CACHE_SIZE + EP_VALCACHE_SHARDS - 1) / EP_VALCACHE_SHARDS;
+    for (g_vc_bucket_num = 1; g_vc_bucket_num < (unsigned int)g_vc_shard_max; g_vc_bucket_num <<= 1)
+        ;
+
+    for (i = 0; i < EP_VALCACHE_SHARDS; i++)
+    {
+        pthread_mutex_init(&(g_vc_shards[i].lock), NULL);
+        g_vc_shards[i].buckets = (ep_valcache_entry_t **)calloc(g_vc_bucket_num,
+                                                   sizeof(ep_valcache_entry_t *));
+        if (!g_vc_shards[i].buckets)
+        {
+            ERROR("Could not allocate value cache. Values are not cached");
+            return;
+        }
+    }
+
+    g_vc_enabled = TRUE;
+
+    INFO("Value cache: TTL %ld ms, %d object/parameter rules, up to %d values",
+         g_vc_ttl, g_vc_rule_num, g_vc_shard_max * EP_VALCACHE_SHARDS);
+}
+
+/* TTL of the parameter values: the parameter rule is preferred to the
+   object one. 0 - the values are not cached */
+static long ep_valcache_ttl(const char *obj_name, const char *param_name)
+{
+    size_t len = strlen(obj_name);
+    long ttl = 0;
+    int i;
+
+    if (g_vc_rule_num == 0)
+        return g_vc_ttl;
+
+    for (i = 0; i < g_vc_rule_num; i++)
+    {
+        if (strncmp(g_vc_rules[i].name, obj_name, len))
+            continue;
+
+        if (g_vc_rules[i].name[len] == '\0')
+            ttl = g_vc_rules[i].ttl_ms;
+        else if (!strcmp(g_vc_rules[i].name + len, param_name))
+            return g_vc_rules[i].ttl_ms;
+    }
+
+    return ttl;
+}
+
+static ep_valcache_entry_t **ep_valcache_bucket(ep_valcache_shard_t *shard, unsigned int hash)
+{
+    return &(shard->buckets[(hash / EP_VALCACHE_SHARDS) & (g_vc_bucket_num - 1)]);
+}
+
+/* Drops expired entries of the shard (the shard is locked) */
+static void ep_valcache_purge(ep_valcache_shard_t *shard, long now)
+{
+    ep_valcache_entry_t **pp, *entry;
+    unsigned int i;
+
+    for (i = 0; i < g_vc_bucket_num; i++)
+    {
+        pp = &(shard->buckets[i]);
+        while ((entry = *pp) != NULL)
+        {
+            if (entry->expire_ms <= now)
+            {
+                *pp = entry->next;
+                free(entry);
+                shard->entry_num--;
+                shard->stats.expired++;
+            }
+            else
+                pp = &(entry->next);
+        }
+    }
+}
+
+BOOL ep_valcache_enabled(void)
+{
+    pthread_once(&g_vc_once, ep_valcache_init);
+
+    return g_vc_enabled;
+}
+
+/* Looks up the value read by the command. If it is cached and not expired,
+   it is copied to "value" (it may be the command buffer) and TRUE is
+   returned. Otherwise the key is saved in "ref": the caller runs the
+   command and passes the result to ep_valcache_store */
+BOOL ep_valcache_lookup(ep_valcache_ref_t *ref, const char *obj_name, const char *param_name,
+                        const char *cmd, char *value, size_t value_size)
+{
+    ep_valcache_shard_t *shard;
+    ep_valcache_entry_t **pp, *entry;
+    BOOL found = FALSE;
+    long now;
+
+    ref->ttl_ms = 0;
+
+    if (!ep_valcache_enabled() || !obj_name || !param_name || !cmd)
+        return FALSE;
+
+    if (strlen(cmd) >= sizeof(ref->cmd) ||
+        (ref->ttl_ms = ep_valcache_ttl(obj_name, param_name)) <= 0)
+    {
+        ref->ttl_ms = 0;
+        return FALSE;
+    }
+
+    ref->obj_name = obj_name;
+    ref->param_name = param_name;
+    ref->hash = ep_valcache_hash(obj_name, param_name, cmd);
+    ref->gen = __atomic_load_n(&g_vc_gen, __ATOMIC_SEQ_CST);
+
+    shard = &g_vc_shards[ref->hash % EP_VALCACHE_SHARDS];
+    now = ep_time_ms();
+
+    pthread_mutex_lock(&(shard->lock));
+
+    pp = ep_valcache_bucket(shard, ref->hash);
+    while ((entry = *pp) != NULL)
+    {
+        if (entry->hash == ref->hash && !strcmp(entry->cmd, cmd) &&
+            !strcmp(entry->param_name, param_name) && !strcmp(entry->obj_name, obj_name))
+        {
+            if (entry->expire_ms > now)
+            {
+                strcpy_safe(value, entry->value, value_size);
+                found = TRUE;
+            }
+            else
+            {
+                *pp = entry->next;
+                free(entry);
+                shard->entry_num--;
+                shard->stats.expired++;
+            }
+            break;
+        }
+        pp = &(entry->next);
+    }
+
+    if (found)
+        shard->stats.hits++;
+    else
+        shard->stats.misses++;
+
+    pthread_mutex_unlock(&(shard->lock));
+
+    if (found)
+        ref->ttl_ms = 0;
+    else
+        strcpy_safe(ref->cmd, cmd, sizeof(ref->cmd));
+
+    return found;
+}
+
+/* Stores the value read by the command of the missed lookup. The value is
+   not stored if the object was invalidated after the lookup (the command
+   could read the value before the write operation) */
+void ep_valcache_store(ep_valcache_ref_t *ref, const char *value)
+{
+    ep_valcache_shard_t *shard;
+    ep_valcache_entry_t **pp, *entry, *old;
+    size_t obj_len, param_len, cmd_len, value_len;
+    long now;
+
+    if (!ref || ref->ttl_ms <= 0 || !value)
+        return;
+
+    obj_len = strlen(ref->obj_name) + 1;
+    param_len = strlen(ref->param_name) + 1;
+    cmd_len = strlen(ref->cmd) + 1;
+    value_len = strlen(value) + 1;
+
+    entry = (ep_valcache_entry_t *)malloc(sizeof(ep_valcache_entry_t) +
+                                          obj_len + param_len + cmd_len + value_len);
+    if (!entry)
+        return;
+
+    now = ep_time_ms();
+    entry->hash = ref->hash;
+    entry->expire_ms = now + ref->ttl_ms;
+    entry->param_name = entry->obj_name + obj_len;
+    entry->cmd = entry->param_name + param_len;
+    entry->value = entry->cmd + cmd_len;
+    memcpy(entry->obj_name, ref->obj_name, obj_len);
+    memcpy(entry->param_name, ref->param_name, param_len);
+    memcpy(entry->cmd, ref->cmd, cmd_len);
+    memcpy(entry->value, value, value_len);
+
+    ref->ttl_ms = 0;
+    shard = &g_vc_shards[entry->hash % EP_VALCACHE_SHARDS];
+
+    pthread_mutex_lock(&(shard->lock));
+
+    if (ref->gen != __atomic_load_n(&g_vc_gen, __ATOMIC_SEQ_CST))
+    {
+        pthread_mutex_unlock(&(shard->lock));
+        free(entry);
+        return;
+    }
+
+    /* The value may be stored by another worker meanwhile */
+    pp = ep_valcache_bucket(shard, entry->hash);
+    while ((old = *pp) != NULL)
+    {
+        if (old->hash == entry->hash && !strcmp(old->cmd, entry->cmd) &&
+            !strcmp(old->param_name, entry->param_name) && !strcmp(old->obj_name, entry->obj_name))
+        {
+            *pp = old->next;
+            free(old);
+            shard->entry_num--;
+            break;
+        }
+        pp = &(old->next);
+    }
+
+    if (shard->entry_num >= g_vc_shard_max)
+        ep_valcache_purge(shard, now);
+
+    if (shard->entry_num >= g_vc_shard_max)
+    {
+        shard->stats.full++;
+        pthread_mutex_unlock(&(shard->lock));
+        free(entry);
+        return;
+    }
+
+    pp = ep_valcache_bucket(shard, entry->hash);
+    entry->next = *pp;
+    *pp = entry;
+    shard->entry_num++;
+    shard->stats.stores++;
+
+    pthread_mutex_unlock(&(shard->lock));
+}
+
+/* Drops the values of the objects which names begin with the prefix
+   (the object and its sub-objects); called on write operations */
+void ep_valcache_invalidate(const char *obj_prefix)
+{
+    ep_valcache_shard_t *shard;
+    ep_valcache_entry_t **pp, *entry;
+    size_t len;
+    unsigned int i;
+    int s;
+
+    if (!ep_valcache_enabled() || !obj_prefix)
+        return;
+
+    len = strlen(obj_prefix);
+    __atomic_add_fetch(&g_vc_gen, 1, __ATOMIC_SEQ_CST);
+
+    for (s = 0; s < EP_VALCACHE_SHARDS; s++)
+    {
+        shard = &g_vc_shards[s];
+        pthread_mutex_lock(&(shard->lock));
+
+        for (i = 0; i < g_vc_bucket_num && shard->entry_num > 0; i++)
+        {
+            pp = &(shard->buckets[i]);
+            while ((entry = *pp) != NULL)
+            {
+                if (!strncmp(entry->obj_name, obj_prefix, len))
+                {
+                    *pp = entry->next;
+                    free(entry);
+                    shard->entry_num--;
+                    shard->stats.invalidated++;
+                }
+                else
+                    pp = &(entry->next);
+            }
+        }
+
+        pthread_mutex_unlock(&(shard->lock));
+    }
+}
+
+void ep_valcache_get_stats(ep_valcache_stats_t *stats)
+{
+    ep_valcache_shard_t *shard;
+    int s;
+
+    memset(stats, 0, sizeof(*stats));
+
+    if (!ep_valcache_enabled())
+        return;
+
+    for (s = 0; s < EP_VALCACHE_SHARDS; s++)
+    {
+        shard = &g_vc_shards[s];
+        pthread_mutex_lock(&(shard->lock));
+
+        stats->hits += shard->stats.hits;
+        stats->misses += shard->stats.misses;
+        stats->stores += shard->stats.stores;
+        stats->expired += shard->stats.expired;
+        stats->invalidated += shard->stats.invalidated;
+        stats->full += shard->stats.full;
+        stats->entries += shard->entry_num;
+
+        pthread_mutex_unlock(&(shard->lock));
+    }
+}
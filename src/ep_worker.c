@@ -74,6 +74,17 @@
 #include "ep_threadpool.h"
 #include "ep_common.h"
 #include "ep_db_utils.h"
+#include "ep_model.h"
+#include "ep_valcache.h"
+#include "ep_json.h"
+#include "ep_coproc.h"
+#include "ep_exec.h"
+#ifdef MMX_EP_WITH_LIBUCI
+#include "ep_uci.h"
+#endif
+#ifdef MMX_EP_WITH_LIBUBUS
+#include "ep_ubus.h"
+#endif
 
 #include "ep_worker.h"
 
@@ -102,6 +113,13 @@
     GetMethod, StyleOfSet, SetMethod, StyleOfGetAll, GetAllMethod, Configurable \
     FROM [MMX_Objects_InfoTbl] WHERE [ObjName] LIKE ?"
 
+/* Parameters of the object (the object info table name is substituted) */
+#define SQL_QUERY_GET_PARAM_INFO "SELECT \
+    ParamName, Writable, UserAccessPerm, ReadFrontEnds, WriteFrontEnds, \
+    ParamType, IsIndex, ValueIsList, MinValue, MaxValue, DefValue, \
+    MinLength, MaxLength, Hidden, NotSaveInDb, Units, EnumValues, \
+    StyleOfGet, StyleOfSet, GetMethod, SetMethod FROM [%s]"
+
 /*
  * --- SQL queries for getting Object info when processing DiscoverConfig ---
  *     6 columns are fetched (column position in query is fixed):
@@ -146,81 +164,132 @@ static ep_stat_t w_handle_discover_config(worker_data_t *wd,
 
 static ep_stat_t w_init_mmxdb_handles(worker_data_t *wd, int dbType, int msgType);
 
+static ep_stat_t w_destroy(worker_data_t *wd);
+
 /* -----------------------------------------------------------------------*
  * ------------------ Common helper functions ----------------------------*
  * -----------------------------------------------------------------------*/
-static ep_stat_t parse_param_name(char *rawstr, parsed_param_name_t *pn)
+/* atoi() over the token characters [s, end) */
+static int parse_token_num(const char *s, const char *end)
 {
-    path_token_type_t token_type = PATH_TOKEN_UNDEF;
-    char buf[MSG_MAX_STR_LEN];
-    BOOL with_placeholders = (strstr(rawstr, ".{i}.") != NULL) ? TRUE : FALSE;
+    int num = 0;
 
-    memset(pn, 0, sizeof(parsed_param_name_t));
-    memset(buf, 0, sizeof(buf));
+    while (s < end && isdigit((unsigned char)*s))
+        num = num * 10 + (*s++ - '0');
 
-    DBG(" raw name string: %s %s", rawstr,
-        (with_placeholders) ? "(placeholder name)" : "");
+    return num;
+}
 
-    /* Copy rawstr to buf so it does not get spoiled by strtok */
-    strcpy_safe(buf, rawstr, sizeof(buf));
-    if (with_placeholders)
-    {
-        strcpy_safe(pn->obj_name, rawstr, MSG_MAX_STR_LEN);
-    }
+static void parse_obj_name_append(parsed_param_name_t *pn, size_t *obj_len,
+                                  const char *s, size_t n)
+{
+    if (n > sizeof(pn->obj_name) - 1 - *obj_len)
+        n = sizeof(pn->obj_name) - 1 - *obj_len;
 
+    memcpy(pn->obj_name + *obj_len, s, n);
+    *obj_len += n;
+    pn->obj_name[*obj_len] = '\0';
+}
 
-    if (LAST_CHAR(buf) == '.')
-    {
-        pn->partial_path = TRUE;
-    }
+/* Parses the name in one pass over the raw string: the tokens are taken
+   in place (empty tokens are skipped), only the resulting object and leaf
+   names are written to pn. The name with ".{i}." placeholders is parsed
+   anew in the placeholder mode when its first placeholder is met */
+static ep_stat_t parse_param_name(const char *rawstr, parsed_param_name_t *pn)
+{
+    path_token_type_t token_type = PATH_TOKEN_UNDEF;
+    size_t len, obj_len = 0, tlen;
+    const char *end, *p = rawstr, *token, *s;
+    BOOL with_placeholders = FALSE, last, is_index;
 
-    char *token, *next_token, *strtok_ctx, *strtok_ctx2;
+    for (len = 0; len < MSG_MAX_STR_LEN - 1 && rawstr[len]; len++);
+    end = rawstr + len;
 
-    token = strtok_r(buf, ".", &strtok_ctx);
-    while (token)
+    pn->obj_name[0] = '\0';
+    pn->leaf_name[0] = '\0';
+    pn->partial_path = (len > 0 && rawstr[len - 1] == '.') ? TRUE : FALSE;
+    pn->index_num = 0;
+    pn->index_set_num = 0;
+    memset(pn->indices, 0, sizeof(pn->indices));
+
+    while (p < end)
     {
-        next_token = strtok_r(NULL, ".", &strtok_ctx);
+        if (*p == '.')
+        {
+            p++;
+            continue;
+        }
+
+        for (token = p; p < end && *p != '.'; p++);
+        tlen = p - token;
+        for (s = p; s < end && *s == '.'; s++);
+        last = (s == end) ? TRUE : FALSE;
+
+        is_index = with_placeholders ? (tlen == 3 && !memcmp(token, "{i}", 3)) :
+                   (isdigit((unsigned char)token[0]) || token[0] == '[' || token[0] == '*');
+        if (is_index && pn->index_num >= MAX_INDECES_PER_OBJECT)
+        {
+            DBG(" Too many indexes in parameter name: %s", rawstr);
+            return EPS_INVALID_ARGUMENT;
+        }
 
         if (!with_placeholders)
         {
-            if (isdigit(token[0]))
+            if (isdigit((unsigned char)token[0]))
             {
                 pn->indices[pn->index_num].type = REQ_IDX_TYPE_EXACT;
-                pn->indices[pn->index_num].exact_val.num = atoi(token);
+                pn->indices[pn->index_num].exact_val.num = parse_token_num(token, p);
                 pn->index_set_num++;
                 pn->index_num++;
-                strcat_safe(pn->obj_name, "{i}.", sizeof(pn->obj_name));
+                parse_obj_name_append(pn, &obj_len, "{i}.", 4);
                 token_type = PATH_TOKEN_INDEX;
             }
             else if (token[0] == '[')
             {
+                /* "[begin-end]": the bounds are the '-' separated fields */
+                for (s = token + 1; s < p && *s == '-'; s++);
                 pn->indices[pn->index_num].type = REQ_IDX_TYPE_RANGE;
-                pn->indices[pn->index_num].range_val.begin = atoi(strtok_r(token+1, "-", &strtok_ctx2));
-                pn->indices[pn->index_num].range_val.end = atoi(strtok_r(NULL, "-", &strtok_ctx2));
+                pn->indices[pn->index_num].range_val.begin = parse_token_num(s, p);
+                for (; s < p && *s != '-'; s++);
+                for (; s < p && *s == '-'; s++);
+                pn->indices[pn->index_num].range_val.end = parse_token_num(s, p);
                 pn->index_num++;
                 pn->index_set_num++;
-                strcat_safe(pn->obj_name, "{i}.", sizeof(pn->obj_name));
+                parse_obj_name_append(pn, &obj_len, "{i}.", 4);
                 token_type = PATH_TOKEN_INDEX;
             }
             else if (token[0] == '*')
             {
                 pn->indices[pn->index_num++].type = REQ_IDX_TYPE_ALL;
-                strcat_safe(pn->obj_name, "{i}.", sizeof(pn->obj_name));
+                parse_obj_name_append(pn, &obj_len, "{i}.", 4);
                 token_type = PATH_TOKEN_INDEX;
             }
-            else if (isalpha(token[0]))
+            else if (isalpha((unsigned char)token[0]))
             {
-                if (!next_token && !pn->partial_path)
+                if (last && !pn->partial_path)
                 {
-                    strncpy(pn->leaf_name, token, sizeof(pn->leaf_name)-1);
+                    memcpy(pn->leaf_name, token, tlen);
+                    pn->leaf_name[tlen] = '\0';
                     token_type = PATH_TOKEN_PARAMNAME;
                     break;
                 }
 
-                strcat_safe(pn->obj_name, token, sizeof(pn->obj_name));
-                strcat_safe(pn->obj_name, ".", sizeof(pn->obj_name));
+                parse_obj_name_append(pn, &obj_len, token, tlen);
+                parse_obj_name_append(pn, &obj_len, ".", 1);
                 token_type = PATH_TOKEN_NODE;
             }
+            else if (token[0] == '{' && strstr(token > rawstr ? token - 1 : token, ".{i}."))
+            {
+                /* The name is given with placeholders: start it anew */
+                with_placeholders = TRUE;
+                memcpy(pn->obj_name, rawstr, len);
+                pn->obj_name[len] = '\0';
+                pn->index_num = 0;
+                pn->index_set_num = 0;
+                memset(pn->indices, 0, sizeof(pn->indices));
+                token_type = PATH_TOKEN_UNDEF;
+                p = rawstr;
+            }
             else
             {
                 DBG(" Incorrect parameter name: %s", rawstr);
@@ -229,17 +298,18 @@ static ep_stat_t parse_param_name(char *rawstr, parsed_param_name_t *pn)
         }
         else /* with_placeholders = TRUE */
         {
-            if (!strcmp(token, "{i}"))
+            if (is_index)
             {
                 pn->indices[pn->index_num].type = REQ_IDX_TYPE_PLACEHOLDER;
                 pn->index_num++;
                 token_type = PATH_TOKEN_PLACEHOLDER;
             }
-            else if (isalpha(token[0]))
+            else if (isalpha((unsigned char)token[0]))
             {
-                if (!next_token && !pn->partial_path)
+                if (last && !pn->partial_path)
                 {
-                    strncpy(pn->leaf_name, token, sizeof(pn->leaf_name)-1);
+                    memcpy(pn->leaf_name, token, tlen);
+                    pn->leaf_name[tlen] = '\0';
                     token_type = PATH_TOKEN_PARAMNAME;
                     break;
                 }
@@ -251,14 +321,129 @@ static ep_stat_t parse_param_name(char *rawstr, parsed_param_name_t *pn)
                 return EPS_INVALID_ARGUMENT;
             }
         }
-
-        token = next_token;
     }
 
+    DBG(" raw name string: %s %s", rawstr,
+        (with_placeholders) ? "(placeholder name)" : "");
+
     pn->last_token_type = token_type;
     return EPS_OK;
 }
 
+/* Recently parsed name of the worker (see w_parse_param_name) */
+typedef struct w_pname_entry_s {
+    unsigned int hash;
+    unsigned int miss_hash;       /* hash of the last name missed in the entry */
+    char raw[MSG_MAX_STR_LEN];    /* empty - free entry */
+    parsed_param_name_t pn;
+} w_pname_entry_t;
+
+static void w_pname_copy(parsed_param_name_t *dst, const parsed_param_name_t *src)
+{
+    strcpy(dst->obj_name, src->obj_name);
+    strcpy(dst->leaf_name, src->leaf_name);
+    dst->partial_path = src->partial_path;
+    dst->last_token_type = src->last_token_type;
+    dst->index_num = src->index_num;
+    dst->index_set_num = src->index_set_num;
+    memcpy(dst->indices, src->indices, sizeof(dst->indices));
+}
+
+/* parse_param_name over the worker's cache of recently parsed names: the
+   front-ends poll the same names, so the parsed name is mostly copied from
+   the cache entry (the cache is allocated on the first use). A name is
+   stored when it misses the entry the second time in a row, so the requests
+   of more distinct names than the cache holds do not copy each of them */
+static ep_stat_t w_parse_param_name(worker_data_t *wd, const char *rawstr,
+                                    parsed_param_name_t *pn)
+{
+    w_pname_entry_t *e;
+    unsigned int h;
+    size_t len;
+    ep_stat_t status;
+
+    if (!wd->pname_cache &&
+        !(wd->pname_cache = calloc(EP_PARAM_NAME_CACHE_SIZE, sizeof(w_pname_entry_t))))
+        return parse_param_name(rawstr, pn);
+
+    h = ep_hash_str(EP_HASH_INIT, rawstr);
+    e = &wd->pname_cache[h % EP_PARAM_NAME_CACHE_SIZE];
+    if (e->hash == h && e->raw[0] && !strcmp(e->raw, rawstr))
+    {
+        wd->pname_hits++;
+        w_pname_copy(pn, &e->pn);
+        return EPS_OK;
+    }
+
+    wd->pname_misses++;
+    if ((status = parse_param_name(rawstr, pn)) != EPS_OK)
+        return status;
+
+    if (e->miss_hash != h)
+    {
+        e->miss_hash = h;
+        return EPS_OK;
+    }
+
+    len = strlen(rawstr);
+    if (len > 0 && len < MSG_MAX_STR_LEN)
+    {
+        e->hash = h;
+        memcpy(e->raw, rawstr, len + 1);
+        w_pname_copy(&e->pn, pn);
+    }
+
+    return EPS_OK;
+}
+
+/* The requests of more names than the cache holds are parsed without it:
+   the names would only evict each other */
+#define W_PNAME_CACHE_USE(names_num)  ((names_num) <= EP_PARAM_NAME_CACHE_SIZE)
+
+static void w_pname_cache_free(worker_data_t *wd)
+{
+    if (wd->pname_cache)
+    {
+        DBG("Parsed names cache: hits %lu, misses %lu", wd->pname_hits, wd->pname_misses);
+        free(wd->pname_cache);
+        wd->pname_cache = NULL;
+    }
+}
+
+/* Worker arena: the arrays too big for the worker stack are taken from it.
+   Memory is released back to a mark taken before the allocations (in the
+   reverse order), the arena is emptied at the start of each task anyway.
+   The memory is not zeroed */
+static void *w_arena_alloc(worker_data_t *wd, size_t size)
+{
+    void *ptr;
+
+    size = (size + 15) & ~(size_t)15;
+    if (size > wd->arena_size - wd->arena_top)
+    {
+        ERROR("Worker arena is exhausted: %lu bytes needed, %lu of %lu are used",
+              (unsigned long)size, (unsigned long)wd->arena_top, (unsigned long)wd->arena_size);
+        return NULL;
+    }
+
+    ptr = wd->arena + wd->arena_top;
+    wd->arena_top += size;
+    if (wd->arena_top > wd->arena_peak)
+        wd->arena_peak = wd->arena_top;
+
+    return ptr;
+}
+
+static inline size_t w_arena_mark(worker_data_t *wd)
+{
+    return wd->arena_top;
+}
+
+static inline void w_arena_release(worker_data_t *wd, size_t mark)
+{
+    wd->arena_top = mark;
+}
+
 /*  If the name does not contain the "." it is leaf name,
     othewise there is full name including object name
     For example,  Device.Bridging.Bridge.2.Name is not leaf name
@@ -672,6 +857,137 @@ static ep_stat_t w_get_prev_multi_obj_name(const char *obj_name, char* prevobj_n
     return EPS_OK;
 }
 
+/* Statement cache for the connection: only statements of the worker's own
+   connections are cached (they are flushed before the connections close) */
+static ep_db_stmt_cache_t *w_stmt_cache(worker_data_t *wd, sqlite3 *conn)
+{
+    return (conn && (conn == wd->main_conn || conn == wd->mdb_conn)) ?
+           &wd->stmt_cache : NULL;
+}
+
+/* Binds index values of the request to the statement parameters starting
+   from "first": one parameter per exact index and two per index range,
+   in the order the queries place "?" for them */
+static ep_stat_t w_bind_index_values(sqlite3_stmt *stmt, int first,
+                                     parsed_param_name_t *pn, int idx_num)
+{
+    int i, res = SQLITE_OK;
+
+    for (i = 0; i < idx_num && res == SQLITE_OK; i++)
+    {
+        if (pn->indices[i].type == REQ_IDX_TYPE_EXACT)
+            res = sqlite3_bind_int(stmt, first++, pn->indices[i].exact_val.num);
+        else if (pn->indices[i].type == REQ_IDX_TYPE_RANGE)
+        {
+            if ((res = sqlite3_bind_int(stmt, first++, pn->indices[i].range_val.begin)) == SQLITE_OK)
+                res = sqlite3_bind_int(stmt, first++, pn->indices[i].range_val.end);
+        }
+    }
+
+    return (res == SQLITE_OK) ? EPS_OK : EPS_SQL_ERROR;
+}
+
+/* Takes the statement of the query from the worker's statement cache and
+   binds index values of the request to it (see w_bind_index_values) */
+static ep_stat_t w_prepare_idx_stmt(worker_data_t *wd, sqlite3 *conn, const char *query,
+                                    parsed_param_name_t *pn, int idx_num,
+                                    sqlite3_stmt **stmt)
+{
+    if (ep_db_stmt_prepare(w_stmt_cache(wd, conn), conn, query, stmt) != EPS_OK)
+        return EPS_SQL_ERROR;
+
+    if (w_bind_index_values(*stmt, 1, pn, idx_num) != EPS_OK)
+    {
+        ep_db_stmt_release(&wd->stmt_cache, *stmt);
+        *stmt = NULL;
+        return EPS_SQL_ERROR;
+    }
+
+    return EPS_OK;
+}
+
+/* Checks whether the subsidiary object is a child (and not augment) object
+   of the object with obj_idx_num indices */
+static BOOL w_obj_is_child(const char *obj_name, int obj_idx_num)
+{
+    int i, child_idx_num;
+    const char *p_ph, *p_curr_offset;
+
+    if ((child_idx_num = w_num_of_obj_indeces(obj_name)) == obj_idx_num)
+    {
+        /*DBG("Obj %s isn't a child: it has the same num of indices (%d)",
+                  obj_name, child_idx_num); */
+        return FALSE;
+    }
+
+    /* Determine the child obj "suffix", i.e. symbols after the last "."
+       (jumping over object placeholders '{i}') */
+    p_curr_offset = obj_name;
+    for (i = 1; i <= child_idx_num; i++)
+    {
+        if ((p_ph = strstr(p_curr_offset,  "."INDEX_PLACEHOLDER".")) == NULL)
+            return FALSE;
+        p_curr_offset = p_ph + strlen( "."INDEX_PLACEHOLDER".");
+    }
+
+    /* Test "suffix" len: for child object must be 0 */
+    if (strlen(p_curr_offset) != 0)
+    {
+        //DBG("Obj %s is not a child: suffix is %s", obj_name, p_curr_offset);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* w_get_obj_info over the management model cache: the same objects in the
+   same order as selected from the meta DB */
+static ep_stat_t w_model_get_obj_info(const ep_model_t *model, parsed_param_name_t *pn,
+                                      char nextLevelOnly, char childsOnly,
+                                      obj_info_t *obj_info, int obj_info_size, int *obj_num)
+{
+    const ep_model_obj_t *obj;
+    ep_model_iter_t it;
+    int i, cnt = 0, obj_idx_num = w_num_of_obj_indeces(pn->obj_name);
+
+    *obj_num = 0;
+
+    if (pn->partial_path && nextLevelOnly == 0)
+    {
+        /* Subtree of the object in the name trie */
+        ep_model_iter_init(&it, model, pn->obj_name);
+        while (cnt < obj_info_size && (i = ep_model_iter_next(&it)) >= 0)
+        {
+            obj = &model->objs[i];
+
+            /* The first one is the specified object itself; check if
+               only child subsidiary objects are requested (see
+               w_obj_is_child) */
+            if (cnt > 0 && childsOnly == 1 &&
+                (obj->ph_num == obj_idx_num || !obj->is_multi))
+                continue;
+
+            obj_info[cnt++] = obj->info;
+        }
+
+        /* The name is left the same as after the meta DB query */
+        strcat_safe(pn->obj_name, "%", sizeof(pn->obj_name));
+    }
+    else if ((obj = ep_model_find_obj(model, pn->obj_name)) != NULL && obj_info_size > 0)
+    {
+        obj_info[cnt++] = obj->info;
+    }
+
+    if (cnt == 0)
+    {
+        ERROR("Unknown object name %s", pn->obj_name);
+        return EPS_INVALID_PARAM_NAME;
+    }
+
+    *obj_num = cnt;
+    return EPS_OK;
+}
+
 /* Get information about objects matched by requested parameter name */
 /*
  *  pn - parsed parameter name
@@ -694,15 +1010,18 @@ static ep_stat_t w_get_obj_info(worker_data_t *wd, parsed_param_name_t *pn,
                                 char nextLevelOnly, char childsOnly,
                                 obj_info_t *obj_info, int obj_info_size, int *obj_num)
 {
-    int i = 0, cnt = 0, res = 0;
-    int obj_idx_num = 0, child_idx_num = 0;
-    char *p_ph, *p_curr_offset;
+    int cnt = 0, res = 0;
+    int obj_idx_num = 0;
     char tmp_obj_name[MSG_MAX_STR_LEN];
 
     /*DBG("%s[%s] (partial path %d, nextLevel %d, childsOnly %d)",
          pn->obj_name, pn->leaf_name,
          pn->partial_path, nextLevelOnly, childsOnly);*/
 
+    if (wd->model)
+        return w_model_get_obj_info(wd->model, pn, nextLevelOnly, childsOnly,
+                                    obj_info, obj_info_size, obj_num);
+
     *obj_num = 0;
     obj_idx_num = w_num_of_obj_indeces(pn->obj_name);
 
@@ -744,28 +1063,8 @@ static ep_stat_t w_get_obj_info(worker_data_t *wd, parsed_param_name_t *pn,
                     memset(tmp_obj_name, 0, sizeof(tmp_obj_name));
                     strcpy_safe(tmp_obj_name, (char *)sqlite3_column_text(stmt, 0),
                                                               sizeof(tmp_obj_name));
-                    if ((child_idx_num = w_num_of_obj_indeces(tmp_obj_name)) == obj_idx_num)
-                    {
-                        /*DBG("Obj %s isn't a child: it has the same num of indices (%d)",
-                                  tmp_obj_name, child_idx_num); */
-                        continue;
-                    }
-
-                    /* Determine the child obj "suffix", i.e. symbols after the last "."
-                       (jumping over object placeholders '{i}') */
-                    p_curr_offset = (char *)tmp_obj_name;
-                    for (i = 1; i <= child_idx_num; i++)
-                    {
-                        p_ph = strstr(p_curr_offset,  "."INDEX_PLACEHOLDER".");
-                        p_curr_offset = p_ph + strlen( "."INDEX_PLACEHOLDER".");
-                    }
-
-                    /* Test "suffix" len: for child object must be 0 */
-                    if (strlen(p_curr_offset) != 0)
-                    {
-                        //DBG("Obj %s is not a child: suffix is %s", tmp_obj_name, p_curr_offset);
+                    if (!w_obj_is_child(tmp_obj_name, obj_idx_num))
                         continue;
-                    }
                 }
             }
 
@@ -805,12 +1104,23 @@ static ep_stat_t w_get_obj_info(worker_data_t *wd, parsed_param_name_t *pn,
     return EPS_OK;
 }
 
+/* Raises the high-water mark of the worker buffer (see w_task_init) */
+static inline void w_buf_used(size_t *used, size_t size)
+{
+    if (size > *used)
+        *used = size;
+}
+
 ep_stat_t w_send_answer(worker_data_t *wd, ep_message_t *message)
 {
     ep_stat_t status = EPS_OK;
     int res;
+    size_t len;
     struct sockaddr_in client_addr;
 
+    if (message->mem_pool.pool == wd->fe_resp_values_pool)
+        w_buf_used(&wd->fe_resp_used, message->mem_pool.curr_offset);
+
     /* check is response has to be sent or not */
     if (message->header.respMode == MMX_API_RESPMODE_NORESP)
     {
@@ -828,15 +1138,19 @@ ep_stat_t w_send_answer(worker_data_t *wd, ep_message_t *message)
     if (status != EPS_OK)
     {
         ERROR("Could not write XML response (%d)", status);
+        w_buf_used(&wd->answer_used, sizeof(wd->answer_buf));
     }
     else
     {
+        len = strlen(wd->answer_buf);
+        w_buf_used(&wd->answer_used, len + 1);
         DBG("Txa Id: %d, resp code: %d, caller Id: %d, moreFlag: %d, resp len: %d bytes",
             message->header.txaId, message->header.respCode,
-            message->header.callerId, message->header.moreFlag, strlen(wd->answer_buf));
+            message->header.callerId, message->header.moreFlag, (int)len);
         //DBG("%s", wd->answer_buf);
 
-        res = sendto(wd->udp_sock, wd->answer_buf, sizeof(wd->answer_buf)+1, 0,
+        /* Only the XML string (with its terminating zero) is sent */
+        res = sendto(wd->udp_sock, wd->answer_buf, len + 1, 0,
                           (struct sockaddr *)&client_addr, sizeof(client_addr));
         if (res < 0)
         {
@@ -852,6 +1166,58 @@ ep_stat_t w_send_answer(worker_data_t *wd, ep_message_t *message)
     return status;
 }
 
+/* w_get_param_info over the management model cache */
+static ep_stat_t w_model_get_param_info(const ep_model_obj_t *obj, parsed_param_name_t *pn,
+                                        char configOnly, param_info_t param_info[],
+                                        int *param_num, int *param_idx)
+{
+    const param_info_t *param;
+    BOOL full_name = (!pn->partial_path && (strlen(pn->leaf_name) > 0));
+    int i, found = -1, paramCnt = 0;
+
+    for (i = 0; i < obj->param_num; i++)
+    {
+        param = &obj->params[i];
+
+        /* Full-path name: the requested parameter and index parameters */
+        if (full_name && !param->isIndex && strcmp(pn->leaf_name, param->paramName))
+            continue;
+
+        /* If only configuration parameters are needed,
+           skip read-only parameters (indexes are always needed) */
+        if (configOnly && ((!param->writable && !param->isIndex) || param->notSaveInDb))
+            continue;
+
+        if (paramCnt >= MAX_PARAMS_PER_OBJECT)
+        {
+            ERROR("Number parameters of object biggest than defined in MAX_PARAMS_PER_OBJECT=(%d)",
+                  MAX_PARAMS_PER_OBJECT);
+            return EPS_GENERAL_ERROR;
+        }
+
+        if (found < 0 && full_name && !strcmp(pn->leaf_name, param->paramName))
+            found = paramCnt;
+
+        param_info[paramCnt++] = *param;
+    }
+    *param_num = paramCnt;
+
+    /* Check if the requested param name was found - for full-path name only*/
+    if (full_name)
+    {
+        if (param_idx)
+            *param_idx = found;
+
+        if (found < 0)
+        {
+            ERROR("Unknown param name: %s", pn->leaf_name);
+            return EPS_INVALID_PARAM_NAME;
+        }
+    }
+
+    return EPS_OK;
+}
+
 /* Select meta information of parameters of the specified object.
    In case of requested parameter is specified by a partial path, meta info of
    all object's parameters are selected. Otherwise (i.e. parameter is specified
@@ -867,16 +1233,16 @@ ep_stat_t w_get_param_info(worker_data_t *wd, parsed_param_name_t *pn,
     int res, i, found, paramCnt = 0;
     char query[EP_SQL_REQUEST_BUF_SIZE];
     sqlite3_stmt *stmt = NULL;
+    const ep_model_obj_t *obj;
 
     if (param_idx) *param_idx = -1;
     *param_num = 0;
 
-    sprintf(query, "SELECT "
-            "ParamName, Writable, UserAccessPerm, ReadFrontEnds, WriteFrontEnds, "
-            "ParamType, IsIndex, ValueIsList, MinValue, MaxValue, DefValue, "
-            "MinLength, MaxLength, Hidden, NotSaveInDb, Units, EnumValues, "
-            "StyleOfGet, StyleOfSet, GetMethod, SetMethod FROM [%s]",
-            obj_info->objInfoTblName);
+    if (wd->model && (obj = ep_model_find_obj(wd->model, obj_info->objName)) != NULL &&
+        obj->params_valid)
+        return w_model_get_param_info(obj, pn, configOnly, param_info, param_num, param_idx);
+
+    sprintf(query, SQL_QUERY_GET_PARAM_INFO, obj_info->objInfoTblName);
 
     if (!pn->partial_path && (strlen(pn->leaf_name) > 0))
     {
@@ -942,6 +1308,90 @@ ret:
     return status;
 }
 
+/* Loads the management model from the meta DB of the current connection:
+   all objects in the meta DB order and all parameters of each object.
+   Object which parameters cannot be selected is kept in the model, its
+   parameters are selected from the meta DB by requests */
+static ep_stat_t w_model_load(void *ctx, ep_model_t *model)
+{
+    worker_data_t *wd = (worker_data_t *)ctx;
+    ep_stat_t status = EPS_OK;
+    sqlite3_stmt *stmt = wd->stmt_get_obj_list, *param_stmt = NULL;
+    char query[EP_SQL_REQUEST_BUF_SIZE];
+    obj_info_t obj_info;
+    param_info_t param_info;
+    int res, obj_pos;
+
+    /* All objects; selected the same way as by prefix in w_get_obj_info */
+    if (sqlite3_bind_text(stmt, 1, "%", -1, SQLITE_STATIC) != SQLITE_OK)
+        GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not bind object name to the prepared statement: %s",
+                            sqlite3_errmsg(wd->mdb_conn));
+
+    while ((res = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        fill_obj_info(stmt, &obj_info);
+
+        if ((status = ep_model_obj_add(model, &obj_info, &obj_pos)) != EPS_OK)
+            GOTO_RET_WITH_ERROR(status, "Could not add object %s to the model", obj_info.objName);
+
+        sprintf(query, SQL_QUERY_GET_PARAM_INFO, obj_info.objInfoTblName);
+
+        if (sqlite3_prepare_v2(wd->mdb_conn, query, -1, &param_stmt, NULL) != SQLITE_OK)
+        {
+            WARN("Could not select parameters of %s: %s", obj_info.objName,
+                  sqlite3_errmsg(wd->mdb_conn));
+            model->objs[obj_pos].params_valid = FALSE;
+            continue;
+        }
+
+        while ((res = sqlite3_step(param_stmt)) == SQLITE_ROW)
+        {
+            fill_param_info(param_stmt, &param_info, 0);
+
+            if ((status = ep_model_param_add(model, obj_pos, &param_info)) != EPS_OK)
+                GOTO_RET_WITH_ERROR(status, "Could not add parameter %s.%s to the model",
+                                    obj_info.objName, param_info.paramName);
+        }
+
+        if (res != SQLITE_DONE)
+            GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not execute query (%d): %s",
+                                res, sqlite3_errmsg(wd->mdb_conn));
+
+        sqlite3_finalize(param_stmt);
+        param_stmt = NULL;
+    }
+
+    if (res != SQLITE_DONE)
+        GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not execute query (%d): %s",
+                            res, sqlite3_errmsg(wd->mdb_conn));
+
+ret:
+    if (param_stmt) sqlite3_finalize(param_stmt);
+    sqlite3_reset(stmt);
+    return status;
+}
+
+/* Takes the management model of the current DB type. The model is taken
+   again only if it was invalidated since the last request */
+static void w_model_refresh(worker_data_t *wd)
+{
+    int gen = ep_model_generation(wd->mmxDbType);
+
+    if (wd->model_gen == gen)
+        return;
+
+    ep_model_release(wd->model);
+    wd->model = ep_model_acquire(wd->mmxDbType, w_model_load, wd);
+    wd->model_gen = gen;
+}
+
+static void w_model_put(worker_data_t *wd)
+{
+    ep_model_release(wd->model);
+    wd->model = NULL;
+    wd->model_gen = -1;
+}
+
 /* Convert MMX EP error codes to the standard TR-069 fault codes
  * (TR-069 Issue 1 Amendment 4) */
 static int w_status2cwmp_error(ep_stat_t status)
@@ -975,38 +1425,63 @@ static char * w_perform_prepared_command(char *buf, int buf_size,
                                          BOOL read_results,
                                          int *res_code)
 {
-    char *p_res = NULL;
-    FILE *fp;
+    ep_stat_t status;
+    char *cmd;
+    int rc;
+
+    /* Commands which results are read are served by the script helper
+       (if configured); the first line of its output is returned, as by the
+       EP. The helper has the timeout of the commands run by the EP. The
+       command is run by the EP only if it was not delivered to the helper:
+       otherwise it may have been run already (set and add scripts must
+       not be run twice) */
+    if (read_results && ep_coproc_enabled() && (cmd = strdup(buf)) != NULL)
+    {
+        status = ep_coproc_run(cmd, EP_EXEC_FIRST_LINE, buf, buf_size, &rc);
+        if (status == EPS_OK)
+        {
+            free(cmd);
+            if (res_code)
+                *res_code = rc;
+            return (strlen(buf) > 0) ? buf : NULL;
+        }
+        if (status == EPS_TIMEOUT)
+        {
+            DBG("Script helper did not complete %s in the timeout", cmd);
+            free(cmd);
+            return NULL;
+        }
+        if (status != EPS_NOTHING_DONE)
+        {
+            ERROR("Script helper failed to run %s (status %d)", cmd, status);
+            free(cmd);
+            return NULL;
+        }
+        WARN("Command was not delivered to script helper, it is run by EP");
 
-    /* Perform command that was preperated in buf and
-       read results if it is requested */
-    fp = popen(buf, "r");
-    if (!fp)
-    {
-        DBG("Could not execute prepared command");
-        return NULL;
+        /* A part of the output may be read to buf before the failure */
+        strcpy_safe(buf, cmd, buf_size);
+        free(cmd);
     }
 
+    /* Perform command that was preperated in buf and
+       read the first line of results if it is requested */
     if (read_results)
-    {
-        memset(buf, 0, buf_size);
-        p_res = fgets(buf, buf_size, fp);
-    }
-
-    if (!res_code)
-    {
-        /* Command's exit status is out of interest */
-        pclose(fp);
-    }
+        status = ep_exec_read(buf, EP_EXEC_FIRST_LINE, buf, buf_size, &rc);
     else
+        status = ep_exec_run(buf, NULL, 0, EP_EXEC_NO_OUTPUT, 0, NULL, NULL, &rc);
+
+    if (status != EPS_OK)
     {
-        /* Command's exit status is needed for the caller.
-           Here we expect the command (child process) terminated normally
-           and returned its status. See more in waitpid() POSIX Specification */
-        *res_code = WEXITSTATUS(pclose(fp));
+        DBG("Could not execute prepared command (status %d)", status);
+        return NULL;
     }
 
-    if (read_results && !p_res)
+    /* Command's exit status is needed for the caller */
+    if (res_code)
+        *res_code = rc;
+
+    if (read_results && strlen(buf) == 0)
     {
         DBG("Could not read command results");
         return NULL;
@@ -1355,6 +1830,9 @@ static ep_stat_t w_save_configuration(worker_data_t *wd, ep_message_t *answer)
     DBG("Save configuration command: %s", buf);
     w_perform_prepared_command((char *)buf, sizeof(buf), FALSE, NULL);
 
+    /* The startup (saved) DB files are replaced */
+    ep_model_invalidate(MMXDBTYPE_STARTUP);
+
     /* Send response to the requestor */
     if (answer)
     {
@@ -1388,6 +1866,9 @@ static ep_stat_t w_save_config_to_candidate(worker_data_t *wd, ep_message_t *ans
     DBG("Copy configuration command: %s", buf);
     w_perform_prepared_command((char *)buf, sizeof(buf), FALSE, NULL);
 
+    /* The candidate DB files are replaced */
+    ep_model_invalidate(MMXDBTYPE_CANDIDATE);
+
     /* Send response to the requestor */
     if (answer)
     {
@@ -1419,6 +1900,8 @@ static ep_stat_t w_remove_candidate_config(worker_data_t *wd, ep_message_t *answ
     DBG("Remove cand DB command: %s", buf);
     w_perform_prepared_command((char *)buf, sizeof(buf), FALSE, NULL);
 
+    ep_model_invalidate(MMXDBTYPE_CANDIDATE);
+
     /* Send response to the requestor */
     if (answer)
     {
@@ -1547,31 +2030,77 @@ static ep_stat_t w_place_indeces_to_objname(const char *obj_name,
     return EPS_OK;
 }
 
-/* Function prepares response message for GetParamValue request.
- * It inserts full-path name and value of the specified parameter to the
- * response buffer. If buffer is already full, the procedure sends already
- * prepared response, and then inserts the needed parameter to the next
- * portion response.
+#define W_NVBUF_INIT_SIZE   1024
+
+/* Appends name-value pair to the buffer of values collected by a subtask.
+ * Pairs are kept as "name\0<flag>value\0", flag tells whether value is NULL
  *   */
-static ep_stat_t w_insert_value_to_answer(worker_data_t *wd, ep_message_t *answer,
-                                          char *obj_name, int *idx_values, int idx_params_num,
-                                          char *paramName, char *paramValue)
+static ep_stat_t w_nvbuf_add(w_nvbuf_t *nvb, const char *name, const char *value)
 {
-#define   EP_FE_XML_HEADER_SIZE   (400)   /* All header tags                 */
-#define   EP_XML_NVP_OVERHEAD     (60)    /* name, value, nameValuePair tags */
-    int res;
+    size_t name_len = strlen(name) + 1;
+    size_t val_len = value ? strlen(value) + 1 : 0;
+    size_t need = name_len + 1 + val_len;
+    size_t new_size;
+    char *new_buf;
+
+    if (nvb->len + need > nvb->size)
+    {
+        new_size = nvb->size ? nvb->size * 2 : W_NVBUF_INIT_SIZE;
+        while (new_size < nvb->len + need)
+            new_size *= 2;
+
+        if ((new_buf = realloc(nvb->buf, new_size)) == NULL)
+        {
+            ERROR("Could not allocate memory for values of param %s", name);
+            return EPS_OUTOFMEMORY;
+        }
+
+        nvb->buf = new_buf;
+        nvb->size = new_size;
+    }
+
+    memcpy(nvb->buf + nvb->len, name, name_len);
+    nvb->len += name_len;
+
+    nvb->buf[nvb->len++] = value ? 1 : 0;
+    if (value)
+    {
+        memcpy(nvb->buf + nvb->len, value, val_len);
+        nvb->len += val_len;
+    }
+
+    nvb->num++;
+
+    return EPS_OK;
+}
+
+static void w_nvbuf_free(w_nvbuf_t *nvb)
+{
+    free(nvb->buf);
+    memset(nvb, 0, sizeof(w_nvbuf_t));
+}
+
+/* Function inserts full-path name and value of the parameter to the
+ * response message for GetParamValue request. If buffer is already full,
+ * the procedure sends already prepared response, and then inserts the
+ * needed parameter to the next portion response.
+ * The XML size of a response portion is limited by EP_ANSWER_PORTION_LEN.
+ *   */
+static ep_stat_t w_insert_nvpair_to_answer(worker_data_t *wd, ep_message_t *answer,
+                                           char *full_param_name, char *paramValue)
+{
+#define   EP_FE_XML_HEADER_SIZE   (400)   /* All header tags                 */
+#define   EP_XML_NVP_OVERHEAD     (60)    /* name, value, nameValuePair tags */
+    int res;
     int arrsize;
     int val_len;
     nvpair_t *p_res_param;
-    char full_param_name[NVP_MAX_NAME_LEN];
-
-    memset ((char *)full_param_name, 0, sizeof(full_param_name));
 
     /* Check the number of name-value pairs in the response */
     if (answer->body.getParamValueResponse.arraySize >= MAX_NUMBER_OF_RESPONSE_VALUES - 1)
     {
         DBG("Response portion is prepared (%d elems) - too many params; param %s will be sent next time",
-             answer->body.getParamValueResponse.arraySize, paramName);
+             answer->body.getParamValueResponse.arraySize, full_param_name);
         answer->header.moreFlag = 1;
         w_send_answer(wd, answer);
     }
@@ -1579,20 +2108,15 @@ static ep_stat_t w_insert_value_to_answer(worker_data_t *wd, ep_message_t *answe
     arrsize = answer->body.getParamValueResponse.arraySize;
     p_res_param = &(answer->body.getParamValueResponse.paramValues[arrsize]);
 
-    /* Fill parameter name (with all indeces) */
-    w_place_indeces_to_objname(obj_name, (int *)idx_values, idx_params_num,
-                               (char *)full_param_name);
-    strcat_safe((char *)full_param_name, paramName, NVP_MAX_NAME_LEN);
-
     val_len = paramValue ? strlen(paramValue) : 0;
 
     /*Check if there is enough space in the answer XML buffer */
     if ((answer->body.getParamValueResponse.totalNVSize + EP_FE_XML_HEADER_SIZE +
          EP_XML_NVP_OVERHEAD * (arrsize + 1) +
-         strlen(full_param_name) + val_len) >= MAX_MMX_EP_ANSWER_LEN)
+         strlen(full_param_name) + val_len) >= EP_ANSWER_PORTION_LEN)
     {
         DBG("Resp portion is prepared (%d elems) - no memory in XML buffer; param %s will be sent next time",
-             answer->body.getParamValueResponse.arraySize, paramName);
+             answer->body.getParamValueResponse.arraySize, full_param_name);
         answer->header.moreFlag = 1;
         w_send_answer(wd, answer);
 
@@ -1605,12 +2129,12 @@ static ep_stat_t w_insert_value_to_answer(worker_data_t *wd, ep_message_t *answe
 
     /* Fill parameter value in the answer array */
     res = mmx_frontapi_msgstruct_insert_nvpair(answer, p_res_param,
-                                        (char *)full_param_name, paramValue);
+                                        full_param_name, paramValue);
     if (res != FA_OK)
     {
         /* There is not enough space in the pool */
         DBG("Resp portion is prepared (%d elems) - no memory in value pool; param %s will be sent next time",
-             answer->body.getParamValueResponse.arraySize, paramName);
+             answer->body.getParamValueResponse.arraySize, full_param_name);
         answer->header.moreFlag = 1;
         w_send_answer(wd, answer);
 
@@ -1623,10 +2147,10 @@ static ep_stat_t w_insert_value_to_answer(worker_data_t *wd, ep_message_t *answe
         p_res_param = &(answer->body.getParamValueResponse.paramValues[arrsize]);
 
         res = mmx_frontapi_msgstruct_insert_nvpair(answer, p_res_param,
-                                        (char *)full_param_name, paramValue);
+                                        full_param_name, paramValue);
         if (res != FA_OK)
         {
-            ERROR("Param %s is too long; cannot be placed to answer msg", paramName);
+            ERROR("Param %s is too long; cannot be placed to answer msg", full_param_name);
             return EPS_IGNORED;
         }
     }
@@ -1641,6 +2165,31 @@ static ep_stat_t w_insert_value_to_answer(worker_data_t *wd, ep_message_t *answe
     return EPS_OK;
 }
 
+/* Function prepares response message for GetParamValue request.
+ * It builds full-path name of the specified parameter and inserts it with
+ * the value to the response buffer. If the worker performs a subtask of
+ * a multi-object request, the pair is collected for the request owner
+ * instead.
+ *   */
+static ep_stat_t w_insert_value_to_answer(worker_data_t *wd, ep_message_t *answer,
+                                          char *obj_name, int *idx_values, int idx_params_num,
+                                          char *paramName, char *paramValue)
+{
+    char full_param_name[NVP_MAX_NAME_LEN];
+
+    memset ((char *)full_param_name, 0, sizeof(full_param_name));
+
+    /* Fill parameter name (with all indeces) */
+    w_place_indeces_to_objname(obj_name, (int *)idx_values, idx_params_num,
+                               (char *)full_param_name);
+    strcat_safe((char *)full_param_name, paramName, NVP_MAX_NAME_LEN);
+
+    if (wd->collect)
+        return w_nvbuf_add(wd->collect, full_param_name, paramValue);
+
+    return w_insert_nvpair_to_answer(wd, answer, full_param_name, paramValue);
+}
+
 /* Param_info array contains information about configuration parameters
    of the specified object (index parameters are also included to the array) */
 static ep_stat_t w_get_values_configonly(worker_data_t *wd, ep_message_t *answer,
@@ -1833,33 +2382,26 @@ static ep_stat_t w_get_values_db(worker_data_t *wd, ep_message_t *answer,
     {
         if (pn->indices[i].type == REQ_IDX_TYPE_EXACT)
         {
-            /* concatenate PARAM=ARG */
+            /* concatenate PARAM=?, the value is bound */
             strcat_safe(query, "[", sizeof(query));
             strcat_safe(query, param_info[i].paramName, sizeof(query));
-            strcat_safe(query, "]=", sizeof(query));
-            sprintf(query+strlen(query), "%d", pn->indices[i].exact_val.num);
-            strcat_safe(query, " AND ", sizeof(query));
+            strcat_safe(query, "]=? AND ", sizeof(query));
         }
         else if (pn->indices[i].type == REQ_IDX_TYPE_RANGE)
         {
-            /* concatenate (PARAM>=RANGE_BEGIN AND PARAM<=RANGE_END) */
+            /* concatenate (PARAM>=? AND PARAM<=?), the range is bound */
             strcat_safe(query, "([", sizeof(query));
             strcat_safe(query, param_info[i].paramName, sizeof(query));
-            strcat_safe(query, "]>=", sizeof(query));
-            sprintf(query+strlen(query), "%d", pn->indices[i].range_val.begin);
-            strcat_safe(query, " AND [", sizeof(query));
+            strcat_safe(query, "]>=? AND [", sizeof(query));
             strcat_safe(query, param_info[i].paramName, sizeof(query));
-            strcat_safe(query, "]<=", sizeof(query));
-            sprintf(query+strlen(query), "%d", pn->indices[i].range_val.end);
-            strcat_safe(query, ")", sizeof(query));
-            strcat_safe(query, " AND ", sizeof(query));
+            strcat_safe(query, "]<=?) AND ", sizeof(query));
         }
     }
     query[strlen(query)-5] = '\0'; /* Remove last " AND " */
 
     /* Execute query */
     DBG("%s", query);
-    if (sqlite3_prepare_v2(obj_db_conn, query, -1, &stmt, NULL) != SQLITE_OK)
+    if (w_prepare_idx_stmt(wd, obj_db_conn, query, pn, pn->index_num, &stmt) != EPS_OK)
         GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not prepare SQL statement: %s", sqlite3_errmsg(obj_db_conn));
 
     /* Write answer values */
@@ -1912,7 +2454,7 @@ static ep_stat_t w_get_values_db(worker_data_t *wd, ep_message_t *answer,
 ret:
     if (param_cnt > 0) DBG(" %d parameters were processed (num of indexes = %d, resp arrsize = %d)",
                            param_cnt, pn->index_num, answer->body.getParamValueResponse.arraySize);
-    if (stmt) sqlite3_finalize(stmt);
+    ep_db_stmt_release(&wd->stmt_cache, stmt);
     return status;
 }
 
@@ -2442,6 +2984,117 @@ static ep_stat_t w_parse_backend_method_string(oper_method_t method, char *metho
 }
 
 
+/* Parsed method string: the parse results point to buf, so the same
+   template serves all requests with this method string */
+typedef struct w_method_tpl_s {
+    oper_method_t method;
+    BOOL backend;                 /* parsed by w_parse_backend_method_string */
+    unsigned int hash;
+    char *src;                    /* original method string */
+    union {
+        parsed_operation_t op;
+        parsed_backend_method_t be;
+    } parsed;
+    char buf[];                   /* method string parsed in place */
+} w_method_tpl_t;
+
+static unsigned int w_method_tpl_hash(oper_method_t method, BOOL backend, const char *str)
+{
+    return ep_hash_str(EP_HASH_INIT ^ ((unsigned int)method * 2 + (backend ? 1 : 0)), str);
+}
+
+/* Returns the template of the method string, parsing the string if there
+   is no template yet. NULL is returned if the string cannot be parsed or
+   the table is filled up (then the caller parses the string itself) */
+static w_method_tpl_t *w_method_tpl_get(worker_data_t *wd, oper_method_t method,
+                                        BOOL backend, const char *method_string)
+{
+    w_method_tpl_t *tpl;
+    unsigned int h = w_method_tpl_hash(method, backend, method_string), pos;
+    size_t len;
+    ep_stat_t status;
+
+    for (pos = h % EP_METHOD_TPL_CACHE_SIZE; (tpl = wd->method_tpls[pos]) != NULL;
+         pos = (pos + 1) % EP_METHOD_TPL_CACHE_SIZE)
+    {
+        if (tpl->hash == h && tpl->method == method && tpl->backend == backend &&
+            !strcmp(tpl->src, method_string))
+            return tpl;
+    }
+
+    if (wd->method_tpl_num >= EP_METHOD_TPL_CACHE_SIZE / 2)
+        return NULL;
+
+    len = strlen(method_string) + 1;
+    if ((tpl = (w_method_tpl_t *)malloc(sizeof(w_method_tpl_t) + 2 * len)) == NULL)
+        return NULL;
+
+    tpl->method = method;
+    tpl->backend = backend;
+    tpl->hash = h;
+    tpl->src = tpl->buf + len;
+    memcpy(tpl->buf, method_string, len);
+    memcpy(tpl->src, method_string, len);
+
+    status = backend ? w_parse_backend_method_string(method, tpl->buf, &tpl->parsed.be) :
+                       w_parse_operation_string(method, tpl->buf, &tpl->parsed.op);
+    if (status != EPS_OK)
+    {
+        free(tpl);
+        return NULL;
+    }
+
+    wd->method_tpls[pos] = tpl;
+    wd->method_tpl_num++;
+
+    return tpl;
+}
+
+/* Frees the method string templates; the templates are referenced by
+   parsed strings of the current request, so it is done between tasks */
+static void w_method_tpls_flush(worker_data_t *wd)
+{
+    int i;
+
+    for (i = 0; i < EP_METHOD_TPL_CACHE_SIZE; i++)
+    {
+        free(wd->method_tpls[i]);
+        wd->method_tpls[i] = NULL;
+    }
+
+    wd->method_tpl_num = 0;
+}
+
+/* w_parse_operation_string over the worker's templates: the method string
+   is parsed once, the next requests take the parsed template. The result
+   must not be modified (and the method string is left intact if the
+   template is used) */
+static ep_stat_t w_get_operation_tpl(worker_data_t *wd, oper_method_t method,
+                                     char *command_string, parsed_operation_t *res)
+{
+    w_method_tpl_t *tpl = w_method_tpl_get(wd, method, FALSE, command_string);
+
+    if (!tpl)
+        return w_parse_operation_string(method, command_string, res);
+
+    *res = tpl->parsed.op;
+    return EPS_OK;
+}
+
+/* w_parse_backend_method_string over the worker's templates (see
+   w_get_operation_tpl) */
+static ep_stat_t w_get_backend_method_tpl(worker_data_t *wd, oper_method_t method,
+                                          char *method_string, parsed_backend_method_t *res)
+{
+    w_method_tpl_t *tpl = w_method_tpl_get(wd, method, TRUE, method_string);
+
+    if (!tpl)
+        return w_parse_backend_method_string(method, method_string, res);
+
+    *res = tpl->parsed.be;
+    return EPS_OK;
+}
+
 /**************************************************************************/
 /*! \fn static ep_stat_t w_form_getall_subst_sql_select(worker_data_t *wd
                 , parsed_param_name_t *pn
@@ -2633,6 +3286,8 @@ static ep_stat_t w_form_getall_subst_sql_select(worker_data_t *wd
 /*
  * Builds SELECT SQL request that retrieves values for substitution
  * If there is no parameter for substitution, do nothing - just return OK
+ * Index values of the request are left as "?" parameters, so the statement
+ * is to be prepared by w_prepare_idx_stmt
  */
 static ep_stat_t w_form_subst_sql_select(worker_data_t *wd, parsed_param_name_t *pn,
         obj_info_t *obj_info, char *query, size_t query_size, char **idx_params,
@@ -2746,28 +3401,21 @@ static ep_stat_t w_form_subst_sql_select(worker_data_t *wd, parsed_param_name_t
     {
         if (pn->indices[j].type == REQ_IDX_TYPE_EXACT)
         {
-            /* concatenate PARAM=ARG */
+            /* concatenate PARAM=?, the value is bound */
             strcat_safe(query, "t.[", query_size);
             strcat_safe(query, idx_params[j], query_size);
-            strcat_safe(query, "]=", query_size);
-            sprintf(query+strlen(query), "%d", pn->indices[j].exact_val.num);
-            strcat_safe(query, " AND ", query_size);
+            strcat_safe(query, "]=? AND ", query_size);
         }
         else if (pn->indices[j].type == REQ_IDX_TYPE_RANGE)
         {
-            /* concatenate (PARAM>=RANGE_BEGIN AND PARAM<=RANGE_END) */
+            /* concatenate (PARAM>=? AND PARAM<=?), the range is bound */
             strcat_safe(query, "(", query_size);
             strcat_safe(query, "t.[", query_size);
             strcat_safe(query, idx_params[j], query_size);
-            strcat_safe(query, "]>=", query_size);
-            sprintf(query+strlen(query), "%d", pn->indices[j].range_val.begin);
-            strcat_safe(query, " AND ", query_size);
+            strcat_safe(query, "]>=? AND ", query_size);
             strcat_safe(query, "t.[", query_size);
             strcat_safe(query, idx_params[j], query_size);
-            strcat_safe(query, "]<=", query_size);
-            sprintf(query+strlen(query), "%d", pn->indices[j].range_val.end);
-            strcat_safe(query, ")", query_size);
-            strcat_safe(query, " AND ", query_size);
+            strcat_safe(query, "]<=?) AND ", query_size);
         }
     }
     query[strlen(query)-5] = '\0'; /* Remove last " AND " */
@@ -2776,6 +3424,7 @@ static ep_stat_t w_form_subst_sql_select(worker_data_t *wd, parsed_param_name_t
 
 /*
  * Builds SELECT SQL request that retrieves values for substitution
+ * (index values are left as "?" parameters, see w_prepare_idx_stmt)
  */
 static ep_stat_t w_form_subst_sql_select_backend(worker_data_t *wd, parsed_param_name_t *pn,
         obj_info_t *obj_info, char *query, size_t query_size, char **idx_params,
@@ -2860,28 +3509,21 @@ static ep_stat_t w_form_subst_sql_select_backend(worker_data_t *wd, parsed_param
     {
         if (pn->indices[j].type == REQ_IDX_TYPE_EXACT)
         {
-            /* concatenate PARAM=ARG */
+            /* concatenate PARAM=?, the value is bound */
             strcat_safe(query, "t.[", query_size);
             strcat_safe(query, idx_params[j], query_size);
-            strcat_safe(query, "]=", query_size);
-            sprintf(query+strlen(query), "%d", pn->indices[j].exact_val.num);
-            strcat_safe(query, " AND ", query_size);
+            strcat_safe(query, "]=? AND ", query_size);
         }
         else if (pn->indices[j].type == REQ_IDX_TYPE_RANGE)
         {
-            /* concatenate (PARAM>=RANGE_BEGIN AND PARAM<=RANGE_END) */
+            /* concatenate (PARAM>=? AND PARAM<=?), the range is bound */
             strcat_safe(query, "(", query_size);
             strcat_safe(query, "t.[", query_size);
             strcat_safe(query, idx_params[j], query_size);
-            strcat_safe(query, "]>=", query_size);
-            sprintf(query+strlen(query), "%d", pn->indices[j].range_val.begin);
-            strcat_safe(query, " AND ", query_size);
+            strcat_safe(query, "]>=? AND ", query_size);
             strcat_safe(query, "t.[", query_size);
             strcat_safe(query, idx_params[j], query_size);
-            strcat_safe(query, "]<=", query_size);
-            sprintf(query+strlen(query), "%d", pn->indices[j].range_val.end);
-            strcat_safe(query, ")", query_size);
-            strcat_safe(query, " AND ", query_size);
+            strcat_safe(query, "]<=?) AND ", query_size);
         }
     }
     query[strlen(query)-5] = '\0'; /* Remove last " AND " */
@@ -2889,127 +3531,656 @@ static ep_stat_t w_form_subst_sql_select_backend(worker_data_t *wd, parsed_param
 }
 
 
-static ep_stat_t w_get_values_uci(worker_data_t *wd, ep_message_t *answer,
-                                  parsed_param_name_t *pn,
-                                  obj_info_t *obj_info, sqlite3 *obj_db_conn,
-                                  param_info_t param_info[], int param_num)
+#define W_UCI_GET_CMD  "uci get "
+
+/* Reads the value by "uci get" command prepared in buf; the value (first
+   line of the output) is returned in buf, NULL - no value. With libuci the
+   value is taken from the package loaded by the request instead */
+static ep_stat_t w_uci_get(worker_data_t *wd, char *buf, size_t buf_size, char **value)
 {
-    ep_stat_t status = EPS_OK;
-    int i, j, param_cnt = 0, res;
-    int  idx_params_num = 0, idx_values[MAX_INDECES_PER_OBJECT];
-    char *idx_params[MAX_INDECES_PER_OBJECT];
-    char  buf[EP_SQL_REQUEST_BUF_SIZE], query[EP_SQL_REQUEST_BUF_SIZE];
-    sqlite3_stmt *stmt = NULL;
-    char *p_extr_param;
-    FILE *fp;
+#ifdef MMX_EP_WITH_LIBUCI
+    *value = (ep_uci_get(wd->uci, buf + strlen(W_UCI_GET_CMD), buf, buf_size) == EPS_OK) ? buf : NULL;
+#else
+    if (ep_exec_read(buf, EP_EXEC_FIRST_LINE, buf, buf_size, NULL) != EPS_OK)
+        return EPS_SYSTEM_ERROR;
 
-    /* Save names of all index parameters of the object */
-    get_index_param_names (param_info, param_num, idx_params, &idx_params_num);
+    *value = (strlen(buf) > 0) ? buf : NULL;
+#endif
 
-    if (idx_params_num != pn->index_num)
-        DBG("Not full set of indeces is used for uci GET request (%d of %d)", pn->index_num, idx_params_num);
+    return EPS_OK;
+}
 
-    for (i = 0; i < param_num; i++)
+#ifndef MMX_EP_WITH_LIBUCI
+/* Line ending a group of the batch: uci reports it as unknown command, so
+   the errors of the group's commands precede this report in the output */
+#define W_UCI_BATCH_SEP      "mmx-ep-next-param\n"
+#define W_UCI_BATCH_SEP_ERR  "Unknown command"
+
+/* Appends the string to the text of the batch */
+static ep_stat_t w_uci_batch_cat(w_nvbuf_t *text, const char *str, size_t len)
+{
+    size_t new_size;
+    char *new_buf;
+
+    if (text->len + len + 1 > text->size)
     {
-        if ((obj_info->getOperStyle == OP_STYLE_UCI) ||
-            (!pn->partial_path && !strcmp(pn->leaf_name, param_info[i].paramName) && param_info[i].getOperStyle == OP_STYLE_UCI) ||
-            (pn->partial_path && param_info[i].getOperStyle == OP_STYLE_UCI))
-        {
-            /* Check if this parameter is allowed to be read by the caller */
-            if (!paramReadAllowed(param_info, i, answer->header.callerId))
-            {
-                /*DBG("Param %s isn't allowed to be read by this requestor (%d)",
-                     param_info[i].paramName, answer->header.callerId);*/
-                continue;
-            }
+        new_size = text->size ? text->size * 2 : W_NVBUF_INIT_SIZE;
+        while (new_size < text->len + len + 1)
+            new_size *= 2;
 
-            if (strlen(param_info[i].getMethod) > 0 )
-            {
-                parsed_operation_t parsed_uci_str;
-                w_parse_operation_string(OP_GET, param_info[i].getMethod, &parsed_uci_str);
+        if ((new_buf = realloc(text->buf, new_size)) == NULL)
+        {
+            ERROR("Could not allocate memory for uci batch");
+            return EPS_OUTOFMEMORY;
+        }
 
-                w_form_subst_sql_select(wd, pn, obj_info, query, sizeof(query), idx_params, idx_params_num, &parsed_uci_str);
+        text->buf = new_buf;
+        text->size = new_size;
+    }
 
-                if (strlen(query) > 0)
-                {
-                   DBG("query:\n%s", query);
-                   if (sqlite3_prepare_v2(obj_db_conn, query, -1, &stmt, NULL) != SQLITE_OK)
-                       GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not prepare SQL statement: %s", sqlite3_errmsg(obj_db_conn));
-                }
+    memcpy(text->buf + text->len, str, len);
+    text->len += len;
+    text->buf[text->len] = '\0';
 
-                while (TRUE)
-                {
-                    res = sqlite3_step(stmt);
+    return EPS_OK;
+}
 
-                    if ((res == SQLITE_ROW) || (strlen(query) == 0))
-                    {
-                        strcpy_safe(buf, "uci get ", sizeof(buf));
-                        w_form_call_str(buf+strlen(buf), sizeof(buf), &parsed_uci_str, stmt, idx_params_num);
-                        DBG("%s", buf);
+/* Drops the commands and the results of the previous batch */
+static void w_uci_batch_reset(w_uci_batch_t *b)
+{
+    if (b->cmds.buf) b->cmds.buf[0] = '\0';
+    if (b->pkgs.buf) b->pkgs.buf[0] = '\0';
+    b->cmds.len = b->pkgs.len = 0;
+    b->grp_start = 0;
+    b->grp_num = 0;
+    b->done = FALSE;
+}
 
-                        /* Save all selected index values */
-                        for (j = 0; j < idx_params_num; j++)
-                            idx_values[j] = sqlite3_column_int(stmt, j);
+static void w_uci_batch_free(w_uci_batch_t *b)
+{
+    w_nvbuf_free(&b->cmds);
+    w_nvbuf_free(&b->pkgs);
+    free(b->grps);
+    memset(b, 0, sizeof(w_uci_batch_t));
+}
 
-                        if (!(fp = popen(buf, "r")))
-                            GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not execute uci");
+/* Closes the open group of the batch by the separator line */
+static ep_stat_t w_uci_batch_end_group(w_uci_batch_t *b, int tag)
+{
+    ep_stat_t status;
+    w_uci_grp_t *new_grps;
+    int new_size;
 
-                        p_extr_param = fgets(buf, sizeof(buf)-1, fp);
-                        pclose(fp);
+    if (b->cmds.len == b->grp_start)
+        return EPS_OK;
 
-                        trim(p_extr_param);
-                        if (!p_extr_param || (strlen(p_extr_param) == 0) ||
-                            (param_info[i].hidden == TRUE))
-                        {
-                            p_extr_param = "";
-                        }
+    if (b->grp_num == b->grp_size)
+    {
+        new_size = b->grp_size ? b->grp_size * 2 : 16;
+        if ((new_grps = realloc(b->grps, new_size * sizeof(w_uci_grp_t))) == NULL)
+        {
+            ERROR("Could not allocate memory for uci batch");
+            return EPS_OUTOFMEMORY;
+        }
+        b->grps = new_grps;
+        b->grp_size = new_size;
+    }
 
-                        DBG("Got from UCI: %s",p_extr_param);
+    status = w_uci_batch_cat(&b->cmds, W_UCI_BATCH_SEP, strlen(W_UCI_BATCH_SEP));
+    if (status != EPS_OK)
+        return status;
 
-                        w_insert_value_to_answer(wd, answer, obj_info->objName,
-                                 idx_values, idx_params_num, param_info[i].paramName,
-                                 (char *)db2soap((char *)p_extr_param, param_info[i].paramType));
+    b->grps[b->grp_num].tag = tag;
+    b->grps[b->grp_num].end = b->cmds.len;
+    b->grp_num++;
+    b->grp_start = b->cmds.len;
 
-                        param_cnt++;
+    return EPS_OK;
+}
+#endif
 
-                        if (strlen(query) == 0)
-                            break;
+/* Sets the option by "uci set" command; with libuci the option is set in
+   the loaded package, otherwise the command is added to the uci batch.
+   The packages are committed at the end of the request (see w_uci_commit) */
+static ep_stat_t w_uci_set(worker_data_t *wd, const char *path, const char *value)
+{
+#ifdef MMX_EP_WITH_LIBUCI
+    DBG("uci set %s='%s'", path, value);
+    return ep_uci_set(wd->uci, path, value);
+#else
+    ep_stat_t status = EPS_OK;
+    w_uci_batch_t *b = &wd->uci_batch;
+    char commit[MAX_METHOD_STR_LEN];
+    const char *p;
+    size_t pkg_len;
+
+    if (b->done)
+        w_uci_batch_reset(b);
+
+    /* Each command is a line of the batch */
+    if (strpbrk(path, "\r\n") || strpbrk(value, "\r\n"))
+        GOTO_RET_WITH_ERROR(EPS_INVALID_ARGUMENT, "Multi-line value for uci option %s", path);
+
+    if ((pkg_len = strcspn(path, ".")) == 0 || path[pkg_len] == '\0')
+        GOTO_RET_WITH_ERROR(EPS_INVALID_FORMAT, "Could not determine uci package of %s", path);
+
+    DBG("uci set %s='%s' (batched)", path, value);
+    if ((status = w_uci_batch_cat(&b->cmds, "set ", 4)) != EPS_OK ||
+        (status = w_uci_batch_cat(&b->cmds, path, strlen(path))) != EPS_OK ||
+        (status = w_uci_batch_cat(&b->cmds, "='", 2)) != EPS_OK ||   //value is placed in quotes
+        (status = w_uci_batch_cat(&b->cmds, value, strlen(value))) != EPS_OK ||
+        (status = w_uci_batch_cat(&b->cmds, "'\n", 2)) != EPS_OK)
+        goto ret;
 
-                    }
-                    else if (res == SQLITE_DONE)
-                        break;
-                    else
-                        GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not execute query: %s", sqlite3_errmsg(obj_db_conn));
-                }
-            }
-        }
+    /* The package is committed once by the batch */
+    snprintf(commit, sizeof(commit), "commit %.*s\n", (int)pkg_len, path);
+    for (p = b->pkgs.buf; p && (p = strstr(p, commit)) != NULL; p++)
+    {
+        if (p == b->pkgs.buf || p[-1] == '\n')
+            break;
     }
+    if (p == NULL)
+        status = w_uci_batch_cat(&b->pkgs, commit, strlen(commit));
 
 ret:
-    if (param_cnt > 0) DBG(" %d parameters were processed", param_cnt);
-
-    if (stmt) sqlite3_finalize(stmt);
     return status;
+#endif
 }
 
-/* TODO: This function should be tested!!! */
-static ep_stat_t w_get_values_ubus(worker_data_t *wd, ep_message_t *answer,
-                                   parsed_param_name_t *pn,
-                                   obj_info_t *obj_info, sqlite3 *obj_db_conn,
-                                   param_info_t param_info[], int param_num)
+/* Returns mark of the uci changes made so far by the request */
+static size_t w_uci_mark(worker_data_t *wd)
 {
-    ep_stat_t status = EPS_OK;
-    int  i, j, res, param_cnt = 0;
-    int  idx_params_num = 0, idx_values[MAX_INDECES_PER_OBJECT];
-    char *idx_params[MAX_INDECES_PER_OBJECT];
-    char buf[EP_SQL_REQUEST_BUF_SIZE], query[EP_SQL_REQUEST_BUF_SIZE];
-    char *p_extr_param = NULL;
-    FILE *fp;
-    parsed_operation_t parsed_ubus_str;
-    sqlite3_stmt *stmt = NULL;
+#ifdef MMX_EP_WITH_LIBUCI
+    return (size_t)ep_uci_mark(wd->uci);
+#else
+    return wd->uci_batch.done ? 0 : wd->uci_batch.cmds.len;
+#endif
+}
 
-    /* Save names of all index parameters of the object */
-    get_index_param_names (param_info, param_num, idx_params, &idx_params_num);
+/* Cancels the uci changes made by the request after the mark */
+static void w_uci_rollback(worker_data_t *wd, size_t mark)
+{
+#ifdef MMX_EP_WITH_LIBUCI
+    ep_uci_rollback(wd->uci, (int)mark);
+#else
+    w_uci_batch_t *b = &wd->uci_batch;
+
+    if (!b->done && mark >= b->grp_start && mark < b->cmds.len)
+    {
+        b->cmds.len = mark;
+        b->cmds.buf[mark] = '\0';
+    }
+#endif
+}
+
+/* Ends the uci changes of the request parameter at the given position;
+   the changes are reported failed by the batch separately of the other
+   parameters (built without libuci) */
+static void w_uci_end_param(worker_data_t *wd, int tag)
+{
+#ifndef MMX_EP_WITH_LIBUCI
+    if (!wd->uci_batch.done)
+        w_uci_batch_end_group(&wd->uci_batch, tag);
+#endif
+}
+
+#ifndef MMX_EP_WITH_LIBUCI
+/* Runs "uci batch" with the text as its input. Returns position of the
+   first group which commands failed (the errors before the k-th separator
+   report belong to the k-th group), grp_num - no group failed, -1 - the
+   errors can't be related to the groups (e.g. the separators are not
+   reported or the batch could not be run) */
+static int w_uci_batch_run(w_uci_batch_t *b, const char *text, size_t len)
+{
+    char *out = NULL, *line, *next;
+    int k = 0, failed = b->grp_num, res = 0;
+    BOOL errors = FALSE, any_errors = FALSE;
+
+    DBG("uci batch:\n%s", text);
+
+    if (ep_exec_read_alloc("uci batch", text, len, EP_EXEC_STDERR, &out, &res) != EPS_OK)
+    {
+        ERROR("Could not execute uci batch command");
+        return -1;
+    }
+
+    for (line = out; line && *line; line = next)
+    {
+        if ((next = strchr(line, '\n')) != NULL)
+            *next++ = '\0';
+
+        if (!strncmp(line, W_UCI_BATCH_SEP_ERR, strlen(W_UCI_BATCH_SEP_ERR)))
+        {
+            if (errors && failed == b->grp_num)
+                failed = k;
+            k++;
+            errors = FALSE;
+        }
+        else if (strlen(trim(line)) > 0)
+        {
+            WARN("uci batch: %s", line);
+            errors = any_errors = TRUE;
+        }
+    }
+    free(out);
+
+    if (res != 0)
+    {
+        ERROR("uci batch command failed. Error %d", res);
+        return -1;
+    }
+
+    /* Errors after the last reported separator */
+    if (errors && failed == b->grp_num)
+        failed = (k < b->grp_num) ? k : -1;
+    else if (any_errors && k < b->grp_num && failed == b->grp_num)
+        failed = -1;
+
+    return failed;
+}
+#endif
+
+/* Writes the uci packages changed by the request. With libuci the loaded
+   packages are committed. Otherwise the collected "set" commands are run
+   by one "uci batch" process and the changed packages are committed by
+   another one. If the commands of a group failed, the changes of this
+   group and of the following ones are reverted, only the preceding groups
+   are committed (as the request stops on the first failed parameter).
+   *failed_tag - tag of the failed group, -1 if the failure can't be related
+   to a parameter */
+static ep_stat_t w_uci_commit(worker_data_t *wd, int *failed_tag)
+{
+#ifdef MMX_EP_WITH_LIBUCI
+    *failed_tag = -1;
+    return ep_uci_commit(wd->uci);
+#else
+    ep_stat_t status = EPS_OK;
+    w_uci_batch_t *b = &wd->uci_batch;
+    w_nvbuf_t text = {0};
+    char *p, *end;
+    int failed;
+
+    *failed_tag = -1;
+
+    if (b->done)
+        return EPS_OK;
+
+    /* Commands out of the parameter groups form the last group */
+    w_uci_batch_end_group(b, -1);
+    b->done = TRUE;
+
+    if (b->grp_num == 0)
+        return EPS_OK;
+
+    if ((failed = w_uci_batch_run(b, b->cmds.buf, b->cmds.len)) == b->grp_num)
+    {
+        /* All commands succeeded */
+        if (w_uci_batch_run(b, b->pkgs.buf, b->pkgs.len) != b->grp_num)
+            GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not commit uci packages:\n%s", b->pkgs.buf);
+        goto ret;
+    }
+
+    if (failed < 0)
+        failed = 0;
+    *failed_tag = b->grps[failed].tag;
+    status = EPS_SYSTEM_ERROR;
+
+    /* The changes of the batch are reverted and the commands of the groups
+       before the failed one are run again */
+    for (p = b->pkgs.buf; p && (end = strchr(p, '\n')) != NULL; p = end + 1)
+    {
+        if (w_uci_batch_cat(&text, "revert", 6) != EPS_OK ||
+            w_uci_batch_cat(&text, p + 6, end - p - 5) != EPS_OK)  /* after "commit" */
+            GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not prepare uci batch revert");
+    }
+    if (failed > 0 &&
+        (w_uci_batch_cat(&text, b->cmds.buf, b->grps[failed - 1].end) != EPS_OK ||
+         w_uci_batch_cat(&text, b->pkgs.buf, b->pkgs.len) != EPS_OK))
+        GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not prepare uci batch commits");
+
+    if (w_uci_batch_run(b, text.buf, text.len) != b->grp_num)
+        ERROR("Could not revert uci changes of the failed parameter:\n%s", text.buf);
+
+ret:
+    w_nvbuf_free(&text);
+    return status;
+#endif
+}
+
+/* Objects which uci options are set by the request. The values read before
+   the uci packages are committed may be cached again in the meantime, so
+   the objects are invalidated once more after w_uci_commit */
+#define W_UCI_OBJS_NUM  8
+
+typedef struct w_uci_objs_s {
+    int num;
+    BOOL all;           /* too many objects - the whole cache is invalidated */
+    char names[W_UCI_OBJS_NUM][MSG_MAX_STR_LEN];
+} w_uci_objs_t;
+
+static void w_uci_objs_add(w_uci_objs_t *objs, const char *obj_name)
+{
+    int i;
+
+    if (objs->all)
+        return;
+
+    for (i = 0; i < objs->num; i++)
+    {
+        if (!strcmp(objs->names[i], obj_name))
+            return;
+    }
+
+    if (objs->num < W_UCI_OBJS_NUM)
+        strcpy_safe(objs->names[objs->num++], obj_name, sizeof(objs->names[0]));
+    else
+        objs->all = TRUE;
+}
+
+static void w_uci_objs_invalidate(w_uci_objs_t *objs)
+{
+    int i;
+
+    if (objs->all)
+        ep_valcache_invalidate("");
+    else
+    {
+        for (i = 0; i < objs->num; i++)
+            ep_valcache_invalidate(objs->names[i]);
+    }
+}
+
+/* Runs the savepoint command ("SAVEPOINT", "ROLLBACK TO" or "RELEASE") for
+   the savepoint of the request parameter. The values DB changes of the uci
+   parameters are kept under savepoints until their uci changes are
+   committed (see w_uci_commit_params) */
+static ep_stat_t w_uci_savepoint(sqlite3 *dbconn, const char *cmd, int tag)
+{
+    char query[64];
+
+    snprintf(query, sizeof(query), "%s w_uci_%d", cmd, tag);
+    if (sqlite3_exec(dbconn, query, NULL, NULL, NULL) != SQLITE_OK)
+    {
+        ERROR("%s failed: %s", query, sqlite3_errmsg(dbconn));
+        return EPS_SQL_ERROR;
+    }
+
+    return EPS_OK;
+}
+
+/* Commits the uci changes of the request parameters starting from "first".
+   The values DB changes of the parameter which uci changes failed and of
+   the following ones are rolled back; the backends are restarted only for
+   the parameters before it. uci_restart[] - the first parameter requiring
+   restart of the backend (-1 - none), it is reset. *failed - position of
+   the failed parameter, -1 - none */
+static ep_stat_t w_uci_commit_params(worker_data_t *wd, sqlite3 *dbconn, int first,
+                                     w_uci_objs_t *objs, int uci_restart[],
+                                     int restart_be[], int *failed)
+{
+    ep_stat_t status;
+    int j;
+
+    status = w_uci_commit(wd, failed);
+    w_uci_objs_invalidate(objs);
+
+    if (status == EPS_OK)
+        *failed = -1;
+    else if (*failed < first)
+        *failed = first;
+
+    if (*failed >= 0)
+        w_uci_savepoint(dbconn, "ROLLBACK TO", *failed);
+    w_uci_savepoint(dbconn, "RELEASE", first);
+
+    for (j = 0; j < MAX_BACKEND_NUM; j++)
+    {
+        if (uci_restart[j] >= 0 && (*failed < 0 || uci_restart[j] < *failed))
+            restart_be[j] = TRUE;
+        uci_restart[j] = -1;
+    }
+
+    return status;
+}
+
+static ep_stat_t w_get_values_uci(worker_data_t *wd, ep_message_t *answer,
+                                  parsed_param_name_t *pn,
+                                  obj_info_t *obj_info, sqlite3 *obj_db_conn,
+                                  param_info_t param_info[], int param_num)
+{
+    ep_stat_t status = EPS_OK;
+    int i, j, param_cnt = 0, res;
+    int  idx_params_num = 0, idx_values[MAX_INDECES_PER_OBJECT];
+    char *idx_params[MAX_INDECES_PER_OBJECT];
+    char  buf[EP_SQL_REQUEST_BUF_SIZE], query[EP_SQL_REQUEST_BUF_SIZE];
+    sqlite3_stmt *stmt = NULL;
+    char *p_extr_param;
+    ep_valcache_ref_t vc_ref;
+
+    /* Save names of all index parameters of the object */
+    get_index_param_names (param_info, param_num, idx_params, &idx_params_num);
+
+    if (idx_params_num != pn->index_num)
+        DBG("Not full set of indeces is used for uci GET request (%d of %d)", pn->index_num, idx_params_num);
+
+    for (i = 0; i < param_num; i++)
+    {
+        if ((obj_info->getOperStyle == OP_STYLE_UCI) ||
+            (!pn->partial_path && !strcmp(pn->leaf_name, param_info[i].paramName) && param_info[i].getOperStyle == OP_STYLE_UCI) ||
+            (pn->partial_path && param_info[i].getOperStyle == OP_STYLE_UCI))
+        {
+            /* Check if this parameter is allowed to be read by the caller */
+            if (!paramReadAllowed(param_info, i, answer->header.callerId))
+            {
+                /*DBG("Param %s isn't allowed to be read by this requestor (%d)",
+                     param_info[i].paramName, answer->header.callerId);*/
+                continue;
+            }
+
+            if (strlen(param_info[i].getMethod) > 0 )
+            {
+                parsed_operation_t parsed_uci_str;
+                w_get_operation_tpl(wd, OP_GET, param_info[i].getMethod, &parsed_uci_str);
+
+                w_form_subst_sql_select(wd, pn, obj_info, query, sizeof(query), idx_params, idx_params_num, &parsed_uci_str);
+
+                if (strlen(query) > 0)
+                {
+                   DBG("query:\n%s", query);
+                   if (w_prepare_idx_stmt(wd, obj_db_conn, query, pn, idx_params_num, &stmt) != EPS_OK)
+                       GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not prepare SQL statement: %s", sqlite3_errmsg(obj_db_conn));
+                }
+
+                while (TRUE)
+                {
+                    res = sqlite3_step(stmt);
+
+                    if ((res == SQLITE_ROW) || (strlen(query) == 0))
+                    {
+                        strcpy_safe(buf, W_UCI_GET_CMD, sizeof(buf));
+                        w_form_call_str(buf+strlen(buf), sizeof(buf), &parsed_uci_str, stmt, idx_params_num);
+                        DBG("%s", buf);
+
+                        /* Save all selected index values */
+                        for (j = 0; j < idx_params_num; j++)
+                            idx_values[j] = sqlite3_column_int(stmt, j);
+
+                        if (ep_valcache_lookup(&vc_ref, obj_info->objName, param_info[i].paramName,
+                                               buf, buf, sizeof(buf)))
+                        {
+                            p_extr_param = buf;
+                        }
+                        else
+                        {
+                            if (w_uci_get(wd, buf, sizeof(buf), &p_extr_param) != EPS_OK)
+                                GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not execute uci");
+
+                            trim(p_extr_param);
+                            ep_valcache_store(&vc_ref, p_extr_param);
+                        }
+
+                        if (!p_extr_param || (strlen(p_extr_param) == 0) ||
+                            (param_info[i].hidden == TRUE))
+                        {
+                            p_extr_param = "";
+                        }
+
+                        DBG("Got from UCI: %s",p_extr_param);
+
+                        w_insert_value_to_answer(wd, answer, obj_info->objName,
+                                 idx_values, idx_params_num, param_info[i].paramName,
+                                 (char *)db2soap((char *)p_extr_param, param_info[i].paramType));
+
+                        param_cnt++;
+
+                        if (strlen(query) == 0)
+                            break;
+
+                    }
+                    else if (res == SQLITE_DONE)
+                        break;
+                    else
+                        GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not execute query: %s", sqlite3_errmsg(obj_db_conn));
+                }
+
+                ep_db_stmt_release(&wd->stmt_cache, stmt);
+                stmt = NULL;
+            }
+        }
+    }
+
+ret:
+    if (param_cnt > 0) DBG(" %d parameters were processed", param_cnt);
+
+    ep_db_stmt_release(&wd->stmt_cache, stmt);
+    return status;
+}
+
+#define W_UBUS_CALL_CMD  "ubus call "
+
+/* Performs ubus call (object, method and message); the JSON result is
+   returned in *result and should be freed by the caller. With libubus
+   the worker's connection to ubusd is used instead of "ubus call" command */
+static ep_stat_t w_ubus_call(worker_data_t *wd, const char *call, char **result)
+{
+#ifdef MMX_EP_WITH_LIBUBUS
+    return ep_ubus_call(wd->ubus, call, result);
+#else
+    ep_stat_t status = EPS_OK;
+    char cmd[EP_SQL_REQUEST_BUF_SIZE];
+    char *buf = NULL;
+    int res;
+
+    *result = NULL;
+
+    strcpy_safe(cmd, W_UBUS_CALL_CMD, sizeof(cmd));
+    strcat_safe(cmd, call, sizeof(cmd));
+
+    if (ep_exec_read_alloc(cmd, NULL, 0, 0, &buf, &res) != EPS_OK)
+        GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not execute ubus");
+
+    if (res != 0)
+        GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "%s failed. Error %d", cmd, res);
+
+    *result = buf;
+    buf = NULL;
+
+ret:
+    free(buf);
+    return status;
+#endif
+}
+
+/* Results of the ubus calls made for the parameters of an object; the
+   parameters of one instance are usually read by the same call */
+typedef struct w_ubus_res_s {
+    char *call;
+    char *json;                   /* NULL - the call failed */
+} w_ubus_res_t;
+
+typedef struct w_ubus_results_s {
+    w_ubus_res_t *res;
+    int num;
+    int size;
+    int last;                     /* position of the last found call */
+} w_ubus_results_t;
+
+/* Returns the result of the call, the call is performed only if it was
+   not made before. The calls are repeated for the parameters in the same
+   order, so the search starts after the last found call */
+static const char *w_ubus_results_get(worker_data_t *wd, w_ubus_results_t *results,
+                                      const char *call)
+{
+    w_ubus_res_t *new_res;
+    int i, k;
+
+    for (k = 0; k < results->num; k++)
+    {
+        i = (results->last + 1 + k) % results->num;
+        if (!strcmp(results->res[i].call, call))
+        {
+            results->last = i;
+            return results->res[i].json;
+        }
+    }
+
+    if (results->num == results->size)
+    {
+        k = results->size ? results->size * 2 : 16;
+        if ((new_res = realloc(results->res, k * sizeof(w_ubus_res_t))) == NULL)
+        {
+            ERROR("Could not allocate memory for ubus results");
+            return NULL;
+        }
+        results->res = new_res;
+        results->size = k;
+    }
+
+    i = results->num;
+    if ((results->res[i].call = strdup(call)) == NULL)
+        return NULL;
+
+    if (w_ubus_call(wd, call, &results->res[i].json) != EPS_OK)
+        results->res[i].json = NULL;
+
+    results->num++;
+    results->last = i;
+
+    return results->res[i].json;
+}
+
+static void w_ubus_results_free(w_ubus_results_t *results)
+{
+    int i;
+
+    for (i = 0; i < results->num; i++)
+    {
+        free(results->res[i].call);
+        free(results->res[i].json);
+    }
+    free(results->res);
+    memset(results, 0, sizeof(w_ubus_results_t));
+}
+
+static ep_stat_t w_get_values_ubus(worker_data_t *wd, ep_message_t *answer,
+                                   parsed_param_name_t *pn,
+                                   obj_info_t *obj_info, sqlite3 *obj_db_conn,
+                                   param_info_t param_info[], int param_num)
+{
+    ep_stat_t status = EPS_OK;
+    int  i, j, res, param_cnt = 0;
+    int  idx_params_num = 0, idx_values[MAX_INDECES_PER_OBJECT];
+    char *idx_params[MAX_INDECES_PER_OBJECT];
+    char buf[EP_SQL_REQUEST_BUF_SIZE], query[EP_SQL_REQUEST_BUF_SIZE];
+    char *p_extr_param = NULL;
+    const char *json;
+    parsed_operation_t parsed_ubus_str;
+    sqlite3_stmt *stmt = NULL;
+    ep_valcache_ref_t vc_ref;
+    w_ubus_results_t results = {0};
+
+    /* Save names of all index parameters of the object */
+    get_index_param_names (param_info, param_num, idx_params, &idx_params_num);
 
     /*if (idx_params_num != pn->index_num)
         DBG("Not full set of indeces is used for ubus GET request (%d of %d)", pn->index_num, idx_params_num);*/
@@ -3033,13 +4204,13 @@ static ep_stat_t w_get_values_ubus(worker_data_t *wd, ep_message_t *answer,
                 DBG("ubus get-method string is not presented for param %s", param_info[i].paramName);
                 continue;
             }
-            w_parse_operation_string(OP_GET, param_info[i].getMethod, &parsed_ubus_str);
+            w_get_operation_tpl(wd, OP_GET, param_info[i].getMethod, &parsed_ubus_str);
             w_form_subst_sql_select(wd, pn, obj_info, query, sizeof(query), idx_params, idx_params_num, &parsed_ubus_str);
 
             if (strlen(query) > 0)
             {
                 DBG("query:\n%s", query);
-                if (sqlite3_prepare_v2(obj_db_conn, query, -1, &stmt, NULL) != SQLITE_OK)
+                if (w_prepare_idx_stmt(wd, obj_db_conn, query, pn, idx_params_num, &stmt) != EPS_OK)
                     GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not prepare SQL statement: %s",
                         sqlite3_errmsg(obj_db_conn));
             }
@@ -3053,31 +4224,31 @@ static ep_stat_t w_get_values_ubus(worker_data_t *wd, ep_message_t *answer,
                     for (j = 0; j < idx_params_num; j++)
                         idx_values[j] = sqlite3_column_int(stmt, j);
 
-                    strcpy_safe(buf, "ubus call ", sizeof(buf));
+                    strcpy_safe(buf, W_UBUS_CALL_CMD, sizeof(buf));
                     w_form_call_str(buf+strlen(buf), sizeof(buf), &parsed_ubus_str, stmt, idx_params_num);
                     DBG("%s", buf);
 
-                    fp = popen(buf, "r");
-                    if (!fp)
-                        GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not execute ubus");
-
-                    p_extr_param = NULL;
-                    while (fgets(buf, sizeof(buf)-1, fp) != NULL)
+                    if (ep_valcache_lookup(&vc_ref, obj_info->objName, param_info[i].paramName,
+                                           buf, buf, sizeof(buf)))
                     {
-                        p_extr_param = strstr(buf, parsed_ubus_str.value_to_extract);
-                        if (p_extr_param)
+                        p_extr_param = buf;
+                    }
+                    else
+                    {
+                        /* The value is extracted from the result of the call,
+                           that is made once for all parameters of the instance */
+                        json = w_ubus_results_get(wd, &results, buf + strlen(W_UBUS_CALL_CMD));
+
+                        p_extr_param = NULL;
+                        if (json && parsed_ubus_str.value_to_extract &&
+                            ep_json_get(json, parsed_ubus_str.value_to_extract,
+                                        buf, sizeof(buf)) == EPS_OK)
                         {
-                            /* Format: "key": "value",\n */
-                            p_extr_param = strstr(buf, " ") + 1;
-                            if (p_extr_param[strlen(p_extr_param)-1] == '\n')
-                                p_extr_param[strlen(p_extr_param)-1] = '\0';
-                            if (p_extr_param[strlen(p_extr_param)-1] == ',')
-                                p_extr_param[strlen(p_extr_param)-1] = '\0';
-                            trim_quotes(p_extr_param);
-                            break;
+                            p_extr_param = buf;
                         }
+
+                        ep_valcache_store(&vc_ref, p_extr_param);
                     }
-                    pclose(fp);
 
                     DBG("Got from ubus: name %s, value %s", parsed_ubus_str.value_to_extract, p_extr_param);
 
@@ -3094,13 +4265,17 @@ static ep_stat_t w_get_values_ubus(worker_data_t *wd, ep_message_t *answer,
                 else
                     GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not execute query: %s", sqlite3_errmsg(obj_db_conn));
             } // End of while over DB rows
+
+            ep_db_stmt_release(&wd->stmt_cache, stmt);
+            stmt = NULL;
         }  // End of "if get-style is ubus
     } // End of "for" stmt over parameters
 
 ret:
     if (param_cnt > 0) DBG(" %d parameters were processed", param_cnt);
 
-    if (stmt) sqlite3_finalize(stmt);
+    w_ubus_results_free(&results);
+    ep_db_stmt_release(&wd->stmt_cache, stmt);
     return status;
 }
 
@@ -3141,7 +4316,7 @@ static ep_stat_t w_prepare_getall_command(worker_data_t *wd
 
     memset(cmd_buf, 0, cmd_buf_len);
 
-    status = w_parse_operation_string(OP_GETALL
+    status = w_get_operation_tpl(wd, OP_GETALL
              , obj_info->getAllMethod, &parsed_operation);
 
     if (status)
@@ -3262,9 +4437,12 @@ static ep_stat_t w_prepare_command(worker_data_t *wd, parsed_param_name_t *pn,
         else
         {
             DBG("Query to select values for substitution (len=%d):\n\t%s", strlen(query), query);
-            if ((res = sqlite3_prepare_v2(obj_db_conn, query, -1, &stmt, NULL)) != SQLITE_OK)
+            if (w_prepare_idx_stmt(wd, obj_db_conn, query, pn, idx_params_num, &stmt) != EPS_OK)
+            {
+                res = SQLITE_ERROR;
                 GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not prepare SQL statement: %s",
                                         sqlite3_errmsg(obj_db_conn));
+            }
         }
     }
     else  //This is not first call, so we continue to work with the existing sqlite stmt
@@ -3312,7 +4490,7 @@ ret:
     {
         //DBG("Last itteration: set p_stmt to NULL");
         *p_stmt = NULL;
-        if (stmt) sqlite3_finalize(stmt);
+        ep_db_stmt_release(&wd->stmt_cache, stmt);
     }
     return status;
 }
@@ -3359,7 +4537,7 @@ static ep_stat_t w_prepare_command2(worker_data_t *wd, parsed_param_name_t *pn,
     }
 
     DBG("Query to select values for substitution (len=%d):\n\t%s", strlen(query), query);
-    if ((res = sqlite3_prepare_v2(dbconn, query, -1, &stmt, NULL)) != SQLITE_OK)
+    if (w_prepare_idx_stmt(wd, dbconn, query, pn, idx_params_num, &stmt) != EPS_OK)
         GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not prepare SQL statement: %s",
                                 sqlite3_errmsg(dbconn));
 
@@ -3408,7 +4586,7 @@ static ep_stat_t w_prepare_command2(worker_data_t *wd, parsed_param_name_t *pn,
 ret:
     //DBG("Prepared command (status %d): \n\t%s", status, cmd_buf);
 
-    if (stmt) sqlite3_finalize(stmt);
+    ep_db_stmt_release(&wd->stmt_cache, stmt);
 
     return status;
 }
@@ -3428,6 +4606,7 @@ static ep_stat_t w_get_values_script_perparam(worker_data_t *wd, ep_message_t *a
     BOOL  more_instance = TRUE;
     parsed_operation_t parsed_script_str;
     sqlite3_stmt *stmt = NULL;
+    ep_valcache_ref_t vc_ref;
 
     /* Save names of all index parameters of the object */
     get_index_param_names (param_info, param_num, idx_params, &idx_params_num);
@@ -3464,7 +4643,7 @@ static ep_stat_t w_get_values_script_perparam(worker_data_t *wd, ep_message_t *a
             continue;
         }
         methodString = param_info[i].getMethod;
-        w_parse_operation_string(OP_GET, methodString, &parsed_script_str);
+        w_get_operation_tpl(wd, OP_GET, methodString, &parsed_script_str);
 
         more_instance = TRUE;
         stmt = NULL;
@@ -3489,50 +4668,60 @@ static ep_stat_t w_get_values_script_perparam(worker_data_t *wd, ep_message_t *a
             }
             DBG("Prepared command: \n\t%s", buf);
 
-            p_extr_param = w_perform_prepared_command(buf, sizeof(buf), TRUE, NULL);
-            if (!p_extr_param)
-                GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not read script results");
-
-            DBG("Result of the command: %s ", trim(p_extr_param));
-
-            /* Parse result buffer and extract param values (if specified) */
-            if (parsed_script_str.value_to_extract &&
-                (strlen(parsed_script_str.value_to_extract) > 0))
+            if (ep_valcache_lookup(&vc_ref, obj_info->objName, param_info[i].paramName,
+                                   buf, buf, sizeof(buf)))
             {
-                DBG("Name of parameter to extract: %s, len=%d", parsed_script_str.value_to_extract,
-                      strlen(parsed_script_str.value_to_extract));
+                p_extr_param = buf;
+            }
+            else
+            {
+                p_extr_param = w_perform_prepared_command(buf, sizeof(buf), TRUE, NULL);
+                if (!p_extr_param)
+                    GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not read script results");
 
-                p_extr_param = strstr(buf, parsed_script_str.value_to_extract);
-                if (p_extr_param)   // TODO!!! WE need to test this scenario!!!
+                DBG("Result of the command: %s ", trim(p_extr_param));
+
+                /* Parse result buffer and extract param values (if specified) */
+                if (parsed_script_str.value_to_extract &&
+                    (strlen(parsed_script_str.value_to_extract) > 0))
                 {
-                    p_extr_param = strstr(buf, " ") + 1;
-                    DBG("Extracted parameter: %s", p_extr_param);
-                }
-            }
-            else /* Param name for extract is not specified in method string */
-            {
-                /* Parse received results. There are two possible formats:
-                 (1) with result code:  rescode ; paramValue
-                 (2) direct value, w/o res code:    paramValue               */
-                p_sep = strstr(buf, ";");
-                if (p_sep)
-                {   /* This is 1st format - with res code */
-                    token    = strtok_r(buf, ";", &strtok_ctx1);
-                    res_code = atoi(token);
-                    if (strlen(token) == 0 || !isdigit(token[0]) || res_code != 0)
-                    {
-                        DBG("Get method script returned error: %d: %s", res_code, token);
-                        if (stmt == NULL)  more_instance = FALSE;
+                    DBG("Name of parameter to extract: %s, len=%d", parsed_script_str.value_to_extract,
+                          strlen(parsed_script_str.value_to_extract));
 
-                        continue;
+                    p_extr_param = strstr(buf, parsed_script_str.value_to_extract);
+                    if (p_extr_param)   // TODO!!! WE need to test this scenario!!!
+                    {
+                        p_extr_param = strstr(buf, " ") + 1;
+                        DBG("Extracted parameter: %s", p_extr_param);
                     }
-                    token = strtok_r(NULL, "; ", &strtok_ctx1);
                 }
-                else /* This is the 2nd format: immediate value without res code */
+                else /* Param name for extract is not specified in method string */
                 {
-                    token = buf;
+                    /* Parse received results. There are two possible formats:
+                     (1) with result code:  rescode ; paramValue
+                     (2) direct value, w/o res code:    paramValue               */
+                    p_sep = strstr(buf, ";");
+                    if (p_sep)
+                    {   /* This is 1st format - with res code */
+                        token    = strtok_r(buf, ";", &strtok_ctx1);
+                        res_code = atoi(token);
+                        if (strlen(token) == 0 || !isdigit(token[0]) || res_code != 0)
+                        {
+                            DBG("Get method script returned error: %d: %s", res_code, token);
+                            if (stmt == NULL)  more_instance = FALSE;
+
+                            continue;
+                        }
+                        token = strtok_r(NULL, "; ", &strtok_ctx1);
+                    }
+                    else /* This is the 2nd format: immediate value without res code */
+                    {
+                        token = buf;
+                    }
+                    p_extr_param = trim(token);
                 }
-                p_extr_param = trim(token);
+
+                ep_valcache_store(&vc_ref, p_extr_param ? p_extr_param : "");
             }
 
             if ((p_extr_param == NULL) || (strlen(p_extr_param) == 0))  p_extr_param = "";
@@ -3553,7 +4742,7 @@ static ep_stat_t w_get_values_script_perparam(worker_data_t *wd, ep_message_t *a
     } //End of for over all received parameters
 
 ret:
-    if (stmt) sqlite3_finalize(stmt);
+    ep_db_stmt_release(&wd->stmt_cache, stmt);
     if (param_cnt > 0) DBG(" %d parameters were processed", param_cnt);
     return status;
 }
@@ -3567,13 +4756,14 @@ static ep_stat_t w_get_values_script_perobject(worker_data_t *wd, ep_message_t *
     int  j, i = 0, param_cnt = 0;
     int  idx_params_num = 0, idx_values[MAX_INDECES_PER_OBJECT];
     char *idx_params[MAX_INDECES_PER_OBJECT];
-    char *methodString,  buf[EP_SQL_REQUEST_BUF_SIZE];
+    char *methodString, *buf;
     char *name, *value, *p_extr_param;
     char *strtok_ctx1, *strtok_ctx2, *token;
     int  res_code = 0;
     BOOL leaf_param_retreived = FALSE, more_instance = TRUE;
     parsed_operation_t parsed_script_str;
     sqlite3_stmt *stmt = NULL;
+    size_t arena_mark = w_arena_mark(wd);
 
     /* Check if we have parameters with "script" get-style */
     for (i = 0; i < param_num; i++)
@@ -3587,12 +4777,16 @@ static ep_stat_t w_get_values_script_perobject(worker_data_t *wd, ep_message_t *
     if (param_cnt == 0) //Nothing to do
         return EPS_OK;
 
+    /* The output of the script with all parameters of the object */
+    if ((buf = w_arena_alloc(wd, EP_SCRIPT_OUTPUT_BUF_SIZE)) == NULL)
+        return EPS_OUTOFMEMORY;
+
     /* Save names of all index parameters of the object */
     get_index_param_names (param_info, param_num, idx_params, &idx_params_num);
 
     /* Prepare method string and shell command (with all needed info) */
     methodString = obj_info->getMethod;
-    w_parse_operation_string(OP_GET, methodString, &parsed_script_str);
+    w_get_operation_tpl(wd, OP_GET, methodString, &parsed_script_str);
 
     i = 0; param_cnt = 0;
     while (more_instance == TRUE)
@@ -3600,7 +4794,7 @@ static ep_stat_t w_get_values_script_perobject(worker_data_t *wd, ep_message_t *
         /* Prepare shell command (with all needed info) and perform it */
         status1 = w_prepare_command(wd, pn, obj_info, obj_db_conn, &parsed_script_str,
                                         idx_params, idx_values, idx_params_num,
-                                        (char*)&buf, sizeof(buf), &stmt);
+                                        buf, EP_SCRIPT_OUTPUT_BUF_SIZE, &stmt);
         if (status1 != EPS_OK)
         {
             if (status1 != EPS_NOTHING_DONE)
@@ -3611,7 +4805,7 @@ static ep_stat_t w_get_values_script_perobject(worker_data_t *wd, ep_message_t *
         DBG("Prepared command %d: \n\t%s", ++i, buf);
 
         /* Now perform the prepared command and parsed received results*/
-        p_extr_param = w_perform_prepared_command(buf, sizeof(buf), TRUE, NULL);
+        p_extr_param = w_perform_prepared_command(buf, EP_SCRIPT_OUTPUT_BUF_SIZE, TRUE, NULL);
         if (!p_extr_param)
             GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not read script results");
 
@@ -3686,7 +4880,8 @@ next_token:
     } // End of while stmt over all instances
 
 ret:
-    if (stmt) sqlite3_finalize(stmt);
+    ep_db_stmt_release(&wd->stmt_cache, stmt);
+    w_arena_release(wd, arena_mark);
     if (param_cnt > 0) DBG(" %d parameters were processed", param_cnt);
     return status;
 }
@@ -3713,6 +4908,7 @@ static ep_stat_t w_prepare_backend_request(worker_data_t *wd, mmxba_op_type_t op
 
     memset((char *)bereq, 0, sizeof(mmxba_request_t));
     mmx_backapi_msgstruct_init(bereq, wd->be_req_values_pool, sizeof( wd->be_req_values_pool));
+    w_buf_used(&wd->be_pool_used, sizeof(wd->be_req_values_pool));
 
     bereq->op_type = op_type;
 
@@ -3997,6 +5193,7 @@ static ep_stat_t form_and_send_be_request(worker_data_t *wd, int be_port,
 
     mmx_backapi_msgstruct_init(be_resp, wd->be_req_values_pool,
                                sizeof( wd->be_req_values_pool));
+    w_buf_used(&wd->be_pool_used, sizeof(wd->be_req_values_pool));
     if (mmx_backapi_message_parse(buf, be_resp) != MMXBA_OK)
         GOTO_RET_WITH_ERROR(EPS_GENERAL_ERROR, "Could not parse response from BE");
 
@@ -4064,7 +5261,7 @@ static ep_stat_t w_get_values_backend(worker_data_t *wd, ep_message_t *answer,
            GOTO_RET_WITH_ERROR(EPS_GENERAL_ERROR, "Could not get port number (%d) for backend %s (per-obj get)",
                             be_port, obj_info->backEndName);
 
-        w_parse_backend_method_string(OP_GET, obj_info->getMethod, &parsed_method);
+        w_get_backend_method_tpl(wd, OP_GET, obj_info->getMethod, &parsed_method);
 
         if (idx_params_num > 0)
         {
@@ -4072,7 +5269,7 @@ static ep_stat_t w_get_values_backend(worker_data_t *wd, ep_message_t *answer,
                                             idx_params_num, &parsed_method);
             DBG("Subst query:\n%s", query);
 
-            if (sqlite3_prepare_v2(obj_db_conn, query, -1, &stmt, NULL) != SQLITE_OK)
+            if (w_prepare_idx_stmt(wd, obj_db_conn, query, pn, idx_params_num, &stmt) != EPS_OK)
                GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not prepare SQL stmt: %s",
                                    sqlite3_errmsg(obj_db_conn));
         }
@@ -4183,7 +5380,7 @@ static ep_stat_t w_get_values_backend(worker_data_t *wd, ep_message_t *answer,
                                  param_info[i].getMethod : obj_info->getMethod;
 
             DBG("Request to backend is needed for param %s", param_info[i].paramName);
-            w_parse_backend_method_string(OP_GET, methodString, &parsed_method);
+            w_get_backend_method_tpl(wd, OP_GET, methodString, &parsed_method);
 
             if (idx_params_num > 0)
             {
@@ -4191,7 +5388,7 @@ static ep_stat_t w_get_values_backend(worker_data_t *wd, ep_message_t *answer,
                                                 idx_params_num, &parsed_method);
                 DBG("Subst query:\n%s", query);
 
-                if (sqlite3_prepare_v2(obj_db_conn, query, -1, &stmt, NULL) != SQLITE_OK)
+                if (w_prepare_idx_stmt(wd, obj_db_conn, query, pn, idx_params_num, &stmt) != EPS_OK)
                    GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not prepare SQL statement: %s",
                                        sqlite3_errmsg(obj_db_conn));
             }
@@ -4247,13 +5444,17 @@ static ep_stat_t w_get_values_backend(worker_data_t *wd, ep_message_t *answer,
                     if (!stmt) more_instance = FALSE;
                 }
             } // End of while (more_instance)
+
+            /* The statement of the next parameter is taken anew */
+            ep_db_stmt_release(&wd->stmt_cache, stmt);
+            stmt = NULL;
         } // End of for stmt over params
     }
 
 ret:
     if (param_cnt > 0) DBG(" %d parameters were processed", param_cnt);
 
-    if (stmt) sqlite3_finalize(stmt);
+    ep_db_stmt_release(&wd->stmt_cache, stmt);
     return status;
 }
 
@@ -4311,23 +5512,523 @@ static ep_stat_t w_check_get_opstyle(worker_data_t *wd, parsed_param_name_t *pn,
         ERROR("Invalid operation style for object: %s", obj_info->objName);
         return EPS_GENERAL_ERROR;
     }
-    else
+    else
+    {
+        return EPS_OK;
+    }
+}
+
+
+/* Result of processing one object of GetParamValue request */
+typedef enum {
+    W_GET_OBJ_DONE = 0,     /* values are retrieved (status tells if successfully) */
+    W_GET_OBJ_SKIPPED,      /* object has no requested parameters */
+    W_GET_OBJ_FATAL         /* the whole request fails */
+} w_get_obj_res_t;
+
+/* Retrieves values of the requested parameters of one object */
+static ep_stat_t w_get_obj_values(worker_data_t *wd, ep_message_t *answer,
+                                  parsed_param_name_t *pn, obj_info_t *obj_info,
+                                  char configOnly, w_get_obj_res_t *res)
+{
+    ep_stat_t status = EPS_OK, status1 = EPS_OK;
+    param_info_t param_info[MAX_PARAMS_PER_OBJECT];
+    sqlite3 *dbconn = wd->main_conn;
+    int param_num;
+
+    *res = W_GET_OBJ_DONE;
+
+    /* Acquire information about the requested parameter(s) from the DB */
+    if (((status = w_get_param_info(wd, pn, obj_info, configOnly,
+                        param_info, &param_num, NULL)) != EPS_OK) || param_num == 0)
+    {
+        DBG("No parameter info (%d). Ignore object", status);
+        *res = W_GET_OBJ_SKIPPED;
+        return status;
+    }
+
+    /* If it is get config-only request, special handler is used */
+    if (configOnly)
+    {
+        status1 = w_get_values_configonly(wd, answer, pn, obj_info, dbconn, param_info, param_num);
+        return status;
+    }
+
+    if ((status = w_check_get_opstyle(wd, pn, obj_info, param_info, param_num)) != EPS_OK)
+    {
+        ERROR("One or more operation styles are invalid");
+        *res = W_GET_OBJ_FATAL;
+        return status;
+    }
+
+    /* Parameters with style == db are to be retrieved from the db regardless of object's get style */
+    if ((status = w_get_values_db(wd, answer, pn, obj_info, dbconn, param_info, param_num)) != EPS_OK)
+    {
+        ERROR("Could not get values from DB");
+        *res = W_GET_OBJ_FATAL;
+        return status;
+    }
+
+    switch (obj_info->getOperStyle)
+    {
+    case OP_STYLE_DB: /* db values already acquired */
+        break;
+    case OP_STYLE_UCI:
+        status1 = w_get_values_uci(wd, answer, pn, obj_info, dbconn, param_info, param_num);
+        break;
+    case OP_STYLE_UBUS:
+        status1 = w_get_values_ubus(wd, answer, pn, obj_info, dbconn, param_info, param_num);
+        break;
+    case OP_STYLE_SCRIPT:
+        status1 = w_get_values_script_perobject(wd, answer, pn, obj_info, dbconn, param_info, param_num);
+        break;
+    case OP_STYLE_BACKEND:
+        status = w_get_values_backend(wd, answer, pn, obj_info, dbconn, param_info, param_num);
+        break;
+
+    /* Style OP_STYLE_SHELL_SCRIPT is currently supported for
+     *  SET operation per distinct Object parameter(s) only */
+
+    /* object's get style is not set, process it parameter by parameter */
+    default:
+        if ((status1 = w_get_values_uci(wd, answer, pn, obj_info, dbconn, param_info, param_num)) != EPS_OK)
+            ERROR("Could not get values from UCI for obj %s (err %d)", obj_info->objName, status);
+
+        if ((status1 = w_get_values_ubus(wd, answer, pn, obj_info, dbconn, param_info, param_num)) != EPS_OK)
+            ERROR("Could not get values from UBUS for obj %s (err %d)", obj_info->objName, status);
+
+        if ((status1 = w_get_values_script_perparam(wd, answer, pn, obj_info, dbconn, param_info, param_num)) != EPS_OK)
+            ERROR("Could not get values from SCRIPT for obj %s (err %d)", obj_info->objName, status);
+
+        if ((status1 = w_get_values_backend(wd, answer, pn, obj_info, dbconn, param_info, param_num)) != EPS_OK)
+            ERROR("Could not get values from BACKEND for obj %s (err %d)", obj_info->objName, status);
+
+    } //End of switch by get style
+
+    return status;
+}
+
+/* -------------------------------------------------------------------------------*
+ * Fan-out of multi-object GetParamValue request.
+ * Objects of a partial-path request are claimed one by one by the request
+ * owner and by idle workers that got the job as a subtask. Helpers collect
+ * values of their objects; the owner inserts them to the response in the
+ * order of objects, so the response stream is the same as of sequential
+ * processing.
+ * -------------------------------------------------------------------------------*/
+typedef struct w_get_job_obj_s {
+    volatile int    done;
+    BOOL            direct;     /* processed by the owner directly into response */
+    ep_stat_t       status;
+    w_get_obj_res_t res;
+    w_nvbuf_t       values;
+} w_get_job_obj_t;
+
+typedef struct w_get_job_s {
+    volatile int    refcnt;     /* owner and not finished subtasks */
+    volatile int    next_obj;   /* next object to be claimed */
+    volatile BOOL   cancelled;
+    tp_event_t      ev;         /* the owner waits for objects here */
+
+    /* Request data; valid while there are not claimed objects */
+    ep_message_t        *answer;
+    parsed_param_name_t *pn;
+    obj_info_t          *obj_info;
+    int                 obj_num;
+    int                 mmxDbType;
+    char                configOnly;
+
+    w_get_job_obj_t objs[MAX_OBJECTS_NUM];
+} w_get_job_t;
+
+static void w_get_job_put(w_get_job_t *job)
+{
+    if (__atomic_sub_fetch(&(job->refcnt), 1, __ATOMIC_SEQ_CST) > 0)
+        return;
+
+    for (int i = 0; i < job->obj_num; i++)
+        w_nvbuf_free(&(job->objs[i].values));
+
+    free(job);
+}
+
+/* Claims and processes the next object of the job. The object with index
+   direct_idx (the one the owner waits for) is processed directly into the
+   response, values of other objects are collected.
+   Returns FALSE if there is no more objects to claim */
+static BOOL w_get_job_process_next(worker_data_t *wd, w_get_job_t *job, int direct_idx)
+{
+    int k = __atomic_fetch_add(&(job->next_obj), 1, __ATOMIC_SEQ_CST);
+    w_get_job_obj_t *obj;
+
+    if (k >= job->obj_num)
+        return FALSE;
+
+    obj = &(job->objs[k]);
+
+    if (__atomic_load_n(&(job->cancelled), __ATOMIC_SEQ_CST))
+    {
+        obj->res = W_GET_OBJ_SKIPPED;
+        obj->status = EPS_OK;
+    }
+    else
+    {
+        DBG("----- Processing object %s (%d of %d)%s", job->obj_info[k].objName,
+             k + 1, job->obj_num, (k == direct_idx) ? "" : " for fanned out request");
+
+        obj->direct = (k == direct_idx);
+        wd->collect = obj->direct ? NULL : &(obj->values);
+        obj->status = w_get_obj_values(wd, job->answer, job->pn, job->obj_info + k,
+                                       job->configOnly, &(obj->res));
+        wd->collect = NULL;
+    }
+
+    __atomic_store_n(&(obj->done), TRUE, __ATOMIC_RELEASE);
+    tp_event_notify(&(job->ev), 1);
+
+    return TRUE;
+}
+
+/* Creates the job for the objects of one requested name and passes it to
+   idle workers as subtasks. NULL is returned if the request is to be
+   processed sequentially */
+static w_get_job_t *w_get_job_start(worker_data_t *wd, ep_message_t *message,
+                                    ep_message_t *answer, parsed_param_name_t *pn,
+                                    obj_info_t *obj_info, int obj_num)
+{
+    tp_threadpool_t *tp = wd->tp;
+    tp_task_t tasks[EP_TP_MAX_WORKER_THREADS_NUM];
+    w_get_job_t *job;
+    int i, helpers, added = 0;
+
+    if (!tp || wd->collect || EP_GET_FANOUT_MIN_OBJECTS <= 0 ||
+        obj_num < EP_GET_FANOUT_MIN_OBJECTS)
+        return NULL;
+
+    /* Fan out only to the workers that are idle right now */
+    helpers = __atomic_load_n(&(tp->ev.waiters), __ATOMIC_SEQ_CST);
+    if (helpers > obj_num - 1)
+        helpers = obj_num - 1;
+    if (helpers > EP_TP_MAX_WORKER_THREADS_NUM)
+        helpers = EP_TP_MAX_WORKER_THREADS_NUM;
+    if (helpers <= 0)
+        return NULL;
+
+    if ((job = (w_get_job_t *)calloc(1, sizeof(w_get_job_t))) == NULL)
+    {
+        WARN("Could not allocate GET job. Processing sequentially");
+        return NULL;
+    }
+
+    job->answer = answer;
+    job->pn = pn;
+    job->obj_info = obj_info;
+    job->obj_num = obj_num;
+    job->mmxDbType = message->header.mmxDbType;
+    job->configOnly = message->body.getParamValue.configOnly;
+    job->refcnt = 1 + helpers;
+
+    memset((char *)tasks, 0, sizeof(tasks));
+    for (i = 0; i < helpers; i++)
+    {
+        tasks[i].task_type = TASK_TYPE_SUBTASK;
+        tasks[i].lane = TP_LANE_READ;
+        tasks[i].shard = wd->tp_group;
+        tasks[i].subtask = job;
+    }
+
+    tp_add_tasks(tp, tasks, helpers, &added);
+
+    /* References of subtasks that were not added */
+    if (added < helpers)
+        __atomic_sub_fetch(&(job->refcnt), helpers - added, __ATOMIC_SEQ_CST);
+
+    DBG("GET of %d objects is fanned out to %d worker(s)", obj_num, added);
+
+    return job;
+}
+
+/* Waits until object idx of the job is processed, processing not claimed
+   objects meanwhile, and inserts its values to the response (unless they
+   are to be discarded) */
+static ep_stat_t w_get_job_obj_wait(worker_data_t *wd, w_get_job_t *job, int idx,
+                                    BOOL discard, w_get_obj_res_t *res)
+{
+    w_get_job_obj_t *obj = &(job->objs[idx]);
+    char *p, *name, *value;
+    int key;
+
+    while (!__atomic_load_n(&(obj->done), __ATOMIC_ACQUIRE))
+    {
+        if (w_get_job_process_next(wd, job, idx))
+            continue;
+
+        /* The object is being processed by a helper */
+        key = tp_event_prepare(&(job->ev));
+        if (__atomic_load_n(&(obj->done), __ATOMIC_ACQUIRE))
+        {
+            tp_event_cancel(&(job->ev));
+            break;
+        }
+        tp_event_wait(&(job->ev), key);
+    }
+
+    if (!obj->direct && !discard)
+    {
+        for (p = obj->values.buf; p && p < obj->values.buf + obj->values.len; )
+        {
+            name = p;
+            p += strlen(p) + 1;
+            value = *p++ ? p : NULL;
+            if (value)
+                p += strlen(value) + 1;
+
+            w_insert_nvpair_to_answer(wd, job->answer, name, value);
+        }
+    }
+
+    w_nvbuf_free(&(obj->values));
+
+    *res = obj->res;
+    return obj->status;
+}
+
+/* Cancels not claimed objects, waits for the claimed ones and releases
+   the owner's reference to the job */
+static void w_get_job_finish(worker_data_t *wd, w_get_job_t *job)
+{
+    w_get_obj_res_t res;
+
+    __atomic_store_n(&(job->cancelled), TRUE, __ATOMIC_SEQ_CST);
+
+    for (int i = 0; i < job->obj_num; i++)
+    {
+        if (!__atomic_load_n(&(job->objs[i].done), __ATOMIC_ACQUIRE))
+            w_get_job_obj_wait(wd, job, i, TRUE, &res);
+    }
+
+    w_get_job_put(job);
+}
+
+/* Subtask of multi-object GetParamValue request: processes objects of the
+   job that are not claimed yet */
+static void w_handle_get_subtask(worker_data_t *wd, w_get_job_t *job)
+{
+    int cnt = 0;
+
+    if (w_init_mmxdb_handles(wd, job->mmxDbType, MSGTYPE_GETVALUE) == EPS_OK)
+    {
+        while (w_get_job_process_next(wd, job, -1))
+            cnt++;
+    }
+
+    DBG("GET subtask done: %d object(s) processed", cnt);
+
+    w_get_job_put(job);
+}
+
+/* -------------------------------------------------------------------------------*
+ * Batched GetParamValue of parameters of the same object instance.
+ * Full names that differ by the leaf only (e.g. "Obj.1.A", "Obj.1.B") of an
+ * object with "db" get style are read by one SELECT when the first of them
+ * is processed. The values are kept until the request loop gets to their
+ * names, so the response order is the order of the request.
+ * -------------------------------------------------------------------------------*/
+#define W_BATCH_NONE     (-1)   /* the name is not planned yet */
+#define W_BATCH_SOLO     (-2)   /* the name is processed on its own */
+#define W_BATCH_NOVALUE  (-3)   /* the name is done, it has no value */
+
+#define W_BATCH_DONE(pos)  ((pos) >= 0 || (pos) == W_BATCH_NOVALUE)
+
+typedef struct w_get_batch_s {
+    int *pos;           /* per request name: W_BATCH_* or value offset in values */
+    w_nvbuf_t values;
+} w_get_batch_t;
+
+static BOOL w_get_batch_eligible(ep_message_t *message, parsed_param_name_t *pn)
+{
+    int i;
+
+    if (message->body.getParamValue.configOnly || message->body.getParamValue.nextLevel ||
+        pn->partial_path || pn->leaf_name[0] == '\0')
+        return FALSE;
+
+    /* The name must point to one instance */
+    for (i = 0; i < pn->index_num; i++)
+    {
+        if (pn->indices[i].type != REQ_IDX_TYPE_EXACT)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* Reads values of the request names starting with the name "first" (pn is
+   its parsed name) that belong to the same object instance. The names that
+   cannot be read this way are marked W_BATCH_SOLO */
+static ep_stat_t w_get_values_db_batch(worker_data_t *wd, ep_message_t *message,
+                                       ep_message_t *answer, parsed_param_name_t *pn,
+                                       int first, w_get_batch_t *batch)
+{
+    ep_stat_t status = EPS_OK;
+    const char *first_name = message->body.getParamValue.paramNames[first];
+    const char *name, *leaf = strrchr(first_name, '.');
+    size_t prefix_len;
+    int members[MAX_PARAMS_PER_OBJECT], member_col[MAX_PARAMS_PER_OBJECT];
+    int member_num = 0, cols[MAX_PARAMS_PER_OBJECT], col_num = 0;
+    int i, k, m, c, res, obj_num = 0, param_num = 0, before;
+    int idx_params_num = 0, idx_values[MAX_INDECES_PER_OBJECT];
+    char *idx_params[MAX_INDECES_PER_OBJECT];
+    param_info_t param_info[MAX_PARAMS_PER_OBJECT];
+    parsed_param_name_t pn_all;
+    obj_info_t obj_info;
+    char query[EP_SQL_REQUEST_BUF_SIZE];
+    sqlite3_stmt *stmt = NULL;
+
+    if (!leaf)
+        return EPS_OK;
+    prefix_len = leaf - first_name + 1;
+
+    /* Names of the same instance: the same "Obj.{idx}." part and a leaf */
+    for (k = first; k < message->body.getParamValue.arraySize && member_num < MAX_PARAMS_PER_OBJECT; k++)
+    {
+        name = message->body.getParamValue.paramNames[k];
+        leaf = name + prefix_len;
+        if (batch->pos[k] == W_BATCH_NONE && !strncmp(name, first_name, prefix_len) &&
+            isalpha((unsigned char)*leaf) && !strchr(leaf, '.'))
+            members[member_num++] = k;
+    }
+
+    /* Whatever happens below, the names are not planned again */
+    for (m = 0; m < member_num; m++)
+        batch->pos[members[m]] = W_BATCH_SOLO;
+
+    if (member_num < 2)
+        return EPS_OK;
+
+    if (w_get_obj_info(wd, pn, 0, 0, &obj_info, 1, &obj_num) != EPS_OK || obj_num != 1 ||
+        obj_info.getOperStyle != OP_STYLE_DB)
+        return EPS_OK;
+
+    /* All parameters of the object; index parameters are the first */
+    memcpy(&pn_all, pn, sizeof(pn_all));
+    pn_all.partial_path = TRUE;
+    pn_all.leaf_name[0] = '\0';
+    if (w_get_param_info(wd, &pn_all, &obj_info, 0, param_info, &param_num, NULL) != EPS_OK)
+        return EPS_OK;
+
+    get_index_param_names(param_info, param_num, idx_params, &idx_params_num);
+    for (i = 0; i < param_num; i++)
+    {
+        if (param_info[i].isIndex)
+            cols[col_num++] = i;
+    }
+
+    /* Columns of the requested parameters, each parameter is selected once */
+    for (m = 0; m < member_num; m++)
+    {
+        leaf = message->body.getParamValue.paramNames[members[m]] + prefix_len;
+        member_col[m] = -1;
+
+        for (i = 0; i < param_num && strcmp(param_info[i].paramName, leaf); i++);
+        if (i == param_num)
+            continue;   /* unknown parameter is processed on its own */
+
+        for (c = 0; c < col_num && cols[c] != i; c++);
+        if (c == col_num)
+            cols[col_num++] = i;
+        member_col[m] = c;
+    }
+
+    strcpy_safe(query, "SELECT ", sizeof(query));
+    for (c = 0; c < col_num; c++)
+    {
+        strcat_safe(query, "[", sizeof(query));
+        strcat_safe(query, param_info[cols[c]].paramName, sizeof(query));
+        strcat_safe(query, "],", sizeof(query));
+    }
+    LAST_CHAR(query) = '\0'; /* Delete last comma */
+
+    strcat_safe(query, " FROM ", sizeof(query));
+    strcat_safe(query, obj_info.objValuesTblName, sizeof(query));
+    strcat_safe(query, " WHERE 1 AND ", sizeof(query));
+    for (i = 0; i < pn->index_num; i++)
+    {
+        strcat_safe(query, "[", sizeof(query));
+        strcat_safe(query, param_info[i].paramName, sizeof(query));
+        strcat_safe(query, "]=? AND ", sizeof(query));
+    }
+    query[strlen(query)-5] = '\0'; /* Remove last " AND " */
+
+    DBG("%s (%d names)", query, member_num);
+    if (w_prepare_idx_stmt(wd, wd->main_conn, query, pn, pn->index_num, &stmt) != EPS_OK)
+        GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not prepare SQL statement: %s",
+                            sqlite3_errmsg(wd->main_conn));
+
+    /* The indexes point to one instance: only its row is taken */
+    res = sqlite3_step(stmt);
+    if (res != SQLITE_ROW && res != SQLITE_DONE)
+        GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not execute query: %s", sqlite3_errmsg(wd->main_conn));
+
+    for (i = 0; res == SQLITE_ROW && i < idx_params_num; i++)
+        idx_values[i] = sqlite3_column_int(stmt, i);
+
+    wd->collect = &(batch->values);
+    for (m = 0; m < member_num; m++)
     {
-        return EPS_OK;
+        if ((c = member_col[m]) < 0)
+            continue;
+
+        k = members[m];
+        batch->pos[k] = W_BATCH_NOVALUE;
+        if (res != SQLITE_ROW || !paramReadAllowed(param_info, cols[c], answer->header.callerId))
+            continue;
+
+        before = batch->values.num;
+        i = (int)batch->values.len;
+        w_insert_value_to_answer(wd, answer, obj_info.objName, idx_values, idx_params_num,
+                                 param_info[cols[c]].paramName,
+                                 (char *)db2soap((char *)sqlite3_column_text(stmt, c),
+                                                 param_info[cols[c]].paramType));
+        if (batch->values.num > before)
+            batch->pos[k] = i;
     }
+    wd->collect = NULL;
+
+ret:
+    ep_db_stmt_release(&wd->stmt_cache, stmt);
+    return status;
 }
 
+/* Inserts the value of the request name read by w_get_values_db_batch */
+static void w_get_batch_insert(worker_data_t *wd, ep_message_t *answer,
+                               w_get_batch_t *batch, int k)
+{
+    char *p, *name, *value;
+
+    if (batch->pos[k] < 0)
+        return;
+
+    p = name = batch->values.buf + batch->pos[k];
+    p += strlen(p) + 1;
+    value = *p++ ? p : NULL;
+
+    w_insert_nvpair_to_answer(wd, answer, name, value);
+}
 
 static ep_stat_t w_handle_getvalue(worker_data_t *wd, ep_message_t *message)
 {
-    ep_stat_t status = EPS_OK, status1 = EPS_OK;
+    ep_stat_t status = EPS_OK;
 
     parsed_param_name_t pn;
-    obj_info_t obj_info[MAX_OBJECTS_NUM];
-    int i, j, obj_num, param_num, req_size;
+    obj_info_t *obj_info;
+    size_t arena_mark = w_arena_mark(wd);
+    int i, j, obj_num, req_size;
     int obj_success_cnt = 0; //Counter of successfully processed objects
-    param_info_t param_info[MAX_PARAMS_PER_OBJECT];
-    sqlite3 *dbconn = NULL;
+    w_get_obj_res_t res;
+    w_get_job_t *job;
+    w_get_batch_t batch = {0};
+    BOOL failed;
     ep_message_t answer;
 
     req_size = message->body.getParamValue.arraySize;
@@ -4344,17 +6045,49 @@ static ep_stat_t w_handle_getvalue(worker_data_t *wd, ep_message_t *message)
     if ((status = w_init_mmxdb_handles(wd, message->header.mmxDbType, MSGTYPE_GETVALUE)) != EPS_OK )
         goto ret;
 
-    dbconn = wd->main_conn;
+    if ((obj_info = w_arena_alloc(wd, MAX_OBJECTS_NUM * sizeof(obj_info_t))) == NULL)
+        GOTO_RET_WITH_ERROR(EPS_OUTOFMEMORY, "Could not allocate objects info");
+
+    if ((batch.pos = w_arena_alloc(wd, req_size * sizeof(int))) == NULL)
+        GOTO_RET_WITH_ERROR(EPS_OUTOFMEMORY, "Could not allocate request plan");
+    for (i = 0; i < req_size; i++)
+        batch.pos[i] = W_BATCH_NONE;
 
     /* For each request parameter */
     for (i = 0; i < req_size; i++)
     {
+        /* The value was read together with other parameters of the instance */
+        if (W_BATCH_DONE(batch.pos[i]))
+        {
+            w_get_batch_insert(wd, &answer, &batch, i);
+            obj_success_cnt++;
+            status = EPS_OK;
+            continue;
+        }
+
         /* Parse request string: extract object name, parameter name, indices provided */
-        if ((status = parse_param_name(message->body.getParamValue.paramNames[i], &pn)) != EPS_OK)
+        status = W_PNAME_CACHE_USE(req_size) ?
+                 w_parse_param_name(wd, message->body.getParamValue.paramNames[i], &pn) :
+                 parse_param_name(message->body.getParamValue.paramNames[i], &pn);
+        if (status != EPS_OK)
         {
             status = EPS_INVALID_FORMAT;
             ERROR("Could not parse object and parameter name %s", message->body.getParamValue.paramNames[i]);
         }
+
+        /* Other parameters of the same instance are read at once with this one */
+        if (status == EPS_OK && req_size > 1 && batch.pos[i] == W_BATCH_NONE &&
+            w_get_batch_eligible(message, &pn))
+        {
+            w_get_values_db_batch(wd, message, &answer, &pn, i, &batch);
+            if (W_BATCH_DONE(batch.pos[i]))
+            {
+                w_get_batch_insert(wd, &answer, &batch, i);
+                obj_success_cnt++;
+                continue;
+            }
+        }
+
         /* Acquire information about the objects from the meta DB */
         if ((status == EPS_OK ) && (w_get_obj_info(wd, &pn, message->body.getParamValue.nextLevel,
                                                    0, obj_info, MAX_OBJECTS_NUM, &obj_num) != EPS_OK))
@@ -4371,81 +6104,53 @@ static ep_stat_t w_handle_getvalue(worker_data_t *wd, ep_message_t *message)
                 continue;
         }
 
+        /* Objects of the partial path may be processed by idle workers too */
+        job = w_get_job_start(wd, message, &answer, &pn, obj_info, obj_num);
+        failed = FALSE;
+
         /* For each object in the requested object's tree */
         for (j = 0; j < obj_num; j++)
         {
-            DBG("----- Processing object %s - num of indeces %d (%d, %d, %d, %d, %d)",
-                  obj_info[j].objName, pn.index_num, i, j, req_size, obj_num,
-                  message->body.getParamValue.configOnly);
-
-            /* Acquire information about the requested parameter(s) from the DB */
-            if (((status = w_get_param_info(wd, &pn, obj_info+j, message->body.getParamValue.configOnly,
-                                param_info, &param_num, NULL)) != EPS_OK) || param_num == 0)
+            if (job)
+                status = w_get_job_obj_wait(wd, job, j, FALSE, &res);
+            else
             {
-                DBG("No parameter info (%d). Ignore object", status);
-                continue;
-            }
+                DBG("----- Processing object %s - num of indeces %d (%d, %d, %d, %d, %d)",
+                      obj_info[j].objName, pn.index_num, i, j, req_size, obj_num,
+                      message->body.getParamValue.configOnly);
 
-            /* If it is get config-only request, special handler is used */
-            if (message->body.getParamValue.configOnly)
-            {
-                status1 = w_get_values_configonly(wd, &answer, &pn, obj_info+j, dbconn, param_info, param_num);
-                goto  check_step_res;
+                status = w_get_obj_values(wd, &answer, &pn, obj_info + j,
+                                          message->body.getParamValue.configOnly, &res);
             }
 
-            if ((status = w_check_get_opstyle(wd, &pn, obj_info+j, param_info, param_num)) != EPS_OK)
-                GOTO_RET_WITH_ERROR(status, "One or more operation styles are invalid");
-
-            /* Parameters with style == db are to be retrieved from the db regardless of object's get style */
-            if ((status = w_get_values_db(wd, &answer, &pn, obj_info+j, dbconn, param_info, param_num)) != EPS_OK)
-                GOTO_RET_WITH_ERROR(status, "Could not get values from DB");
+            if (res == W_GET_OBJ_SKIPPED)
+                continue;
 
-            switch (obj_info[j].getOperStyle)
+            if (res == W_GET_OBJ_FATAL)
             {
-            case OP_STYLE_DB: /* db values already acquired */
-                break;
-            case OP_STYLE_UCI:
-                status1 = w_get_values_uci(wd, &answer, &pn, obj_info+j, dbconn, param_info, param_num);
-                break;
-            case OP_STYLE_UBUS:
-                status1 = w_get_values_ubus(wd, &answer, &pn, obj_info+j, dbconn, param_info, param_num);
-                break;
-            case OP_STYLE_SCRIPT:
-                status1 = w_get_values_script_perobject(wd, &answer, &pn, obj_info+j, dbconn, param_info, param_num);
-                break;
-            case OP_STYLE_BACKEND:
-                status = w_get_values_backend(wd, &answer, &pn, obj_info+j, dbconn, param_info, param_num);
+                failed = TRUE;
                 break;
+            }
 
-            /* Style OP_STYLE_SHELL_SCRIPT is currently supported for
-             *  SET operation per distinct Object parameter(s) only */
-
-            /* object's get style is not set, process it parameter by parameter */
-            default:
-                if ((status1 = w_get_values_uci(wd, &answer, &pn, obj_info+j, dbconn, param_info, param_num)) != EPS_OK)
-                    ERROR("Could not get values from UCI for obj %s (err %d)", obj_info[j].objName, status);
-
-                if ((status1 = w_get_values_ubus(wd, &answer, &pn, obj_info+j, dbconn, param_info, param_num)) != EPS_OK)
-                    ERROR("Could not get values from UBUS for obj %s (err %d)", obj_info[j].objName, status);
-
-                if ((status1 = w_get_values_script_perparam(wd, &answer, &pn, obj_info+j, dbconn, param_info, param_num)) != EPS_OK)
-                    ERROR("Could not get values from SCRIPT for obj %s (err %d)", obj_info[j].objName, status);
-
-                if ((status1 = w_get_values_backend(wd, &answer, &pn, obj_info+j, dbconn, param_info, param_num)) != EPS_OK)
-                    ERROR("Could not get values from BACKEND for obj %s (err %d)", obj_info[j].objName, status);
-
-            } //End of switch by get style
-
-check_step_res:
             if (status == EPS_OK)
                 obj_success_cnt++;
             else  /* If only one object is requested, we stop here with error*/
             {
                 if ((req_size == 1) && (obj_num == 1))
-                   GOTO_RET_WITH_ERROR(status, "Failed to get values for one requested object");
+                {
+                    ERROR("Failed to get values for one requested object");
+                    failed = TRUE;
+                    break;
+                }
             }
         }   // End of "for j" stmt
 
+        if (job)
+            w_get_job_finish(wd, job);
+
+        if (failed)
+            goto ret;
+
         if (obj_num == 0)
             GOTO_RET_WITH_ERROR(EPS_INVALID_PARAM_NAME, "Unknown object `%s'", pn.obj_name);
 
@@ -4467,6 +6172,8 @@ ret:
             status, answer.header.respCode);
         answer.body.getParamValueResponse.arraySize = 0;
     }
+    w_nvbuf_free(&batch.values);
+    w_arena_release(wd, arena_mark);
     w_send_answer(wd, &answer);
     return status;
 }
@@ -4481,9 +6188,9 @@ static ep_stat_t w_set_value_db(worker_data_t *wd, parsed_param_name_t *pn, obj_
                          int set_param_index, char *value)
 {
     ep_stat_t status = EPS_OK;
-    int i;
-    int modified_rows_num = 0;
+    int i, res;
     char ownerStr[3] = {0};
+    sqlite3_stmt *stmt = NULL;
 
     sprintf((char *)ownerStr, "%d", EP_DATA_OWNER_USER);
 
@@ -4494,7 +6201,7 @@ static ep_stat_t w_set_value_db(worker_data_t *wd, parsed_param_name_t *pn, obj_
         return EPS_OK;
     }
 
-    /* Build UPDATE query */
+    /* Build UPDATE query; the value and indexes are bound to the statement */
     char query[EP_SQL_REQUEST_BUF_SIZE] = "UPDATE ";
     strcat_safe(query, obj_info->objValuesTblName, sizeof(query));
     strcat_safe(query, " SET ", sizeof(query));
@@ -4502,9 +6209,7 @@ static ep_stat_t w_set_value_db(worker_data_t *wd, parsed_param_name_t *pn, obj_
     /* param name and its value to be set  */
     strcat_safe(query, "[", sizeof(query));
     strcat_safe(query, pn->leaf_name, sizeof(query));
-    strcat_safe(query, "]='", sizeof(query));
-    strcat_safe(query, soap2db(value, param_info[set_param_index].paramType), sizeof(query));
-    strcat_safe(query, "'", sizeof(query));
+    strcat_safe(query, "]=?", sizeof(query));
 
     /* Set config owner to 1 (i.e. user)*/
     strcat_safe(query, ", ", sizeof(query));
@@ -4519,21 +6224,16 @@ static ep_stat_t w_set_value_db(worker_data_t *wd, parsed_param_name_t *pn, obj_
     {
         if (pn->indices[i].type == REQ_IDX_TYPE_EXACT)
         {
-            /* concatenate PARAM=ARG */
+            /* concatenate PARAM=? */
             strcat_safe(query, " AND [", sizeof(query));
             strcat_safe(query, param_info[i].paramName, sizeof(query));
-            strcat_safe(query, "] = ", sizeof(query));
-            sprintf(query+strlen(query), "%d", pn->indices[i].exact_val.num);
+            strcat_safe(query, "] = ?", sizeof(query));
         }
         else if (pn->indices[i].type == REQ_IDX_TYPE_RANGE)
         {
             strcat_safe(query, " AND ([", sizeof(query));
             strcat_safe(query, param_info[i].paramName, sizeof(query));
-            strcat_safe(query, "] BETWEEN ", sizeof(query));
-            sprintf(query+strlen(query), "%d", pn->indices[i].range_val.begin);
-            strcat_safe(query, " AND ", sizeof(query));
-            sprintf(query+strlen(query), "%d", pn->indices[i].range_val.end);
-            strcat_safe(query, " ) ", sizeof(query));
+            strcat_safe(query, "] BETWEEN ? AND ? ) ", sizeof(query));
         }
         else // REQ_IDX_TYPE_ALL: no restriction for that index
         {
@@ -4541,10 +6241,23 @@ static ep_stat_t w_set_value_db(worker_data_t *wd, parsed_param_name_t *pn, obj_
     }
     DBG("%s", query);
 
-    if ((status = ep_db_exec_write_query(dbconn, query, &modified_rows_num)) != EPS_OK)
-        GOTO_RET_WITH_ERROR(status, "Could not execute UPDATE query: %d", status);
+    if (ep_db_stmt_prepare(w_stmt_cache(wd, dbconn), dbconn, query, &stmt) != EPS_OK)
+        GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Couldn't prepare UPDATE stmt: %s",
+                            sqlite3_errmsg(dbconn));
+
+    if ((sqlite3_bind_text(stmt, 1, soap2db(value, param_info[set_param_index].paramType),
+                           -1, SQLITE_TRANSIENT) != SQLITE_OK) ||
+        (w_bind_index_values(stmt, 2, pn, pn->index_num) != EPS_OK))
+        GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Couldn't bind UPDATE stmt values: %s",
+                            sqlite3_errmsg(dbconn));
+
+    res = sqlite3_step(stmt);
+    if ((res != SQLITE_OK) && (res != SQLITE_DONE))
+        GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not execute UPDATE query: err %d - %s",
+                            res, sqlite3_errmsg(dbconn));
 
 ret:
+    ep_db_stmt_release(&wd->stmt_cache, stmt);
     return status;
 }
 
@@ -4604,7 +6317,8 @@ ret:
 }
 
 /* Handler function for processing setParamValue operation in case of
-   "uci" set-style is used for set method                                */
+   "uci" set-style is used for set method. The packages are committed
+   by w_uci_commit at the end of the request                              */
 ep_stat_t w_set_value_uci(worker_data_t *wd, parsed_param_name_t *pn,
                           obj_info_t *obj_info, sqlite3 *dbconn,
                           param_info_t param_info[], int param_num,
@@ -4612,13 +6326,14 @@ ep_stat_t w_set_value_uci(worker_data_t *wd, parsed_param_name_t *pn,
 {
     ep_stat_t status = EPS_OK, status1 = EPS_OK;
     char *idx_params[MAX_INDECES_PER_OBJECT];
-    int  i, res, idx_params_num = 0, idx_values[MAX_INDECES_PER_OBJECT];
+    int  i, idx_params_num = 0, idx_values[MAX_INDECES_PER_OBJECT];
     BOOL more_instance = TRUE, commit_needed = FALSE;
     char buf[EP_SQL_REQUEST_BUF_SIZE];
-    char *filename, *strtok_ctx;
+    char *filename, *strtok_ctx, filenameBuf[MAX_METHOD_STR_LEN];
     parsed_operation_t parsed_uci_str;
     sqlite3_stmt *stmt = NULL;
     char setMethodBuf[MAX_METHOD_STR_LEN] = {0};
+    size_t undo_mark = w_uci_mark(wd);
 
     /* Save index values */
     for (i = 0; i < param_num; i++)
@@ -4630,24 +6345,23 @@ ep_stat_t w_set_value_uci(worker_data_t *wd, parsed_param_name_t *pn,
     /* Save method string before parsing */
     memcpy(setMethodBuf, param_info[set_param_index].setMethod, sizeof(setMethodBuf));
 
-    w_parse_operation_string(OP_SET, (char *)setMethodBuf, &parsed_uci_str);
+    w_get_operation_tpl(wd, OP_SET, (char *)setMethodBuf, &parsed_uci_str);
 
     DBG("Value for setting: %s", value);
 
-    /*Determine name of uci config file */
-    filename = strtok_r(parsed_uci_str.command, ".", &strtok_ctx);
+    /*Determine name of uci config file (the parsed command is not modified) */
+    strcpy_safe(filenameBuf, parsed_uci_str.command, sizeof(filenameBuf));
+    filename = strtok_r(filenameBuf, ".", &strtok_ctx);
     if (!filename || (strlen(trim(filename)) == 0))
         GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not determine uci file name for param");
 
     i = 0;
     while (more_instance == TRUE)
     {
-        /* Prepare shell command (with all needed info) and perform it */
-        memset(buf, 0, sizeof(buf));
-        strcpy_safe(buf, "uci set ", sizeof(buf));
+        /* Prepare uci option name (with all needed info) and set it */
         status1 = w_prepare_command(wd, pn, obj_info, dbconn, &parsed_uci_str,
                                         idx_params, idx_values, idx_params_num,
-                                        (char*)&(buf)+strlen(buf), sizeof(buf)-strlen(buf), &stmt);
+                                        buf, sizeof(buf), &stmt);
         if (status1 != EPS_OK)
         {
             if (status1 != EPS_NOTHING_DONE)
@@ -4657,17 +6371,9 @@ ep_stat_t w_set_value_uci(worker_data_t *wd, parsed_param_name_t *pn,
             continue;
         }
 
-        strcat_safe(buf, "='", sizeof(buf));    //value is placed in quotes
-        strcat_safe(buf, value, sizeof(buf));
-        strcat_safe(buf, "'", sizeof(buf));
-        strcat_safe(buf, " 2>/dev/null", sizeof(buf));
-        DBG("Prepared command (%d): \n\t%s", ++i, buf);
-
-        res = system(buf);
-        if (res)
+        DBG("uci set (%d)", ++i);
+        if (w_uci_set(wd, buf, value) != EPS_OK)
         {
-
-            ERROR("Could not execute uci set command. Error 0x%x", res);
             status = EPS_SYSTEM_ERROR;
             break;
         }
@@ -4691,34 +6397,16 @@ ep_stat_t w_set_value_uci(worker_data_t *wd, parsed_param_name_t *pn,
 
     } //End of while stmt over instances
 
-    /* Check results of operation and perform uci commit or revert if needed */
-    memset(buf, 0, sizeof(buf));
-    if (commit_needed)
-    {
-        if (status == EPS_OK)
-            strcpy_safe(buf, "uci commit ", sizeof(buf));
-        else
-            strcpy_safe(buf, "uci revert ", sizeof(buf));
-
-        strcat_safe(buf, filename, sizeof(buf));
-        DBG( "uci command: %s", buf);
-
-        res = system(buf);
-        if (res)
-        {
-             /* It is almost impossible case. */
-             GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not execute uci commit or revert. Error 0x%x", res);
-        }
-        else
-        {
-            if (status == EPS_OK)
-                *p_set_status = 1;  //backend restart is always needed after uci set and commit
-        }
-    }
+    /* The packages are committed once by the request (w_uci_commit) */
+    if (commit_needed && (status == EPS_OK))
+        *p_set_status = 1;  //backend restart is always needed after uci set and commit
 
 ret:
+    /* Options of the failed parameter are restored */
+    if (status != EPS_OK)
+        w_uci_rollback(wd, undo_mark);
 
-    if (stmt) sqlite3_finalize(stmt);
+    ep_db_stmt_release(&wd->stmt_cache, stmt);
     return status;
 }
 
@@ -4734,6 +6422,7 @@ ep_stat_t w_set_value_ubus(worker_data_t *wd, parsed_param_name_t *pn,
     int  i, idx_params_num = 0;
     char buf[EP_SQL_REQUEST_BUF_SIZE], query[EP_SQL_REQUEST_BUF_SIZE];
     char setMethodBuf[MAX_METHOD_STR_LEN] = {0};
+    char *result;
     parsed_operation_t parsed_ubus_str;
 
     sqlite3 *conn = NULL;
@@ -4749,14 +6438,14 @@ ep_stat_t w_set_value_ubus(worker_data_t *wd, parsed_param_name_t *pn,
     /* Save method string before parsing */
     memcpy(setMethodBuf, param_info[set_param_index].setMethod, sizeof(setMethodBuf));
 
-    w_parse_operation_string(OP_SET, (char *)setMethodBuf, &parsed_ubus_str);
+    w_get_operation_tpl(wd, OP_SET, (char *)setMethodBuf, &parsed_ubus_str);
 
     w_form_subst_sql_select(wd, pn, obj_info, query, sizeof(query), idx_params, idx_params_num, &parsed_ubus_str);
 
     conn = wd->main_conn;
     DBG("query:\n%s", query);
 
-    if (sqlite3_prepare_v2(conn, query, -1, &stmt, NULL) != SQLITE_OK)
+    if (w_prepare_idx_stmt(wd, conn, query, pn, idx_params_num, &stmt) != EPS_OK)
         GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not prepare SQL statement: %s", sqlite3_errmsg(conn));
 
     while (TRUE)
@@ -4765,13 +6454,13 @@ ep_stat_t w_set_value_ubus(worker_data_t *wd, parsed_param_name_t *pn,
 
         if (res == SQLITE_ROW)
         {
-            strcpy_safe(buf, "ubus call ", sizeof(buf));
-            w_form_call_str(buf+strlen(buf), sizeof(buf), &parsed_ubus_str, stmt, idx_params_num);
-            DBG("%s", buf);
+            w_form_call_str(buf, sizeof(buf), &parsed_ubus_str, stmt, idx_params_num);
+            DBG("%s%s", W_UBUS_CALL_CMD, buf);
             //TODO - add code to insert the set value to the prepared command string
 
-            status = system(buf);
-            if (status)
+            status = w_ubus_call(wd, buf, &result);
+            free(result);
+            if (status != EPS_OK)
                 GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not execute ubus");
         }
         else if (res == SQLITE_DONE)
@@ -4781,7 +6470,7 @@ ep_stat_t w_set_value_ubus(worker_data_t *wd, parsed_param_name_t *pn,
     }
 
 ret:
-    if (stmt) sqlite3_finalize(stmt);
+    ep_db_stmt_release(&wd->stmt_cache, stmt);
     return status;
 }
 
@@ -4813,7 +6502,7 @@ ep_stat_t w_set_value_script(worker_data_t *wd, parsed_param_name_t *pn,
     /* Save method string before parsing */
     memcpy(setMethodBuf, setMethod, sizeof(setMethodBuf));
 
-    w_parse_operation_string(OP_SET, (char *)setMethodBuf, &parsed_script_str);
+    w_get_operation_tpl(wd, OP_SET, (char *)setMethodBuf, &parsed_script_str);
 
     paramName = param_info[set_param_index].paramName;
 
@@ -4888,7 +6577,7 @@ ep_stat_t w_set_value_script(worker_data_t *wd, parsed_param_name_t *pn,
     } //End of while stmt over instances
 
 ret:
-    if (stmt) sqlite3_finalize(stmt);
+    ep_db_stmt_release(&wd->stmt_cache, stmt);
     return status;
 }
 
@@ -5025,7 +6714,7 @@ ep_stat_t w_set_value_shell(worker_data_t *wd, parsed_param_name_t *pn,
     } /* End of while stmt over instances */
 
 ret:
-    if (stmt) sqlite3_finalize(stmt);
+    ep_db_stmt_release(&wd->stmt_cache, stmt);
     return status;
 }
 
@@ -5142,7 +6831,7 @@ ep_stat_t w_set_value_backend( worker_data_t *wd, parsed_param_name_t *pn,
 
     DBG("Backend '%s': port %d", obj_info->backEndName, be_port);
 
-    w_parse_backend_method_string(OP_SET, (char *)setMethodBuf, &parsed_method);
+    w_get_backend_method_tpl(wd, OP_SET, (char *)setMethodBuf, &parsed_method);
 
     if (idx_params_num > 0)
     {
@@ -5150,7 +6839,7 @@ ep_stat_t w_set_value_backend( worker_data_t *wd, parsed_param_name_t *pn,
                                         idx_params_num, &parsed_method);
         DBG("Subst query:\n%s", query);
 
-        if (sqlite3_prepare_v2(dbconn, query, -1, &stmt, NULL) != SQLITE_OK)
+        if (w_prepare_idx_stmt(wd, dbconn, query, pn, idx_params_num, &stmt) != EPS_OK)
             GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not prepare SQL statement: %s",
                                 sqlite3_errmsg(dbconn));
     }
@@ -5196,7 +6885,7 @@ ep_stat_t w_set_value_backend( worker_data_t *wd, parsed_param_name_t *pn,
     }
 
 ret:
-    if (stmt) sqlite3_finalize(stmt);
+    ep_db_stmt_release(&wd->stmt_cache, stmt);
 
     return status;
 }
@@ -5248,7 +6937,9 @@ static ep_stat_t w_handle_setvalue(worker_data_t *wd, ep_message_t *message)
     int setStatus = 0, total_setStatus = 0, minFaultCode = 0;
     int obj_num, param_num, setStyle = 0;
     int restart_be[MAX_BACKEND_NUM];
-    BOOL mmx_own_params = FALSE, dbSave = FALSE;
+    int uci_first = -1, uci_failed = -1, uci_restart[MAX_BACKEND_NUM];
+    BOOL mmx_own_params = FALSE, dbSave = FALSE, uci_savepoint;
+    w_uci_objs_t uci_objs;
 
     obj_info_t           obj_info[1];
     param_info_t         param_info[MAX_PARAMS_PER_OBJECT];
@@ -5268,6 +6959,10 @@ static ep_stat_t w_handle_setvalue(worker_data_t *wd, ep_message_t *message)
     answer.header.msgType = MSGTYPE_SETVALUE_RESP;
 
     memset((char *)&restart_be, 0, sizeof(restart_be));
+    for (j = 0; j < MAX_BACKEND_NUM; j++)
+        uci_restart[j] = -1;
+    uci_objs.num = 0;
+    uci_objs.all = FALSE;
 
     if (operAllowedForDbType(OP_SET, message->header.mmxDbType) != TRUE)
     {
@@ -5304,11 +6999,15 @@ static ep_stat_t w_handle_setvalue(worker_data_t *wd, ep_message_t *message)
         status = EPS_OK;
         setStatus = 0;
         set_param_index = -1;
+        uci_savepoint = FALSE;
         prev_fault_arrsize = answer.body.setParamValueFaultResponse.arraySize;
         p_setPairs = (nvpair_t *)&message->body.setParamValue.paramValues;
 
         /* Parse request string: extract object name, parameter name, arguments provided*/
-        if ((status = parse_param_name(p_setPairs[i].name, &pn)) != EPS_OK)
+        status = W_PNAME_CACHE_USE(message->body.setParamValue.arraySize) ?
+                 w_parse_param_name(wd, p_setPairs[i].name, &pn) :
+                 parse_param_name(p_setPairs[i].name, &pn);
+        if (status != EPS_OK)
         {
             status = EPS_INVALID_FORMAT;
             ERROR("Could not parse object and parameter name %s", p_setPairs[i].name);
@@ -5408,6 +7107,27 @@ static ep_stat_t w_handle_setvalue(worker_data_t *wd, ep_message_t *message)
                      mmx_own_params ? "true" : "false", setStyle, dbSave);
         }
 
+        /* The uci changes of the preceding parameters are committed before
+           a parameter of another set style is processed; the request stops
+           on the parameter which uci changes failed */
+        if ((uci_first >= 0) &&
+            ((status != EPS_OK) || mmx_own_params || (setStyle != OP_STYLE_UCI)))
+        {
+            status1 = w_uci_commit_params(wd, dbconn, uci_first, &uci_objs, uci_restart,
+                                          restart_be, &uci_failed);
+            uci_first = -1;
+            if (status1 != EPS_OK)
+                break;
+        }
+
+        if ((status == EPS_OK) && !mmx_own_params && (setStyle == OP_STYLE_UCI) &&
+            ((status = w_uci_savepoint(dbconn, "SAVEPOINT", i)) == EPS_OK))
+        {
+            uci_savepoint = TRUE;
+            if (uci_first < 0)
+                uci_first = i;
+        }
+
         /* Call per-style handler functions to perform SetParamValue operation */
         if (status == EPS_OK)
         {
@@ -5422,6 +7142,8 @@ static ep_stat_t w_handle_setvalue(worker_data_t *wd, ep_message_t *message)
                 case OP_STYLE_UCI:
                     status = w_set_value_uci(wd, &pn, obj_info, dbconn, param_info, param_num,
                                                 set_param_index, p_setPairs[i].pValue, &setStatus);
+                    w_uci_end_param(wd, i);
+                    w_uci_objs_add(&uci_objs, obj_info->objName);
                     break;
                 case OP_STYLE_SCRIPT:
                     status = w_set_value_script(wd, &pn, obj_info, dbconn, param_info, param_num,
@@ -5443,6 +7165,9 @@ static ep_stat_t w_handle_setvalue(worker_data_t *wd, ep_message_t *message)
                     ERROR("unknown set operation style %d", param_info[set_param_index].setOperStyle);
                     status = EPS_NOT_IMPLEMENTED;
                 }
+
+                /* Cached values of the object may be changed by the operation */
+                ep_valcache_invalidate(obj_info->objName);
             }
             else
             {
@@ -5460,7 +7185,13 @@ static ep_stat_t w_handle_setvalue(worker_data_t *wd, ep_message_t *message)
             {
                 total_setStatus = 1;
                 if ((j = ep_common_get_beinfo_index(obj_info->backEndName)) >= 0)
-                    restart_be[j] = TRUE;
+                {
+                    /* uci changes are restarted after they are committed */
+                    if (setStyle != OP_STYLE_UCI)
+                        restart_be[j] = TRUE;
+                    else if (uci_restart[j] < 0)
+                        uci_restart[j] = i;
+                }
             }
 
             /* Update values DB (for not DB or SCRIPT or SHELL_SCRIPT styles,
@@ -5502,12 +7233,47 @@ static ep_stat_t w_handle_setvalue(worker_data_t *wd, ep_message_t *message)
                      answer.body.setParamValueFaultResponse.arraySize);
             }
 
+            /* Values DB changes of the failed uci parameter are rolled back */
+            if (uci_savepoint)
+            {
+                w_uci_savepoint(dbconn, "ROLLBACK TO", i);
+                if (uci_first == i)
+                {
+                    w_uci_savepoint(dbconn, "RELEASE", i);
+                    uci_first = -1;
+                }
+            }
+
             /* Set failed - don't continue to process other parameters*/
             break;
         }
 
     }  // End of for stmt over received parameters
 
+    /* Write uci packages changed by the parameters */
+    if (uci_first >= 0)
+    {
+        status1 = w_uci_commit_params(wd, dbconn, uci_first, &uci_objs, uci_restart,
+                                      restart_be, &uci_failed);
+    }
+
+    /* The parameter which uci changes failed */
+    if (uci_failed >= 0)
+    {
+        ERROR("Could not commit uci changes (status %d)", status1);
+        if (total_status == EPS_OK)
+            total_status = status1;
+
+        s = answer.body.setParamValueFaultResponse.arraySize;
+        pFault = &answer.body.setParamValueFaultResponse.paramFaults[s];
+        strcpy_safe(pFault->name, p_setPairs[uci_failed].name, sizeof(pFault->name));
+        pFault->faultcode = w_status2cwmp_error(status1);
+        answer.body.setParamValueFaultResponse.arraySize++;
+
+        DBG("uci SET failed for %s; faultcode %d, index %d",
+            pFault->name, pFault->faultcode, s);
+    }
+
     if (message->header.mmxDbType == MMXDBTYPE_RUNNING)
     {
         if ((dbSave == TRUE) && (total_status == EPS_OK) &&
@@ -5836,7 +7602,9 @@ static ep_stat_t w_do_instance_object(worker_data_t *wd,
     sqlite3_stmt   *selIdxStmt  = NULL;
     int idx_params_num = 0, idx_row = 0;
     char *idx_params[MAX_INDECES_PER_OBJECT];
-    int current_values[MAX_INSTANCES_PER_OBJECT][MAX_INDECES_PER_OBJECT] = {{0}};
+    int (*current_values)[MAX_INDECES_PER_OBJECT];
+    const size_t values_size = MAX_INSTANCES_PER_OBJECT * sizeof(*current_values);
+    size_t arena_mark = w_arena_mark(wd);
     int current_num_values = 0;
     int current_num_idx = 0;
     int idx_values[MAX_INDECES_PER_OBJECT] = {0};
@@ -5856,6 +7624,10 @@ static ep_stat_t w_do_instance_object(worker_data_t *wd,
         }
     }
 
+    if ((current_values = w_arena_alloc(wd, values_size)) == NULL)
+        GOTO_RET_WITH_ERROR(EPS_OUTOFMEMORY, "Could not allocate instance indexes");
+    memset(current_values, 0, values_size);
+
     /* Prepare sqlite statement to select needed instanses of the object */
     status =  w_prepare_stmt_instances(pn, param_info, param_num, vdb_conn,
                              obj_info->objValuesTblName, &index_num, &selIdxStmt);
@@ -5907,7 +7679,7 @@ static ep_stat_t w_do_instance_object(worker_data_t *wd,
                     w_insert_multi_instance_root_object_to_answer(answer, obj_info, index_num, previous_values[i]);
                 }
             }
-            memcpy(previous_values, current_values, sizeof(current_values));
+            memcpy(previous_values, current_values, values_size);
             *previous_num_values = 0;
             *previous_num_idx = 0;
             goto ret;
@@ -6002,7 +7774,7 @@ static ep_stat_t w_do_instance_object(worker_data_t *wd,
         }
 
         /* Keep values for next step*/
-        memcpy(previous_values, current_values, sizeof(current_values));
+        memcpy(previous_values, current_values, values_size);
         *previous_num_values = current_num_values;
         *previous_num_idx = current_num_idx;
 
@@ -6022,6 +7794,7 @@ ret:
         sqlite3_finalize(selIdxStmt);
         selIdxStmt = NULL;
     }
+    w_arena_release(wd, arena_mark);
     DBG("Response %d (last): %d of %d objects processed, %d instances, %d elements were sent",
          ++resp_cnt, obj_cnt, total_cnt, inst_cnt, answer->body.getParamNamesResponse.arraySize );
     return status;
@@ -6038,7 +7811,8 @@ static ep_stat_t w_handle_getparamnames(worker_data_t *wd, ep_message_t *message
     sqlite3        *vdb_conn = NULL;
     sqlite3_stmt   *stmt = NULL;
     char count_query[EP_SQL_REQUEST_BUF_SIZE] = {0};
-    int previous_values[MAX_INSTANCES_PER_OBJECT][MAX_INDECES_PER_OBJECT];
+    int (*previous_values)[MAX_INDECES_PER_OBJECT] = NULL;
+    size_t arena_mark = w_arena_mark(wd);
     int previous_num_values = 0;
     int previous_num_idx = 0;
 
@@ -6046,7 +7820,7 @@ static ep_stat_t w_handle_getparamnames(worker_data_t *wd, ep_message_t *message
     answer.header.respFlag = 1;
     answer.header.msgType = MSGTYPE_GETPARAMNAMES_RESP;
 
-    if ((status = parse_param_name(message->body.getParamNames.pathName, &pn)) != EPS_OK)
+    if ((status = w_parse_param_name(wd, message->body.getParamNames.pathName, &pn)) != EPS_OK)
         GOTO_RET_WITH_ERROR(status, "Could not parse name");
 
     /* Special case: empty name means the top hierarchy name */
@@ -6065,13 +7839,21 @@ static ep_stat_t w_handle_getparamnames(worker_data_t *wd, ep_message_t *message
 
     vdb_conn = wd->main_conn;
 
-    /* Prepare query*/
-    sprintf(count_query, "%s WHERE ObjName like '%s%%'", "MMX_Objects_InfoTbl", pn.obj_name);
-    /* Get number of objects in MMX_Objects_Info_Tbl*/
-    if ((status = ep_db_get_tbl_row_count(wd->mdb_conn, count_query,
-                                          &objects_count)) != EPS_OK)
-        GOTO_RET_WITH_ERROR(status, "Couldn't get objects count (error %d)", status);
-        
+    if (wd->model)
+    {
+        /* Objects are taken from the management model cache */
+        objects_count = ep_model_count_prefix_objs(wd->model, pn.obj_name);
+    }
+    else
+    {
+        /* Prepare query*/
+        sprintf(count_query, "%s WHERE ObjName like '%s%%'", "MMX_Objects_InfoTbl", pn.obj_name);
+        /* Get number of objects in MMX_Objects_Info_Tbl*/
+        if ((status = ep_db_get_tbl_row_count(wd->mdb_conn, NULL, count_query,
+                                              &objects_count)) != EPS_OK)
+            GOTO_RET_WITH_ERROR(status, "Couldn't get objects count (error %d)", status);
+    }
+
     DBG("Objects %d", objects_count);
 
     /* Allocate memory for objects struct*/
@@ -6083,8 +7865,31 @@ static ep_stat_t w_handle_getparamnames(worker_data_t *wd, ep_message_t *message
     }
     memset(obj_info, 0, sizeof(obj_info_t) * objects_count);
 
+    previous_values = w_arena_alloc(wd, MAX_INSTANCES_PER_OBJECT * sizeof(*previous_values));
+    if (!previous_values)
+        GOTO_RET_WITH_ERROR(EPS_OUTOFMEMORY, "Could not allocate instance indexes");
+
+    if (wd->model)
+    {
+        const ep_model_obj_t *obj;
+
+        if (pn.partial_path && !message->body.getParamNames.nextLevel)
+        {
+            ep_model_iter_t it;
+            int i;
+
+            /* All subsidiary objects in the management model */
+            ep_model_iter_init(&it, wd->model, pn.obj_name);
+            while (current_object < objects_count && (i = ep_model_iter_next(&it)) >= 0)
+                obj_info[current_object++] = wd->model->objs[i].info;
+
+            strcat_safe(pn.obj_name, "%", sizeof(pn.obj_name));
+        }
+        else if ((obj = ep_model_find_obj(wd->model, pn.obj_name)) != NULL && objects_count > 0)
+            obj_info[current_object++] = obj->info;
+    }
     /* Prepare SQL stmt to get list of all subsidairy objects */
-    if (pn.partial_path && !message->body.getParamNames.nextLevel)
+    else if (pn.partial_path && !message->body.getParamNames.nextLevel)
     {
         stmt = wd->stmt_get_obj_list;
         strcat_safe(pn.obj_name, "%", sizeof(pn.obj_name));
@@ -6093,17 +7898,21 @@ static ep_stat_t w_handle_getparamnames(worker_data_t *wd, ep_message_t *message
     {
         stmt = wd->stmt_get_obj_info;
     }
-    res = sqlite3_bind_text(stmt, 1, pn.obj_name, -1, SQLITE_STATIC);
-    if (res != SQLITE_OK)
-        GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not bind obj name %s to prepared stmt (%d)",
-                            pn.obj_name, res);
 
-    /* Go over all subsidairy objects in the management model */
-    while (sqlite3_step(stmt) == SQLITE_ROW)
+    if (stmt)
     {
-        fill_obj_info(stmt, &obj_info[current_object]);
-        current_object++;
-    } //End of while cycle over all objects
+        res = sqlite3_bind_text(stmt, 1, pn.obj_name, -1, SQLITE_STATIC);
+        if (res != SQLITE_OK)
+            GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not bind obj name %s to prepared stmt (%d)",
+                                pn.obj_name, res);
+
+        /* Go over all subsidairy objects in the management model */
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            fill_obj_info(stmt, &obj_info[current_object]);
+            current_object++;
+        } //End of while cycle over all objects
+    }
 
     for (int i = 0; i < objects_count; i++)
     {
@@ -6133,8 +7942,9 @@ static ep_stat_t w_handle_getparamnames(worker_data_t *wd, ep_message_t *message
 ret:
 
     free(obj_info);
+    w_arena_release(wd, arena_mark);
 
-    if (sqlite3_reset(stmt) != SQLITE_OK)
+    if (stmt && sqlite3_reset(stmt) != SQLITE_OK)
         ERROR("Could not reset sql statement: %s", sqlite3_errmsg(wd->mdb_conn));
 
     answer.header.respCode = w_status2cwmp_error(status);
@@ -6238,7 +8048,7 @@ static ep_stat_t w_prepare_addobj_command(
     }
 
 ret:
-    if (stmt) sqlite3_finalize(stmt);
+    ep_db_stmt_release(&wd->stmt_cache, stmt);
     return status;
 }
 
@@ -7246,7 +9056,7 @@ ep_stat_t w_addobj_autocreate_recursively(worker_data_t *wd,
 
         /* Check Dependent Object - parse the Object name */
         memset(&next_obj_pn, 0, sizeof(parsed_param_name_t));
-        status = parse_param_name(curr_obj_depInfo[i].childObjName, &next_obj_pn);
+        status = w_parse_param_name(wd, curr_obj_depInfo[i].childObjName, &next_obj_pn);
         if (status != EPS_OK)
         {
             RECURSLEVEL_WARN("==> Dependency [L%d, %d of %d] is invalid - ignored",
@@ -7435,7 +9245,7 @@ ep_stat_t w_addobj_autocreate_recursively(worker_data_t *wd,
          */
 
         /* Check Object instance number limit */
-        if ((status = ep_db_get_tbl_row_count(conn, next_obj_info->objValuesTblName,
+        if ((status = ep_db_get_tbl_row_count(conn, w_stmt_cache(wd, conn), next_obj_info->objValuesTblName,
                                               &rowCount)) != EPS_OK)
         {
             RECURSLEVEL_ERROR("==> Failed to get row count in dependent Object DB table %s (%d)",
@@ -7549,7 +9359,7 @@ ep_stat_t w_addobj_autocreate_recursively(worker_data_t *wd,
                         curr_obj_depInfo[i].childParamName, NVP_MAX_NAME_LEN);
             /* To add dependency parameter value (of dependent Object) we run
              *  SQL query to fetch it from Current Object instance */
-            status = ep_db_get_tbl_row_column(conn, curr_obj_info->objValuesTblName,
+            status = ep_db_get_tbl_row_column(conn, w_stmt_cache(wd, conn), curr_obj_info->objValuesTblName,
                                curr_obj_idx_params_num, curr_obj_idx_params, curr_obj_indexvalues->indexvalues,
                                (char *)curr_obj_depInfo[i].parentParamName, (char *)&pValue, sizeof(pValue));
             if (status != EPS_OK)
@@ -7735,7 +9545,7 @@ static ep_stat_t w_handle_addobject(worker_data_t *wd, ep_message_t *message)
 
     conn = wd->main_conn;
 
-    if ((status = parse_param_name(message->body.addObject.objName, &pn)) != EPS_OK)
+    if ((status = w_parse_param_name(wd, message->body.addObject.objName, &pn)) != EPS_OK)
         GOTO_RET_WITH_ERROR(status, "Could not parse name");
 
     pn.partial_path = FALSE;
@@ -7760,7 +9570,7 @@ static ep_stat_t w_handle_addobject(worker_data_t *wd, ep_message_t *message)
     if (w_get_param_info(wd, &pn, &obj_info, 0, param_info, &param_num, NULL) != EPS_OK)
         GOTO_RET_WITH_ERROR(EPS_INVALID_ARGUMENT, "Could not retrieve parameters info for object %s", pn.obj_name);
 
-    if ((status = ep_db_get_tbl_row_count(conn, obj_info.objValuesTblName,
+    if ((status = ep_db_get_tbl_row_count(conn, w_stmt_cache(wd, conn), obj_info.objValuesTblName,
                                           &rowCount)) != EPS_OK)
         GOTO_RET_WITH_ERROR(status, "Couldn't get row count in %s (%d)", obj_info.objValuesDbName, status);
 
@@ -7807,6 +9617,9 @@ static ep_stat_t w_handle_addobject(worker_data_t *wd, ep_message_t *message)
             break;
     }
 
+    /* Cached values of the object and its sub-objects may be changed */
+    ep_valcache_invalidate(obj_info.objName);
+
     if (status == EPS_OK)
     {
         /* Initialize auto_add_objects structure to run autoCreate recursion */
@@ -8127,7 +9940,7 @@ static ep_stat_t w_delobject_script(worker_data_t *wd, ep_message_t *message,
         DBG("%d of %d delete operations completed successfully",success_cnt,total_cnt);
 
 ret:
-    if (stmt) sqlite3_finalize(stmt);
+    ep_db_stmt_release(&wd->stmt_cache, stmt);
     return status;
 }
 
@@ -8176,7 +9989,7 @@ static ep_stat_t w_delobject_backend(worker_data_t *wd, ep_message_t *message,
         GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not prepare subst sql query for obj %s",
                             obj_info->objName);
 
-    if (sqlite3_prepare_v2(dbconn, query, -1, &stmt, NULL) != SQLITE_OK)
+    if (w_prepare_idx_stmt(wd, dbconn, query, pn, idx_params_num, &stmt) != EPS_OK)
         GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not prepare SQL statement: %s",
                                             sqlite3_errmsg(dbconn));
     while (more_instance)
@@ -8226,7 +10039,7 @@ static ep_stat_t w_delobject_backend(worker_data_t *wd, ep_message_t *message,
     } // End of while (more_instance)
 
 ret:
-    if (stmt) sqlite3_finalize(stmt);
+    ep_db_stmt_release(&wd->stmt_cache, stmt);
 
     if (status != EPS_OK)
         DBG("DELOBJ operation failed (status = %d)", status);
@@ -8374,7 +10187,7 @@ static ep_stat_t w_delobject_script(worker_data_t *wd, sqlite3 *dbconn,
     *delStatus = 0;
 
     strcpy_safe(objName, obj_info->objName, sizeof(objName));
-    status = parse_param_name(objName, &pn);
+    status = w_parse_param_name(wd, objName, &pn);
     if (status != EPS_OK)
     {
         GOTO_RET_WITH_ERROR(status, "Could not parse object name: %s", objName);
@@ -8500,7 +10313,7 @@ static ep_stat_t w_delobject_backend(worker_data_t *wd, sqlite3 *dbconn,
     char *delMethod;
 
     strcpy_safe(objName, obj_info->objName, sizeof(objName));
-    status = parse_param_name(objName, &pn);
+    status = w_parse_param_name(wd, objName, &pn);
     if (status != EPS_OK)
     {
         GOTO_RET_WITH_ERROR(status, "Could not parse object name: %s", objName);
@@ -8549,7 +10362,7 @@ static ep_stat_t w_delobject_backend(worker_data_t *wd, sqlite3 *dbconn,
             GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not prepare subst sql query for obj %s"
                                 "(instance %d of %d)", obj_info->objName, i+1, inst_num);
 
-        if (sqlite3_prepare_v2(dbconn, query, -1, &stmt, NULL) != SQLITE_OK)
+        if (w_prepare_idx_stmt(wd, dbconn, query, &pn, idx_num, &stmt) != EPS_OK)
             GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not prepare SQL statement: %s",
                                                 sqlite3_errmsg(dbconn));
 
@@ -8622,13 +10435,13 @@ static ep_stat_t w_delobject_backend(worker_data_t *wd, sqlite3 *dbconn,
 
         if (stmt)
         {
-            sqlite3_finalize(stmt);
+            ep_db_stmt_release(&wd->stmt_cache, stmt);
             stmt = NULL;
         }
     } /* End of for ( over deleted Object instances ) */
 
 ret:
-    if (stmt) sqlite3_finalize(stmt);
+    ep_db_stmt_release(&wd->stmt_cache, stmt);
 
     /* Print the summary */
     DBG("Results (status %d):\n\t%d instances were requested to be deleted\n\t"
@@ -8870,7 +10683,7 @@ ep_stat_t w_delobj_autodelete_recursively(worker_data_t *wd,
 
         /* Check Dependent Object - parse the Object name */
         memset(&next_obj_pn, 0, sizeof(parsed_param_name_t));
-        status = parse_param_name(curr_obj_depInfo[i].childObjName, &next_obj_pn);
+        status = w_parse_param_name(wd, curr_obj_depInfo[i].childObjName, &next_obj_pn);
         if (status != EPS_OK)
         {
             RECURSLEVEL_WARN("==> Dependency [L%d, %d of %d] is invalid - ignored",
@@ -8993,7 +10806,7 @@ ep_stat_t w_delobj_autodelete_recursively(worker_data_t *wd,
              * Fetch DB instances of the dependent Object with prepared where_cond
              * In case of failure - stop and return the error
              */
-            status = ep_db_get_tbl_row_indexes(conn, next_obj_info->objValuesTblName,
+            status = ep_db_get_tbl_row_indexes(conn, w_stmt_cache(wd, conn), next_obj_info->objValuesTblName,
                            next_obj_pn.index_num, idx_params, &(next_obj_pn.indices[0]),
                            where_cond, next_obj_indexset);
             if (status != EPS_OK)
@@ -9111,6 +10924,8 @@ delete_curr_obj_instances:
                        &(auto_del_objects.obj_indexvalues_set[level]), &delStatus);
             break;
     }
+
+    ep_valcache_invalidate(curr_obj_info->objName);
     if (status != EPS_OK)
     {
         RECURSLEVEL_ERROR("DelObject failed for Object %s (status %d)",
@@ -9202,7 +11017,7 @@ static ep_stat_t w_handle_delobject(worker_data_t *wd, ep_message_t *message)
     req_size = message->body.delObject.arraySize;
     for (i = 0; i < req_size; i++)
     {
-        if ((status = parse_param_name(message->body.delObject.objects[i], &pn)) != EPS_OK)
+        if ((status = w_parse_param_name(wd, message->body.delObject.objects[i], &pn)) != EPS_OK)
             GOTO_RET_WITH_ERROR(status, "Could not parse object name: %s", message->body.delObject.objects[i]);
 
         if (w_get_obj_info(wd, &pn, 1, 0, obj_info, 1, &obj_num) != EPS_OK)
@@ -9230,7 +11045,7 @@ static ep_stat_t w_handle_delobject(worker_data_t *wd, ep_message_t *message)
         get_index_param_names(param_info, param_num, idx_params, &idx_params_num);
 
         /* Fetch Object instances (only index values) from the DB */
-        status = ep_db_get_tbl_row_indexes(conn, obj_info[0].objValuesTblName, pn.index_num,
+        status = ep_db_get_tbl_row_indexes(conn, w_stmt_cache(wd, conn), obj_info[0].objValuesTblName, pn.index_num,
                        idx_params, &(pn.indices[0]), NULL, &(auto_del_objects.obj_indexvalues_set[0]));
         if (status != EPS_OK)
         {
@@ -9299,6 +11114,9 @@ static ep_stat_t w_handle_delobject(worker_data_t *wd, ep_message_t *message)
                 break;
         }
 
+        /* Cached values of the object and its sub-objects may be changed */
+        ep_valcache_invalidate(obj_info[0].objName);
+
         if (status == EPS_OK)
         {
             success_cnt++;
@@ -10367,7 +12185,7 @@ static ep_stat_t w_getall_updobj_in_be_script( worker_data_t *wd, obj_info_t *ob
 
     memcpy((char *)method_str, obj_info->setMethod, sizeof(method_str));
 
-    status = w_parse_operation_string(OP_SET, method_str, &parsed_script_method);
+    status = w_get_operation_tpl(wd, OP_SET, method_str, &parsed_script_method);
 
     if (status != EPS_OK)
         GOTO_RET_WITH_ERROR(EPS_GENERAL_ERROR,"Could not parse script set method for obj %s",
@@ -10418,7 +12236,7 @@ static ep_stat_t w_getall_updobj_in_be_script( worker_data_t *wd, obj_info_t *ob
     }
 
 ret:
-    if (stmt) sqlite3_finalize(stmt);
+    ep_db_stmt_release(&wd->stmt_cache, stmt);
 
     return status;
 }
@@ -10447,7 +12265,7 @@ static ep_stat_t w_getall_updobj_in_be_backend(worker_data_t *wd, obj_info_t *ob
 
     memcpy((char *)method_str, obj_info->setMethod, sizeof(method_str));
 
-    status = w_parse_backend_method_string(OP_SET, method_str, &parsed_be_method);
+    status = w_get_backend_method_tpl(wd, OP_SET, method_str, &parsed_be_method);
     if (status != EPS_OK)
         GOTO_RET_WITH_ERROR(EPS_GENERAL_ERROR, "Could not parse BE set method for obj %s",
                                                           obj_info->objName);
@@ -10463,7 +12281,7 @@ static ep_stat_t w_getall_updobj_in_be_backend(worker_data_t *wd, obj_info_t *ob
                                         idx_params, idx_params_num, &parsed_be_method);
         DBG("Subst query:\n%s", query);
 
-        if (sqlite3_prepare_v2(dbconn, query, -1, &stmt, NULL) != SQLITE_OK)
+        if (w_prepare_idx_stmt(wd, dbconn, query, pn, idx_params_num, &stmt) != EPS_OK)
             GOTO_RET_WITH_ERROR(EPS_SQL_ERROR,"Could not prepare SQL statement: %s", sqlite3_errmsg(dbconn));
     }
 
@@ -10504,7 +12322,7 @@ static ep_stat_t w_getall_updobj_in_be_backend(worker_data_t *wd, obj_info_t *ob
     }
 
 ret:
-   if (stmt) sqlite3_finalize(stmt);
+   ep_db_stmt_release(&wd->stmt_cache, stmt);
 
    return status;
 }
@@ -10523,7 +12341,8 @@ static ep_stat_t w_getall_updobj_in_be(worker_data_t *wd, obj_info_t *obj_info,
 {
     ep_stat_t status = EPS_OK;
     int i, j, c, cnt = 0, cfg_param_num = MAX_PARAMS_PER_OBJECT;
-    int                   inst_num = 0, beRestartNeeded = 0;
+    int                   inst_num = 0, beRestartNeeded = 0, uci_failed;
+    BOOL                  uciRestartNeeded = FALSE;
     oper_style_t          objSetStyle, paramSetStyle;
     nvpair_t              cfg_nvpairs[MAX_PARAMS_PER_OBJECT];
     int                   cfg_param_idx[MAX_PARAMS_PER_OBJECT];
@@ -10651,6 +12470,10 @@ static ep_stat_t w_getall_updobj_in_be(worker_data_t *wd, obj_info_t *obj_info,
                 case OP_STYLE_UCI:
                     status = w_set_value_uci(wd, &pn, obj_info, conn, param_info, param_num,
                                              c, cfg_nvpairs[j].pValue, &beRestartNeeded);
+                    /* The backend is restarted after the uci changes are committed */
+                    if (beRestartNeeded > 0)
+                        uciRestartNeeded = TRUE;
+                    beRestartNeeded = 0;
                     break;
                 case OP_STYLE_UBUS: /* currently not used */
                     status = w_set_value_ubus(wd, &pn, obj_info, param_info, param_num,
@@ -10681,6 +12504,16 @@ next_inst:
             break;
     }   //End of "for i" loop over instances
 
+    /* Write uci packages changed by the instances */
+    if (w_uci_commit(wd, &uci_failed) != EPS_OK)
+    {
+        ERROR("Could not commit uci changes of obj %s", obj_info->objName);
+        status = EPS_SYSTEM_ERROR;
+    }
+    else if (setStatus != NULL && uciRestartNeeded)
+        *setStatus = 1;
+    ep_valcache_invalidate(obj_info->objName);
+
     DBG("%d (of %d) instances successfully updated in the backend",cnt,inst_num);
 
     return status;
@@ -10824,7 +12657,7 @@ static ep_stat_t w_getall_addobj_to_be_backend(
     if ((status != EPS_OK) || (config_param_num == 0))
     {
         DBG("No config params selected (stat = %d, num = %d)", status, config_param_num);
-        return status;
+        goto ret;
     }
 
     /* Get port number of the backend */
@@ -10853,7 +12686,7 @@ static ep_stat_t w_getall_addobj_to_be_backend(
 
         if (strlen(query) > 0)
         {
-            if (sqlite3_prepare_v2(conn, query, -1, &stmt1, NULL) != SQLITE_OK)
+            if (w_prepare_idx_stmt(wd, conn, query, &pn, idx_params_num, &stmt1) != EPS_OK)
                 GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not prepare SQL statement: %s",
                                     sqlite3_errmsg(conn));
 
@@ -10882,8 +12715,8 @@ static ep_stat_t w_getall_addobj_to_be_backend(
     *addStatus = be_ans.postOpStatus;
 
 ret:
-    if (stmt)  sqlite3_finalize(stmt);
-    if (stmt1) sqlite3_finalize(stmt1);
+    ep_db_stmt_release(&wd->stmt_cache, stmt);
+    ep_db_stmt_release(&wd->stmt_cache, stmt1);
     return status;
 }
 
@@ -11071,7 +12904,6 @@ static ep_stat_t w_getall_obj_script(worker_data_t *wd, obj_info_t *obj_info,
 {
     ep_stat_t status = EPS_OK;
     char *be_key, *p_extr_param;
-    FILE *fp;
     char *strtok_ctx1, *strtok_ctx2, *subtoken, *token;
     int  i, res_code = 99;
     char *buf = wd->be_req_xml_buf;
@@ -11119,15 +12951,9 @@ static ep_stat_t w_getall_obj_script(worker_data_t *wd, obj_info_t *obj_info,
         w_form_call_str_getall(buf, bufSize, parsed_backend_string);
     }
 
-    fp = popen(buf, "r");
-    memset(buf, 0, bufSize);
-    if (!fp)
-        GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not execute getall script");
-
-    p_extr_param = fgets(buf, bufSize-1, fp);
-    pclose(fp);
+    p_extr_param = w_perform_prepared_command(buf, bufSize, TRUE, NULL);
     if (!p_extr_param)
-        GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "fget for getall script failed");
+        GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not read getall script results");
 
     trim(buf);
     DBG("script returned: '%s'", buf);
@@ -11188,14 +13014,13 @@ static ep_stat_t w_config_disc_object(worker_data_t *wd, const char *name,
     obj_info_t *obj_info = &obj_info_arr[0];
 
     sqlite3 *conn = NULL;
-    getall_keys_t dbkeys, bekeys;
+    getall_keys_t *dbkeys, *bekeys;
+    size_t arena_mark = w_arena_mark(wd);
     getall_keys_ref_t refNewDbKeys, refUpdBeKeys, refAddToBeKeys;
 
     parsed_param_name_t pn = {{0}};
     parsed_backend_method_t parsed_method_string;
 
-    memset(&dbkeys, 0, sizeof(getall_keys_t));
-    memset(&bekeys, 0, sizeof(getall_keys_t));
 
     memset(&refNewDbKeys, 0, sizeof(getall_keys_ref_t));
     memset(&refUpdBeKeys, 0, sizeof(getall_keys_ref_t));
@@ -11215,20 +13040,28 @@ static ep_stat_t w_config_disc_object(worker_data_t *wd, const char *name,
          (obj_info->getAllOperStyle != OP_STYLE_SCRIPT)))
         return  EPS_OK;  //Do nothing - ignore such object
 
+    /* Key tables are too big for the stack */
+    dbkeys = w_arena_alloc(wd, sizeof(getall_keys_t));
+    bekeys = w_arena_alloc(wd, sizeof(getall_keys_t));
+    if (!dbkeys || !bekeys)
+        GOTO_RET_WITH_ERROR(EPS_OUTOFMEMORY, "Could not allocate key tables");
+    memset(dbkeys, 0, sizeof(getall_keys_t));
+    memset(bekeys, 0, sizeof(getall_keys_t));
+
     /* Since getall method string has the same format for both "script"  */
     /* and "backend" style we use here parse_backend_method function     */
-    status = w_parse_backend_method_string(OP_GETALL, obj_info->getAllMethod,
+    status = w_get_backend_method_tpl(wd, OP_GETALL, obj_info->getAllMethod,
                                            &parsed_method_string);
 
     if (obj_info->getAllOperStyle == OP_STYLE_BACKEND)
     {
-        status = w_getall_obj_backend(wd, obj_info, &parsed_method_string, &bekeys);
+        status = w_getall_obj_backend(wd, obj_info, &parsed_method_string, bekeys);
         if (status != EPS_OK)
             GOTO_RET_WITH_ERROR(status, "Could not process object (backend style)");
     }
     else if (obj_info->getAllOperStyle == OP_STYLE_SCRIPT)
     {
-        status = w_getall_obj_script(wd, obj_info, &parsed_method_string, &bekeys, &pn);
+        status = w_getall_obj_script(wd, obj_info, &parsed_method_string, bekeys, &pn);
         if (status != EPS_OK)
             GOTO_RET_WITH_ERROR(status, "Could not process object (script style)");
     }
@@ -11246,28 +13079,28 @@ static ep_stat_t w_config_disc_object(worker_data_t *wd, const char *name,
     get_index_param_names (param_info, param_num, idx_params, &idx_params_num);
 
     /* Get all keys from db */
-    if (w_fill_dbkeys(wd, obj_info, &parsed_method_string, idx_params_num, idx_params, conn, &dbkeys, &pn) != EPS_OK)
+    if (w_fill_dbkeys(wd, obj_info, &parsed_method_string, idx_params_num, idx_params, conn, dbkeys, &pn) != EPS_OK)
         GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not get keys from db");
 
-    DBG("Current instances: %d in db, %d in backend ", dbkeys.rows_num, bekeys.rows_num);
-    DBG("Instances in the db:");      print_getall_keys(&dbkeys);
-    //DBG("Instances in the backend:"); print_getall_keys(&bekeys);
+    DBG("Current instances: %d in db, %d in backend ", dbkeys->rows_num, bekeys->rows_num);
+    DBG("Instances in the db:");      print_getall_keys(dbkeys);
+    //DBG("Instances in the backend:"); print_getall_keys(bekeys);
 
     /* Compare instances from DB and from backend; decide what to do with them*/
 
-    qsort(&dbkeys.rows, dbkeys.rows_num, sizeof(dbkeys.rows[0]), &compare_getall_rows);
-    qsort(&bekeys.rows, bekeys.rows_num, sizeof(bekeys.rows[0]), &compare_getall_rows);
+    qsort(&dbkeys->rows, dbkeys->rows_num, sizeof(dbkeys->rows[0]), &compare_getall_rows);
+    qsort(&bekeys->rows, bekeys->rows_num, sizeof(bekeys->rows[0]), &compare_getall_rows);
 
-    while (dbrow_pos < dbkeys.rows_num && berow_pos < bekeys.rows_num)
+    while (dbrow_pos < dbkeys->rows_num && berow_pos < bekeys->rows_num)
     {
-        cmp_res = compare_getall_rows(&dbkeys.rows[dbrow_pos], &bekeys.rows[berow_pos]);
+        cmp_res = compare_getall_rows(&dbkeys->rows[dbrow_pos], &bekeys->rows[berow_pos]);
 
         if (cmp_res == 0) /* instance is known both in DB and backend */
         {
-            if (dbkeys.rows[dbrow_pos].create_owner == EP_DATA_OWNER_USER ||
-                dbkeys.rows[dbrow_pos].cfg_owner == EP_DATA_OWNER_USER)
+            if (dbkeys->rows[dbrow_pos].create_owner == EP_DATA_OWNER_USER ||
+                dbkeys->rows[dbrow_pos].cfg_owner == EP_DATA_OWNER_USER)
             {
-                refUpdBeKeys.rows_ptr[refUpdBeKeys.rows_num++] = &dbkeys.rows[dbrow_pos];
+                refUpdBeKeys.rows_ptr[refUpdBeKeys.rows_num++] = &dbkeys->rows[dbrow_pos];
             }
             else
             {
@@ -11284,10 +13117,10 @@ static ep_stat_t w_config_disc_object(worker_data_t *wd, const char *name,
                 If the instance does not contain data configured by user,
                 it should be deleted from the db.
                 Otherwise we need to keep this row (!!!May cause "not-active" row*/
-                if (dbkeys.rows[dbrow_pos].cfg_owner == EP_DATA_OWNER_SYSTEM)
+                if (dbkeys->rows[dbrow_pos].cfg_owner == EP_DATA_OWNER_SYSTEM)
                 {
                     w_getall_del_row_from_db(wd, (obj_info_t *)obj_info_arr, obj_num,
-                               idx_params_num, idx_params, conn, &dbkeys.rows[dbrow_pos]);
+                               idx_params_num, idx_params, conn, &dbkeys->rows[dbrow_pos]);
                     delFromDbCnt++;
                 }
                 else
@@ -11298,17 +13131,17 @@ static ep_stat_t w_config_disc_object(worker_data_t *wd, const char *name,
                 /* Read-write obj: instance can be created by user or by system:
                    if it is user-created instance, add it to the backend,
                    if it is system-created instance, deleted it from the DB. */
-                if (dbkeys.rows[dbrow_pos].create_owner == EP_DATA_OWNER_USER)
+                if (dbkeys->rows[dbrow_pos].create_owner == EP_DATA_OWNER_USER)
                 {
-                    refAddToBeKeys.rows_ptr[refAddToBeKeys.rows_num++] = &dbkeys.rows[dbrow_pos];
+                    refAddToBeKeys.rows_ptr[refAddToBeKeys.rows_num++] = &dbkeys->rows[dbrow_pos];
                 }
                 else   //it is system-created instance
                 {
-                    if (dbkeys.rows[dbrow_pos].cfg_owner != EP_DATA_OWNER_USER)
+                    if (dbkeys->rows[dbrow_pos].cfg_owner != EP_DATA_OWNER_USER)
                     {
                         //DBG("Instance of read-write object created by system is found");
                         w_getall_del_row_from_db(wd, (obj_info_t *)obj_info_arr, obj_num, idx_params_num, idx_params,
-                                                 conn, &dbkeys.rows[dbrow_pos]);
+                                                 conn, &dbkeys->rows[dbrow_pos]);
                         delFromDbCnt++;
                     }
                     else  /* system-created and user-configured instance
@@ -11328,19 +13161,19 @@ static ep_stat_t w_config_disc_object(worker_data_t *wd, const char *name,
                Writable object instances are created mostly by user, but
                sometimes by backend as well (for ex, default config info),
                so we need "to merge instances", i.e. add them to DB */
-            refNewDbKeys.rows_ptr[refNewDbKeys.rows_num++] = &bekeys.rows[berow_pos++];
+            refNewDbKeys.rows_ptr[refNewDbKeys.rows_num++] = &bekeys->rows[berow_pos++];
         }
     }  //End of while over dbrows and berows
 
     /* Check remaining rows that are known in the DB, but unknown in backend */
-    while (dbrow_pos < dbkeys.rows_num)
+    while (dbrow_pos < dbkeys->rows_num)
     {
         if (obj_info->writable == FALSE)
         {
-            if (dbkeys.rows[dbrow_pos].cfg_owner == EP_DATA_OWNER_SYSTEM)
+            if (dbkeys->rows[dbrow_pos].cfg_owner == EP_DATA_OWNER_SYSTEM)
             {
                 w_getall_del_row_from_db(wd, (obj_info_t *)obj_info_arr, obj_num, idx_params_num, idx_params,
-                                         conn, &dbkeys.rows[dbrow_pos]);
+                                         conn, &dbkeys->rows[dbrow_pos]);
                 delFromDbCnt++;
             }
             else
@@ -11351,17 +13184,17 @@ static ep_stat_t w_config_disc_object(worker_data_t *wd, const char *name,
         else /*If writable obj inst was created by user - add it to backend,
                if it was created by system - delete it from the DB         */
         {
-            if (dbkeys.rows[dbrow_pos].create_owner == EP_DATA_OWNER_USER)
+            if (dbkeys->rows[dbrow_pos].create_owner == EP_DATA_OWNER_USER)
             {
-                refAddToBeKeys.rows_ptr[refAddToBeKeys.rows_num++] = &dbkeys.rows[dbrow_pos];
+                refAddToBeKeys.rows_ptr[refAddToBeKeys.rows_num++] = &dbkeys->rows[dbrow_pos];
             }
             else //it is system-created instance
             {
-                if (dbkeys.rows[dbrow_pos].cfg_owner != EP_DATA_OWNER_USER)
+                if (dbkeys->rows[dbrow_pos].cfg_owner != EP_DATA_OWNER_USER)
                 {
                     //DBG("Instance of writable object created by system is found");
                     w_getall_del_row_from_db(wd, (obj_info_t *)obj_info_arr, obj_num, idx_params_num, idx_params,
-                                             conn, &dbkeys.rows[dbrow_pos]);
+                                             conn, &dbkeys->rows[dbrow_pos]);
                     delFromDbCnt++;
                 }
                 else // system-created and user-configured instance
@@ -11375,9 +13208,9 @@ static ep_stat_t w_config_disc_object(worker_data_t *wd, const char *name,
     }
 
     /* Check remaining rows that are known in the backend, but unknown in DB */
-    while (berow_pos < bekeys.rows_num)
+    while (berow_pos < bekeys->rows_num)
     {
-        refNewDbKeys.rows_ptr[refNewDbKeys.rows_num++] = &bekeys.rows[berow_pos++];
+        refNewDbKeys.rows_ptr[refNewDbKeys.rows_num++] = &bekeys->rows[berow_pos++];
     }
 
     /* Sort the rows prepared for adding to DB as they received from backend */
@@ -11414,6 +13247,7 @@ ret:
         strcpy_safe(beName, obj_info->backEndName, beNameSize);
     }
 
+    w_arena_release(wd, arena_mark);
     return status;
 }
 
@@ -11765,12 +13599,11 @@ static ep_stat_t w_config_disc_tree(worker_data_t *wd
     param_info_t       param_info[MAX_PARAMS_PER_OBJECT];
     obj_info_t         obj_info_arr[MAX_DEPENDED_OBJ_NUM];
     obj_info_t        *obj_info = &obj_info_arr[0];
-    getall_keys_t      dbkeys;
-    getall_keys_t      bekeys;
+    getall_keys_t     *dbkeys;
+    getall_keys_t     *bekeys;
+    size_t             arena_mark           = w_arena_mark(wd);
     parsed_backend_method_t parsed_method_string;
     
-    memset(&dbkeys, 0, sizeof(getall_keys_t));
-    memset(&bekeys, 0, sizeof(getall_keys_t));
 
     /* Prepare data about object - filling up obj_info structure */
     status = w_get_obj_info(wd, pn, 0, 0, obj_info, obj_info_size, &obj_num);
@@ -11779,10 +13612,18 @@ static ep_stat_t w_config_disc_tree(worker_data_t *wd
         GOTO_RET_WITH_ERROR(status, "Could not get object info");
     }
 
+    /* Key tables are too big for the stack */
+    dbkeys = w_arena_alloc(wd, sizeof(getall_keys_t));
+    bekeys = w_arena_alloc(wd, sizeof(getall_keys_t));
+    if (!dbkeys || !bekeys)
+        GOTO_RET_WITH_ERROR(EPS_OUTOFMEMORY, "Could not allocate key tables");
+    memset(dbkeys, 0, sizeof(getall_keys_t));
+    memset(bekeys, 0, sizeof(getall_keys_t));
+
     if (obj_info->getAllOperStyle == OP_STYLE_SCRIPT)
     {
         /* Filling up parsed_method_string for w_getall_obj_script */
-        status = w_parse_backend_method_string(OP_GETALL
+        status = w_get_backend_method_tpl(wd, OP_GETALL
                 , obj_info->getAllMethod
                 , &parsed_method_string);
 
@@ -11793,7 +13634,7 @@ static ep_stat_t w_config_disc_tree(worker_data_t *wd
 
         /* Execute backend lua script and parse result, filling up  bekeys*/
         status = w_getall_obj_script(wd
-                , obj_info, &parsed_method_string, &bekeys, pn);
+                , obj_info, &parsed_method_string, bekeys, pn);
 
         if (status != EPS_OK)
         {
@@ -11830,7 +13671,7 @@ static ep_stat_t w_config_disc_tree(worker_data_t *wd
     status = w_fill_dbkeys(wd
              , obj_info
              , &parsed_method_string
-             , idx_params_num, idx_params, conn, &dbkeys, pn);
+             , idx_params_num, idx_params, conn, dbkeys, pn);
 
     if (status != EPS_OK)
     {
@@ -11838,18 +13679,18 @@ static ep_stat_t w_config_disc_tree(worker_data_t *wd
     }
 
     DBG("Current instances: %d in db, %d in backend "
-    , dbkeys.rows_num, bekeys.rows_num);
+    , dbkeys->rows_num, bekeys->rows_num);
 
     DBG("Instances in the db:");
-    print_getall_keys(&dbkeys);
+    print_getall_keys(dbkeys);
 
     w_getall_sync_db_be_keys(wd
     , &obj_info_arr[0]
     , obj_num
     , idx_params_num
     , idx_params
-    , &dbkeys
-    , &bekeys
+    , dbkeys
+    , bekeys
     , param_info, param_num, &parsed_method_string, &addStatus, &updStatus);
 
 
@@ -11863,6 +13704,7 @@ ret:
         *beRestart = (addStatus > 0 || updStatus > 0);
     }
 
+    w_arena_release(wd, arena_mark);
     return status;
 }
 
@@ -11880,12 +13722,12 @@ static ep_stat_t w_config_disc_augment_object(worker_data_t *wd, const char *nam
     param_info_t param_info[MAX_PARAMS_PER_OBJECT];
     obj_info_t obj_info;
 
-    getall_keys_t dbkeys;
+    getall_keys_t *dbkeys;
+    size_t arena_mark = w_arena_mark(wd);
     getall_keys_ref_t refUpdBeKeys;
     parsed_param_name_t pn = {{0}};
     sqlite3 *conn = NULL;
 
-    memset(&dbkeys, 0, sizeof(getall_keys_t));
     memset(&refUpdBeKeys, 0, sizeof(getall_keys_ref_t));
 
     pn.partial_path = FALSE;
@@ -11917,20 +13759,25 @@ static ep_stat_t w_config_disc_augment_object(worker_data_t *wd, const char *nam
 
     conn = wd->main_conn;
 
+    /* Key table is too big for the stack */
+    if ((dbkeys = w_arena_alloc(wd, sizeof(getall_keys_t))) == NULL)
+        GOTO_RET_WITH_ERROR(EPS_OUTOFMEMORY, "Could not allocate key table");
+    memset(dbkeys, 0, sizeof(getall_keys_t));
+
     /* Get all keys from db */
     if (w_fill_dbkeys(wd, &obj_info, parsed_method, idx_params_num, idx_params,
-                                                       conn, &dbkeys, &pn) != EPS_OK)
+                                                       conn, dbkeys, &pn) != EPS_OK)
         GOTO_RET_WITH_ERROR(EPS_SQL_ERROR, "Could not get keys from db");
 
-    DBG("Current instances: %d in db", dbkeys.rows_num);
-    //DBG("Instances in the db:");      print_getall_keys(&dbkeys);
+    DBG("Current instances: %d in db", dbkeys->rows_num);
+    //DBG("Instances in the db:");      print_getall_keys(dbkeys);
 
-    for (dbrow_pos = 0; dbrow_pos < dbkeys.rows_num ; dbrow_pos++)
+    for (dbrow_pos = 0; dbrow_pos < dbkeys->rows_num ; dbrow_pos++)
     {
-        if (dbkeys.rows[dbrow_pos].create_owner == EP_DATA_OWNER_USER ||
-            dbkeys.rows[dbrow_pos].cfg_owner == EP_DATA_OWNER_USER)
+        if (dbkeys->rows[dbrow_pos].create_owner == EP_DATA_OWNER_USER ||
+            dbkeys->rows[dbrow_pos].cfg_owner == EP_DATA_OWNER_USER)
         {
-            refUpdBeKeys.rows_ptr[refUpdBeKeys.rows_num++] = &dbkeys.rows[dbrow_pos];
+            refUpdBeKeys.rows_ptr[refUpdBeKeys.rows_num++] = &dbkeys->rows[dbrow_pos];
         }
     }
     DBG("%d instances should be updated in the backend", refUpdBeKeys.rows_num);
@@ -11946,6 +13793,7 @@ ret:
         strcpy_safe(beName, obj_info.backEndName, beNameSize);
     }
 
+    w_arena_release(wd, arena_mark);
     return status;
 }
 
@@ -11980,7 +13828,7 @@ static ep_stat_t w_handle_discover_config(worker_data_t *wd, ep_message_t *messa
 
     if (indexedObjName)
     {
-        int resCode =  parse_param_name(indexedObjName, &pn);
+        int resCode =  w_parse_param_name(wd, indexedObjName, &pn);
 
         objName = pn.obj_name;
         if (resCode != EPS_OK)
@@ -12139,6 +13987,7 @@ static ep_stat_t w_handle_discover_config(worker_data_t *wd, ep_message_t *messa
                             {
                                 w_config_disc_augment_object(wd, trim(token),
                                         &parsed_method, &updStatus, NULL, 0);
+                                ep_valcache_invalidate(trim(token));
                                 token = strtok_r(NULL, ",", &strtok_ctx);
                             }
                         }
@@ -12147,6 +13996,9 @@ static ep_stat_t w_handle_discover_config(worker_data_t *wd, ep_message_t *messa
             }
         } // End of multi-instance Object processing
 
+        /* Cached values of the object may be changed by the discovery */
+        ep_valcache_invalidate(objNameFromDb);
+
         if (status != EPS_OK)
             WARN("Could not process object (stat %d). Ignore.", status);
         else
@@ -12340,6 +14192,8 @@ static ep_stat_t w_free_metadb_info(worker_data_t *wd)
 {
     DBG("Free meta db info for db type %d", wd->mmxDbType);
 
+    w_model_put(wd);
+
     if (wd->stmt_get_obj_info) {
         sqlite3_finalize(wd->stmt_get_obj_info);
         wd->stmt_get_obj_info = NULL;
@@ -12350,6 +14204,7 @@ static ep_stat_t w_free_metadb_info(worker_data_t *wd)
     }
 
     if (wd->mdb_conn) {
+        ep_db_stmt_cache_flush(&wd->stmt_cache, wd->mdb_conn);
         sql_closeConnection(wd->mdb_conn);
         wd->mdb_conn = NULL;
     }
@@ -12365,6 +14220,7 @@ static ep_stat_t w_free_maindb_info(worker_data_t *wd)
 
     if (wd->main_conn)
     {
+        ep_db_stmt_cache_flush(&wd->stmt_cache, wd->main_conn);
         sql_closeConnection(wd->main_conn);
         wd->main_conn = NULL;
     }
@@ -12385,6 +14241,7 @@ static ep_stat_t w_init_mmxdb_handles(worker_data_t *wd, int dbType, int msgType
     {
         DBG ("Connections to MMX meta and main db type %d (%s) already exist",
                                            dbType, mmxdbtype_num2str(dbType));
+        w_model_refresh(wd);
         return EPS_OK;
     }
 
@@ -12438,6 +14295,8 @@ static ep_stat_t w_init_mmxdb_handles(worker_data_t *wd, int dbType, int msgType
 
     wd->mmxDbType = dbType;
 
+    w_model_refresh(wd);
+
 ret:
     if (status != EPS_OK)
     {
@@ -12496,27 +14355,49 @@ ret:
     return status;
 }
 
-static ep_stat_t w_init(worker_data_t *wd)
+/* Default size of the worker arena: the biggest arrays the requests take
+   from it (DiscoverConfig key tables, GetParamValue objects info and plan,
+   per-object script output, GetParamNames instance indexes) */
+#define W_ARENA_DEFAULT_SIZE  (2 * sizeof(getall_keys_t) + \
+                               MAX_OBJECTS_NUM * sizeof(obj_info_t) + \
+                               EP_SCRIPT_OUTPUT_BUF_SIZE + \
+                               sizeof(((ep_message_t *)0)->body.getParamValue.paramNames) / \
+                               sizeof(((ep_message_t *)0)->body.getParamValue.paramNames[0]) * sizeof(int) + \
+                               2 * MAX_INSTANCES_PER_OBJECT * MAX_INDECES_PER_OBJECT * sizeof(int) + \
+                               1024)
+
+static ep_stat_t w_init(worker_data_t *wd, tp_worker_slot_t *slot)
 {
+    ep_stat_t status = EPS_OK;
     char buf[FILENAME_BUF_LEN];
+    const char *setting;
     struct timeval timeout;
 
-    wd->be_req_cnt = 0;
-    wd->self_w_num = tiddb_get_w_num();
+    /* Worker number is the thread pool slot number, so it is unique among
+       the running workers whatever the pool size is */
+    wd->be_req_cnt = slot->be_req_cnt;
+    wd->self_w_num = slot->w_num;
+
+    /* The management model is taken with the first DB connection */
+    wd->model = NULL;
+    wd->model_gen = -1;
+
+    /* Nothing is opened yet (see w_destroy) */
+    wd->udp_sock = wd->udp_be_sock = wd->ipc_sock = -1;
 
     /* Create UDP and IPC sockets for the EP worker thread */
     wd->udp_port = EP_PORT_STARTNUM + wd->self_w_num;
     if (udp_socket_init(&(wd->udp_sock), MMX_EP_ADDR, wd->udp_port) != ING_STAT_OK)
     {
-        ERROR("Could not create UDP socket for worker");
-        return EPS_SYSTEM_ERROR;
+        wd->udp_sock = -1;
+        GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not create UDP socket for worker");
     }
 
-    wd->udp_be_port = EP_PORT_STARTNUM + wd->self_w_num + 4;
+    wd->udp_be_port = EP_BE_PORT_STARTNUM + wd->self_w_num;
     if (udp_socket_init(&(wd->udp_be_sock), MMX_EP_BE_ADDR, wd->udp_be_port) != ING_STAT_OK)
     {
-        ERROR("Could not create UDP socket for worker");
-        return EPS_SYSTEM_ERROR;
+        wd->udp_be_sock = -1;
+        GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not create UDP socket for worker");
     }
 
     DBG ("Created UDP sock for ep worker - port %d", EP_PORT_STARTNUM + wd->self_w_num);
@@ -12527,15 +14408,13 @@ static ep_stat_t w_init(worker_data_t *wd)
     if (setsockopt(wd->udp_sock, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeout,
                                                            sizeof(timeout)) < 0)
     {
-        ERROR("Could not set timeout");
-        return EPS_SYSTEM_ERROR;
+        GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not set timeout");
     }
 
     if (setsockopt(wd->udp_be_sock, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeout,
                                                            sizeof(timeout)) < 0)
     {
-        ERROR("Could not set timeout");
-        return EPS_SYSTEM_ERROR;
+        GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not set timeout");
     }
 
     memset(buf, 0, sizeof(buf));
@@ -12543,20 +14422,79 @@ static ep_stat_t w_init(worker_data_t *wd)
     strcat_safe(buf, tiddb_get(), sizeof(buf));
     if (unix_socket_init_full(&(wd->ipc_sock), buf, &(wd->addr), &(wd->addr_len)) != ING_STAT_OK)
     {
-        ERROR("Could not create UNIX socket");
-        return EPS_SYSTEM_ERROR;
+        wd->ipc_sock = -1;
+        GOTO_RET_WITH_ERROR(EPS_SYSTEM_ERROR, "Could not create UNIX socket");
     }
 
-    return EPS_OK;
+    /* Arena for the big arrays of the requests; its pages are touched
+       only when they are used */
+    wd->arena_size = W_ARENA_DEFAULT_SIZE;
+    if ((setting = EP_WORKER_ARENA_SIZE) != NULL && atol(setting) > 0)
+        wd->arena_size = (size_t)atol(setting);
+
+    if ((wd->arena = (char *)malloc(wd->arena_size)) == NULL)
+    {
+        GOTO_RET_WITH_ERROR(EPS_OUTOFMEMORY, "Could not allocate worker arena (%lu bytes)",
+                            (unsigned long)wd->arena_size);
+    }
+
+#ifdef MMX_EP_WITH_LIBUCI
+    if ((wd->uci = ep_uci_create()) == NULL)
+        GOTO_RET_WITH_ERROR(EPS_OUTOFMEMORY, "Could not allocate uci data");
+#endif
+
+#ifdef MMX_EP_WITH_LIBUBUS
+    /* ubusd is connected by the first ubus call of the worker */
+    if ((wd->ubus = ep_ubus_create()) == NULL)
+        GOTO_RET_WITH_ERROR(EPS_OUTOFMEMORY, "Could not allocate ubus data");
+#endif
+
+ret:
+    /* Workers are started and retired at runtime: the sockets (ports of
+       the slot) and memory of the failed worker are released right away */
+    if (status != EPS_OK)
+        w_destroy(wd);
+
+    return status;
 }
 
 static ep_stat_t w_destroy(worker_data_t *wd)
 {
     w_free_metadb_info(wd);
+    w_free_maindb_info(wd);
+    w_method_tpls_flush(wd);
+    w_pname_cache_free(wd);
+
+    if (wd->arena)
+    {
+        DBG("Worker arena: %lu of %lu bytes used at most",
+            (unsigned long)wd->arena_peak, (unsigned long)wd->arena_size);
+        free(wd->arena);
+        wd->arena = NULL;
+    }
+
+#ifdef MMX_EP_WITH_LIBUCI
+    ep_uci_destroy(wd->uci);
+    wd->uci = NULL;
+#else
+    w_uci_batch_free(&wd->uci_batch);
+#endif
 
-    close(wd->udp_sock); wd->udp_sock = 0;
-    close(wd->udp_sock); wd->udp_be_sock = 0;
-    close(wd->ipc_sock); wd->ipc_sock = 0;
+#ifdef MMX_EP_WITH_LIBUBUS
+    ep_ubus_destroy(wd->ubus);
+    wd->ubus = NULL;
+#endif
+
+    /* The ports and the socket file are bound by the next worker of the slot */
+    if (wd->udp_sock >= 0) close(wd->udp_sock);
+    if (wd->udp_be_sock >= 0) close(wd->udp_be_sock);
+    if (wd->ipc_sock >= 0)
+    {
+        close(wd->ipc_sock);
+        if (wd->addr.sun_path[0])
+            unlink(wd->addr.sun_path);
+    }
+    wd->udp_sock = wd->udp_be_sock = wd->ipc_sock = -1;
 
     return EPS_OK;
 }
@@ -12564,10 +14502,30 @@ static ep_stat_t w_destroy(worker_data_t *wd)
 /* Prepare worker data when a new task is got */
 static ep_stat_t w_task_init(worker_data_t *wd)
 {
-    memset(wd->answer_buf, 0, sizeof(wd->answer_buf));
-    memset(wd->fe_req_values_pool, 0, sizeof(wd->fe_req_values_pool));
-    memset(wd->fe_resp_values_pool, 0, sizeof(wd->fe_resp_values_pool));
-    memset(wd->be_req_values_pool, 0, sizeof(wd->be_req_values_pool));
+    /* Templates table is full: start it anew */
+    if (wd->method_tpl_num >= EP_METHOD_TPL_CACHE_SIZE / 2)
+        w_method_tpls_flush(wd);
+
+    if (wd->arena_top != 0)
+    {
+        WARN("%lu bytes of the worker arena were not released", (unsigned long)wd->arena_top);
+        wd->arena_top = 0;
+    }
+
+#ifdef MMX_EP_WITH_LIBUCI
+    /* UCI packages are loaded anew by each request */
+    ep_uci_reset(wd->uci);
+#else
+    w_uci_batch_reset(&wd->uci_batch);
+#endif
+
+    /* Only the parts used by the previous task are cleared: the message
+       pools are filled from their beginning, the answer XML is a string */
+    memset(wd->answer_buf, 0, wd->answer_used);
+    memset(wd->fe_req_values_pool, 0, wd->fe_req_used);
+    memset(wd->fe_resp_values_pool, 0, wd->fe_resp_used);
+    memset(wd->be_req_values_pool, 0, wd->be_pool_used);
+    wd->answer_used = wd->fe_req_used = wd->fe_resp_used = wd->be_pool_used = 0;
 
     return EPS_OK;
 }
@@ -12575,18 +14533,27 @@ static ep_stat_t w_task_init(worker_data_t *wd)
 void *tp_worker(void *data)
 {
     ep_stat_t status = EPS_OK;
-    tp_threadpool_t *tp = (tp_threadpool_t *)data;
+    tp_worker_slot_t *slot = (tp_worker_slot_t *)data;
+    tp_threadpool_t *tp = slot->tp;
     tp_task_t task;
     worker_data_t wd = {0};
     ep_message_t message;
+    BOOL retired = FALSE;
+    char name[8];
 
-    tiddb_add(NULL);
+    snprintf(name, sizeof(name), "w%02d", slot->w_num);
+    tiddb_add(name);
 
     INFO("Thread %lu started", pthread_self());
 
-    if (w_init(&wd) != EPS_OK)
+    wd.tp = tp;
+    wd.tp_group = slot->group;
+
+    if (w_init(&wd, slot) != EPS_OK)
     {
         ERROR("Could not initialize worker. Exiting thread");
+        tp_worker_exit(slot, slot->be_req_cnt, FALSE);
+        tiddb_del();
         return NULL;
     }
 
@@ -12595,7 +14562,13 @@ void *tp_worker(void *data)
         if (tp->stopped)
             break;
 
-        if (tp_get_task(tp, &task) != EPS_OK)
+        if ((status = tp_get_task(tp, wd.tp_group, &task)) == EPS_TIMEOUT)
+        {
+            INFO("Worker is idle, exiting since thread pool shrinks");
+            retired = TRUE;
+            break;
+        }
+        else if (status != EPS_OK)
         {
             if (!tp->stopped) ERROR("Could not get task. Trying again");
             continue;
@@ -12604,15 +14577,22 @@ void *tp_worker(void *data)
         DBG("Got task. Working on it");
 
         w_task_init(&wd);
-        memset((char *)&message, 0, sizeof(message));
-        mmx_frontapi_msg_struct_init(&message, (char *)wd.fe_req_values_pool,
-                                     sizeof(wd.fe_req_values_pool));
         if (task.task_type == TASK_TYPE_RAW)
         {
+            /* The request message is needed for raw messages only */
+            memset((char *)&message, 0, sizeof(message));
+            mmx_frontapi_msg_struct_init(&message, (char *)wd.fe_req_values_pool,
+                                         sizeof(wd.fe_req_values_pool));
+
             /* DBG("Raw message. Parsing..."); */
-            if (mmx_frontapi_message_parse(task.raw_message, &message) != EPS_OK)
+            status = mmx_frontapi_message_parse(task.msgbuf->msg, &message);
+            w_buf_used(&wd.fe_req_used, (status == EPS_OK) ? message.mem_pool.curr_offset :
+                                                             sizeof(wd.fe_req_values_pool));
+            if (status != EPS_OK)
             {
                 ERROR("Could not parse raw message");
+                tp_put_msgbuf(tp, task.msgbuf);
+                tp_task_done(tp, &task);
                 continue;
             }
 
@@ -12620,21 +14600,29 @@ void *tp_worker(void *data)
             status = w_handle_msg(&wd, &message);
             DBG("-------- Message %s has been processed (status %d) --------",
                                 msgtype2str(message.header.msgType), status);
+
+            /* The worker owns the message buffer of the task */
+            tp_put_msgbuf(tp, task.msgbuf);
         }
         else if (task.task_type == TASK_TYPE_SUBTASK)
         {
             DBG("Subtask. Performing...");
-            // TODO do job
+            w_handle_get_subtask(&wd, (w_get_job_t *)task.subtask);
         }
         else
         {
             ERROR("Incorrect task type");
         }
+
+        tp_task_done(tp, &task);
     }
 
     w_destroy(&wd);
 
     INFO("Exiting");
 
+    tp_worker_exit(slot, wd.be_req_cnt, retired);
+    tiddb_del();
+
     return NULL;
 }
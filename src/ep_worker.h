@@ -73,11 +73,15 @@
 
 #include "ep_common.h"
 #include "ep_config.h"
+#include "ep_db_utils.h"
 
 #include <mmx-backapi-config.h>
 
 #define UDP_SOCK_TIMEOUT  6 /* sec */  // Waiting for response from backends
 #define EP_PORT_STARTNUM  10200
+/* Ports of worker sockets for backend responses follow the ports of all
+   possible workers */
+#define EP_BE_PORT_STARTNUM  (EP_PORT_STARTNUM + EP_TP_MAX_WORKER_THREADS_NUM)
 
 #define MAX_MMX_BE_REQ_LEN      20480
 #define EP_BE_VALUES_POOL_LEN   20480
@@ -86,12 +90,49 @@
 #define EP_RESP_POOL_LEN   16384
 
 
+/* Name-value pairs of GetParamValue response collected by a subtask */
+typedef struct w_nvbuf_s {
+    char   *buf;
+    size_t len;
+    size_t size;
+    int    num;
+} w_nvbuf_t;
+
+/* Commands of one parameter in the uci batch */
+typedef struct w_uci_grp_s {
+    int    tag;   /* position of the parameter in the request, -1 - none */
+    size_t end;   /* end of the group (after its separator) in the commands */
+} w_uci_grp_t;
+
+/* uci commands of the request run by "uci batch" at the end of the
+   request, see w_uci_commit (built without libuci) */
+typedef struct w_uci_batch_s {
+    w_nvbuf_t cmds;     /* "set" lines, each group ends by a separator */
+    w_nvbuf_t pkgs;     /* "commit" lines of the changed packages */
+    size_t grp_start;   /* beginning of the open group in cmds */
+    int grp_num;
+    int grp_size;
+    w_uci_grp_t *grps;
+    BOOL done;          /* the batch was run, only results are valid */
+} w_uci_batch_t;
+
 typedef struct worker_data_s {
     int     mmxDbType;   /* type of MMX DB: 0/1/2 - running/startup/candidate */
     sqlite3 *mdb_conn;   /* Meta db connection */
     sqlite3 *main_conn;  /* Main db connection */
     sqlite3_stmt *stmt_get_obj_info;
     sqlite3_stmt *stmt_get_obj_list;
+    ep_db_stmt_cache_t stmt_cache; /* statements of meta and main db connections */
+
+    /* Parsed method strings (getMethod, setMethod, getAllMethod), see
+       w_get_operation_tpl; hash table by the method string */
+    struct w_method_tpl_s *method_tpls[EP_METHOD_TPL_CACHE_SIZE];
+    int method_tpl_num;
+
+    /* Recently parsed parameter names, see w_parse_param_name */
+    struct w_pname_entry_s *pname_cache;
+    unsigned long pname_hits;
+    unsigned long pname_misses;
 
     int self_w_num;   /* "worker-number" of the worker */
 
@@ -105,6 +146,36 @@ typedef struct worker_data_s {
 
     int be_req_cnt; /* seq num of req to backends (for backend-style methods)*/
 
+    struct tp_threadpool_s *tp;  /* thread pool the worker belongs to */
+    int tp_group;                /* home group of the thread pool queues */
+
+    /* Management model cache of the current DB type and its generation
+       (see ep_model.h); NULL if the meta DB is queried */
+    struct ep_model_s *model;
+    int model_gen;
+    w_nvbuf_t *collect; /* if set, GET values are collected here (subtask) */
+
+    /* UCI packages loaded by the current request (see ep_uci.h);
+       NULL if uci command is used, then the commands are batched */
+    struct ep_uci_s *uci;
+    w_uci_batch_t uci_batch;
+
+    /* Connection to ubusd (see ep_ubus.h); NULL if ubus command is used */
+    struct ep_ubus_s *ubus;
+
+    /* Arena for big per-request arrays, see w_arena_alloc */
+    char *arena;
+    size_t arena_size;
+    size_t arena_top;
+    size_t arena_peak;
+
+    /* High-water marks of the buffers below in the current task; only
+       the used parts are cleared by w_task_init */
+    size_t be_pool_used;
+    size_t answer_used;
+    size_t fe_req_used;
+    size_t fe_resp_used;
+
     /* Buffer for Backend API request/response XML string*/
     char be_req_xml_buf[MAX_MMX_BE_REQ_LEN];
 
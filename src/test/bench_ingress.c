@@ -0,0 +1,297 @@
+/* bench_ingress.c
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+
+
+/*
+ * Dispatcher ingress benchmark. Bursts of GetParameterValues datagrams are
+ * sent to a loopback UDP socket and received by disp_recv of the dispatcher
+ * the way disp_loop does it (one receive per epoll readiness). The received
+ * requests are added to the lane queues of a thread pool without workers;
+ * the benchmark takes them back between the bursts. Reported per request:
+ * epoll and receive syscalls, lock acquisitions (counted by wrappers of
+ * the pthread lock functions), queue operations and dispatcher CPU time.
+ * Built with BENCH_RECV_BATCH 1 (recv per datagram) and with a batch of
+ * recvmmsg, see Makefile
+ *
+ * Usage: bench_ingress_recv|bench_ingress_mmsg [requests [burst]]
+ */
+
+#define _GNU_SOURCE
+
+#include <stddef.h>
+
+#include "ep_common.h"
+
+/* The receive mode under test replaces the configured one */
+#undef EP_DISP_RECV_BATCH
+#define EP_DISP_RECV_BATCH  BENCH_RECV_BATCH
+
+/* The dispatcher functions are called directly, its main is not used */
+#define main disp_main
+#include "ep_dispatcher.c"
+#undef main
+
+#include "ep_test.h"
+
+#define BENCH_DEF_REQUESTS  200000
+#define BENCH_DEF_BURST     16      /* below the queue high-water mark */
+
+#define BENCH_MSG \
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?><mmxEpMsg><header>" \
+    "<callerId>1</callerId><txaId>1</txaId><respMode>0</respMode>" \
+    "<respIpAddr>127.0.0.1</respIpAddr><respPort>9999</respPort>" \
+    "<msgType>GetParameterValues</msgType><mmxDbType>0</mmxDbType></header>" \
+    "<body><GetParameterValues><ParameterNames arraySize=\"2\">" \
+    "<string>Device.IP.Interface.1.Status</string>" \
+    "<string>Device.IP.Interface.1.IPv4Address.1.IPAddress</string>" \
+    "</ParameterNames></GetParameterValues></body></mmxEpMsg>"
+
+static volatile BOOL g_bench_counting;
+static unsigned long g_bench_locks;
+
+int __real_pthread_mutex_lock(pthread_mutex_t *mutex);
+int __real_pthread_rwlock_rdlock(pthread_rwlock_t *lock);
+int __real_pthread_rwlock_wrlock(pthread_rwlock_t *lock);
+
+int __wrap_pthread_mutex_lock(pthread_mutex_t *mutex)
+{
+    if (g_bench_counting)
+        g_bench_locks++;
+    return __real_pthread_mutex_lock(mutex);
+}
+
+int __wrap_pthread_rwlock_rdlock(pthread_rwlock_t *lock)
+{
+    if (g_bench_counting)
+        g_bench_locks++;
+    return __real_pthread_rwlock_rdlock(lock);
+}
+
+int __wrap_pthread_rwlock_wrlock(pthread_rwlock_t *lock)
+{
+    if (g_bench_counting)
+        g_bench_locks++;
+    return __real_pthread_rwlock_wrlock(lock);
+}
+
+/* No worker is started by the benchmark */
+void *tp_worker(void *data)
+{
+    return NULL;
+}
+
+/* Thread pool with the queues and the message pool of one shard only */
+static tp_threadpool_t *bench_tp_create(void)
+{
+    tp_threadpool_t *tp = (tp_threadpool_t *)calloc(1, sizeof(tp_threadpool_t));
+    int l;
+
+    if (!tp)
+        return NULL;
+
+    tp->group_num = 1;
+    pthread_mutex_init(&(tp->workers_lock), NULL);
+
+    if (tp_msgpool_init(&(tp->msg_pool), TP_MSG_POOL_SIZE(1, 1)) != EPS_OK)
+        return NULL;
+
+    for (l = 0; l < TP_LANE_NUM; l++)
+    {
+        if (tp_queue_init(&(tp->lanes[0][l]), FALSE) != EPS_OK)
+            return NULL;
+    }
+
+    return tp;
+}
+
+static int bench_socket_init(int *rx, int *tx)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int size = 1024 * 1024;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if ((*rx = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0)) < 0 ||
+        (*tx = socket(AF_INET, SOCK_DGRAM, 0)) < 0 ||
+        bind(*rx, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        getsockname(*rx, (struct sockaddr *)&addr, &len) < 0 ||
+        connect(*tx, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+        return -1;
+
+    setsockopt(*rx, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int requests = (argc > 1) ? atoi(argv[1]) : BENCH_DEF_REQUESTS;
+    int burst = (argc > 2) ? atoi(argv[2]) : BENCH_DEF_BURST;
+    tp_threadpool_t *tp;
+    tp_queue_stats_t qstats;
+    tp_task_t task;
+    disp_ctx_t ctx;
+    struct epoll_event ev;
+    static char pkt[MAX_DISP_MSG_LEN];
+    size_t pkt_len;
+    unsigned long polls = 0, recvs = 0;
+    long long cpu_ns = 0, start;
+    int rx, tx, epfd, i, n, sent = 0;
+
+    if (requests <= 0 || burst <= 0)
+    {
+        fprintf(stderr, "Usage: %s [requests [burst]]\n", argv[0]);
+        return 1;
+    }
+
+    if (bench_socket_init(&rx, &tx) < 0 || (epfd = epoll_create1(0)) < 0)
+    {
+        perror("socket");
+        return 1;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = rx;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, rx, &ev);
+
+    if ((tp = bench_tp_create()) == NULL)
+    {
+        fprintf(stderr, "Could not create thread pool\n");
+        return 1;
+    }
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.tp = tp;
+    ctx.shard = 0;
+    ctx.udp_sock = rx;
+    disp_ctx_init(&ctx);
+
+    strcpy(((ep_packet_t *)pkt)->msg, BENCH_MSG);
+    pkt_len = offsetof(ep_packet_t, msg) + strlen(BENCH_MSG) + 1;
+
+    while (sent < requests)
+    {
+        n = (requests - sent < burst) ? requests - sent : burst;
+        for (i = 0; i < n; i++)
+        {
+            if (send(tx, pkt, pkt_len, 0) < 0)
+            {
+                perror("send");
+                return 1;
+            }
+        }
+        sent += n;
+
+        /* Dispatcher: one receive per readiness until the socket is drained;
+           the last (empty) poll stands for the wait of the next burst */
+        g_bench_counting = TRUE;
+        start = ep_bench_cpu_ns();
+        while (epoll_wait(epfd, &ev, 1, 0) > 0)
+        {
+            polls++;
+            recvs++;
+            disp_recv(&ctx, rx);
+        }
+        polls++;
+        cpu_ns += ep_bench_cpu_ns() - start;
+        g_bench_counting = FALSE;
+
+        /* Workers: the tasks are taken, their buffers are returned */
+        while (tp_queue_try_dequeue(&(tp->lanes[0][TP_LANE_READ]), &task) == EPS_OK)
+            tp_put_msgbuf(tp, task.msgbuf);
+    }
+
+    tp_queue_get_stats(&(tp->lanes[0][TP_LANE_READ]), &qstats);
+
+    printf("Ingress of %d requests in bursts of %d, receive batch %d (%s)\n", requests,
+           burst, EP_DISP_RECV_BATCH, (EP_DISP_RECV_BATCH > 1) ? "recvmmsg" : "recv");
+    ep_bench_report("epoll_wait calls per request", polls, ctx.stats.rcvd_msgs);
+    ep_bench_report("receive calls per request", recvs, ctx.stats.rcvd_msgs);
+    ep_bench_report("lock acquisitions per request", g_bench_locks, ctx.stats.rcvd_msgs);
+    ep_bench_report("queue operations per request", qstats.enq_op_cnt, ctx.stats.rcvd_msgs);
+    ep_bench_report("dispatcher CPU ns per request", cpu_ns, ctx.stats.rcvd_msgs);
+
+    if (ctx.stats.rcvd_msgs != (unsigned long)requests || ctx.stats.dropped ||
+        ctx.stats.rejected_queue || ctx.stats.rejected_rate)
+    {
+        fprintf(stderr, "Lost requests: %lu received, %lu dropped, %lu rejected\n",
+                ctx.stats.rcvd_msgs, ctx.stats.dropped,
+                ctx.stats.rejected_queue + ctx.stats.rejected_rate);
+        return 1;
+    }
+
+    disp_ctx_cleanup(&ctx);
+    close(epfd);
+    close(rx);
+    close(tx);
+
+    return 0;
+}
@@ -0,0 +1,337 @@
+/* bench_model.c
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+
+
+/*
+ * Object name resolution benchmark. w_get_obj_info of the worker resolves
+ * the requested object names over a synthetic meta DB shaped like the
+ * TR-181 model (multi-instance tables with "{i}" down to four levels)
+ * twice: by the SQL queries of MMX_Objects_InfoTbl (no model) and by the
+ * management model cache (name hash and trie). The object names are
+ * indexed in the meta DB; the index serves "=" but not LIKE, which is
+ * case insensitive. Every object of the model
+ * is requested as the exact name, as the partial path (subtree) and as the
+ * partial path of child objects only; both ways must return the same
+ * objects. Reported: microseconds per call of each kind
+ *
+ * Usage: bench_model [rounds]
+ */
+
+#include "ep_worker.c"
+
+#include "ep_test.h"
+
+#define BENCH_DEF_ROUNDS  5
+#define BENCH_MAX_OBJS    2048
+
+/* Parameters of all objects are taken from the same info table */
+#define BENCH_PARAMS_TBL  "Bench_ParamsTbl"
+
+/* Top-level objects of the synthetic model; each of them has the same
+   subtree of tables and scalar objects */
+static const char *bench_roots[] = {
+    "DeviceInfo", "Time", "UserInterface", "InterfaceStack", "DSL", "Optical",
+    "Cellular", "ATM", "PTM", "Ethernet", "USB", "HPNA", "MoCA", "Ghn",
+    "HomePlug", "UPA", "WiFi", "ZigBee", "Bridging", "PPP", "IP", "LLDP",
+    "IPsec", "GRE", "L2TPv3", "VXLAN", "MAP", "CaptivePortal", "Routing",
+    "NeighborDiscovery", "RouterAdvertisement", "IPv6rd", "DSLite", "QoS",
+    "LANConfigSecurity", "Hosts", "DNS", "NAT", "PCP", "DHCPv4", "DHCPv6",
+    "IEEE8021x", "Users", "SmartCardReaders", "UPnP", "DLNA", "Firewall",
+    "PeriodicStatistics", "FaultMgmt", "Security"
+};
+
+#define BENCH_ROOTS_NUM  (int)(sizeof(bench_roots) / sizeof(bench_roots[0]))
+
+static worker_data_t g_wd;
+static char (*g_names)[MSG_MAX_STR_LEN];
+static int g_names_num;
+
+/* Objects found by name: number and hash of the names */
+typedef struct bench_result_s {
+    int num;
+    unsigned int hash;
+} bench_result_t;
+
+/* Adds the object and its subtree (depth first, as the meta DB is
+   filled): a scalar "Stats" and tables of the lower levels */
+static int bench_add_obj(sqlite3_stmt *ins, const char *name, int level)
+{
+    char child[MSG_MAX_STR_LEN];
+    int i, tables = 3 - level;
+
+    sqlite3_bind_text(ins, 1, name, -1, SQLITE_STATIC);
+    if (g_names_num >= BENCH_MAX_OBJS || sqlite3_step(ins) != SQLITE_DONE)
+        return -1;
+    sqlite3_reset(ins);
+    strcpy_safe(g_names[g_names_num++], name, MSG_MAX_STR_LEN);
+
+    if (tables <= 0)
+        return 0;
+
+    snprintf(child, sizeof(child), "%sStats.", name);
+    if (bench_add_obj(ins, child, 3) < 0)
+        return -1;
+
+    for (i = 1; i <= tables; i++)
+    {
+        snprintf(child, sizeof(child), "%sTable%d.{i}.", name, i);
+        if (bench_add_obj(ins, child, level + 1) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+static int bench_meta_db_init(void)
+{
+    sqlite3_stmt *ins = NULL;
+    char name[MSG_MAX_STR_LEN];
+    int i;
+
+    if (sqlite3_open(":memory:", &g_wd.mdb_conn) != SQLITE_OK ||
+        sqlite3_exec(g_wd.mdb_conn,
+            "CREATE TABLE [MMX_Objects_InfoTbl] (ObjName TEXT, ObjInternalId INTEGER, "
+            "PackageName TEXT, InfoTblName TEXT, ValuesDbName TEXT, ValuesTblName TEXT, "
+            "BackEndName TEXT, Writable INTEGER, UserAccessPerm INTEGER, "
+            "ReadFrontEnds INTEGER, WriteFrontEnds INTEGER, MinEntNumber INTEGER, "
+            "MaxEntNumber INTEGER, NumOfEntParamName TEXT, EnableParamName TEXT, "
+            "UniKeyParamNames TEXT, StyleOfAddObj TEXT, AddObjMethod TEXT, "
+            "StyleOfDelObj TEXT, DelObjMethod TEXT, StyleOfGet TEXT, GetMethod TEXT, "
+            "StyleOfSet TEXT, SetMethod TEXT, StyleOfGetAll TEXT, GetAllMethod TEXT, "
+            "Configurable INTEGER);"
+            "CREATE INDEX [Bench_ObjNameIdx] ON [MMX_Objects_InfoTbl] (ObjName);"
+            "CREATE TABLE [" BENCH_PARAMS_TBL "] (ParamName TEXT, Writable INTEGER, "
+            "UserAccessPerm INTEGER, ReadFrontEnds INTEGER, WriteFrontEnds INTEGER, "
+            "ParamType TEXT, IsIndex INTEGER, ValueIsList INTEGER, MinValue TEXT, "
+            "MaxValue TEXT, DefValue TEXT, MinLength INTEGER, MaxLength INTEGER, "
+            "Hidden INTEGER, NotSaveInDb INTEGER, Units TEXT, EnumValues TEXT, "
+            "StyleOfGet TEXT, StyleOfSet TEXT, GetMethod TEXT, SetMethod TEXT);"
+            "INSERT INTO [" BENCH_PARAMS_TBL "] VALUES "
+            "('Enable', 1, 0, 0, 0, 'boolean', 0, 0, '', '', '0', 0, 0, 0, 0, '', '', "
+            "'db', 'db', '', ''),"
+            "('Status', 0, 0, 0, 0, 'string', 0, 0, '', '', '', 0, 64, 0, 1, '', "
+            "'Up,Down', 'script', '', 'bench-get', ''),"
+            "('Alias', 1, 0, 0, 0, 'string', 0, 0, '', '', '', 0, 64, 0, 0, '', '', "
+            "'db', 'db', '', '');",
+            NULL, NULL, NULL) != SQLITE_OK)
+        return -1;
+
+    if (sqlite3_prepare_v2(g_wd.mdb_conn,
+            "INSERT INTO [MMX_Objects_InfoTbl] VALUES (?, 0, 'bench', '" BENCH_PARAMS_TBL
+            "', 'bench.db', 'Bench_ValuesTbl', '', 1, 0, 0, 0, 0, 0, '', 'Enable', "
+            "'Alias', 'db', '', 'db', '', 'db', '', 'db', '', 'script', 'bench-getall', 1)",
+            -1, &ins, NULL) != SQLITE_OK)
+        return -1;
+
+    if (bench_add_obj(ins, "Device.", 3) < 0)
+        return -1;
+
+    for (i = 0; i < BENCH_ROOTS_NUM; i++)
+    {
+        snprintf(name, sizeof(name), "Device.%s.", bench_roots[i]);
+        if (bench_add_obj(ins, name, 0) < 0)
+            return -1;
+    }
+    sqlite3_finalize(ins);
+
+    if (sqlite3_prepare_v2(g_wd.mdb_conn, SQL_QUERY_GET_OBJ_INFO, -1,
+                           &g_wd.stmt_get_obj_info, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(g_wd.mdb_conn, SQL_QUERY_GET_OBJ_LIST_INFO, -1,
+                           &g_wd.stmt_get_obj_list, NULL) != SQLITE_OK)
+        return -1;
+
+    return 0;
+}
+
+/* Resolves every object name of the model. The results are saved by the
+   first pass and compared by the next ones. Returns total number of the
+   objects found, -1 on error */
+static long bench_resolve(BOOL partial_path, char childs_only, obj_info_t *obj_info,
+                          bench_result_t *results, BOOL save)
+{
+    parsed_param_name_t pn;
+    unsigned int hash;
+    const char *c;
+    long total = 0;
+    int i, j, num;
+
+    for (i = 0; i < g_names_num; i++)
+    {
+        memset(&pn, 0, sizeof(pn));
+        strcpy_safe(pn.obj_name, g_names[i], sizeof(pn.obj_name));
+        pn.partial_path = partial_path;
+
+        if (w_get_obj_info(&g_wd, &pn, 0, childs_only, obj_info, g_names_num, &num) != EPS_OK)
+            return -1;
+
+        for (hash = 0, j = 0; j < num; j++)
+        {
+            for (c = obj_info[j].objName; *c; c++)
+                hash = hash * 31 + (unsigned char)*c;
+        }
+
+        if (save)
+        {
+            results[i].num = num;
+            results[i].hash = hash;
+        }
+        else if (results[i].num != num || results[i].hash != hash)
+        {
+            fprintf(stderr, "Objects of %s%s differ: %d found, %d expected\n", g_names[i],
+                    partial_path ? "%" : "", num, results[i].num);
+            return -1;
+        }
+
+        total += num;
+    }
+
+    return total;
+}
+
+int main(int argc, char **argv)
+{
+    static const struct {
+        const char *name;
+        BOOL partial_path;
+        char childs_only;
+    } kinds[] = {
+        { "exact name", FALSE, 0 },
+        { "partial path", TRUE, 0 },
+        { "partial path, child objects", TRUE, 1 },
+    };
+    int rounds = (argc > 1) ? atoi(argv[1]) : BENCH_DEF_ROUNDS;
+    obj_info_t *obj_info;
+    bench_result_t *results;
+    ep_model_t *model;
+    long long ns[2];
+    long total = 0;
+    int k, m, r;
+
+    if (rounds <= 0)
+    {
+        fprintf(stderr, "Usage: %s [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    g_names = calloc(BENCH_MAX_OBJS, MSG_MAX_STR_LEN);
+    if (!g_names || bench_meta_db_init() < 0)
+    {
+        fprintf(stderr, "Could not create meta DB: %s\n",
+                g_wd.mdb_conn ? sqlite3_errmsg(g_wd.mdb_conn) : "no memory");
+        return 1;
+    }
+
+    obj_info = calloc(g_names_num, sizeof(obj_info_t));
+    results = calloc(g_names_num, sizeof(bench_result_t));
+    if (!obj_info || !results)
+        return 1;
+
+    g_wd.model_gen = -1;
+    w_model_refresh(&g_wd);
+    if ((model = g_wd.model) == NULL)
+    {
+        fprintf(stderr, "Could not build management model\n");
+        return 1;
+    }
+
+    printf("Synthetic model: %d objects, %d name trie nodes; %d rounds\n",
+           model->obj_num, model->node_num, rounds);
+
+    for (k = 0; k < (int)(sizeof(kinds) / sizeof(kinds[0])); k++)
+    {
+        /* The meta DB first (no model), then the model */
+        for (m = 0; m < 2; m++)
+        {
+            g_wd.model = m ? model : NULL;
+
+            ns[m] = ep_bench_now_ns();
+            for (r = 0; r < rounds; r++)
+            {
+                total = bench_resolve(kinds[k].partial_path, kinds[k].childs_only,
+                                      obj_info, results, (m == 0 && r == 0));
+                if (total < 0)
+                    return 1;
+            }
+            ns[m] = ep_bench_now_ns() - ns[m];
+        }
+
+        printf("%s: %ld objects found per round\n", kinds[k].name, total);
+        ep_bench_report("meta DB, us per call", ns[0] / 1000, (unsigned long)rounds * g_names_num);
+        ep_bench_report("model, us per call", ns[1] / 1000, (unsigned long)rounds * g_names_num);
+    }
+
+    w_model_put(&g_wd);
+    sqlite3_finalize(g_wd.stmt_get_obj_info);
+    sqlite3_finalize(g_wd.stmt_get_obj_list);
+    sqlite3_close(g_wd.mdb_conn);
+    free(obj_info);
+    free(results);
+    free(g_names);
+
+    return 0;
+}
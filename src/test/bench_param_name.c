@@ -0,0 +1,204 @@
+/* bench_param_name.c
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+
+
+/*
+ * Parameter name parsing benchmark: the names of a polling front-end
+ * (GetParameterValues of the same names again and again) are parsed by the
+ * strtok based parser parse_param_name replaced (param_name_base.h), by
+ * the one-pass scanner and by the worker's cache of parsed names. The
+ * cache is measured with the polled names (hits) and with a scan of more
+ * distinct names than it has entries (misses). Reported: ns per name
+ *
+ * Usage: bench_param_name [rounds]
+ */
+
+#include "ep_worker.c"
+
+#include "param_name_base.h"
+#include "ep_test.h"
+
+#define BENCH_DEF_ROUNDS  50000
+
+/* Names polled by a front-end */
+static const char *g_polled[] = {
+    "Device.DeviceInfo.UpTime",
+    "Device.DeviceInfo.MemoryStatus.Free",
+    "Device.DeviceInfo.ProcessStatus.CPUUsage",
+    "Device.Ethernet.Interface.1.Status",
+    "Device.Ethernet.Interface.1.Stats.BytesReceived",
+    "Device.Ethernet.Interface.1.Stats.BytesSent",
+    "Device.IP.Interface.2.IPv4Address.1.IPAddress",
+    "Device.IP.Interface.*.Status",
+    "Device.WiFi.Radio.[1-2].Channel",
+    "Device.WiFi.AccessPoint.1.AssociatedDevice.",
+    "Device.Hosts.Host.",
+    "Device.DHCPv4.Server.Pool.1.Client.{i}.Chaddr",
+};
+
+#define POLLED_NUM  (int)(sizeof(g_polled) / sizeof(g_polled[0]))
+
+static worker_data_t g_wd;
+
+static long long bench_base(const char **names, int num, int rounds)
+{
+    parsed_param_name_t pn;
+    long long start = ep_bench_now_ns();
+    int r, i;
+
+    for (r = 0; r < rounds; r++)
+    {
+        for (i = 0; i < num; i++)
+            base_parse_param_name((char *)names[i], &pn);
+    }
+
+    return ep_bench_now_ns() - start;
+}
+
+static long long bench_scanner(const char **names, int num, int rounds)
+{
+    parsed_param_name_t pn;
+    long long start = ep_bench_now_ns();
+    int r, i;
+
+    for (r = 0; r < rounds; r++)
+    {
+        for (i = 0; i < num; i++)
+            parse_param_name(names[i], &pn);
+    }
+
+    return ep_bench_now_ns() - start;
+}
+
+static long long bench_cache(const char **names, int num, int rounds)
+{
+    parsed_param_name_t pn;
+    long long start = ep_bench_now_ns();
+    int r, i;
+
+    for (r = 0; r < rounds; r++)
+    {
+        /* The names are requested by up to EP_PARAM_NAME_CACHE_SIZE, the
+           largest request that uses the cache */
+        for (i = 0; i < num; i++)
+            w_parse_param_name(&g_wd, names[i], &pn);
+    }
+
+    return ep_bench_now_ns() - start;
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = (argc > 1) ? atoi(argv[1]) : BENCH_DEF_ROUNDS;
+    int distinct_num = 4 * EP_PARAM_NAME_CACHE_SIZE, i;
+    unsigned long ops = (unsigned long)rounds * POLLED_NUM;
+    char (*distinct_buf)[MSG_MAX_STR_LEN];
+    const char **distinct;
+
+    if (rounds <= 0)
+    {
+        fprintf(stderr, "Usage: %s [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    /* Distinct names: the polled ones with other instance numbers */
+    distinct_buf = calloc(distinct_num, MSG_MAX_STR_LEN);
+    distinct = calloc(distinct_num, sizeof(char *));
+    if (!distinct_buf || !distinct)
+        return 1;
+
+    for (i = 0; i < distinct_num; i++)
+    {
+        snprintf(distinct_buf[i], MSG_MAX_STR_LEN, "Device.IP.Interface.%d.IPv4Address.%d.%s",
+                 i % 16 + 1, i / 16 + 1, (i & 1) ? "IPAddress" : "SubnetMask");
+        distinct[i] = distinct_buf[i];
+    }
+
+    printf("%d polled names, %d rounds; cache of %d entries\n", POLLED_NUM, rounds,
+           EP_PARAM_NAME_CACHE_SIZE);
+    ep_bench_report("strtok parser, ns per name", bench_base(g_polled, POLLED_NUM, rounds), ops);
+    ep_bench_report("scanner, ns per name", bench_scanner(g_polled, POLLED_NUM, rounds), ops);
+    ep_bench_report("cache, ns per name", bench_cache(g_polled, POLLED_NUM, rounds), ops);
+    printf("  %-32s %lu/%lu\n", "cache hits/misses", g_wd.pname_hits, g_wd.pname_misses);
+
+    g_wd.pname_hits = g_wd.pname_misses = 0;
+    rounds = (rounds >= 16) ? rounds / 16 : 1;
+    ops = (unsigned long)rounds * distinct_num;
+
+    printf("%d distinct names, %d rounds\n", distinct_num, rounds);
+    ep_bench_report("strtok parser, ns per name", bench_base(distinct, distinct_num, rounds), ops);
+    ep_bench_report("scanner, ns per name", bench_scanner(distinct, distinct_num, rounds), ops);
+    ep_bench_report("cache, ns per name", bench_cache(distinct, distinct_num, rounds), ops);
+    printf("  %-32s %lu/%lu\n", "cache hits/misses", g_wd.pname_hits, g_wd.pname_misses);
+
+    w_pname_cache_free(&g_wd);
+    free(distinct);
+    free(distinct_buf);
+
+    return 0;
+}
@@ -0,0 +1,222 @@
+/* bench_task_init.c
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+
+
+/*
+ * Worker task preparation benchmark: a small GetParameterValues task (three
+ * values in a response that is not sent) is run again and again on the
+ * same worker, before it the worker buffers are cleared either whole (as
+ * w_task_init did before the high-water marks) or by w_task_init. The
+ * caches are flushed by a walk over EVICT_SIZE bytes between the tasks, as
+ * the rest of the request processing does. Reported per task: bytes
+ * cleared, time and cache misses (perf hardware counter, when available)
+ *
+ * Usage: bench_task_init [tasks]
+ */
+
+#define _GNU_SOURCE
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+
+#include "ep_worker.c"
+
+#include "ep_test.h"
+
+#define BENCH_DEF_TASKS  5000
+#define EVICT_SIZE       (4 * 1024 * 1024)
+
+static worker_data_t g_wd;
+static ep_message_t g_message;
+static ep_message_t g_answer;
+static char *g_evict;
+
+/* w_task_init before the high-water marks */
+static size_t bench_clear_whole(worker_data_t *wd)
+{
+    memset(wd->answer_buf, 0, sizeof(wd->answer_buf));
+    memset(wd->fe_req_values_pool, 0, sizeof(wd->fe_req_values_pool));
+    memset(wd->fe_resp_values_pool, 0, sizeof(wd->fe_resp_values_pool));
+    memset(wd->be_req_values_pool, 0, sizeof(wd->be_req_values_pool));
+
+    return sizeof(wd->answer_buf) + sizeof(wd->fe_req_values_pool) +
+           sizeof(wd->fe_resp_values_pool) + sizeof(wd->be_req_values_pool);
+}
+
+static size_t bench_clear_used(worker_data_t *wd)
+{
+    size_t size = wd->answer_used + wd->fe_req_used + wd->fe_resp_used + wd->be_pool_used;
+
+    w_task_init(wd);
+    return size;
+}
+
+/* The task: the request message is prepared as tp_worker does, the answer
+   as the GET handler does */
+static void bench_task(void)
+{
+    char name[MSG_MAX_STR_LEN];
+    int i;
+
+    memset((char *)&g_message, 0, sizeof(g_message));
+    mmx_frontapi_msg_struct_init(&g_message, (char *)g_wd.fe_req_values_pool,
+                                 sizeof(g_wd.fe_req_values_pool));
+
+    memset(&g_answer, 0, sizeof(g_answer));
+    mmx_frontapi_msg_struct_init(&g_answer, (char *)g_wd.fe_resp_values_pool,
+                                 sizeof(g_wd.fe_resp_values_pool));
+    g_answer.header.respMode = MMX_API_RESPMODE_NORESP;
+
+    for (i = 0; i < 3; i++)
+    {
+        snprintf(name, sizeof(name), "Device.Ethernet.Interface.1.Stats.Counter%d", i);
+        w_insert_nvpair_to_answer(&g_wd, &g_answer, name, "123456789");
+    }
+    w_send_answer(&g_wd, &g_answer);
+}
+
+static int bench_perf_open(void)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void bench_run(const char *name, size_t (*clear)(worker_data_t *), int tasks, int perf_fd)
+{
+    unsigned long long cleared = 0, misses = 0, cnt;
+    long long ns = 0, start;
+    volatile char sum = 0;
+    int t, i;
+
+    for (t = 0; t < tasks; t++)
+    {
+        for (i = 0; i < EVICT_SIZE; i += 64)
+            sum += g_evict[i]++;
+
+        if (perf_fd >= 0)
+        {
+            ioctl(perf_fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(perf_fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        start = ep_bench_now_ns();
+
+        cleared += clear(&g_wd);
+        bench_task();
+
+        ns += ep_bench_now_ns() - start;
+        if (perf_fd >= 0)
+        {
+            ioctl(perf_fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(perf_fd, &cnt, sizeof(cnt)) == sizeof(cnt))
+                misses += cnt;
+        }
+    }
+
+    printf("%s\n", name);
+    ep_bench_report("bytes cleared per task", cleared, tasks);
+    ep_bench_report("ns per task", ns, tasks);
+    if (perf_fd >= 0)
+        ep_bench_report("cache misses per task", misses, tasks);
+}
+
+int main(int argc, char **argv)
+{
+    int tasks = (argc > 1) ? atoi(argv[1]) : BENCH_DEF_TASKS;
+    int perf_fd;
+
+    if (tasks <= 0)
+    {
+        fprintf(stderr, "Usage: %s [tasks]\n", argv[0]);
+        return 1;
+    }
+
+    if ((g_evict = calloc(1, EVICT_SIZE)) == NULL)
+        return 1;
+
+    if ((perf_fd = bench_perf_open()) < 0)
+        printf("Cache misses are not counted: perf_event_open: %s\n", strerror(errno));
+
+    printf("%d small GET tasks, caches flushed between them; ep_message_t of %lu bytes "
+           "is zeroed for the request and the answer\n", tasks, (unsigned long)sizeof(ep_message_t));
+    bench_run("whole buffers cleared", bench_clear_whole, tasks, perf_fd);
+    bench_run("used parts cleared (w_task_init)", bench_clear_used, tasks, perf_fd);
+
+    if (perf_fd >= 0)
+        close(perf_fd);
+    free(g_evict);
+
+    return 0;
+}
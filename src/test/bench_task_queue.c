@@ -0,0 +1,298 @@
+/* bench_task_queue.c
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+
+
+/*
+ * Task queue contention benchmark: producers and consumers pass tasks
+ * through one blocking queue of TP_MAX_TASK_QUEUE_SIZE slots. The lock-free
+ * ring of ep_task_queue.c is compared with the mutex and condition variable
+ * queue it replaced (reproduced below: one lock per operation, broadcast
+ * to all consumers when the queue becomes non-empty). Reported for each
+ * number of producers and consumers: throughput, CAS retries, parks and
+ * wake-ups of the ring, condition variable wake-ups of the mutex queue
+ *
+ * Usage: bench_task_queue [tasks]
+ */
+
+#include <sched.h>
+
+#include "ep_threadpool.h"
+#include "ep_test.h"
+
+#define BENCH_DEF_TASKS  200000
+
+/* The queue before the lock-free ring */
+typedef struct bench_mq_s {
+    tp_task_t elems[TP_MAX_TASK_QUEUE_SIZE];
+    unsigned int head;
+    unsigned int tail;
+    unsigned int length;
+    BOOL is_blocking;
+    pthread_mutex_t mutex;
+    pthread_cond_t cv_got_task;
+    unsigned long wakeups;          /* returns from pthread_cond_wait */
+} bench_mq_t;
+
+static void bench_mq_init(bench_mq_t *q)
+{
+    memset(q, 0, sizeof(bench_mq_t));
+    pthread_mutex_init(&(q->mutex), NULL);
+    pthread_cond_init(&(q->cv_got_task), NULL);
+    q->is_blocking = TRUE;
+}
+
+static ep_stat_t bench_mq_enqueue(bench_mq_t *q, tp_task_t *elem)
+{
+    pthread_mutex_lock(&(q->mutex));
+    if (q->length >= TP_MAX_TASK_QUEUE_SIZE)
+    {
+        pthread_mutex_unlock(&(q->mutex));
+        return EPS_FULL;
+    }
+
+    q->elems[q->tail] = *elem;
+    q->tail = (q->tail + 1) % TP_MAX_TASK_QUEUE_SIZE;
+    if (++q->length == 1 && q->is_blocking)
+        pthread_cond_broadcast(&(q->cv_got_task));
+    pthread_mutex_unlock(&(q->mutex));
+
+    return EPS_OK;
+}
+
+static ep_stat_t bench_mq_dequeue(bench_mq_t *q, tp_task_t *t)
+{
+    pthread_mutex_lock(&(q->mutex));
+    while (q->is_blocking && q->length == 0)
+    {
+        pthread_cond_wait(&(q->cv_got_task), &(q->mutex));
+        q->wakeups++;
+    }
+
+    if (q->length == 0)
+    {
+        pthread_mutex_unlock(&(q->mutex));
+        return EPS_EMPTY;
+    }
+
+    *t = q->elems[q->head];
+    q->head = (q->head + 1) % TP_MAX_TASK_QUEUE_SIZE;
+    q->length--;
+    pthread_mutex_unlock(&(q->mutex));
+
+    return EPS_OK;
+}
+
+static void bench_mq_set_nonblocking(bench_mq_t *q)
+{
+    pthread_mutex_lock(&(q->mutex));
+    q->is_blocking = FALSE;
+    pthread_cond_broadcast(&(q->cv_got_task));
+    pthread_mutex_unlock(&(q->mutex));
+}
+
+typedef struct bench_run_s {
+    BOOL ring;                      /* lock-free ring or the mutex queue */
+    tp_queue_t *rq;
+    bench_mq_t *mq;
+    int tasks_per_producer;
+    unsigned long consumed;
+    unsigned long full;             /* enqueue attempts on the full queue */
+} bench_run_t;
+
+static void *bench_producer(void *arg)
+{
+    bench_run_t *run = (bench_run_t *)arg;
+    tp_task_t task;
+    unsigned long full = 0;
+    int i;
+
+    memset(&task, 0, sizeof(task));
+    for (i = 0; i < run->tasks_per_producer; i++)
+    {
+        task.subtask = (void *)(long)(i + 1);
+        while ((run->ring ? tp_queue_enqueue(run->rq, &task) : bench_mq_enqueue(run->mq, &task))
+               == EPS_FULL)
+        {
+            full++;
+            sched_yield();
+        }
+    }
+
+    __atomic_fetch_add(&(run->full), full, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static void *bench_consumer(void *arg)
+{
+    bench_run_t *run = (bench_run_t *)arg;
+    tp_task_t task;
+    unsigned long cnt = 0;
+
+    while ((run->ring ? tp_queue_dequeue(run->rq, &task) : bench_mq_dequeue(run->mq, &task))
+           == EPS_OK)
+        cnt++;
+
+    __atomic_fetch_add(&(run->consumed), cnt, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static int bench_run(BOOL ring, int producers, int consumers, int tasks)
+{
+    static tp_queue_t rq;
+    static bench_mq_t mq;
+    pthread_t threads[64];
+    bench_run_t run;
+    tp_queue_stats_t stats;
+    long long start, ns;
+    int i, total;
+
+    memset(&run, 0, sizeof(run));
+    run.ring = ring;
+    run.rq = &rq;
+    run.mq = &mq;
+    run.tasks_per_producer = tasks / producers;
+    total = run.tasks_per_producer * producers;
+
+    if (ring)
+        tp_queue_init(&rq, TRUE);
+    else
+        bench_mq_init(&mq);
+
+    start = ep_bench_now_ns();
+    for (i = 0; i < consumers; i++)
+        pthread_create(&threads[producers + i], NULL, bench_consumer, &run);
+    for (i = 0; i < producers; i++)
+        pthread_create(&threads[i], NULL, bench_producer, &run);
+
+    for (i = 0; i < producers; i++)
+        pthread_join(threads[i], NULL);
+
+    /* The consumers leave when the queue is empty */
+    if (ring)
+        tp_queue_set_nonblocking(&rq);
+    else
+        bench_mq_set_nonblocking(&mq);
+
+    for (i = 0; i < consumers; i++)
+        pthread_join(threads[producers + i], NULL);
+    ns = ep_bench_now_ns() - start;
+
+    printf("%-6s %2d producers %2d consumers: %6.2f Mtasks/s", ring ? "ring" : "mutex",
+           producers, consumers, total * 1000.0 / ns);
+    if (ring)
+    {
+        tp_queue_get_stats(&rq, &stats);
+        printf(", per 1000 tasks: %lu CAS retries, %lu parks, %lu wake-ups\n",
+               (stats.enq_retry_cnt + stats.deq_retry_cnt) * 1000 / total,
+               stats.park_cnt * 1000 / total, stats.wake_cnt * 1000 / total);
+        tp_queue_destroy(&rq);
+    }
+    else
+    {
+        printf(", per 1000 tasks: %lu consumer wake-ups\n", mq.wakeups * 1000 / total);
+        pthread_mutex_destroy(&(mq.mutex));
+        pthread_cond_destroy(&(mq.cv_got_task));
+    }
+
+    if (run.consumed != (unsigned long)total)
+    {
+        fprintf(stderr, "%lu of %d tasks consumed\n", run.consumed, total);
+        return -1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    static const int producers[] = {1, 2, 4};
+    static const int consumers[] = {1, 4, 8};
+    int tasks = (argc > 1) ? atoi(argv[1]) : BENCH_DEF_TASKS;
+    int p, c;
+
+    if (tasks <= 0)
+    {
+        fprintf(stderr, "Usage: %s [tasks]\n", argv[0]);
+        return 1;
+    }
+
+    printf("Queue of %d slots, %d tasks, %ld CPUs\n", TP_MAX_TASK_QUEUE_SIZE, tasks,
+           sysconf(_SC_NPROCESSORS_ONLN));
+
+    for (p = 0; p < (int)(sizeof(producers) / sizeof(producers[0])); p++)
+    {
+        for (c = 0; c < (int)(sizeof(consumers) / sizeof(consumers[0])); c++)
+        {
+            if (bench_run(FALSE, producers[p], consumers[c], tasks) < 0 ||
+                bench_run(TRUE, producers[p], consumers[c], tasks) < 0)
+                return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,186 @@
+/* param_name_base.h
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+#ifndef PARAM_NAME_BASE_H_
+#define PARAM_NAME_BASE_H_
+
+/*
+ * parse_param_name of the worker before the one-pass scanner: the
+ * reference of test_param_name and bench_param_name (included after
+ * ep_worker.c). Range indexes must have both bounds, "[5]" crashes it
+ */
+static ep_stat_t base_parse_param_name(char *rawstr, parsed_param_name_t *pn)
+{
+    path_token_type_t token_type = PATH_TOKEN_UNDEF;
+    char buf[MSG_MAX_STR_LEN];
+    BOOL with_placeholders = (strstr(rawstr, ".{i}.") != NULL) ? TRUE : FALSE;
+
+    memset(pn, 0, sizeof(parsed_param_name_t));
+    memset(buf, 0, sizeof(buf));
+
+    DBG(" raw name string: %s %s", rawstr,
+        (with_placeholders) ? "(placeholder name)" : "");
+
+    /* Copy rawstr to buf so it does not get spoiled by strtok */
+    strcpy_safe(buf, rawstr, sizeof(buf));
+    if (with_placeholders)
+    {
+        strcpy_safe(pn->obj_name, rawstr, MSG_MAX_STR_LEN);
+    }
+
+
+    if (LAST_CHAR(buf) == '.')
+    {
+        pn->partial_path = TRUE;
+    }
+
+    char *token, *next_token, *strtok_ctx, *strtok_ctx2;
+
+    token = strtok_r(buf, ".", &strtok_ctx);
+    while (token)
+    {
+        next_token = strtok_r(NULL, ".", &strtok_ctx);
+
+        if (!with_placeholders)
+        {
+            if (isdigit(token[0]))
+            {
+                pn->indices[pn->index_num].type = REQ_IDX_TYPE_EXACT;
+                pn->indices[pn->index_num].exact_val.num = atoi(token);
+                pn->index_set_num++;
+                pn->index_num++;
+                strcat_safe(pn->obj_name, "{i}.", sizeof(pn->obj_name));
+                token_type = PATH_TOKEN_INDEX;
+            }
+            else if (token[0] == '[')
+            {
+                pn->indices[pn->index_num].type = REQ_IDX_TYPE_RANGE;
+                pn->indices[pn->index_num].range_val.begin = atoi(strtok_r(token+1, "-", &strtok_ctx2));
+                pn->indices[pn->index_num].range_val.end = atoi(strtok_r(NULL, "-", &strtok_ctx2));
+                pn->index_num++;
+                pn->index_set_num++;
+                strcat_safe(pn->obj_name, "{i}.", sizeof(pn->obj_name));
+                token_type = PATH_TOKEN_INDEX;
+            }
+            else if (token[0] == '*')
+            {
+                pn->indices[pn->index_num++].type = REQ_IDX_TYPE_ALL;
+                strcat_safe(pn->obj_name, "{i}.", sizeof(pn->obj_name));
+                token_type = PATH_TOKEN_INDEX;
+            }
+            else if (isalpha(token[0]))
+            {
+                if (!next_token && !pn->partial_path)
+                {
+                    strncpy(pn->leaf_name, token, sizeof(pn->leaf_name)-1);
+                    token_type = PATH_TOKEN_PARAMNAME;
+                    break;
+                }
+
+                strcat_safe(pn->obj_name, token, sizeof(pn->obj_name));
+                strcat_safe(pn->obj_name, ".", sizeof(pn->obj_name));
+                token_type = PATH_TOKEN_NODE;
+            }
+            else
+            {
+                DBG(" Incorrect parameter name: %s", rawstr);
+                return EPS_INVALID_ARGUMENT;
+            }
+        }
+        else /* with_placeholders = TRUE */
+        {
+            if (!strcmp(token, "{i}"))
+            {
+                pn->indices[pn->index_num].type = REQ_IDX_TYPE_PLACEHOLDER;
+                pn->index_num++;
+                token_type = PATH_TOKEN_PLACEHOLDER;
+            }
+            else if (isalpha(token[0]))
+            {
+                if (!next_token && !pn->partial_path)
+                {
+                    strncpy(pn->leaf_name, token, sizeof(pn->leaf_name)-1);
+                    token_type = PATH_TOKEN_PARAMNAME;
+                    break;
+                }
+                token_type = PATH_TOKEN_NODE;
+            }
+            else
+            {
+                DBG(" Incorrect parameter placeholder name: %s", rawstr);
+                return EPS_INVALID_ARGUMENT;
+            }
+        }
+
+        token = next_token;
+    }
+
+    pn->last_token_type = token_type;
+    return EPS_OK;
+}
+
+#endif /* PARAM_NAME_BASE_H_ */
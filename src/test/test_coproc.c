@@ -0,0 +1,226 @@
+/* test_coproc.c
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+
+
+/*
+ * Test of the commands served by the script helper (w_perform_prepared_command
+ * with MMX_EP_SCRIPT_HELPER) over a mock helper: a command that may have been
+ * run by the helper is not run again by the EP, even if the helper failed to
+ * answer; a command not delivered to the helper (it has exited) is run by
+ * the EP. Each run of the command is logged
+ */
+
+#define _GNU_SOURCE
+
+#include "ep_worker.c"
+
+#include "ep_test.h"
+
+static char g_dir[] = "/tmp/ep_test_coproc.XXXXXX";
+
+/* Mode of the helper after it runs a command: "normal" - it answers,
+   "garbage" - the response header is invalid, "once" - it answers and
+   exits */
+static const char *g_helper_script =
+    "#!/bin/sh\n"
+    "dir=$(dirname \"$0\")\n"
+    "while read -r len; do\n"
+    "    cmd=$(head -c \"$len\")\n"
+    "    out=$(sh -c \"$cmd\"); rc=$?\n"
+    "    case $(cat \"$dir/mode\") in\n"
+    "        garbage) echo 'garbage'; exit 0;;\n"
+    "        once) printf '%d %d\\n%s' $rc ${#out} \"$out\"; exit 0;;\n"
+    "        *) printf '%d %d\\n%s' $rc ${#out} \"$out\";;\n"
+    "    esac\n"
+    "done\n";
+
+static int test_write(const char *name, const char *text)
+{
+    char path[sizeof(g_dir) + 16];
+    FILE *f;
+
+    snprintf(path, sizeof(path), "%s/%s", g_dir, name);
+    if ((f = fopen(path, "w")) == NULL)
+        return -1;
+
+    fputs(text, f);
+    return fclose(f);
+}
+
+static int test_setup(void)
+{
+    char path[sizeof(g_dir) + 16];
+
+    if (!mkdtemp(g_dir) || test_write("helper", g_helper_script) || test_write("mode", "normal"))
+        return -1;
+
+    snprintf(path, sizeof(path), "%s/helper", g_dir);
+    if (chmod(path, 0755))
+        return -1;
+
+    setenv("MMX_EP_SCRIPT_HELPER", path, 1);
+    setenv("MMX_EP_SCRIPT_HELPER_NUM", "1", 1);
+    setenv("MMX_EP_EXEC_TIMEOUT", "5000", 1);
+
+    return 0;
+}
+
+static void test_cleanup(void)
+{
+    char path[sizeof(g_dir) + 16];
+    const char *names[] = { "helper", "mode", "log" };
+    int i;
+
+    for (i = 0; i < 3; i++)
+    {
+        snprintf(path, sizeof(path), "%s/%s", g_dir, names[i]);
+        unlink(path);
+    }
+    rmdir(g_dir);
+}
+
+/* Number of the runs logged since the previous call */
+static int test_runs(void)
+{
+    char path[sizeof(g_dir) + 16], line[64];
+    int num = 0;
+    FILE *f;
+
+    snprintf(path, sizeof(path), "%s/log", g_dir);
+    if ((f = fopen(path, "r")) == NULL)
+        return 0;
+
+    while (fgets(line, sizeof(line), f))
+        num++;
+    fclose(f);
+    unlink(path);
+
+    return num;
+}
+
+/* Runs the logged command by w_perform_prepared_command */
+static char *test_command(char *buf, size_t size, int *rc)
+{
+    snprintf(buf, size, "echo run >> %s/log; echo result", g_dir);
+    *rc = -1;
+
+    return w_perform_prepared_command(buf, (int)size, TRUE, rc);
+}
+
+int main(void)
+{
+    char buf[256], *res;
+    int rc, runs;
+
+    if (test_setup() != 0)
+    {
+        perror("setup");
+        test_cleanup();
+        return 1;
+    }
+
+    EP_CHECK(ep_coproc_enabled(), "script helper is enabled");
+
+    /* Served by the helper */
+    res = test_command(buf, sizeof(buf), &rc);
+    runs = test_runs();
+    EP_CHECK(res && !strncmp(res, "result", 6) && rc == 0, "result \"%s\", rc %d", res ? res : "(null)", rc);
+    EP_CHECK(runs == 1, "%d runs", runs);
+
+    /* The command was run, but the helper's response is invalid */
+    test_write("mode", "garbage");
+    res = test_command(buf, sizeof(buf), &rc);
+    runs = test_runs();
+    EP_CHECK(res == NULL, "result of the failed helper \"%s\"", res);
+    EP_CHECK(runs == 1, "%d runs after the invalid response", runs);
+
+    /* The helper exits after the command; the next command is not
+       delivered to it and is run by the EP */
+    test_write("mode", "once");
+    res = test_command(buf, sizeof(buf), &rc);
+    runs = test_runs();
+    EP_CHECK(res && !strncmp(res, "result", 6), "result \"%s\"", res ? res : "(null)");
+    EP_CHECK(runs == 1, "%d runs", runs);
+
+    test_write("mode", "normal");
+    usleep(300000);
+    res = test_command(buf, sizeof(buf), &rc);
+    runs = test_runs();
+    EP_CHECK(res && !strncmp(res, "result", 6) && rc == 0,
+             "result of the not delivered command \"%s\", rc %d", res ? res : "(null)", rc);
+    EP_CHECK(runs == 1, "%d runs of the not delivered command", runs);
+
+    /* A new helper serves the next command */
+    res = test_command(buf, sizeof(buf), &rc);
+    runs = test_runs();
+    EP_CHECK(res && runs == 1, "%d runs by the restarted helper", runs);
+
+    test_cleanup();
+
+    return ep_test_result("test_coproc");
+}
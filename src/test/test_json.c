@@ -0,0 +1,212 @@
+/* test_json.c
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+
+
+/*
+ * Test of the extraction of values from ubus call results (ep_json_get):
+ * member names found at any depth, paths with array positions, strings
+ * with escapes, values truncated to the buffer and invalid JSON
+ */
+
+#include "ep_json.h"
+#include "ep_test.h"
+
+static const char *g_status =
+    "{\n"
+    "\t\"up\": true,\n"
+    "\t\"l3_device\": \"br-lan\",\n"
+    "\t\"note\": \"mtu\",\n"
+    "\t\"uptime\": 1234,\n"
+    "\t\"metric\": -1.5e3,\n"
+    "\t\"delegation\": null,\n"
+    "\t\"ipv4-address\": [\n"
+    "\t\t{ \"address\": \"192.168.1.1\", \"mask\": 24 },\n"
+    "\t\t{ \"address\": \"10.0.0.1\", \"mask\": 8 }\n"
+    "\t],\n"
+    "\t\"route\": [ ],\n"
+    "\t\"data\": { \"stats\": { \"mtu\": 1500 } }\n"
+    "}\n";
+
+/* Checks the status and the value got for the key into a buffer of
+   value_size bytes */
+static void test_get(const char *json, const char *key, size_t value_size,
+                     ep_stat_t expected, const char *expected_value)
+{
+    char value[256];
+    char *copy = strdup(json);    /* exact size, so that over-reads are seen by ASan */
+    ep_stat_t status;
+
+    memset(value, 'X', sizeof(value));
+    status = ep_json_get(copy, key, value, value_size);
+    free(copy);
+
+    EP_CHECK(status == expected, "%s: status %d, expected %d", key, (int)status, (int)expected);
+    EP_CHECK(strlen(value) < value_size && !strcmp(value, expected_value),
+             "%s: \"%s\", expected \"%s\"", key, value, expected_value);
+}
+
+static void test_members(void)
+{
+    test_get(g_status, "l3_device", 256, EPS_OK, "br-lan");
+    test_get(g_status, "up", 256, EPS_OK, "true");
+    test_get(g_status, "uptime", 256, EPS_OK, "1234");
+    test_get(g_status, "metric", 256, EPS_OK, "-1.5e3");
+    test_get(g_status, "delegation", 256, EPS_OK, "null");
+    /* "mtu" is a value of "note" before it, the member is nested */
+    test_get(g_status, "mtu", 256, EPS_OK, "1500");
+    /* The first member in the order of the text */
+    test_get(g_status, "address", 256, EPS_OK, "192.168.1.1");
+    test_get(g_status, "stats", 256, EPS_OK, "{ \"mtu\": 1500 }");
+    test_get(g_status, "route", 256, EPS_OK, "[ ]");
+    test_get(g_status, "proto", 256, EPS_NOT_FOUND, "");
+    test_get(g_status, "l3_dev", 256, EPS_NOT_FOUND, "");
+}
+
+static void test_paths(void)
+{
+    test_get(g_status, "ipv4-address/0/address", 256, EPS_OK, "192.168.1.1");
+    test_get(g_status, "ipv4-address/1/address", 256, EPS_OK, "10.0.0.1");
+    test_get(g_status, "ipv4-address/1/mask", 256, EPS_OK, "8");
+    test_get(g_status, "ipv4-address/0", 256, EPS_OK,
+             "{ \"address\": \"192.168.1.1\", \"mask\": 24 }");
+    test_get(g_status, "data/stats/mtu", 256, EPS_OK, "1500");
+    test_get("[1, [2, 3], \"x\"]", "1/1", 256, EPS_OK, "3");
+    test_get("[1, [2, 3], \"x\"]", "1/0", 256, EPS_OK, "2");
+
+    /* Path segments are not searched at depth */
+    test_get(g_status, "stats/mtu", 256, EPS_NOT_FOUND, "");
+    test_get(g_status, "ipv4-address/2/address", 256, EPS_NOT_FOUND, "");
+    test_get(g_status, "ipv4-address/-1/address", 256, EPS_NOT_FOUND, "");
+    test_get(g_status, "ipv4-address/x/address", 256, EPS_NOT_FOUND, "");
+    test_get(g_status, "ipv4-address/0/address/0", 256, EPS_NOT_FOUND, "");
+    test_get(g_status, "route/0", 256, EPS_NOT_FOUND, "");
+}
+
+static void test_escapes(void)
+{
+    test_get("{\"s\": \"a\\\"b\\\\c\\/d\"}", "s", 256, EPS_OK, "a\"b\\c/d");
+    test_get("{\"s\": \"1\\t2\\n3\\r\\b\\f\"}", "s", 256, EPS_OK, "1\t2\n3\r\b\f");
+    test_get("{\"s\": \"\\u0041\\u00e9\\u20ac\"}", "s", 256, EPS_OK, "A\xC3\xA9\xE2\x82\xAC");
+    /* Surrogate pairs are not combined: each half is encoded on its own */
+    test_get("{\"s\": \"\\ud83d\\ude00\"}", "s", 256, EPS_OK, "\xED\xA0\xBD\xED\xB8\x80");
+    test_get("{\"s\": \"\\u00zz\"}", "s", 256, EPS_OK, "u00zz");
+    /* \u0000 is skipped; \u with less than 4 chars before the end of input */
+    test_get("{\"s\": \"a\\u0000b\"}", "s", 256, EPS_OK, "ab");
+    test_get("{\"s\": \"\\u1\"", "s", 256, EPS_OK, "u1");
+    /* Escaped quote in a member name and in a value before the member */
+    test_get("{\"a\\\"b\": \"x\\\"}\", \"c\": \"d\"}", "c", 256, EPS_OK, "d");
+}
+
+static void test_truncation(void)
+{
+    test_get(g_status, "l3_device", 4, EPS_OK, "br-");
+    test_get(g_status, "uptime", 3, EPS_OK, "12");
+    test_get(g_status, "stats", 6, EPS_OK, "{ \"mt");
+    test_get(g_status, "l3_device", 1, EPS_OK, "");
+    /* A multibyte character is not split */
+    test_get("{\"s\": \"x\\u00e9\"}", "s", 3, EPS_OK, "x");
+    test_get("{\"s\": \"x\\u20ac\"}", "s", 4, EPS_OK, "x");
+    test_get("{\"s\": \"x\\u20ac\"}", "s", 5, EPS_OK, "x\xE2\x82\xAC");
+    test_get("{\"s\": \"ab\\n\"}", "s", 3, EPS_OK, "ab");
+}
+
+static void test_invalid(void)
+{
+    char value[8];
+
+    /* The value itself is invalid */
+    test_get("{\"a\": \"abc", "a", 256, EPS_INVALID_FORMAT, "");
+    test_get("{\"a\": [1, 2", "a", 256, EPS_INVALID_FORMAT, "");
+    test_get("{\"a\": {\"b\" 1}}", "a", 256, EPS_INVALID_FORMAT, "");
+    test_get("{\"a\": }", "a", 256, EPS_INVALID_FORMAT, "");
+
+    /* The text before the member is invalid */
+    test_get("{\"x\": [1, 2 \"a\": 1}", "a", 256, EPS_NOT_FOUND, "");
+    test_get("{\"x\": [1, 2 \"a\": 1}", "x/5", 256, EPS_NOT_FOUND, "");
+    test_get("{\"x\" 1, \"a\": 1}", "a", 256, EPS_NOT_FOUND, "");
+    test_get("{\"x\": , \"a\": 1}", "a", 256, EPS_NOT_FOUND, "");
+    test_get("{\"x\": \"abc", "a", 256, EPS_NOT_FOUND, "");
+    test_get("{\"x\": 1 \"a\": 1}", "a", 256, EPS_NOT_FOUND, "");
+    test_get("\"a\"", "a", 256, EPS_NOT_FOUND, "");
+    test_get("", "a", 256, EPS_NOT_FOUND, "");
+    test_get("Command failed: Not found", "a", 256, EPS_NOT_FOUND, "");
+
+    EP_CHECK(ep_json_get(NULL, "a", value, sizeof(value)) == EPS_INVALID_ARGUMENT, "no JSON");
+    EP_CHECK(ep_json_get("{}", "a", value, 0) == EPS_INVALID_ARGUMENT, "empty buffer");
+}
+
+int main(void)
+{
+    test_members();
+    test_paths();
+    test_escapes();
+    test_truncation();
+    test_invalid();
+
+    return ep_test_result("test_json");
+}
@@ -0,0 +1,204 @@
+/* test_param_name.c
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+
+
+/*
+ * Differential test of parse_param_name: the one-pass scanner and the
+ * worker's cache of parsed names (w_parse_param_name) must give the same
+ * result as the strtok based parser it replaced (param_name_base.h) for
+ * all names of up to BASE_SEGS_NUM segments of the alphabet below, with
+ * and without the trailing dot and with empty segments
+ */
+
+#include "ep_worker.c"
+
+#include "param_name_base.h"
+#include "ep_test.h"
+
+#define BASE_SEGS_NUM  4
+
+/* Segments of the names; "" makes an empty segment ("..") */
+static const char *g_segs[] = {
+    "Device", "IP", "Interface", "Status", "1", "12", "3x", "[1-3]", "[10-2]",
+    "[-1-3]", "[1--3]", "[1-3", "*", "{i}", "", "#x", "{x}", "_a"
+};
+
+#define SEGS_NUM  (int)(sizeof(g_segs) / sizeof(g_segs[0]))
+
+static worker_data_t g_wd;
+
+/* Index segments of the name (the base parser writes past the indexes
+   array if there are more than MAX_INDECES_PER_OBJECT of them) */
+static int test_index_segs(const int *segs, int num)
+{
+    int i, cnt = 0;
+
+    for (i = 0; i < num; i++)
+    {
+        if (strchr("0123456789[*{", g_segs[segs[i]][0]) && g_segs[segs[i]][0])
+            cnt++;
+    }
+
+    return cnt;
+}
+
+static void test_compare(const char *name, const char *what, ep_stat_t status,
+                         const parsed_param_name_t *pn, ep_stat_t exp_status,
+                         const parsed_param_name_t *exp)
+{
+    EP_CHECK(status == exp_status, "%s of \"%s\": status %d, expected %d",
+             what, name, (int)status, (int)exp_status);
+    if (status != EPS_OK || exp_status != EPS_OK)
+        return;
+
+    EP_CHECK(!strcmp(pn->obj_name, exp->obj_name), "%s of \"%s\": object \"%s\", expected \"%s\"",
+             what, name, pn->obj_name, exp->obj_name);
+    EP_CHECK(!strcmp(pn->leaf_name, exp->leaf_name), "%s of \"%s\": leaf \"%s\", expected \"%s\"",
+             what, name, pn->leaf_name, exp->leaf_name);
+    EP_CHECK(pn->partial_path == exp->partial_path && pn->last_token_type == exp->last_token_type &&
+             pn->index_num == exp->index_num && pn->index_set_num == exp->index_set_num,
+             "%s of \"%s\": partial %d, last token %d, indexes %d/%d, expected %d, %d, %d/%d",
+             what, name, pn->partial_path, pn->last_token_type, pn->index_num,
+             pn->index_set_num, exp->partial_path, exp->last_token_type, exp->index_num,
+             exp->index_set_num);
+    EP_CHECK(!memcmp(pn->indices, exp->indices, sizeof(pn->indices)),
+             "%s of \"%s\": index values differ", what, name);
+}
+
+static void test_name(const char *name)
+{
+    parsed_param_name_t exp, pn;
+    char raw[MSG_MAX_STR_LEN];
+    ep_stat_t exp_status, status;
+
+    strcpy_safe(raw, name, sizeof(raw));
+    exp_status = base_parse_param_name(raw, &exp);
+
+    /* The parsed name is written over the garbage of a previous one */
+    memset(&pn, 0x5a, sizeof(pn));
+    status = parse_param_name(name, &pn);
+    test_compare(name, "parse_param_name", status, &pn, exp_status, &exp);
+
+    memset(&pn, 0x5a, sizeof(pn));
+    status = w_parse_param_name(&g_wd, name, &pn);
+    test_compare(name, "w_parse_param_name", status, &pn, exp_status, &exp);
+}
+
+int main(void)
+{
+    static const char *names[] = {
+        "", ".", "..", "Device", "Device.", ".Device.IP.", "Device..IP..Interface.1.Status",
+        "Device.IP.Interface.{i}.", "Device.IP.Interface.{i}.IPv4Address.{i}.Enable",
+        "Device.IP.Interface.{i}", "{i}.Device.{i}.", "Device.IP.Interface.1.{i}.",
+        "Device.IP.Interface.[1-3].IPv4Address.*.IPAddress",
+        "Device.IP.Interface.*.IPv4Address.[2-4].", "Device.IP.Interface.-1.Status",
+    };
+    int segs[BASE_SEGS_NUM];
+    char name[MSG_MAX_STR_LEN];
+    int num, i, round, trailing;
+
+    for (i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++)
+        test_name(names[i]);
+
+    /* All names of 1..BASE_SEGS_NUM segments; the second round takes the
+       names that are left in the cache from it */
+    for (round = 0; round < 2; round++)
+    {
+        for (num = 1; num <= BASE_SEGS_NUM; num++)
+        {
+            memset(segs, 0, sizeof(segs));
+            while (TRUE)
+            {
+                if (test_index_segs(segs, num) <= MAX_INDECES_PER_OBJECT)
+                {
+                    for (trailing = 0; trailing < 2; trailing++)
+                    {
+                        name[0] = '\0';
+                        for (i = 0; i < num; i++)
+                        {
+                            strcat_safe(name, g_segs[segs[i]], sizeof(name));
+                            if (i < num - 1 || trailing)
+                                strcat_safe(name, ".", sizeof(name));
+                        }
+                        test_name(name);
+                    }
+                }
+
+                for (i = 0; i < num && ++segs[i] == SEGS_NUM; i++)
+                    segs[i] = 0;
+                if (i == num)
+                    break;
+            }
+        }
+    }
+
+    EP_CHECK(g_wd.pname_hits > 0, "no names taken from the cache (%lu misses)", g_wd.pname_misses);
+    w_pname_cache_free(&g_wd);
+
+    return ep_test_result("test_param_name");
+}
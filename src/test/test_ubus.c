@@ -0,0 +1,332 @@
+/* test_ubus.c
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+
+
+/*
+ * Test of the ubus GET path (w_get_values_ubus, built without libubus) over
+ * a mock transport: "ubus" found first in PATH is a script that logs each
+ * call and prints a JSON result. The parameters of an instance read by the
+ * same call must be extracted from one result, so the number of calls is
+ * the number of instances times the number of different calls
+ */
+
+#define _GNU_SOURCE
+
+#include "ep_worker.c"
+
+#include "ep_test.h"
+
+#define TEST_INSTANCES  3
+
+static worker_data_t g_wd;
+static char g_dir[] = "/tmp/ep_test_ubus.XXXXXX";
+static char g_log[sizeof(g_dir) + 8];
+
+/* network.interface.<name> status: the status of the interface;
+   network.device.<name> status: the carrier of the device, "guest" device
+   does not exist (the call fails) */
+static const char *g_ubus_script =
+    "#!/bin/sh\n"
+    "echo \"$*\" >> \"$(dirname \"$0\")/calls\"\n"
+    "name=${2#*.*.}\n"
+    "case \"$1 $2 $3\" in\n"
+    "    \"call network.interface.$name status\")\n"
+    "        printf '{ \"up\": true, \"l3_device\": \"br-%s\", \"ipv4-address\": "
+    "[ { \"address\": \"10.0.0.%s\", \"mask\": 24 } ] }\\n' \"$name\" \"${#name}\";;\n"
+    "    \"call network.device.guest status\")\n"
+    "        echo 'Command failed: Not found'; exit 4;;\n"
+    "    \"call network.device.$name status\")\n"
+    "        echo '{ \"carrier\": 1 }';;\n"
+    "    *)\n"
+    "        exit 2;;\n"
+    "esac\n";
+
+static const char *g_names[TEST_INSTANCES] = { "lan", "wan", "guest" };
+
+static obj_info_t g_obj_info = {
+    .objName = "Device.Test.Iface.{i}.",
+    .objValuesTblName = "Iface",
+};
+
+static param_info_t g_param_info[] = {
+    { .paramName = "Idx", .paramType = "int", .isIndex = TRUE, .getOperStyle = OP_STYLE_DB },
+    { .paramName = "Name", .paramType = "string", .getOperStyle = OP_STYLE_DB },
+    { .paramName = "Up", .paramType = "boolean", .getOperStyle = OP_STYLE_UBUS,
+      .getMethod = "network.interface.$$ status; Name; up" },
+    { .paramName = "Device", .paramType = "string", .getOperStyle = OP_STYLE_UBUS,
+      .getMethod = "network.interface.$$ status; Name; l3_device" },
+    { .paramName = "Address", .paramType = "string", .getOperStyle = OP_STYLE_UBUS,
+      .getMethod = "network.interface.$$ status; Name; ipv4-address/0/address" },
+    { .paramName = "Carrier", .paramType = "boolean", .getOperStyle = OP_STYLE_UBUS,
+      .getMethod = "network.device.$$ status; Name; carrier" },
+};
+
+#define TEST_PARAMS  (int)(sizeof(g_param_info) / sizeof(g_param_info[0]))
+
+static int test_setup(sqlite3 **conn)
+{
+    char path[sizeof(g_dir) + 8], env[4096];
+    FILE *f;
+    int i;
+
+    if (!mkdtemp(g_dir))
+        return -1;
+
+    snprintf(path, sizeof(path), "%s/ubus", g_dir);
+    snprintf(g_log, sizeof(g_log), "%s/calls", g_dir);
+    if ((f = fopen(path, "w")) == NULL)
+        return -1;
+    fputs(g_ubus_script, f);
+    if (fclose(f) || chmod(path, 0755))
+        return -1;
+
+    snprintf(env, sizeof(env), "%s:%s", g_dir, getenv("PATH") ? getenv("PATH") : "/bin:/usr/bin");
+    setenv("PATH", env, 1);
+    /* The values are read by the calls, not from the value cache */
+    unsetenv("MMX_EP_VALUE_CACHE_TTL");
+    unsetenv("MMX_EP_VALUE_CACHE_OBJECTS");
+
+    if (sqlite3_open(":memory:", conn) != SQLITE_OK ||
+        sqlite3_exec(*conn, "CREATE TABLE Iface ([Idx] INTEGER, [Name] TEXT)",
+                     NULL, NULL, NULL) != SQLITE_OK)
+        return -1;
+
+    for (i = 0; i < TEST_INSTANCES; i++)
+    {
+        snprintf(env, sizeof(env), "INSERT INTO Iface VALUES (%d, '%s')", i + 1, g_names[i]);
+        if (sqlite3_exec(*conn, env, NULL, NULL, NULL) != SQLITE_OK)
+            return -1;
+    }
+
+    return 0;
+}
+
+static void test_cleanup(void)
+{
+    char path[sizeof(g_dir) + 8];
+
+    snprintf(path, sizeof(path), "%s/ubus", g_dir);
+    unlink(path);
+    unlink(g_log);
+    rmdir(g_dir);
+}
+
+/* Number of logged calls with the arguments (all calls - NULL); the log is
+   truncated after each request */
+static int test_calls(const char *args)
+{
+    char line[256];
+    int num = 0;
+    FILE *f = fopen(g_log, "r");
+
+    while (f && fgets(line, sizeof(line), f))
+    {
+        line[strcspn(line, "\n")] = '\0';
+        if (!args || !strcmp(line, args))
+            num++;
+    }
+
+    if (f)
+        fclose(f);
+
+    return num;
+}
+
+static void test_reset_calls(void)
+{
+    truncate(g_log, 0);
+}
+
+static const char *test_value(ep_message_t *answer, const char *name)
+{
+    int i;
+
+    for (i = 0; i < answer->body.getParamValueResponse.arraySize; i++)
+    {
+        if (!strcmp(answer->body.getParamValueResponse.paramValues[i].name, name))
+            return answer->body.getParamValueResponse.paramValues[i].pValue;
+    }
+
+    return "(none)";
+}
+
+static void test_answer_init(ep_message_t *answer)
+{
+    w_task_init(&g_wd);
+
+    memset(answer, 0, sizeof(ep_message_t));
+    mmx_frontapi_msg_struct_init(answer, (char *)g_wd.fe_resp_values_pool,
+                                 sizeof(g_wd.fe_resp_values_pool));
+    answer->header.msgType = MSGTYPE_GETVALUE_RESP;
+    answer->header.respMode = MMX_API_RESPMODE_NORESP;
+}
+
+/* Device.Test.Iface. - all parameters of all instances */
+static void test_all_instances(ep_message_t *answer, sqlite3 *conn)
+{
+    parsed_param_name_t pn;
+    char name[NVP_MAX_NAME_LEN], args[64];
+    const char *value;
+    ep_stat_t status;
+    int i;
+
+    memset(&pn, 0, sizeof(pn));
+    strcpy(pn.obj_name, g_obj_info.objName);
+    pn.partial_path = TRUE;
+    pn.index_num = 1;
+    pn.indices[0].type = REQ_IDX_TYPE_ALL;
+
+    test_answer_init(answer);
+    test_reset_calls();
+
+    status = w_get_values_ubus(&g_wd, answer, &pn, &g_obj_info, conn, g_param_info, TEST_PARAMS);
+    EP_CHECK(status == EPS_OK, "status %d", (int)status);
+    EP_CHECK(answer->body.getParamValueResponse.arraySize == TEST_INSTANCES * 4,
+             "%d values", answer->body.getParamValueResponse.arraySize);
+
+    /* One call per instance and per method, the failed call is not repeated */
+    EP_CHECK(test_calls(NULL) == TEST_INSTANCES * 2, "%d calls", test_calls(NULL));
+    for (i = 0; i < TEST_INSTANCES; i++)
+    {
+        snprintf(args, sizeof(args), "call network.interface.%s status", g_names[i]);
+        EP_CHECK(test_calls(args) == 1, "%d calls \"%s\"", test_calls(args), args);
+        snprintf(args, sizeof(args), "call network.device.%s status", g_names[i]);
+        EP_CHECK(test_calls(args) == 1, "%d calls \"%s\"", test_calls(args), args);
+    }
+
+    for (i = 0; i < TEST_INSTANCES; i++)
+    {
+        snprintf(name, sizeof(name), "Device.Test.Iface.%d.Up", i + 1);
+        value = test_value(answer, name);
+        EP_CHECK(!strcmp(value, "true"), "%s: \"%s\"", name, value);
+
+        snprintf(name, sizeof(name), "Device.Test.Iface.%d.Device", i + 1);
+        snprintf(args, sizeof(args), "br-%s", g_names[i]);
+        value = test_value(answer, name);
+        EP_CHECK(!strcmp(value, args), "%s: \"%s\"", name, value);
+
+        snprintf(name, sizeof(name), "Device.Test.Iface.%d.Address", i + 1);
+        snprintf(args, sizeof(args), "10.0.0.%d", (int)strlen(g_names[i]));
+        value = test_value(answer, name);
+        EP_CHECK(!strcmp(value, args), "%s: \"%s\"", name, value);
+
+        snprintf(name, sizeof(name), "Device.Test.Iface.%d.Carrier", i + 1);
+        value = test_value(answer, name);
+        EP_CHECK(!strcmp(value, (i < 2) ? "true" : "false"), "%s: \"%s\"", name, value);
+    }
+}
+
+/* Device.Test.Iface.2.Address - one call for the instance */
+static void test_one_param(ep_message_t *answer, sqlite3 *conn)
+{
+    parsed_param_name_t pn;
+    const char *value;
+    ep_stat_t status;
+
+    memset(&pn, 0, sizeof(pn));
+    strcpy(pn.obj_name, g_obj_info.objName);
+    strcpy(pn.leaf_name, "Address");
+    pn.index_num = 1;
+    pn.indices[0].type = REQ_IDX_TYPE_EXACT;
+    pn.indices[0].exact_val.num = 2;
+
+    test_answer_init(answer);
+    test_reset_calls();
+
+    status = w_get_values_ubus(&g_wd, answer, &pn, &g_obj_info, conn, g_param_info, TEST_PARAMS);
+    EP_CHECK(status == EPS_OK, "status %d", (int)status);
+    EP_CHECK(answer->body.getParamValueResponse.arraySize == 1,
+             "%d values", answer->body.getParamValueResponse.arraySize);
+    EP_CHECK(test_calls(NULL) == 1 && test_calls("call network.interface.wan status") == 1,
+             "%d calls", test_calls(NULL));
+
+    value = test_value(answer, "Device.Test.Iface.2.Address");
+    EP_CHECK(!strcmp(value, "10.0.0.3"), "value \"%s\"", value);
+}
+
+int main(void)
+{
+    ep_message_t *answer = calloc(1, sizeof(ep_message_t));
+    sqlite3 *conn = NULL;
+
+    if (!answer || test_setup(&conn) != 0)
+    {
+        perror("setup");
+        test_cleanup();
+        return 1;
+    }
+
+    test_all_instances(answer, conn);
+    test_one_param(answer, conn);
+
+    sqlite3_close(conn);
+    test_cleanup();
+    free(answer);
+
+    return ep_test_result("test_ubus");
+}
@@ -0,0 +1,230 @@
+/* test_uci.c
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+
+
+/*
+ * Test of the UCI access layer (ep_uci.c, built with CONFIG_WITH_LIBUCI=y)
+ * over a temporary UCI config directory and changes directory (see
+ * MMX_EP_UCI_CONFDIR and MMX_EP_UCI_SAVEDIR): gets of the loaded package,
+ * sets served from it, rollback to a mark, one commit of the changed
+ * packages, and reload of the configs by the next request
+ */
+
+#define _GNU_SOURCE
+
+#include <unistd.h>
+
+#include "ep_uci.h"
+#include "ep_test.h"
+
+static char g_confdir[] = "/tmp/ep_test_uci.XXXXXX";
+static char g_savedir[sizeof(g_confdir) + 8];
+
+static int test_write_config(const char *package, const char *text)
+{
+    char path[256];
+    FILE *f;
+
+    snprintf(path, sizeof(path), "%s/%s", g_confdir, package);
+    if ((f = fopen(path, "w")) == NULL)
+        return -1;
+
+    fputs(text, f);
+    return fclose(f);
+}
+
+/* Value of the path read by a new UCI object (as by the next request) */
+static const char *test_reload(const char *path)
+{
+    static char value[256];
+    ep_uci_t *uci = ep_uci_create();
+
+    if (!uci || ep_uci_get(uci, path, value, sizeof(value)) != EPS_OK)
+        strcpy(value, "(none)");
+
+    ep_uci_destroy(uci);
+    return value;
+}
+
+static void test_get(ep_uci_t *uci)
+{
+    char value[256];
+
+    EP_CHECK(ep_uci_get(uci, "network.lan.ipaddr", value, sizeof(value)) == EPS_OK &&
+             !strcmp(value, "192.168.1.1"), "option: \"%s\"", value);
+    EP_CHECK(ep_uci_get(uci, "network.lan", value, sizeof(value)) == EPS_OK &&
+             !strcmp(value, "interface"), "section type: \"%s\"", value);
+    EP_CHECK(ep_uci_get(uci, "network.@device[1].name", value, sizeof(value)) == EPS_OK &&
+             !strcmp(value, "eth1"), "anonymous section: \"%s\"", value);
+    EP_CHECK(ep_uci_get(uci, " network.lan.dns ", value, sizeof(value)) == EPS_OK &&
+             !strcmp(value, "8.8.8.8 1.1.1.1"), "list: \"%s\"", value);
+    EP_CHECK(ep_uci_get(uci, "network.lan.mtu", value, sizeof(value)) == EPS_NOT_FOUND &&
+             value[0] == '\0', "missing option: \"%s\"", value);
+    EP_CHECK(ep_uci_get(uci, "network.wan.proto", value, sizeof(value)) == EPS_NOT_FOUND,
+             "option of missing section");
+    EP_CHECK(ep_uci_get(uci, "nosuchpkg.lan.proto", value, sizeof(value)) == EPS_INVALID_ARGUMENT,
+             "missing package");
+    EP_CHECK(ep_uci_get(uci, "network.lan.ipaddr", value, 4) == EPS_OK && !strcmp(value, "192"),
+             "value truncated to its buffer: \"%s\"", value);
+}
+
+static void test_set(ep_uci_t *uci)
+{
+    char value[256];
+    int mark;
+
+    EP_CHECK(ep_uci_set(uci, "network.lan.ipaddr", "10.0.0.1") == EPS_OK, "set");
+    EP_CHECK(ep_uci_get(uci, "network.lan.ipaddr", value, sizeof(value)) == EPS_OK &&
+             !strcmp(value, "10.0.0.1"), "set value is got before commit: \"%s\"", value);
+    EP_CHECK(!strcmp(test_reload("network.lan.ipaddr"), "192.168.1.1"),
+             "set value is not seen by others before commit");
+
+    /* Failed object of a request: its changes are rolled back */
+    mark = ep_uci_mark(uci);
+    EP_CHECK(ep_uci_set(uci, "network.lan.netmask", "255.0.0.0") == EPS_OK, "set 2");
+    EP_CHECK(ep_uci_set(uci, "network.lan.mtu", "1400") == EPS_OK, "set of new option");
+    EP_CHECK(ep_uci_set(uci, "system.main.hostname", "test") == EPS_OK, "set of 2nd package");
+    ep_uci_rollback(uci, mark);
+
+    EP_CHECK(ep_uci_get(uci, "network.lan.netmask", value, sizeof(value)) == EPS_OK &&
+             !strcmp(value, "255.255.255.0"), "rolled back value: \"%s\"", value);
+    EP_CHECK(ep_uci_get(uci, "network.lan.mtu", value, sizeof(value)) == EPS_NOT_FOUND,
+             "rolled back new option: \"%s\"", value);
+    EP_CHECK(ep_uci_get(uci, "network.lan.ipaddr", value, sizeof(value)) == EPS_OK &&
+             !strcmp(value, "10.0.0.1"), "value set before the mark: \"%s\"", value);
+
+    EP_CHECK(ep_uci_set(uci, "system.main.timezone", "UTC") == EPS_OK, "set 3");
+    EP_CHECK(ep_uci_set(uci, "network.nosuchsection.proto", "dhcp") != EPS_OK,
+             "set of missing section");
+
+    EP_CHECK(ep_uci_commit(uci) == EPS_OK, "commit");
+    EP_CHECK(!strcmp(test_reload("network.lan.ipaddr"), "10.0.0.1"), "committed value");
+    EP_CHECK(!strcmp(test_reload("system.main.timezone"), "UTC"), "committed 2nd package");
+    EP_CHECK(!strcmp(test_reload("system.main.hostname"), "gw"), "rolled back 2nd package");
+    EP_CHECK(!strcmp(test_reload("network.lan.dns"), "8.8.8.8 1.1.1.1"), "list kept");
+}
+
+int main(void)
+{
+    char value[256];
+    ep_uci_t *uci;
+
+    if (!mkdtemp(g_confdir))
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(g_savedir, sizeof(g_savedir), "%s/.save", g_confdir);
+    mkdir(g_savedir, 0700);
+    setenv("MMX_EP_UCI_CONFDIR", g_confdir, 1);
+    setenv("MMX_EP_UCI_SAVEDIR", g_savedir, 1);
+
+    if (test_write_config("network",
+            "config interface 'lan'\n"
+            "\toption proto 'static'\n"
+            "\toption ipaddr '192.168.1.1'\n"
+            "\toption netmask '255.255.255.0'\n"
+            "\tlist dns '8.8.8.8'\n"
+            "\tlist dns '1.1.1.1'\n"
+            "\n"
+            "config device\n"
+            "\toption name 'eth0'\n"
+            "\n"
+            "config device\n"
+            "\toption name 'eth1'\n") < 0 ||
+        test_write_config("system",
+            "config system 'main'\n"
+            "\toption hostname 'gw'\n") < 0 ||
+        (uci = ep_uci_create()) == NULL)
+    {
+        perror("config");
+        return 1;
+    }
+
+    test_get(uci);
+    test_set(uci);
+
+    /* The next request reads the current configs */
+    ep_uci_reset(uci);
+    test_write_config("system", "config system 'main'\n\toption hostname 'changed'\n");
+    EP_CHECK(ep_uci_get(uci, "system.main.hostname", value, sizeof(value)) == EPS_OK &&
+             !strcmp(value, "changed"), "config changed between requests: \"%s\"", value);
+
+    /* Changes that are not committed are dropped */
+    EP_CHECK(ep_uci_set(uci, "system.main.hostname", "lost") == EPS_OK, "set 4");
+    ep_uci_reset(uci);
+    EP_CHECK(!strcmp(test_reload("system.main.hostname"), "changed"), "not committed value");
+
+    ep_uci_destroy(uci);
+
+    snprintf(value, sizeof(value), "rm -rf '%s'", g_confdir);
+    if (system(value) != 0)
+        fprintf(stderr, "Could not remove %s\n", g_confdir);
+
+    return ep_test_result("test_uci");
+}
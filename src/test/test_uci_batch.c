@@ -0,0 +1,322 @@
+/* test_uci_batch.c
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+
+
+/*
+ * Test of the uci batch of a SET request (built without libuci) over a
+ * mock "uci" found first in PATH: it saves the input of each "uci batch"
+ * run and reports the "set" commands of the options named "bad*" failed.
+ * The parameters before the failed one are committed, its changes and the
+ * changes of the following parameters are reverted; their values DB
+ * changes are rolled back and their backends are not restarted
+ */
+
+#define _GNU_SOURCE
+
+#include "ep_worker.c"
+
+#include "ep_test.h"
+
+static worker_data_t g_wd;
+static sqlite3 *g_conn;
+static char g_dir[] = "/tmp/ep_test_uci_batch.XXXXXX";
+
+static const char *g_uci_script =
+    "#!/bin/sh\n"
+    "dir=$(dirname \"$0\")\n"
+    "[ -f \"$dir/broken\" ] && exit 1\n"
+    "n=$(ls \"$dir\" | grep -c '^run')\n"
+    "cat > \"$dir/run$n\"\n"
+    "while read -r cmd arg; do\n"
+    "    case \"$cmd $arg\" in\n"
+    "        \"set \"*.bad*) echo \"uci: Invalid argument\" >&2;;\n"
+    "        \"mmx-ep-next-param \") echo \"Unknown command\" >&2;;\n"
+    "    esac\n"
+    "done < \"$dir/run$n\"\n";
+
+static int test_setup(void)
+{
+    char path[sizeof(g_dir) + 8], env[4096];
+    FILE *f;
+
+    if (!mkdtemp(g_dir))
+        return -1;
+
+    snprintf(path, sizeof(path), "%s/uci", g_dir);
+    if ((f = fopen(path, "w")) == NULL)
+        return -1;
+    fputs(g_uci_script, f);
+    if (fclose(f) || chmod(path, 0755))
+        return -1;
+
+    snprintf(env, sizeof(env), "%s:%s", g_dir, getenv("PATH") ? getenv("PATH") : "/bin:/usr/bin");
+    setenv("PATH", env, 1);
+
+    if (sqlite3_open(":memory:", &g_conn) != SQLITE_OK ||
+        sqlite3_exec(g_conn, "CREATE TABLE t ([Idx] INTEGER, [Value] TEXT);"
+                     "INSERT INTO t VALUES (0, 'old'), (1, 'old'), (2, 'old')",
+                     NULL, NULL, NULL) != SQLITE_OK)
+        return -1;
+
+    return 0;
+}
+
+/* Removes the saved runs and the "broken" mark */
+static void test_clean_dir(void)
+{
+    char path[sizeof(g_dir) + 16];
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        snprintf(path, sizeof(path), "%s/run%d", g_dir, i);
+        unlink(path);
+    }
+    snprintf(path, sizeof(path), "%s/broken", g_dir);
+    unlink(path);
+}
+
+static void test_cleanup(void)
+{
+    char path[sizeof(g_dir) + 8];
+
+    test_clean_dir();
+    snprintf(path, sizeof(path), "%s/uci", g_dir);
+    unlink(path);
+    rmdir(g_dir);
+}
+
+/* Input of the n-th "uci batch" run, "(none)" - there was no such run */
+static const char *test_run(int n)
+{
+    static char text[1024];
+    char path[sizeof(g_dir) + 16];
+    size_t len = 0;
+    FILE *f;
+
+    snprintf(path, sizeof(path), "%s/run%d", g_dir, n);
+    if ((f = fopen(path, "r")) == NULL)
+        return "(none)";
+
+    len = fread(text, 1, sizeof(text) - 1, f);
+    text[len] = '\0';
+    fclose(f);
+
+    return text;
+}
+
+static const char *test_db_value(int idx)
+{
+    static char value[64];
+    sqlite3_stmt *stmt = NULL;
+
+    strcpy(value, "(none)");
+    if (sqlite3_prepare_v2(g_conn, "SELECT [Value] FROM t WHERE [Idx]=?", -1, &stmt, NULL) == SQLITE_OK &&
+        sqlite3_bind_int(stmt, 1, idx) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW)
+        snprintf(value, sizeof(value), "%s", (const char *)sqlite3_column_text(stmt, 0));
+
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+/* Parameter "tag" of the request: its option is set, its value is written
+   to the values DB under its savepoint; the parameter requires restart of
+   backend "tag" */
+static void test_set_param(const char *path, int tag, int uci_restart[])
+{
+    char query[128];
+
+    EP_CHECK(w_uci_savepoint(g_conn, "SAVEPOINT", tag) == EPS_OK, "savepoint %d", tag);
+    EP_CHECK(w_uci_set(&g_wd, path, "new") == EPS_OK, "set %s", path);
+    w_uci_end_param(&g_wd, tag);
+
+    snprintf(query, sizeof(query), "UPDATE t SET [Value]='new' WHERE [Idx]=%d", tag);
+    EP_CHECK(sqlite3_exec(g_conn, query, NULL, NULL, NULL) == SQLITE_OK, "%s", query);
+
+    uci_restart[tag] = tag;
+}
+
+/* Sets the options of the parameters, the n-th one to path[n] and commits
+   them; returns position of the failed parameter */
+static int test_request(const char *paths[], int num, int restart_be[])
+{
+    int uci_restart[MAX_BACKEND_NUM], i, failed = -2;
+    w_uci_objs_t objs = {0};
+    ep_stat_t status;
+
+    for (i = 0; i < MAX_BACKEND_NUM; i++)
+    {
+        uci_restart[i] = -1;
+        restart_be[i] = FALSE;
+    }
+
+    sqlite3_exec(g_conn, "UPDATE t SET [Value]='old'", NULL, NULL, NULL);
+    for (i = 0; i < num; i++)
+        test_set_param(paths[i], i, uci_restart);
+
+    status = w_uci_commit_params(&g_wd, g_conn, 0, &objs, uci_restart, restart_be, &failed);
+    EP_CHECK((status == EPS_OK) == (failed < 0), "status %d, failed %d", (int)status, failed);
+    EP_CHECK(sqlite3_get_autocommit(g_conn), "savepoints are released");
+
+    return failed;
+}
+
+static void test_all_committed(void)
+{
+    const char *paths[] = { "network.lan.ipaddr", "wireless.radio0.channel", "network.wan.proto" };
+    int restart_be[MAX_BACKEND_NUM];
+
+    test_clean_dir();
+    EP_CHECK(test_request(paths, 3, restart_be) == -1, "no parameter failed");
+    EP_CHECK(!strcmp(test_run(0), "set network.lan.ipaddr='new'\nmmx-ep-next-param\n"
+                                  "set wireless.radio0.channel='new'\nmmx-ep-next-param\n"
+                                  "set network.wan.proto='new'\nmmx-ep-next-param\n"),
+             "commands:\n%s", test_run(0));
+    EP_CHECK(!strcmp(test_run(1), "commit network\ncommit wireless\n"), "commits:\n%s", test_run(1));
+    EP_CHECK(!strcmp(test_run(2), "(none)"), "third run:\n%s", test_run(2));
+    EP_CHECK(!strcmp(test_db_value(0), "new") && !strcmp(test_db_value(2), "new"), "DB values kept");
+    EP_CHECK(restart_be[0] && restart_be[1] && restart_be[2], "backends restarted");
+}
+
+static void test_second_failed(void)
+{
+    const char *paths[] = { "network.lan.ipaddr", "wireless.bad.channel", "network.wan.proto" };
+    int restart_be[MAX_BACKEND_NUM];
+    int failed;
+
+    test_clean_dir();
+    failed = test_request(paths, 3, restart_be);
+    EP_CHECK(failed == 1, "failed parameter %d", failed);
+    EP_CHECK(!strcmp(test_run(1), "revert network\nrevert wireless\n"
+                                  "set network.lan.ipaddr='new'\nmmx-ep-next-param\n"
+                                  "commit network\ncommit wireless\n"),
+             "revert and commit:\n%s", test_run(1));
+    EP_CHECK(!strcmp(test_db_value(0), "new"), "DB value of the committed parameter: %s",
+             test_db_value(0));
+    EP_CHECK(!strcmp(test_db_value(1), "old") && !strcmp(test_db_value(2), "old"),
+             "DB values of the failed and next parameters: %s, %s",
+             test_db_value(1), test_db_value(2));
+    EP_CHECK(restart_be[0] && !restart_be[1] && !restart_be[2], "restarted backends: %d %d %d",
+             restart_be[0], restart_be[1], restart_be[2]);
+}
+
+static void test_first_failed(void)
+{
+    const char *paths[] = { "network.bad.ipaddr", "network.wan.proto" };
+    int restart_be[MAX_BACKEND_NUM];
+    int failed;
+
+    test_clean_dir();
+    failed = test_request(paths, 2, restart_be);
+    EP_CHECK(failed == 0, "failed parameter %d", failed);
+    EP_CHECK(!strcmp(test_run(1), "revert network\n"), "revert:\n%s", test_run(1));
+    EP_CHECK(!strcmp(test_db_value(0), "old") && !strcmp(test_db_value(1), "old"),
+             "DB values rolled back");
+    EP_CHECK(!restart_be[0] && !restart_be[1], "no backend restarted");
+}
+
+static void test_not_run(void)
+{
+    const char *paths[] = { "network.lan.ipaddr", "network.wan.proto" };
+    char path[sizeof(g_dir) + 16];
+    int restart_be[MAX_BACKEND_NUM];
+    int failed;
+    FILE *f;
+
+    test_clean_dir();
+    snprintf(path, sizeof(path), "%s/broken", g_dir);
+    if ((f = fopen(path, "w")) != NULL)
+        fclose(f);
+
+    failed = test_request(paths, 2, restart_be);
+    EP_CHECK(failed == 0, "failed parameter %d", failed);
+    EP_CHECK(!strcmp(test_db_value(0), "old") && !strcmp(test_db_value(1), "old"),
+             "DB values rolled back");
+    EP_CHECK(!restart_be[0] && !restart_be[1], "no backend restarted");
+}
+
+int main(void)
+{
+    if (test_setup() != 0)
+    {
+        perror("setup");
+        test_cleanup();
+        return 1;
+    }
+
+    test_all_committed();
+    test_second_failed();
+    test_first_failed();
+    test_not_run();
+
+    sqlite3_close(g_conn);
+    test_cleanup();
+    w_uci_batch_free(&g_wd.uci_batch);
+
+    return ep_test_result("test_uci_batch");
+}
@@ -0,0 +1,215 @@
+/* test_worker_buffers.c
+ *
+ * Copyright (c) 2013-2021 Inango Systems LTD.
+ *
+ * Author: Inango Systems LTD. <support@inango-systems.com>
+ * Creation Date: May 2013
+ *
+ * The author may be reached at support@inango-systems.com
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * Subject to the terms and conditions of this license, each copyright holder
+ * and contributor hereby grants to those receiving rights under this license
+ * a perpetual, worldwide, non-exclusive, no-charge, royalty-free, irrevocable
+ * (except for failure to satisfy the conditions of this license) patent license
+ * to make, have made, use, offer to sell, sell, import, and otherwise transfer
+ * this software, where such license applies only to those patent claims, already
+ * acquired or hereafter acquired, licensable by such copyright holder or contributor
+ * that are necessarily infringed by:
+ *
+ * (a) their Contribution(s) (the licensed copyrights of copyright holders and
+ * non-copyrightable additions of contributors, in source or binary form) alone;
+ * or
+ *
+ * (b) combination of their Contribution(s) with the work of authorship to which
+ * such Contribution(s) was added by such copyright holder or contributor, if,
+ * at the time the Contribution is added, such addition causes such combination
+ * to be necessarily infringed. The patent license shall not apply to any other
+ * combinations which include the Contribution.
+ *
+ * Except as expressly stated above, no rights or licenses from any copyright
+ * holder or contributor is granted under this license, whether expressly, by
+ * implication, estoppel or otherwise.
+ *
+ * DISCLAIMER
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * NOTE
+ *
+ * This is part of a management middleware software package called MMX that was developed by Inango Systems Ltd.
+ *
+ * This version of MMX provides web and command-line management interfaces.
+ *
+ * Please contact us at Inango at support@inango-systems.com if you would like to hear more about
+ * - other management packages, such as SNMP, TR-069 or Netconf
+ * - how we can extend the data model to support all parts of your system
+ * - professional sub-contract and customization services
+ */
+
+
+
+/*
+ * Test of the lazy clearing of the worker buffers (w_task_init clears only
+ * the parts used by the previous task). A large GetParameterValues answer
+ * (several portions sent with moreFlag, each one filling the response
+ * pool anew) is followed by a small one on the same worker: the small
+ * answer must not see the data of the large one, and every buffer must be
+ * all zeros after each w_task_init
+ */
+
+#include "ep_worker.c"
+
+#include "ep_test.h"
+
+#define TEST_LARGE_PARAMS  400
+#define TEST_VALUE_LEN     200
+
+static worker_data_t g_wd;
+
+static BOOL test_zeros(const char *buf, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        if (buf[i])
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void test_check_cleared(const char *when)
+{
+    EP_CHECK(test_zeros(g_wd.answer_buf, sizeof(g_wd.answer_buf)), "answer buffer %s", when);
+    EP_CHECK(test_zeros(g_wd.fe_req_values_pool, sizeof(g_wd.fe_req_values_pool)),
+             "request pool %s", when);
+    EP_CHECK(test_zeros(g_wd.fe_resp_values_pool, sizeof(g_wd.fe_resp_values_pool)),
+             "response pool %s", when);
+    EP_CHECK(test_zeros(g_wd.be_req_values_pool, sizeof(g_wd.be_req_values_pool)),
+             "backend pool %s", when);
+}
+
+/* Fills GetParameterValues answer of "num" parameters as the GET handler
+   does (the portions that are full are sent on the way) */
+static void test_fill_answer(ep_message_t *answer, int rx, int num, char fill)
+{
+    char name[MSG_MAX_STR_LEN], value[TEST_VALUE_LEN + 1];
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int i;
+
+    getsockname(rx, (struct sockaddr *)&addr, &addr_len);
+
+    memset(answer, 0, sizeof(ep_message_t));
+    mmx_frontapi_msg_struct_init(answer, (char *)g_wd.fe_resp_values_pool,
+                                 sizeof(g_wd.fe_resp_values_pool));
+    answer->header.msgType = MSGTYPE_GETVALUE_RESP;
+    answer->header.respMode = MMX_API_RESPMODE_NORESP + 1;   /* response is sent */
+    answer->header.respIpAddr = addr.sin_addr.s_addr;
+    answer->header.respPort = ntohs(addr.sin_port);
+
+    memset(value, fill, TEST_VALUE_LEN);
+    value[TEST_VALUE_LEN] = '\0';
+
+    for (i = 0; i < num; i++)
+    {
+        snprintf(name, sizeof(name), "Device.Test.Table.%d.Value", i + 1);
+        EP_CHECK(w_insert_nvpair_to_answer(&g_wd, answer, name, value) == EPS_OK,
+                 "parameter %d is not inserted", i + 1);
+    }
+}
+
+/* Sends the last portion of the answer; returns number of the portions
+   received */
+static int test_send_answer(ep_message_t *answer, int rx)
+{
+    char pkt[MAX_MMX_EP_ANSWER_LEN];
+    int portions = 0;
+
+    w_send_answer(&g_wd, answer);
+
+    while (recv(rx, pkt, sizeof(pkt), MSG_DONTWAIT) > 0)
+        portions++;
+
+    return portions;
+}
+
+int main(void)
+{
+    ep_message_t *answer = calloc(1, sizeof(ep_message_t));
+    nvpair_t *nv;
+    struct sockaddr_in addr;
+    size_t used;
+    int rx, portions;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    rx = socket(AF_INET, SOCK_DGRAM, 0);
+    g_wd.udp_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (!answer || rx < 0 || g_wd.udp_sock < 0 ||
+        bind(rx, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        perror("socket");
+        return 1;
+    }
+
+    w_task_init(&g_wd);
+    test_check_cleared("before the first task");
+
+    /* Large request: the response pool is filled and reused by portions */
+    test_fill_answer(answer, rx, TEST_LARGE_PARAMS, 'L');
+    portions = test_send_answer(answer, rx);
+    EP_CHECK(portions > 1, "%d portion(s) of the large answer", portions);
+    EP_CHECK(g_wd.fe_resp_used > sizeof(g_wd.fe_resp_values_pool) / 2,
+             "response pool mark %lu after the large answer", (unsigned long)g_wd.fe_resp_used);
+
+    w_task_init(&g_wd);
+    test_check_cleared("after the large task");
+
+    /* Small request on the same worker */
+    test_fill_answer(answer, rx, 1, 's');
+    nv = &answer->body.getParamValueResponse.paramValues[0];
+    EP_CHECK(answer->body.getParamValueResponse.arraySize == 1 && nv->pValue &&
+             strlen(nv->pValue) == TEST_VALUE_LEN && !strchr(nv->pValue, 'L'),
+             "value of the small answer");
+    EP_CHECK(test_zeros(g_wd.fe_resp_values_pool + answer->mem_pool.curr_offset,
+                        sizeof(g_wd.fe_resp_values_pool) - answer->mem_pool.curr_offset),
+             "response pool past the small answer");
+
+    used = answer->mem_pool.curr_offset;
+    portions = test_send_answer(answer, rx);
+    EP_CHECK(portions == 1, "%d portion(s) of the small answer", portions);
+    EP_CHECK(g_wd.fe_resp_used == used, "response pool mark %lu, %lu used",
+             (unsigned long)g_wd.fe_resp_used, (unsigned long)used);
+
+    w_task_init(&g_wd);
+    test_check_cleared("after the small task");
+
+    close(g_wd.udp_sock);
+    close(rx);
+    free(answer);
+
+    return ep_test_result("test_worker_buffers");
+}